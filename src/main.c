@@ -21,6 +21,7 @@
 
 #include <surgescript.h>
 #include <string.h>
+#include <stdlib.h>
 #include <stdio.h>
 
 static surgescript_vm_t* make_vm(int argc, char** argv);
@@ -65,6 +66,9 @@ int main(int argc, char* argv[])
 surgescript_vm_t* make_vm(int argc, char** argv)
 {
     surgescript_vm_t* vm = NULL;
+    int optimization_level = SSPARSER_DEFAULT_OPTIMIZATION_LEVEL;
+    const char* cache_directory = NULL;
+    int update_threads = 1;
     int i;
 
     /* disable debugging */
@@ -82,6 +86,31 @@ surgescript_vm_t* make_vm(int argc, char** argv)
             printf("%s\n", surgescript_util_version());
             return NULL;
         }
+        else if(strcmp(arg, "--opt-level") == 0 || strcmp(arg, "-O") == 0) {
+            /* set the optimization level */
+            const char* level = (i + 1 < argc) ? argv[++i] : "";
+            if(!(level[0] >= '0' && level[0] <= '2' && level[1] == '\0')) {
+                printf("Invalid optimization level: '%s'. Expected 0, 1 or 2.\n", level);
+                return NULL;
+            }
+            optimization_level = atoi(level);
+        }
+        else if(strcmp(arg, "--cache-dir") == 0) {
+            /* enable the bytecode cache */
+            if(i + 1 >= argc) {
+                printf("Missing directory after '%s'.\n", arg);
+                return NULL;
+            }
+            cache_directory = argv[++i];
+        }
+        else if(strcmp(arg, "--threads") == 0 || strcmp(arg, "-j") == 0) {
+            /* update the children of the parallel objects on many threads */
+            const char* threads = (i + 1 < argc) ? argv[++i] : "";
+            if((update_threads = atoi(threads)) < 1) {
+                printf("Invalid number of threads: '%s'. Expected a positive integer.\n", threads);
+                return NULL;
+            }
+        }
         else if(strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
             /* show help */
             show_help(surgescript_util_basename(argv[0]));
@@ -95,6 +124,9 @@ surgescript_vm_t* make_vm(int argc, char** argv)
 
     /* create an empty VM */
     vm = surgescript_vm_create();
+    surgescript_parser_set_optimization_level(surgescript_vm_parser(vm), optimization_level);
+    surgescript_parser_set_cache_directory(surgescript_vm_parser(vm), cache_directory);
+    surgescript_vm_set_update_threads(vm, update_threads);
 
     /* compile the scripts */
     for(; i < argc && strcmp(argv[i], "--") != 0; i++) {
@@ -126,6 +158,9 @@ void show_help(const char* executable)
         "Options:\n"
         "    -v, --version                         shows the version of SurgeScript\n"
         "    -D, --debug                           prints debugging information\n"
+        "    -O, --opt-level <n>                   sets the optimization level: 0, 1 or 2 (default)\n"
+        "    --cache-dir <directory>               caches the compiled scripts in the given directory\n"
+        "    -j, --threads <n>                     updates the children of @Parallel objects on n threads\n"
         "    -h, --help                            shows this message\n"
         "\n"
         "Examples:\n"
@@ -61,26 +61,16 @@
 #define T3                              U(3)
 #define BREAKPOINT(str)                 emit_breakpoint(context, (str))
 
+/* expression temporaries */
+static void emit_savetmp(surgescript_nodecontext_t context);
+static void emit_loadtmp(surgescript_nodecontext_t context, unsigned k);
 
-/* objects */
-void emit_object_header(surgescript_nodecontext_t context, surgescript_program_label_t start, surgescript_program_label_t end)
-{
-    SSASM(SSOP_JMP, U(end));
-    LABEL(start);
-}
 
-void emit_object_footer(surgescript_nodecontext_t context, surgescript_program_label_t start, surgescript_program_label_t end)
+/* objects */
+void emit_object_footer(surgescript_nodecontext_t context)
 {
-    surgescript_program_label_t aloc = NEWLABEL();
-
+    /* the fields are allocated when the object is spawned (see the heap layout) */
     SSASM(SSOP_RET);
-    LABEL(end);
-        SSASM(SSOP_MOVX, T2, U(surgescript_symtable_local_count(context.symtable)));
-        LABEL(aloc);
-            SSASM(SSOP_JE, U(start));
-            SSASM(SSOP_ALLOC);
-            SSASM(SSOP_DEC, T2);
-            SSASM(SSOP_JMP, U(aloc));
 }
 
 /* declarations */
@@ -91,6 +81,47 @@ void emit_vardecl(surgescript_nodecontext_t context, const char* identifier)
     surgescript_symtable_emit_write(context.symtable, identifier, context.program, 0);
 }
 
+/* declares a new field initialized with a constant: the code emitted since first_line,
+   which loads the constant, is discarded and the constant is written to value.
+   Returns false (and does nothing) if the code doesn't just load a constant */
+bool emit_constdecl(surgescript_nodecontext_t context, const char* identifier, int first_line, surgescript_var_t* value)
+{
+    surgescript_program_operator_t op;
+    surgescript_program_operand_t a, b;
+
+    if(surgescript_program_line_count(context.program) != first_line + 1)
+        return false;
+
+    surgescript_program_read_line(context.program, first_line, &op, &a, &b);
+    if(a.u != 0) /* t[0] = constant */
+        return false;
+
+    switch(op) {
+        case SSOP_MOVN:
+            surgescript_var_set_null(value);
+            break;
+
+        case SSOP_MOVB:
+            surgescript_var_set_bool(value, b.b);
+            break;
+
+        case SSOP_MOVF:
+            surgescript_var_set_number(value, b.f);
+            break;
+
+        case SSOP_MOVS:
+            surgescript_var_set_string(value, surgescript_program_get_text(context.program, b.u));
+            break;
+
+        default:
+            return false;
+    }
+
+    surgescript_program_chg_line(context.program, first_line, SSOP_NOP, SSOP(), SSOP());
+    surgescript_symtable_put_heap_symbol(context.symtable, identifier, (surgescript_heapptr_t)surgescript_symtable_local_count(context.symtable));
+    return true;
+}
+
 void emit_vargetter(surgescript_nodecontext_t context, const char* identifier)
 {
     surgescript_symtable_emit_read(context.symtable, identifier, context.program, 0);
@@ -209,14 +240,14 @@ void emit_logicalandexpr2(surgescript_nodecontext_t context, surgescript_program
 
 void emit_equalityexpr1(surgescript_nodecontext_t context)
 {
-    SSASM(SSOP_PUSH, T0);
+    emit_savetmp(context);
 }
 
 void emit_equalityexpr2(surgescript_nodecontext_t context, const char* equalityop)
 {
     surgescript_program_label_t done = NEWLABEL();
 
-    SSASM(SSOP_POP, T1);
+    emit_loadtmp(context, 1);
     if(strcmp(equalityop, "==") == 0) {
         SSASM(SSOP_CMP, T1, T0);
         SSASM(SSOP_LNOT, T0, T2);
@@ -250,14 +281,14 @@ void emit_equalityexpr2(surgescript_nodecontext_t context, const char* equalityo
 
 void emit_relationalexpr1(surgescript_nodecontext_t context)
 {
-    SSASM(SSOP_PUSH, T0);
+    emit_savetmp(context);
 }
 
 void emit_relationalexpr2(surgescript_nodecontext_t context, const char* relationalop)
 {
     surgescript_program_label_t done = NEWLABEL();
 
-    SSASM(SSOP_POP, T1);
+    emit_loadtmp(context, 1);
     SSASM(SSOP_CMP, T1, T0);
     SSASM(SSOP_MOVB, T0, B(true));
     if(strcmp(relationalop, ">=") == 0) {
@@ -281,12 +312,12 @@ void emit_relationalexpr2(surgescript_nodecontext_t context, const char* relatio
 
 void emit_additiveexpr1(surgescript_nodecontext_t context)
 {
-    SSASM(SSOP_PUSH, T0);
+    emit_savetmp(context);
 }
 
 void emit_additiveexpr2(surgescript_nodecontext_t context, const char* additiveop)
 {
-    SSASM(SSOP_POP, T1);
+    emit_loadtmp(context, 1);
     switch(*additiveop) {
         case '+': {
             surgescript_program_label_t cat = NEWLABEL();
@@ -319,12 +350,12 @@ void emit_additiveexpr2(surgescript_nodecontext_t context, const char* additiveo
 
 void emit_multiplicativeexpr1(surgescript_nodecontext_t context)
 {
-    SSASM(SSOP_PUSH, T0);
+    emit_savetmp(context);
 }
 
 void emit_multiplicativeexpr2(surgescript_nodecontext_t context, const char* multiplicativeop)
 {
-    SSASM(SSOP_POP, T1);
+    emit_loadtmp(context, 1);
     switch(*multiplicativeop) {
         case '*':
             SSASM(SSOP_MUL, T0, T1);
@@ -543,9 +574,7 @@ void emit_getter(surgescript_nodecontext_t context, const char* property_name)
 {
     char* getter_name = surgescript_util_accessorfun("get", property_name);
 
-    SSASM(SSOP_PUSH, T0); /* object pointer */
-    SSASM(SSOP_CALL, TEXT(getter_name), U(0));
-    SSASM(SSOP_POPN, U(1));
+    SSASM(SSOP_GETFIELD, TEXT(getter_name)); /* t0 = t0.getter_name() */
 
     ssfree(getter_name);
 }
@@ -555,7 +584,7 @@ void emit_setter1(surgescript_nodecontext_t context, const char* property_name)
     char* getter_name = surgescript_util_accessorfun("get", property_name); /* get the value first */
 
     SSASM(SSOP_PUSH, T0); /* object pointer */
-    SSASM(SSOP_CALL, TEXT(getter_name), U(0));
+    SSASM(SSOP_GETFIELD, TEXT(getter_name));
     SSASM(SSOP_PUSH, T0); /* push object.property_name */
 
     ssfree(getter_name);
@@ -571,9 +600,8 @@ void emit_setter2(surgescript_nodecontext_t context, const char* property_name,
     /* now, t1 = <assignexpr> and t0 = object.property_name */
     switch(*assignop) {
         case '=': /* object.property_name = <assignexpr> */
-            SSASM(SSOP_PUSH, T1); /* push <assignexpr> */
-            SSASM(SSOP_CALL, TEXT(setter_name), U(1));
-            SSASM(SSOP_POP, T0); /* return <assignexpr> */
+            SSASM(SSOP_MOV, T0, T1); /* return <assignexpr> */
+            SSASM(SSOP_SETFIELD, TEXT(setter_name));
             SSASM(SSOP_POPN, U(1)); /* pop object pointer */
             break;
 
@@ -594,34 +622,26 @@ void emit_setter2(surgescript_nodecontext_t context, const char* property_name,
             SSASM(SSOP_POPN, U(3));
             LABEL(end);
 
-            SSASM(SSOP_PUSH, T0);
-            SSASM(SSOP_CALL, TEXT(setter_name), U(1));
-            SSASM(SSOP_POP, T0);
+            SSASM(SSOP_SETFIELD, TEXT(setter_name));
             SSASM(SSOP_POPN, U(1));
             break;
         }
 
         case '-': /* object.property_name -= <assignexpr> */
             SSASM(SSOP_SUB, T0, T1); /* t0 now stores the result of the expression */
-            SSASM(SSOP_PUSH, T0);
-            SSASM(SSOP_CALL, TEXT(setter_name), U(1));
-            SSASM(SSOP_POP, T0);
+            SSASM(SSOP_SETFIELD, TEXT(setter_name));
             SSASM(SSOP_POPN, U(1));
             break;
 
         case '*': /* object.property_name *= <assignexpr> */
             SSASM(SSOP_MUL, T0, T1);
-            SSASM(SSOP_PUSH, T0);
-            SSASM(SSOP_CALL, TEXT(setter_name), U(1));
-            SSASM(SSOP_POP, T0);
+            SSASM(SSOP_SETFIELD, TEXT(setter_name));
             SSASM(SSOP_POPN, U(1));
             break;
 
         case '/': /* object.property_name /= <assignexpr> */
             SSASM(SSOP_DIV, T0, T1);
-            SSASM(SSOP_PUSH, T0);
-            SSASM(SSOP_CALL, TEXT(setter_name), U(1));
-            SSASM(SSOP_POP, T0);
+            SSASM(SSOP_SETFIELD, TEXT(setter_name));
             SSASM(SSOP_POPN, U(1));
             break;
 
@@ -639,11 +659,9 @@ void emit_setterincdec(surgescript_nodecontext_t context, const char* property_n
     char* setter_name = surgescript_util_accessorfun("set", property_name);
 
     SSASM(SSOP_PUSH, T0); /* object pointer */
-    SSASM(SSOP_CALL, TEXT(getter_name), U(0)); /* t0 = old value */
+    SSASM(SSOP_GETFIELD, TEXT(getter_name)); /* t0 = old value */
     SSASM(*op == '+' ? SSOP_INC : SSOP_DEC, T0); /* update t0 */
-    SSASM(SSOP_PUSH, T0); /* push new value */
-    SSASM(SSOP_CALL, TEXT(setter_name), U(1)); /* call setter */
-    SSASM(SSOP_POP, T0); /* restore pushed value */
+    SSASM(SSOP_SETFIELD, TEXT(setter_name)); /* call setter with t0 */
     SSASM(*op != '+' ? SSOP_INC : SSOP_DEC, T0); /* return old value */
     SSASM(SSOP_POPN, U(1)); /* clear up the stack */
 
@@ -927,4 +945,44 @@ void emit_nop(surgescript_nodecontext_t context)
 void emit_breakpoint(surgescript_nodecontext_t context, const char* text)
 {
     SSASM(SSOP_NOP, I(-1), TEXT(text));
-}
\ No newline at end of file
+}
+
+
+
+/* expression temporaries */
+
+/* saves t[0] as an expression temporary. In functions, temporaries are registers
+   living in the stack frame (no allocations); otherwise, we push them onto the stack */
+void emit_savetmp(surgescript_nodecontext_t context)
+{
+    surgescript_regwindow_t* regs = context.regwindow;
+
+    if(regs != NULL && regs->top < SURGESCRIPT_REGWINDOW_MAXREGS) {
+        /* allocate a new register in the stack frame as a hidden local variable */
+        if(regs->top == regs->count) {
+            char name[16];
+            surgescript_stackptr_t address = (surgescript_stackptr_t)(1 + surgescript_symtable_local_count(context.symtable) - surgescript_program_arity(context.program));
+            snprintf(name, sizeof(name), "$%d", regs->count); /* not a valid identifier */
+            surgescript_symtable_put_stack_symbol(context.symtable, name, address);
+            regs->address[regs->count++] = address;
+        }
+
+        SSASM(SSOP_SPOKE, T0, I(regs->address[regs->top++]));
+    }
+    else {
+        SSASM(SSOP_PUSH, T0);
+        if(regs != NULL)
+            regs->top++;
+    }
+}
+
+/* loads the most recently saved expression temporary into t[k] */
+void emit_loadtmp(surgescript_nodecontext_t context, unsigned k)
+{
+    surgescript_regwindow_t* regs = context.regwindow;
+
+    if(regs != NULL && --regs->top < SURGESCRIPT_REGWINDOW_MAXREGS)
+        SSASM(SSOP_SPEEK, U(k), I(regs->address[regs->top]));
+    else
+        SSASM(SSOP_POP, U(k));
+}
@@ -27,11 +27,11 @@
 #include "../runtime/program.h"
 
 /* objects */
-void emit_object_header(surgescript_nodecontext_t context, surgescript_program_label_t start, surgescript_program_label_t end);
-void emit_object_footer(surgescript_nodecontext_t context, surgescript_program_label_t start, surgescript_program_label_t end);
+void emit_object_footer(surgescript_nodecontext_t context);
 
 /* declarations */
 void emit_vardecl(surgescript_nodecontext_t context, const char* identifier);
+bool emit_constdecl(surgescript_nodecontext_t context, const char* identifier, int first_line, surgescript_var_t* value);
 void emit_vargetter(surgescript_nodecontext_t context, const char* identifier);
 void emit_varsetter(surgescript_nodecontext_t context, const char* identifier);
 
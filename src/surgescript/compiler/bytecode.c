@@ -0,0 +1,808 @@
+/*
+ * SurgeScript
+ * A scripting language for games
+ * Copyright 2026 Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * compiler/bytecode.c
+ * SurgeScript Compiler: precompiled bytecode (cache files)
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "bytecode.h"
+#include "../runtime/program.h"
+#include "../runtime/program_pool.h"
+#include "../runtime/variable.h"
+#include "../util/util.h"
+
+/* xxhash is inlined. GCC reports a false positive of -Warray-bounds
+   when XXH64_update() is inlined with a short buffer */
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Warray-bounds"
+#endif
+#define XXH_INLINE_ALL
+#include "../util/xxhash.h"
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+/* memory-mapped files are available on POSIX systems */
+#if defined(__unix__) || defined(__unix) || defined(__APPLE__)
+#define SURGESCRIPT_BYTECODE_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/*
+ * File format (native byte order; every record is 8-byte aligned):
+ *
+ * header: see surgescript_bytecode_header_t
+ * payload: a sequence of records, terminated by SSBC_END
+ *
+ * record: type (u32), length of the name (u32), name (NUL-terminated, padded)
+ *         followed by:
+ *         SSBC_OBJECT: fingerprint (u64)
+ *         SSBC_PROGRAM: arity (i32), line count (u32), text count (u32), reserved (u32),
+ *                       lines: { operator (u32), reserved (u32), a (u64), b (u64) } * line count,
+ *                       texts: { length (u32), characters (NUL-terminated, padded) } * text count
+ *         SSBC_LAYOUT: field count (u32), text count (u32),
+ *                      fields: { type (u32), reserved (u32), value (u64) } * field count,
+ *                      texts: same as above; the value of a string field is an index to them
+ */
+#define SSBC_MAGIC "SSBC"
+#define SSBC_FORMAT_VERSION 2
+#define SSBC_ENDIANNESS 0x01020304
+#define SSBC_ALIGN(n) (((n) + 7) & ~((size_t)7))
+
+typedef struct surgescript_bytecode_header_t surgescript_bytecode_header_t;
+struct surgescript_bytecode_header_t
+{
+    char magic[4]; /* "SSBC" */
+    uint32_t format; /* version of the file format */
+    uint32_t endianness; /* SSBC_ENDIANNESS, as written by the host */
+    uint32_t optimization_level; /* optimization level of the programs */
+    uint64_t version_hash; /* hash of the version of SurgeScript */
+    uint64_t source_hash; /* hash of the source code */
+    uint64_t payload_size; /* size of the payload, in bytes */
+    uint64_t payload_hash; /* hash of the payload */
+};
+
+typedef struct surgescript_bytecode_recordheader_t surgescript_bytecode_recordheader_t;
+struct surgescript_bytecode_recordheader_t
+{
+    uint32_t type;
+    uint32_t name_length; /* not including the NUL terminator */
+};
+
+typedef struct surgescript_bytecode_programheader_t surgescript_bytecode_programheader_t;
+struct surgescript_bytecode_programheader_t
+{
+    int32_t arity;
+    uint32_t line_count;
+    uint32_t text_count;
+    uint32_t reserved;
+};
+
+typedef struct surgescript_bytecode_line_t surgescript_bytecode_line_t;
+struct surgescript_bytecode_line_t
+{
+    uint32_t op;
+    uint32_t reserved;
+    uint64_t a, b;
+};
+
+typedef struct surgescript_bytecode_layoutheader_t surgescript_bytecode_layoutheader_t;
+struct surgescript_bytecode_layoutheader_t
+{
+    uint32_t field_count;
+    uint32_t text_count;
+};
+
+typedef struct surgescript_bytecode_field_t surgescript_bytecode_field_t;
+struct surgescript_bytecode_field_t
+{
+    uint32_t type; /* enum surgescript_vartype_t */
+    uint32_t reserved;
+    uint64_t value;
+};
+
+/* bytecode */
+struct surgescript_bytecode_t
+{
+    surgescript_bytecode_header_t header;
+
+    /* payload */
+    uint8_t* data; /* payload being written */
+    size_t size; /* size of the payload */
+    size_t capacity; /* capacity of data[] */
+
+    /* reading */
+    const uint8_t* mapped; /* the whole file, in memory */
+    size_t mapped_size;
+    const uint8_t* payload; /* records */
+    const uint8_t* record; /* current record (NULL before the first call to next) */
+    size_t offset; /* offset of the next record */
+};
+
+/* private */
+static void write_data(surgescript_bytecode_t* bytecode, const void* data, size_t size);
+static void write_string(surgescript_bytecode_t* bytecode, const char* str);
+static void write_record(surgescript_bytecode_t* bytecode, surgescript_bytecode_record_t type, const char* name);
+static size_t record_size(const uint8_t* record, size_t available);
+static size_t string_size(const uint8_t* str, size_t available);
+static const uint8_t* record_body(const uint8_t* record);
+static const uint8_t* map_file(const char* filepath, size_t* size);
+static void unmap_file(const uint8_t* data, size_t size);
+static uint64_t version_hash();
+
+
+
+/*
+ * surgescript_bytecode_create()
+ * Creates an empty bytecode, to be written
+ */
+surgescript_bytecode_t* surgescript_bytecode_create(uint64_t source_hash, int optimization_level)
+{
+    surgescript_bytecode_t* bytecode = ssmalloc(sizeof *bytecode);
+
+    memset(&bytecode->header, 0, sizeof(bytecode->header));
+    memcpy(bytecode->header.magic, SSBC_MAGIC, sizeof(bytecode->header.magic));
+    bytecode->header.format = SSBC_FORMAT_VERSION;
+    bytecode->header.endianness = SSBC_ENDIANNESS;
+    bytecode->header.optimization_level = optimization_level;
+    bytecode->header.version_hash = version_hash();
+    bytecode->header.source_hash = source_hash;
+
+    bytecode->capacity = 4096;
+    bytecode->data = ssmalloc(bytecode->capacity);
+    bytecode->size = 0;
+
+    bytecode->mapped = NULL;
+    bytecode->mapped_size = 0;
+    bytecode->payload = NULL;
+    bytecode->record = NULL;
+    bytecode->offset = 0;
+
+    return bytecode;
+}
+
+/*
+ * surgescript_bytecode_load()
+ * Maps a bytecode file into memory. Returns NULL if the file is missing,
+ * if it doesn't match the given source code / settings or if it's corrupted
+ */
+surgescript_bytecode_t* surgescript_bytecode_load(const char* filepath, uint64_t source_hash, int optimization_level)
+{
+    const surgescript_bytecode_header_t* header;
+    surgescript_bytecode_t* bytecode;
+    const uint8_t* payload;
+    size_t size = 0, offset = 0, n;
+
+    /* map the file */
+    const uint8_t* data = map_file(filepath, &size);
+    if(data == NULL)
+        return NULL;
+
+    /* validate the header */
+    header = (const surgescript_bytecode_header_t*)data;
+    if(size < sizeof(*header) ||
+        memcmp(header->magic, SSBC_MAGIC, sizeof(header->magic)) != 0 ||
+        header->format != SSBC_FORMAT_VERSION ||
+        header->endianness != SSBC_ENDIANNESS ||
+        header->optimization_level != optimization_level ||
+        header->version_hash != version_hash() ||
+        header->source_hash != source_hash ||
+        header->payload_size != size - sizeof(*header)
+    ) {
+        unmap_file(data, size);
+        return NULL;
+    }
+
+    /* validate the payload */
+    payload = data + sizeof(*header);
+    if(surgescript_bytecode_hash(payload, header->payload_size, source_hash) != header->payload_hash) {
+        sslog("Discarding corrupted bytecode file %s", filepath);
+        unmap_file(data, size);
+        return NULL;
+    }
+
+    /* validate the structure of the records */
+    do {
+        if(0 == (n = record_size(payload + offset, header->payload_size - offset))) {
+            sslog("Discarding malformed bytecode file %s", filepath);
+            unmap_file(data, size);
+            return NULL;
+        }
+        offset += n;
+    } while(((const surgescript_bytecode_recordheader_t*)(payload + offset - n))->type != SSBC_END);
+
+    /* done! */
+    bytecode = ssmalloc(sizeof *bytecode);
+    bytecode->header = *header;
+    bytecode->data = NULL;
+    bytecode->size = bytecode->capacity = 0;
+    bytecode->mapped = data;
+    bytecode->mapped_size = size;
+    bytecode->payload = payload;
+    bytecode->record = NULL;
+    bytecode->offset = 0;
+    return bytecode;
+}
+
+/*
+ * surgescript_bytecode_destroy()
+ * Destroys / unmaps a bytecode
+ */
+surgescript_bytecode_t* surgescript_bytecode_destroy(surgescript_bytecode_t* bytecode)
+{
+    if(bytecode->mapped != NULL)
+        unmap_file(bytecode->mapped, bytecode->mapped_size);
+    if(bytecode->data != NULL)
+        ssfree(bytecode->data);
+    return ssfree(bytecode);
+}
+
+/*
+ * surgescript_bytecode_add_object()
+ * Adds a SSBC_OBJECT record. The fingerprint describes the
+ * environment in which the object was compiled
+ */
+void surgescript_bytecode_add_object(surgescript_bytecode_t* bytecode, const char* object_name, uint64_t fingerprint)
+{
+    write_record(bytecode, SSBC_OBJECT, object_name);
+    write_data(bytecode, &fingerprint, sizeof(fingerprint));
+}
+
+/*
+ * surgescript_bytecode_add_program()
+ * Adds a SSBC_PROGRAM record
+ */
+void surgescript_bytecode_add_program(surgescript_bytecode_t* bytecode, const char* program_name, surgescript_program_t* program)
+{
+    surgescript_bytecode_programheader_t header = {
+        .arity = surgescript_program_arity(program),
+        .line_count = surgescript_program_line_count(program),
+        .text_count = surgescript_program_text_count(program),
+        .reserved = 0
+    };
+
+    ssassert(!surgescript_program_is_native(program));
+    write_record(bytecode, SSBC_PROGRAM, program_name);
+    write_data(bytecode, &header, sizeof(header));
+
+    /* lines of code */
+    for(int i = 0; i < header.line_count; i++) {
+        surgescript_bytecode_line_t line = { 0 };
+        surgescript_program_operator_t op;
+        surgescript_program_operand_t a, b;
+
+        surgescript_program_read_line(program, i, &op, &a, &b);
+        line.op = op;
+        line.a = a._u;
+        line.b = b._u;
+        write_data(bytecode, &line, sizeof(line));
+    }
+
+    /* string literals */
+    for(int j = 0; j < header.text_count; j++)
+        write_string(bytecode, surgescript_program_get_text(program, j));
+}
+
+/*
+ * surgescript_bytecode_add_empty_program()
+ * Adds a SSBC_EMPTY_PROGRAM record
+ */
+void surgescript_bytecode_add_empty_program(surgescript_bytecode_t* bytecode, const char* program_name)
+{
+    write_record(bytecode, SSBC_EMPTY_PROGRAM, program_name);
+}
+
+/*
+ * surgescript_bytecode_add_tag()
+ * Adds a SSBC_TAG record
+ */
+void surgescript_bytecode_add_tag(surgescript_bytecode_t* bytecode, const char* tag_name)
+{
+    write_record(bytecode, SSBC_TAG, tag_name);
+}
+
+/*
+ * surgescript_bytecode_add_plugin()
+ * Adds a SSBC_PLUGIN record
+ */
+void surgescript_bytecode_add_plugin(surgescript_bytecode_t* bytecode, const char* plugin_name)
+{
+    write_record(bytecode, SSBC_PLUGIN, plugin_name);
+}
+
+/*
+ * surgescript_bytecode_add_layout()
+ * Adds a SSBC_LAYOUT record
+ */
+void surgescript_bytecode_add_layout(surgescript_bytecode_t* bytecode, int field_count, const surgescript_var_t** initial_value)
+{
+    surgescript_bytecode_layoutheader_t header = { .field_count = field_count, .text_count = 0 };
+
+    for(int i = 0; i < field_count; i++) {
+        if(initial_value[i] != NULL && surgescript_var_is_string(initial_value[i]))
+            header.text_count++;
+    }
+
+    write_record(bytecode, SSBC_LAYOUT, "");
+    write_data(bytecode, &header, sizeof(header));
+
+    /* fields */
+    for(int i = 0, j = 0; i < field_count; i++) {
+        surgescript_bytecode_field_t field = { .type = SSVAR_NULL, .reserved = 0, .value = 0 };
+        const surgescript_var_t* value = initial_value[i];
+
+        if(value == NULL || surgescript_var_is_null(value))
+            field.type = SSVAR_NULL;
+        else if(surgescript_var_is_bool(value)) {
+            field.type = SSVAR_BOOL;
+            field.value = surgescript_var_get_bool(value);
+        }
+        else if(surgescript_var_is_number(value)) {
+            double number = surgescript_var_get_number(value);
+            field.type = SSVAR_NUMBER;
+            memcpy(&field.value, &number, sizeof(number));
+        }
+        else if(surgescript_var_is_string(value)) {
+            field.type = SSVAR_STRING;
+            field.value = j++;
+        }
+        else
+            ssfatal("Can't store the initial value of field %d in the bytecode", i);
+
+        write_data(bytecode, &field, sizeof(field));
+    }
+
+    /* string literals */
+    for(int i = 0; i < field_count; i++) {
+        if(initial_value[i] != NULL && surgescript_var_is_string(initial_value[i]))
+            write_string(bytecode, surgescript_var_fast_get_string(initial_value[i]));
+    }
+}
+
+/*
+ * surgescript_bytecode_save()
+ * Saves the bytecode to a file. The file is written atomically:
+ * readers will never see a partially written bytecode
+ */
+bool surgescript_bytecode_save(const surgescript_bytecode_t* bytecode, const char* filepath)
+{
+    surgescript_bytecode_header_t header = bytecode->header;
+    uint8_t end[SSBC_ALIGN(sizeof(surgescript_bytecode_recordheader_t) + 1)] = { 0 };
+    surgescript_bytecode_recordheader_t end_header = { .type = SSBC_END, .name_length = 0 };
+    XXH64_state_t state;
+    char* tmp_filepath;
+    bool success;
+    FILE* fp;
+
+    /* the payload is terminated by a SSBC_END record, which is
+       not stored in data[], so that we may keep on writing to it */
+    memcpy(end, &end_header, sizeof(end_header));
+    header.payload_size = bytecode->size + sizeof(end);
+    XXH64_reset(&state, header.source_hash);
+    XXH64_update(&state, bytecode->data, bytecode->size);
+    XXH64_update(&state, end, sizeof(end));
+    header.payload_hash = XXH64_digest(&state);
+
+    /* write to a temporary file */
+    tmp_filepath = ssmalloc(strlen(filepath) + 5);
+    strcpy(tmp_filepath, filepath);
+    strcat(tmp_filepath, ".tmp");
+    if(NULL == (fp = surgescript_util_fopen_utf8(tmp_filepath, "wb"))) {
+        sslog("Can't write bytecode file %s", tmp_filepath);
+        ssfree(tmp_filepath);
+        return false;
+    }
+
+    success = fwrite(&header, sizeof(header), 1, fp) == 1;
+    success = success && (bytecode->size == 0 || fwrite(bytecode->data, bytecode->size, 1, fp) == 1);
+    success = success && fwrite(end, sizeof(end), 1, fp) == 1;
+    success = (fclose(fp) == 0) && success;
+
+    /* move the temporary file */
+    if(success) {
+        remove(filepath); /* needed on Windows */
+        success = (rename(tmp_filepath, filepath) == 0);
+    }
+    if(!success) {
+        sslog("Can't write bytecode file %s", filepath);
+        remove(tmp_filepath);
+    }
+
+    /* done */
+    ssfree(tmp_filepath);
+    return success;
+}
+
+/*
+ * surgescript_bytecode_next()
+ * Moves to the next record, returning its type
+ */
+surgescript_bytecode_record_t surgescript_bytecode_next(surgescript_bytecode_t* bytecode)
+{
+    const surgescript_bytecode_recordheader_t* header;
+
+    if(bytecode->payload == NULL)
+        return SSBC_END;
+
+    /* records have been validated when loading the file */
+    bytecode->record = bytecode->payload + bytecode->offset;
+    header = (const surgescript_bytecode_recordheader_t*)(bytecode->record);
+    if(header->type != SSBC_END)
+        bytecode->offset += record_size(bytecode->record, bytecode->header.payload_size - bytecode->offset);
+
+    return header->type;
+}
+
+/*
+ * surgescript_bytecode_rewind()
+ * Moves back to the first record
+ */
+void surgescript_bytecode_rewind(surgescript_bytecode_t* bytecode)
+{
+    bytecode->record = NULL;
+    bytecode->offset = 0;
+}
+
+/*
+ * surgescript_bytecode_name()
+ * The name stored in the current record
+ */
+const char* surgescript_bytecode_name(const surgescript_bytecode_t* bytecode)
+{
+    if(bytecode->record != NULL)
+        return (const char*)(bytecode->record + sizeof(surgescript_bytecode_recordheader_t));
+    else
+        return "";
+}
+
+/*
+ * surgescript_bytecode_fingerprint()
+ * The fingerprint of the current SSBC_OBJECT record
+ */
+uint64_t surgescript_bytecode_fingerprint(const surgescript_bytecode_t* bytecode)
+{
+    const surgescript_bytecode_recordheader_t* header = (const surgescript_bytecode_recordheader_t*)(bytecode->record);
+    uint64_t fingerprint = 0;
+
+    if(header != NULL && header->type == SSBC_OBJECT)
+        memcpy(&fingerprint, record_body(bytecode->record), sizeof(fingerprint));
+
+    return fingerprint;
+}
+
+/*
+ * surgescript_bytecode_program()
+ * Creates the program of the current SSBC_PROGRAM record
+ */
+surgescript_program_t* surgescript_bytecode_program(const surgescript_bytecode_t* bytecode)
+{
+    const surgescript_bytecode_recordheader_t* header = (const surgescript_bytecode_recordheader_t*)(bytecode->record);
+    const surgescript_bytecode_programheader_t* program_header;
+    const surgescript_bytecode_line_t* line;
+    const uint8_t* text;
+    surgescript_program_t* program;
+
+    if(header == NULL || header->type != SSBC_PROGRAM)
+        return NULL;
+
+    /* create the program */
+    program_header = (const surgescript_bytecode_programheader_t*)record_body(bytecode->record);
+    program = surgescript_program_create(program_header->arity);
+
+    /* read the code. No fixups are needed: jumps refer to line numbers
+       and operands refer to the text section, which is read in order */
+    line = (const surgescript_bytecode_line_t*)(program_header + 1);
+    for(int i = 0; i < program_header->line_count; i++, line++) {
+        surgescript_program_operand_t a = { ._u = line->a }, b = { ._u = line->b };
+        surgescript_program_add_line(program, (surgescript_program_operator_t)(line->op), a, b);
+    }
+
+    /* read the text */
+    text = (const uint8_t*)line;
+    for(int j = 0; j < program_header->text_count; j++) {
+        surgescript_program_add_text(program, (const char*)(text + sizeof(uint32_t)));
+        text += string_size(text, SIZE_MAX);
+    }
+
+    /* done! */
+    return program;
+}
+
+/*
+ * surgescript_bytecode_layout()
+ * Puts the heap layout of the current SSBC_LAYOUT record in the program pool
+ */
+void surgescript_bytecode_layout(const surgescript_bytecode_t* bytecode, surgescript_programpool_t* pool, const char* object_name)
+{
+    const surgescript_bytecode_recordheader_t* header = (const surgescript_bytecode_recordheader_t*)(bytecode->record);
+    const surgescript_bytecode_layoutheader_t* layout_header;
+    const surgescript_bytecode_field_t* field;
+    const uint8_t** text;
+    surgescript_var_t** initial_value;
+    const uint8_t* t;
+
+    if(header == NULL || header->type != SSBC_LAYOUT)
+        return;
+
+    /* locate the fields & the texts */
+    layout_header = (const surgescript_bytecode_layoutheader_t*)record_body(bytecode->record);
+    field = (const surgescript_bytecode_field_t*)(layout_header + 1);
+    text = ssmalloc((1 + layout_header->text_count) * sizeof(*text));
+    t = (const uint8_t*)(field + layout_header->field_count);
+    for(int j = 0; j < layout_header->text_count; j++) {
+        text[j] = t + sizeof(uint32_t);
+        t += string_size(t, SIZE_MAX);
+    }
+
+    /* read the initial values */
+    initial_value = ssmalloc((1 + layout_header->field_count) * sizeof(*initial_value));
+    for(int i = 0; i < layout_header->field_count; i++, field++) {
+        double number;
+        initial_value[i] = surgescript_var_create();
+        switch(field->type) {
+            case SSVAR_BOOL:
+                surgescript_var_set_bool(initial_value[i], field->value != 0);
+                break;
+
+            case SSVAR_NUMBER:
+                memcpy(&number, &field->value, sizeof(number));
+                surgescript_var_set_number(initial_value[i], number);
+                break;
+
+            case SSVAR_STRING:
+                if(field->value < layout_header->text_count)
+                    surgescript_var_set_string(initial_value[i], (const char*)text[field->value]);
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    /* put the layout in the pool */
+    surgescript_programpool_put_layout(pool, object_name, layout_header->field_count, (const surgescript_var_t**)initial_value);
+    for(int i = 0; i < layout_header->field_count; i++)
+        surgescript_var_destroy(initial_value[i]);
+    ssfree(initial_value);
+    ssfree(text);
+}
+
+/*
+ * surgescript_bytecode_hash()
+ * Hash function used to validate the bytecode
+ */
+uint64_t surgescript_bytecode_hash(const void* data, size_t size, uint64_t seed)
+{
+    return XXH64(data, size, seed);
+}
+
+
+
+/* private */
+
+/* appends data to the payload */
+void write_data(surgescript_bytecode_t* bytecode, const void* data, size_t size)
+{
+    size_t new_size = bytecode->size + SSBC_ALIGN(size);
+
+    if(new_size > bytecode->capacity) {
+        while(new_size > bytecode->capacity)
+            bytecode->capacity *= 2;
+        bytecode->data = ssrealloc(bytecode->data, bytecode->capacity);
+    }
+
+    memcpy(bytecode->data + bytecode->size, data, size);
+    memset(bytecode->data + bytecode->size + size, 0, SSBC_ALIGN(size) - size);
+    bytecode->size = new_size;
+}
+
+/* appends a string to the payload: length (u32) + characters (NUL-terminated) */
+void write_string(surgescript_bytecode_t* bytecode, const char* str)
+{
+    uint32_t length = strlen(str);
+    size_t size = sizeof(length) + length + 1;
+    uint8_t* buf = ssmalloc(size);
+
+    memcpy(buf, &length, sizeof(length));
+    memcpy(buf + sizeof(length), str, length + 1);
+    write_data(bytecode, buf, size);
+
+    ssfree(buf);
+}
+
+/* appends the header of a record to the payload */
+void write_record(surgescript_bytecode_t* bytecode, surgescript_bytecode_record_t type, const char* name)
+{
+    surgescript_bytecode_recordheader_t header = { .type = type, .name_length = strlen(name) };
+    size_t size = sizeof(header) + header.name_length + 1;
+    uint8_t* buf = ssmalloc(size);
+
+    memcpy(buf, &header, sizeof(header));
+    memcpy(buf + sizeof(header), name, header.name_length + 1);
+    write_data(bytecode, buf, size);
+
+    ssfree(buf);
+}
+
+/* the size of a string stored in the payload, or 0 if it's malformed */
+size_t string_size(const uint8_t* str, size_t available)
+{
+    uint32_t length;
+
+    if(available < sizeof(length))
+        return 0;
+
+    memcpy(&length, str, sizeof(length));
+    if(available - sizeof(length) <= length || str[sizeof(length) + length] != 0)
+        return 0;
+
+    return SSBC_ALIGN(sizeof(length) + length + 1);
+}
+
+/* the body of a record: what follows its name */
+const uint8_t* record_body(const uint8_t* record)
+{
+    const surgescript_bytecode_recordheader_t* header = (const surgescript_bytecode_recordheader_t*)record;
+    return record + SSBC_ALIGN(sizeof(*header) + header->name_length + 1);
+}
+
+/* the size of a record, or 0 if it's malformed */
+size_t record_size(const uint8_t* record, size_t available)
+{
+    const surgescript_bytecode_recordheader_t* header = (const surgescript_bytecode_recordheader_t*)record;
+    size_t size;
+
+    /* header & name */
+    if(available < sizeof(*header) || available - sizeof(*header) <= header->name_length)
+        return 0;
+    else if(record[sizeof(*header) + header->name_length] != 0)
+        return 0;
+    size = SSBC_ALIGN(sizeof(*header) + header->name_length + 1);
+    if(size > available)
+        return 0;
+
+    /* body */
+    switch(header->type) {
+        case SSBC_END:
+        case SSBC_EMPTY_PROGRAM:
+        case SSBC_TAG:
+        case SSBC_PLUGIN:
+            return size;
+
+        case SSBC_OBJECT:
+            return (available - size >= sizeof(uint64_t)) ? size + sizeof(uint64_t) : 0;
+
+        case SSBC_PROGRAM: {
+            const surgescript_bytecode_programheader_t* program_header = (const surgescript_bytecode_programheader_t*)(record + size);
+            size_t n;
+
+            if(available - size < sizeof(*program_header))
+                return 0;
+            size += sizeof(*program_header);
+
+            if((available - size) / sizeof(surgescript_bytecode_line_t) < program_header->line_count)
+                return 0;
+            size += program_header->line_count * sizeof(surgescript_bytecode_line_t);
+
+            for(int j = 0; j < program_header->text_count; j++) {
+                if(0 == (n = string_size(record + size, available - size)))
+                    return 0;
+                size += n;
+            }
+
+            return size;
+        }
+
+        case SSBC_LAYOUT: {
+            const surgescript_bytecode_layoutheader_t* layout_header = (const surgescript_bytecode_layoutheader_t*)(record + size);
+            size_t n;
+
+            if(available - size < sizeof(*layout_header))
+                return 0;
+            size += sizeof(*layout_header);
+
+            if((available - size) / sizeof(surgescript_bytecode_field_t) < layout_header->field_count)
+                return 0;
+            size += layout_header->field_count * sizeof(surgescript_bytecode_field_t);
+
+            for(int j = 0; j < layout_header->text_count; j++) {
+                if(0 == (n = string_size(record + size, available - size)))
+                    return 0;
+                size += n;
+            }
+
+            return size;
+        }
+
+        default:
+            return 0;
+    }
+}
+
+/* maps a file into (read-only) memory. Returns NULL on error */
+const uint8_t* map_file(const char* filepath, size_t* size)
+{
+#if defined(SURGESCRIPT_BYTECODE_MMAP)
+    struct stat st;
+    void* data;
+    int fd;
+
+    if((fd = open(filepath, O_RDONLY)) < 0)
+        return NULL;
+
+    if(fstat(fd, &st) < 0 || st.st_size <= 0) {
+        close(fd);
+        return NULL;
+    }
+
+    data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); /* the mapping is kept */
+    if(data == MAP_FAILED)
+        return NULL;
+
+    *size = (size_t)st.st_size;
+    return data;
+#else
+    FILE* fp = surgescript_util_fopen_utf8(filepath, "rb");
+    uint8_t* data = NULL;
+    long length;
+
+    if(fp == NULL)
+        return NULL;
+
+    if(fseek(fp, 0, SEEK_END) == 0 && (length = ftell(fp)) > 0 && fseek(fp, 0, SEEK_SET) == 0) {
+        data = ssmalloc(length);
+        if(fread(data, length, 1, fp) == 1)
+            *size = length;
+        else
+            data = ssfree(data);
+    }
+
+    fclose(fp);
+    return data;
+#endif
+}
+
+/* unmaps a file previously mapped with map_file() */
+void unmap_file(const uint8_t* data, size_t size)
+{
+#if defined(SURGESCRIPT_BYTECODE_MMAP)
+    munmap((void*)data, size);
+#else
+    ssfree((void*)data);
+#endif
+}
+
+/* a bytecode file is only valid for the version of SurgeScript that wrote it */
+uint64_t version_hash()
+{
+    const char* version = surgescript_util_version();
+    uint64_t hash = surgescript_bytecode_hash(version, strlen(version), SSBC_FORMAT_VERSION);
+
+    /* the encoding of the operators may change between builds */
+    #define HASH_OPERATOR(x, y) hash = surgescript_bytecode_hash(y, strlen(y), hash);
+    SURGESCRIPT_PROGRAM_OPERATORS(HASH_OPERATOR)
+    #undef HASH_OPERATOR
+
+    return hash;
+}
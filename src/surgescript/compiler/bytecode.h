@@ -0,0 +1,78 @@
+/*
+ * SurgeScript
+ * A scripting language for games
+ * Copyright 2026 Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * compiler/bytecode.h
+ * SurgeScript Compiler: precompiled bytecode (cache files)
+ */
+
+#ifndef _SURGESCRIPT_COMPILER_BYTECODE_H
+#define _SURGESCRIPT_COMPILER_BYTECODE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * A bytecode file stores the result of compiling a script: a sequence of
+ * records that, when replayed in order, recreate the programs, the tags and
+ * the plugins declared in that script. Programs and tags belong to the
+ * object declared in the last SSBC_OBJECT record.
+ */
+
+/* types */
+typedef struct surgescript_bytecode_t surgescript_bytecode_t;
+struct surgescript_program_t;
+struct surgescript_programpool_t;
+struct surgescript_var_t;
+
+/* records */
+typedef enum surgescript_bytecode_record_t {
+    SSBC_END = 0, /* end of the bytecode */
+    SSBC_OBJECT, /* an object: name & fingerprint of the environment it was compiled in */
+    SSBC_PROGRAM, /* a program of the current object: name & code */
+    SSBC_EMPTY_PROGRAM, /* a native program of the current object that does nothing: name */
+    SSBC_TAG, /* a tag of the current object: name */
+    SSBC_PLUGIN, /* a plugin: name */
+    SSBC_LAYOUT /* the heap layout of the current object: initial values of its fields */
+} surgescript_bytecode_record_t;
+
+/* create & destroy */
+surgescript_bytecode_t* surgescript_bytecode_create(uint64_t source_hash, int optimization_level); /* creates an empty bytecode, to be written */
+surgescript_bytecode_t* surgescript_bytecode_load(const char* filepath, uint64_t source_hash, int optimization_level); /* maps a bytecode file into memory; returns NULL if it's missing, outdated or corrupted */
+surgescript_bytecode_t* surgescript_bytecode_destroy(surgescript_bytecode_t* bytecode); /* destroys / unmaps a bytecode */
+
+/* write */
+void surgescript_bytecode_add_object(surgescript_bytecode_t* bytecode, const char* object_name, uint64_t fingerprint); /* adds a SSBC_OBJECT record */
+void surgescript_bytecode_add_program(surgescript_bytecode_t* bytecode, const char* program_name, struct surgescript_program_t* program); /* adds a SSBC_PROGRAM record */
+void surgescript_bytecode_add_empty_program(surgescript_bytecode_t* bytecode, const char* program_name); /* adds a SSBC_EMPTY_PROGRAM record */
+void surgescript_bytecode_add_tag(surgescript_bytecode_t* bytecode, const char* tag_name); /* adds a SSBC_TAG record */
+void surgescript_bytecode_add_plugin(surgescript_bytecode_t* bytecode, const char* plugin_name); /* adds a SSBC_PLUGIN record */
+void surgescript_bytecode_add_layout(surgescript_bytecode_t* bytecode, int field_count, const struct surgescript_var_t** initial_value); /* adds a SSBC_LAYOUT record; initial values may be NULL, null, booleans, numbers or strings */
+bool surgescript_bytecode_save(const surgescript_bytecode_t* bytecode, const char* filepath); /* saves the bytecode to a file */
+
+/* read */
+surgescript_bytecode_record_t surgescript_bytecode_next(surgescript_bytecode_t* bytecode); /* moves to the next record, returning its type */
+void surgescript_bytecode_rewind(surgescript_bytecode_t* bytecode); /* moves back to the first record */
+const char* surgescript_bytecode_name(const surgescript_bytecode_t* bytecode); /* the name stored in the current record */
+uint64_t surgescript_bytecode_fingerprint(const surgescript_bytecode_t* bytecode); /* the fingerprint of the current SSBC_OBJECT record */
+struct surgescript_program_t* surgescript_bytecode_program(const surgescript_bytecode_t* bytecode); /* creates the program of the current SSBC_PROGRAM record */
+void surgescript_bytecode_layout(const surgescript_bytecode_t* bytecode, struct surgescript_programpool_t* pool, const char* object_name); /* puts the heap layout of the current SSBC_LAYOUT record in the pool */
+
+/* utilities */
+uint64_t surgescript_bytecode_hash(const void* data, size_t size, uint64_t seed); /* hash function used to validate the bytecode */
+
+#endif
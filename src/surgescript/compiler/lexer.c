@@ -50,7 +50,7 @@ struct surgescript_lexer_t
 };
 
 /* keywords */
-static surgescript_tokentype_t keyword[] = { SSTOK_TRUE, SSTOK_FALSE, SSTOK_NULL, SSTOK_OBJECT, SSTOK_STATE, SSTOK_FUN, SSTOK_RETURN, SSTOK_THIS, SSTOK_IF, SSTOK_ELSE, SSTOK_WHILE, SSTOK_FOR, SSTOK_FOREACH, SSTOK_IN, SSTOK_BREAK, SSTOK_CONTINUE, SSTOK_TYPEOF, SSTOK_PUBLIC, SSTOK_USING, SSTOK_DO, SSTOK_SWITCH, SSTOK_CASE, SSTOK_DEFAULT, SSTOK_CONST, SSTOK_ASSERT, SSTOK_WAIT, SSTOK_TIMEOUT, SSTOK_STATIC, SSTOK_SUPER, SSTOK_OF, SSTOK_IS, SSTOK_CALLER, SSTOK_READONLY };
+static const surgescript_tokentype_t keyword[] = { SSTOK_TRUE, SSTOK_FALSE, SSTOK_NULL, SSTOK_OBJECT, SSTOK_STATE, SSTOK_FUN, SSTOK_RETURN, SSTOK_THIS, SSTOK_IF, SSTOK_ELSE, SSTOK_WHILE, SSTOK_FOR, SSTOK_FOREACH, SSTOK_IN, SSTOK_BREAK, SSTOK_CONTINUE, SSTOK_TYPEOF, SSTOK_PUBLIC, SSTOK_USING, SSTOK_DO, SSTOK_SWITCH, SSTOK_CASE, SSTOK_DEFAULT, SSTOK_CONST, SSTOK_ASSERT, SSTOK_WAIT, SSTOK_TIMEOUT, SSTOK_STATIC, SSTOK_SUPER, SSTOK_OF, SSTOK_IS, SSTOK_CALLER, SSTOK_READONLY };
 static int indexof_keyword(const char* identifier);
 static inline void bufadd(surgescript_lexer_t* lexer, char c);
 static inline void bufclear(surgescript_lexer_t* lexer);
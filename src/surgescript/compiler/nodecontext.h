@@ -23,9 +23,19 @@
 #define _SURGESCRIPT_COMPILER_NODECONTEXT_H
 
 #include "../runtime/program.h"
+#include "../runtime/stack.h"
 
 struct surgescript_symtable_t;
 
+/* register window: expression temporaries that live in the stack frame of a function */
+#define SURGESCRIPT_REGWINDOW_MAXREGS 16
+typedef struct surgescript_regwindow_t
+{
+    int top; /* how many registers are in use */
+    int count; /* how many registers have been allocated in the stack frame */
+    surgescript_stackptr_t address[SURGESCRIPT_REGWINDOW_MAXREGS]; /* stack addresses, relative to the base pointer */
+} surgescript_regwindow_t;
+
 /* node context */
 typedef struct surgescript_nodecontext_t
 {
@@ -36,13 +46,21 @@ typedef struct surgescript_nodecontext_t
     surgescript_program_t* program;
     surgescript_program_label_t loop_begin;
     surgescript_program_label_t loop_end;
+    surgescript_regwindow_t* regwindow; /* NULL if there is no stack frame */
 } surgescript_nodecontext_t;
 
 /* node context constructor */
 static inline surgescript_nodecontext_t nodecontext(const char* source_file, const char* object_name, const char* program_name, struct surgescript_symtable_t* symbol_table, surgescript_program_t* program)
 {
-    surgescript_nodecontext_t ctx = { source_file, object_name, program_name, symbol_table, program, SURGESCRIPT_PROGRAM_UNDEFINED_LABEL, SURGESCRIPT_PROGRAM_UNDEFINED_LABEL };
+    surgescript_nodecontext_t ctx = { source_file, object_name, program_name, symbol_table, program, SURGESCRIPT_PROGRAM_UNDEFINED_LABEL, SURGESCRIPT_PROGRAM_UNDEFINED_LABEL, NULL };
     return ctx;
 }
 
+/* a new, empty register window */
+static inline surgescript_regwindow_t regwindow()
+{
+    surgescript_regwindow_t regs = { 0, 0, { 0 } };
+    return regs;
+}
+
 #endif
\ No newline at end of file
@@ -22,7 +22,6 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <locale.h>
 #include <errno.h>
 #include <ctype.h>
 #include "parser.h"
@@ -31,6 +30,7 @@
 #include "nodecontext.h"
 #include "symtable.h"
 #include "asm.h"
+#include "bytecode.h"
 #include "../runtime/object.h"
 #include "../runtime/object_manager.h"
 #include "../runtime/tag_system.h"
@@ -51,6 +51,10 @@ struct surgescript_parser_t
     surgescript_symtable_t* base_table; /* valid symbols in the current file (code unit) */
     SSARRAY(char*, known_plugins); /* known plugins in all files (the names of the objects) */
     surgescript_parser_flags_t flags;
+    int optimization_level; /* peephole optimizer: 0 = off */
+    char* cache_directory; /* bytecode cache (NULL if disabled) */
+    surgescript_bytecode_t* bytecode; /* bytecode of the file being parsed (NULL if not recording) */
+    SSARRAY(surgescript_var_t*, field_value); /* initial values of the fields of the object being parsed (NULL if not constant) */
 };
 
 /* helpers */
@@ -78,6 +82,7 @@ static surgescript_symtable_t* configure_base_table(surgescript_symtable_t* base
 static void read_annotations(surgescript_parser_t* parser, char*** annotations);
 static void release_annotations(char** annotations);
 static void process_annotations(surgescript_parser_t* parser, char** annotations, const char* object_name);
+static void mark_as_parallel(surgescript_parser_t* parser, const char* object_name);
 static surgescript_program_t* make_file_program(const char* source_file);
 static void pick_non_natives(const char* program_name, void* data);
 static void remove_object_definition(surgescript_programpool_t* pool, const char* object_name);
@@ -86,6 +91,15 @@ static bool is_state_context(surgescript_nodecontext_t context);
 static char* randstr(char* buf, size_t size);
 static bool is_large_name(const char* name);
 static bool is_valid_name(const char* name);
+static void put_program(surgescript_parser_t* parser, const char* object_name, const char* program_name, surgescript_program_t* program);
+static void put_layout(surgescript_parser_t* parser, const char* object_name, int field_count);
+static void add_tag(surgescript_parser_t* parser, const char* object_name, const char* tag_name);
+static void parse_with_cache(surgescript_parser_t* parser, const char* absolute_path, const char* data, size_t size);
+static bool load_bytecode(surgescript_parser_t* parser, const char* filepath, uint64_t source_hash);
+static void discard_bytecode(surgescript_parser_t* parser);
+static char* bytecode_filepath(const char* cache_directory, const char* absolute_path, int optimization_level);
+static uint64_t environment_fingerprint(surgescript_parser_t* parser, const char* object_name);
+static void fingerprint_program(const char* program_name, void* data);
 
 /* non-terminals */
 static void importlist(surgescript_parser_t* parser);
@@ -160,8 +174,11 @@ surgescript_parser_t* surgescript_parser_create(surgescript_programpool_t* progr
     parser->tag_system = tag_system;
     parser->base_table = NULL;
     parser->flags = SSPARSER_DEFAULTS;
+    parser->optimization_level = SSPARSER_DEFAULT_OPTIMIZATION_LEVEL;
+    parser->cache_directory = NULL;
+    parser->bytecode = NULL;
+    ssarray_init(parser->field_value);
     init_plugins_list(parser);
-    setlocale(LC_NUMERIC, "C"); /* use '.' as the decimal separator on atof() */
     return parser;
 }
 
@@ -172,6 +189,10 @@ surgescript_parser_t* surgescript_parser_create(surgescript_programpool_t* progr
 surgescript_parser_t* surgescript_parser_destroy(surgescript_parser_t* parser)
 {
     ssfree(parser->filename);
+    if(parser->cache_directory)
+        ssfree(parser->cache_directory);
+    if(parser->bytecode)
+        surgescript_bytecode_destroy(parser->bytecode);
     surgescript_lexer_destroy(parser->lexer);
     if(parser->lookahead)
         surgescript_token_destroy(parser->lookahead);
@@ -179,19 +200,25 @@ surgescript_parser_t* surgescript_parser_destroy(surgescript_parser_t* parser)
         surgescript_token_destroy(parser->previous);
     if(parser->base_table)
         surgescript_symtable_destroy(parser->base_table);
+    for(int i = 0; i < ssarray_length(parser->field_value); i++) {
+        if(parser->field_value[i] != NULL)
+            surgescript_var_destroy(parser->field_value[i]);
+    }
+    ssarray_release(parser->field_value);
     release_plugins_list(parser);
     return ssfree(parser);
 }
 
 /*
  * surgescript_parser_parsefile()
- * Parse a script file; returns false on error
+ * Parse a script file; returns false on error. If the bytecode
+ * cache is enabled, the script will only be parsed if it has changed
  */
 bool surgescript_parser_parsefile(surgescript_parser_t* parser, const char* absolute_path)
 {
     FILE* fp = surgescript_util_fopen_utf8(absolute_path, "rb"); /* use binary mode, so offsets don't get messed up */
     if(fp) {
-        static size_t BUFSIZE = 1024;
+        const size_t BUFSIZE = 1024;
         char* data = NULL;
         size_t read_chars = 0, data_size = 0;
 
@@ -208,8 +235,12 @@ bool surgescript_parser_parsefile(surgescript_parser_t* parser, const char* abso
         /* parse it */
         ssfree(parser->filename);
         parser->filename = ssstrdup(surgescript_util_basename(absolute_path));
-        surgescript_lexer_set(parser->lexer, data);
-        parse(parser);
+        if(parser->cache_directory == NULL) {
+            surgescript_lexer_set(parser->lexer, data);
+            parse(parser);
+        }
+        else
+            parse_with_cache(parser, absolute_path, data, read_chars);
 
         /* done! */
         ssfree(data);
@@ -279,6 +310,53 @@ surgescript_parser_flags_t surgescript_parser_get_flags(surgescript_parser_t* pa
 }
 
 
+/*
+ * surgescript_parser_set_optimization_level()
+ * Set the optimization level of the compiled programs:
+ * 0 (no optimization), 1 (peephole optimizations) or 2 (also fold constants)
+ */
+void surgescript_parser_set_optimization_level(surgescript_parser_t* parser, int level)
+{
+    parser->optimization_level = ssclamp(level, 0, 2);
+}
+
+
+/*
+ * surgescript_parser_get_optimization_level()
+ * Get the optimization level of the compiled programs
+ */
+int surgescript_parser_get_optimization_level(surgescript_parser_t* parser)
+{
+    return parser->optimization_level;
+}
+
+
+/*
+ * surgescript_parser_set_cache_directory()
+ * Enables a bytecode cache in the given directory: the compiled
+ * scripts will be stored there and reused while they don't change.
+ * Pass NULL to disable the cache (the default)
+ */
+void surgescript_parser_set_cache_directory(surgescript_parser_t* parser, const char* directory)
+{
+    if(parser->cache_directory != NULL)
+        parser->cache_directory = ssfree(parser->cache_directory);
+
+    if(directory != NULL && *directory != '\0')
+        parser->cache_directory = ssstrdup(directory);
+}
+
+
+/*
+ * surgescript_parser_get_cache_directory()
+ * The directory of the bytecode cache, or NULL if the cache is disabled
+ */
+const char* surgescript_parser_get_cache_directory(surgescript_parser_t* parser)
+{
+    return parser->cache_directory;
+}
+
+
 /* privates & helpers */
 
 
@@ -429,6 +507,8 @@ void validate_object(surgescript_parser_t* parser, surgescript_nodecontext_t con
         if(strcmp(context.object_name, "Application") != 0) {
             surgescript_program_t* cprogram = surgescript_program_create_native(0, empty_main);
             surgescript_programpool_put(parser->program_pool, context.object_name, "state:main", cprogram);
+            if(parser->bytecode != NULL)
+                surgescript_bytecode_add_empty_program(parser->bytecode, "state:main");
             /*sslog("Object \"%s\" in \"%s\" has omitted its \"main\" state and will be disabled.", context.object_name, context.source_file);*/
         }
         else
@@ -461,7 +541,8 @@ void create_getter(surgescript_parser_t* parser, surgescript_nodecontext_t conte
     ), identifier);
 
     /* register things */
-    surgescript_programpool_put(parser->program_pool, context.object_name, getter_name, getter);
+    surgescript_program_optimize(getter, parser->optimization_level);
+    put_program(parser, context.object_name, getter_name, getter);
 
     /* done */
     ssfree(getter_name);
@@ -483,7 +564,8 @@ void create_setter(surgescript_parser_t* parser, surgescript_nodecontext_t conte
     ), identifier);
 
     /* register things */
-    surgescript_programpool_put(parser->program_pool, context.object_name, setter_name, setter);
+    surgescript_program_optimize(setter, parser->optimization_level);
+    put_program(parser, context.object_name, setter_name, setter);
 
     /* done */
     ssfree(setter_name);
@@ -520,7 +602,8 @@ void remove_object_definition(surgescript_programpool_t* pool, const char* objec
     char** programs = NULL; int count = 0;
     void* data[] = { pool, (void*)object_name, &count, &programs };
 
-    /* remove all programs (non-natives) */
+    /* remove all programs (non-natives) & the heap layout */
+    surgescript_programpool_put_layout(pool, object_name, 0, NULL);
     surgescript_programpool_foreach_ex(pool, object_name, data, pick_non_natives);
     if(programs != NULL) {
         for(int i = 0; i < count; i++) {
@@ -601,6 +684,165 @@ bool is_valid_name(const char* name)
 }
 
 
+/* registers a compiled program in the program pool */
+void put_program(surgescript_parser_t* parser, const char* object_name, const char* program_name, surgescript_program_t* program)
+{
+    surgescript_programpool_put(parser->program_pool, object_name, program_name, program);
+    if(parser->bytecode != NULL)
+        surgescript_bytecode_add_program(parser->bytecode, program_name, program);
+}
+
+/* sets the heap layout of an object, given the fields read so far */
+void put_layout(surgescript_parser_t* parser, const char* object_name, int field_count)
+{
+    while(ssarray_length(parser->field_value) < field_count)
+        ssarray_push(parser->field_value, NULL);
+
+    surgescript_programpool_put_layout(parser->program_pool, object_name, field_count, (const surgescript_var_t**)parser->field_value);
+    if(parser->bytecode != NULL)
+        surgescript_bytecode_add_layout(parser->bytecode, field_count, (const surgescript_var_t**)parser->field_value);
+
+    for(int i = 0; i < ssarray_length(parser->field_value); i++) {
+        if(parser->field_value[i] != NULL)
+            surgescript_var_destroy(parser->field_value[i]);
+    }
+    ssarray_reset(parser->field_value);
+}
+
+/* adds a tag to an object */
+void add_tag(surgescript_parser_t* parser, const char* object_name, const char* tag_name)
+{
+    surgescript_tagsystem_add_tag(parser->tag_system, object_name, tag_name);
+    if(parser->bytecode != NULL)
+        surgescript_bytecode_add_tag(parser->bytecode, tag_name);
+}
+
+/* parses a script, reusing its bytecode if it's in the cache */
+void parse_with_cache(surgescript_parser_t* parser, const char* absolute_path, const char* data, size_t size)
+{
+    uint64_t seed = surgescript_bytecode_hash(parser->filename, strlen(parser->filename), 0);
+    uint64_t source_hash = surgescript_bytecode_hash(data, size, seed);
+    char* filepath = bytecode_filepath(parser->cache_directory, absolute_path, parser->optimization_level);
+
+    if(!load_bytecode(parser, filepath, source_hash)) {
+        /* cache miss: parse the script, recording its bytecode */
+        parser->bytecode = surgescript_bytecode_create(source_hash, parser->optimization_level);
+        surgescript_lexer_set(parser->lexer, data);
+        parse(parser);
+
+        /* update the cache */
+        if(parser->bytecode != NULL) {
+            surgescript_bytecode_save(parser->bytecode, filepath);
+            parser->bytecode = surgescript_bytecode_destroy(parser->bytecode);
+        }
+    }
+
+    ssfree(filepath);
+}
+
+/* loads the bytecode of a script, if it's valid. Returns true on success */
+bool load_bytecode(surgescript_parser_t* parser, const char* filepath, uint64_t source_hash)
+{
+    surgescript_bytecode_t* bytecode = surgescript_bytecode_load(filepath, source_hash, parser->optimization_level);
+    surgescript_bytecode_record_t record;
+    const char* object_name = NULL;
+
+    if(bytecode == NULL)
+        return false;
+
+    /* the objects must be compiled in the same environment */
+    while((record = surgescript_bytecode_next(bytecode)) != SSBC_END) {
+        if(record == SSBC_OBJECT) {
+            object_name = surgescript_bytecode_name(bytecode);
+            if(surgescript_programpool_exists(parser->program_pool, object_name, "state:main") ||
+            environment_fingerprint(parser, object_name) != surgescript_bytecode_fingerprint(bytecode)) {
+                surgescript_bytecode_destroy(bytecode);
+                return false;
+            }
+        }
+    }
+
+    /* replay the records */
+    sslog("Using bytecode %s", filepath);
+    surgescript_bytecode_rewind(bytecode);
+    while((record = surgescript_bytecode_next(bytecode)) != SSBC_END) {
+        const char* name = surgescript_bytecode_name(bytecode);
+        switch(record) {
+            case SSBC_OBJECT:
+                object_name = name;
+                break;
+
+            case SSBC_PROGRAM:
+                surgescript_programpool_put(parser->program_pool, object_name, name, surgescript_bytecode_program(bytecode));
+                break;
+
+            case SSBC_EMPTY_PROGRAM:
+                surgescript_programpool_put(parser->program_pool, object_name, name, surgescript_program_create_native(0, empty_main));
+                break;
+
+            case SSBC_LAYOUT:
+                surgescript_bytecode_layout(bytecode, parser->program_pool, object_name);
+                break;
+
+            case SSBC_TAG:
+                surgescript_tagsystem_add_tag(parser->tag_system, object_name, name);
+                break;
+
+            case SSBC_PLUGIN:
+                add_to_plugins_list(parser, name);
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    /* done! */
+    surgescript_bytecode_destroy(bytecode);
+    return true;
+}
+
+/* stops recording the bytecode of the file being parsed (it won't be cached) */
+void discard_bytecode(surgescript_parser_t* parser)
+{
+    if(parser->bytecode != NULL)
+        parser->bytecode = surgescript_bytecode_destroy(parser->bytecode);
+}
+
+/* the path of the bytecode of a script in the cache */
+char* bytecode_filepath(const char* cache_directory, const char* absolute_path, int optimization_level)
+{
+    uint64_t hash = surgescript_bytecode_hash(absolute_path, strlen(absolute_path), 0);
+    size_t size = strlen(cache_directory) + 32;
+    char* filepath = ssmalloc(size);
+
+    snprintf(filepath, size, "%s/%016llx-%d.ssbc", cache_directory, (unsigned long long)hash, optimization_level);
+    return filepath;
+}
+
+/* the code generated for an object depends on the programs that exist
+   for it (and for Object) before it's parsed; e.g., its accessors */
+uint64_t environment_fingerprint(surgescript_parser_t* parser, const char* object_name)
+{
+    const char* names[] = { "Object", object_name };
+    uint64_t data[2] = { 0, 0 }; /* { fingerprint, seed } */
+
+    for(int i = 0; i < sizeof(names) / sizeof(*names); i++) {
+        data[1] = surgescript_bytecode_hash(names[i], strlen(names[i]), i);
+        surgescript_programpool_foreach_ex(parser->program_pool, names[i], data, fingerprint_program);
+    }
+
+    return data[0];
+}
+
+/* combines the name of a program with the fingerprint (order-independent) */
+void fingerprint_program(const char* program_name, void* data)
+{
+    uint64_t* fingerprint = (uint64_t*)data;
+    fingerprint[0] += surgescript_bytecode_hash(program_name, strlen(program_name), fingerprint[1]);
+}
+
+
 /* non-terminals of the grammar */
 
 void objectlist(surgescript_parser_t* parser)
@@ -653,6 +895,12 @@ void object(surgescript_parser_t* parser)
             ssfatal("Compile Error: duplicate definition of object \"%s\" in %s:%d.", object_name, parser->filename, surgescript_token_linenumber(parser->lookahead));
     }
 
+    /* record the bytecode */
+    if(duplicate || strcmp(object_name, "Object") == 0)
+        discard_bytecode(parser); /* the result depends on the objects that were parsed before */
+    else if(parser->bytecode != NULL)
+        surgescript_bytecode_add_object(parser->bytecode, object_name, environment_fingerprint(parser, object_name));
+
     /* read the object */
     match(parser, SSTOK_STRING);
     qualifiers(parser, context);
@@ -662,9 +910,11 @@ void object(surgescript_parser_t* parser)
 
     /* object configuration */
     process_annotations(parser, annotations, object_name);
-    surgescript_programpool_put(parser->program_pool, object_name, "__ssconstructor", context.program);
+    put_layout(parser, object_name, surgescript_symtable_local_count(context.symtable));
+    surgescript_program_optimize(context.program, parser->optimization_level);
+    put_program(parser, object_name, "__ssconstructor", context.program);
     if(!surgescript_programpool_shallowcheck(parser->program_pool, object_name, "get___file"))
-        surgescript_programpool_put(parser->program_pool, object_name, "get___file", make_file_program(context.source_file));
+        put_program(parser, object_name, "get___file", make_file_program(context.source_file));
 
     /* cleanup */
     if(duplicate && (parser->flags & SSPARSER_SKIP_DUPLICATES))
@@ -676,16 +926,10 @@ void object(surgescript_parser_t* parser)
 
 void objectdecl(surgescript_parser_t* parser, surgescript_nodecontext_t context)
 {
-    surgescript_program_label_t start = surgescript_program_new_label(context.program);
-    surgescript_program_label_t end = surgescript_program_new_label(context.program);
-
     /* import properties */
     import_public_vars(parser, context, "Object");
     import_public_vars(parser, context, context.object_name);
 
-    /* allocate variables */
-    emit_object_header(context, start, end);
-
     /* read non-terminals */
     vardecllist(parser, context);
     statedecllist(parser, context);
@@ -694,8 +938,8 @@ void objectdecl(surgescript_parser_t* parser, surgescript_nodecontext_t context)
     /* check if the object is all right */
     validate_object(parser, context);
 
-    /* tell the program how many variables should be allocated */
-    emit_object_footer(context, start, end);
+    /* finish the constructor */
+    emit_object_footer(context);
 }
 
 void qualifiers(surgescript_parser_t* parser, surgescript_nodecontext_t context)
@@ -716,7 +960,7 @@ void qualifiers(surgescript_parser_t* parser, surgescript_nodecontext_t context)
                 ssfatal("Compile Error: invalid tag name \"%s\" in object \"%s\" at %s:%d", tag_name, context.object_name, context.source_file, surgescript_token_linenumber(parser->lookahead));
 
             /* okay, add tag */
-            surgescript_tagsystem_add_tag(parser->tag_system, context.object_name, tag_name);
+            add_tag(parser, context.object_name, tag_name);
             match(parser, SSTOK_STRING);
             if(optmatch(parser, SSTOK_COMMA))
                 expect(parser, SSTOK_STRING);
@@ -727,7 +971,7 @@ void qualifiers(surgescript_parser_t* parser, surgescript_nodecontext_t context)
         /* read emoticon */
         if(got_type(parser, SSTOK_EMOTICON)) {
             const char* emoticon = surgescript_token_lexeme(parser->lookahead);
-            surgescript_tagsystem_add_tag(parser->tag_system, context.object_name, emoticon);
+            add_tag(parser, context.object_name, emoticon);
             match(parser, SSTOK_EMOTICON);
         }
     }
@@ -772,13 +1016,26 @@ void vardecl(surgescript_parser_t* parser, surgescript_nodecontext_t context)
     bool public_var = optmatch(parser, SSTOK_PUBLIC);
     bool readonly_var = optmatch(parser, SSTOK_READONLY);
     char* id = ssstrdup(surgescript_token_lexeme(parser->lookahead));
+    int first_line = surgescript_program_line_count(context.program);
+    int address = surgescript_symtable_local_count(context.symtable);
+    surgescript_var_t* value = surgescript_var_create();
 
     match(parser, SSTOK_IDENTIFIER);
     match_exactly(parser, SSTOK_ASSIGNOP, "=");
     conditionalexpr(parser, context);
     match(parser, SSTOK_SEMICOLON);
 
-    emit_vardecl(context, id);
+    /* new fields initialized with constants are set up
+       when the object is spawned (see the heap layout) */
+    if(!surgescript_symtable_has_symbol(context.symtable, id) && emit_constdecl(context, id, first_line, value)) {
+        while(ssarray_length(parser->field_value) <= address)
+            ssarray_push(parser->field_value, NULL);
+        parser->field_value[address] = value;
+    }
+    else {
+        emit_vardecl(context, id);
+        surgescript_var_destroy(value);
+    }
     if(public_var) {
         create_getter(parser, context, id);
         if(!readonly_var)
@@ -800,6 +1057,7 @@ void statedecl(surgescript_parser_t* parser, surgescript_nodecontext_t context)
 {
     static const char prefix[] = "state:";
     const char* state_name = surgescript_token_lexeme(parser->lookahead);
+    surgescript_regwindow_t regs = regwindow();
     char* program_name;
     int fun_header = 0;
 
@@ -822,6 +1080,7 @@ void statedecl(surgescript_parser_t* parser, surgescript_nodecontext_t context)
         surgescript_symtable_create(context.symtable), /* new symbol table for local variables */
         surgescript_program_create(0)
     );
+    context.regwindow = &regs;
 
     /* duplicate check */
     if(surgescript_programpool_shallowcheck(parser->program_pool, context.object_name, program_name))
@@ -835,7 +1094,8 @@ void statedecl(surgescript_parser_t* parser, surgescript_nodecontext_t context)
     match(parser, SSTOK_RCURLY);
 
     /* register the function and cleanup */
-    surgescript_programpool_put(parser->program_pool, context.object_name, program_name, context.program);
+    surgescript_program_optimize(context.program, parser->optimization_level);
+    put_program(parser, context.object_name, program_name, context.program);
     surgescript_symtable_destroy(context.symtable);
     ssfree(program_name);
 }
@@ -852,6 +1112,7 @@ void fundecl(surgescript_parser_t* parser, surgescript_nodecontext_t context)
 {
     int i, fun_header = 0;
     int num_arguments = 0;
+    surgescript_regwindow_t regs = regwindow();
     char* program_name = ssstrdup(surgescript_token_lexeme(parser->lookahead));
     SSARRAY(surgescript_token_t*, arg);
     ssarray_init(arg);
@@ -887,6 +1148,7 @@ void fundecl(surgescript_parser_t* parser, surgescript_nodecontext_t context)
         surgescript_symtable_create(context.symtable), /* new symbol table for local variables */
         surgescript_program_create(num_arguments)
     );
+    context.regwindow = &regs;
 
     /* write list of arguments to the symbol table */
     for(i = 0; i < num_arguments; i++) {
@@ -902,7 +1164,8 @@ void fundecl(surgescript_parser_t* parser, surgescript_nodecontext_t context)
     match(parser, SSTOK_RCURLY);
 
     /* register the function and cleanup */
-    surgescript_programpool_put(parser->program_pool, context.object_name, program_name, context.program);
+    surgescript_program_optimize(context.program, parser->optimization_level);
+    put_program(parser, context.object_name, program_name, context.program);
     surgescript_symtable_destroy(context.symtable);
     ssarray_release(arg);
     ssfree(program_name);
@@ -1326,7 +1589,7 @@ void constant(surgescript_parser_t* parser, surgescript_nodecontext_t context)
             break;
 
         case SSTOK_NUMBER:
-            emit_number(context, atof(surgescript_token_lexeme(token)));
+            emit_number(context, surgescript_util_strtod(surgescript_token_lexeme(token), NULL));
             match(parser, surgescript_token_type(token));
             break;
 
@@ -1620,13 +1883,13 @@ void signednum(surgescript_parser_t* parser, surgescript_nodecontext_t context)
         match(parser, SSTOK_ADDITIVEOP);
         if(got_type(parser, SSTOK_NUMBER)) {
             token = parser->lookahead;
-            value = atof(surgescript_token_lexeme(token));
+            value = surgescript_util_strtod(surgescript_token_lexeme(token), NULL);
             emit_number(context, plus ? value : -value);
         }
         match(parser, SSTOK_NUMBER);
     }
     else if(got_type(parser, SSTOK_NUMBER)) {
-        emit_number(context, atof(surgescript_token_lexeme(token)));
+        emit_number(context, surgescript_util_strtod(surgescript_token_lexeme(token), NULL));
         match(parser, SSTOK_NUMBER);
     }
     else
@@ -1678,6 +1941,8 @@ void add_to_plugins_list(surgescript_parser_t* parser, const char* plugin_name)
 
     /* add to the plugins list */
     ssarray_push(parser->known_plugins, ssstrdup(plugin_name));
+    if(parser->bytecode != NULL)
+        surgescript_bytecode_add_plugin(parser->bytecode, plugin_name);
 }
 
 surgescript_symtable_t* configure_base_table(surgescript_symtable_t* base_table)
@@ -1726,6 +1991,17 @@ void release_annotations(char** annotations)
     }
 }
 
+/* the children of a @Parallel object are updated in parallel (see vm.h). The
+   object manager looks for this program, which is cached with the others */
+void mark_as_parallel(surgescript_parser_t* parser, const char* object_name)
+{
+    if(!surgescript_programpool_shallowcheck(parser->program_pool, object_name, "__ssparallel")) {
+        surgescript_program_t* program = surgescript_program_create(0);
+        surgescript_program_add_line(program, SSOP_RET, SSOPu(0), SSOPu(0));
+        put_program(parser, object_name, "__ssparallel", program);
+    }
+}
+
 void process_annotations(surgescript_parser_t* parser, char** annotations, const char* object_name)
 {
     /* I have made the annotations system in such
@@ -1735,6 +2011,8 @@ void process_annotations(surgescript_parser_t* parser, char** annotations, const
             const char* annotation = *annotations++;
             if(strcmp(annotation, "@Package") == 0 || strcmp(annotation, "@Plugin") == 0)
                 add_to_plugins_list(parser, object_name);
+            else if(strcmp(annotation, "@Parallel") == 0)
+                mark_as_parallel(parser, object_name);
             else
                 ssfatal("Compile Error: unrecognized annotation \"%s\" around object \"%s\" in %s.", annotation, object_name, parser->filename);
         }
@@ -144,6 +144,9 @@ typedef enum surgescript_parser_flags_t {
     SSPARSER_SKIP_DUPLICATES = 2, /* skip duplicate objects */
 } surgescript_parser_flags_t;
 
+/* optimization level of the compiled programs (0 = no optimization) */
+#define SSPARSER_DEFAULT_OPTIMIZATION_LEVEL 2
+
 /* create & destroy */
 surgescript_parser_t* surgescript_parser_create(struct surgescript_programpool_t* program_pool, struct surgescript_tagsystem_t* tag_system);
 surgescript_parser_t* surgescript_parser_destroy(surgescript_parser_t* parser);
@@ -154,5 +157,9 @@ bool surgescript_parser_parsemem(surgescript_parser_t* parser, const char* code_
 void surgescript_parser_foreach_plugin(surgescript_parser_t* parser, void* data, void (*fun)(const char*,void*)); /* foreach plugin object found in any parsed script, run fun(object_name, data) */
 void surgescript_parser_set_flags(surgescript_parser_t* parser, surgescript_parser_flags_t flags); /* set parser options (flags) */
 surgescript_parser_flags_t surgescript_parser_get_flags(surgescript_parser_t* parser); /* get parser flags */
+void surgescript_parser_set_optimization_level(surgescript_parser_t* parser, int level); /* set the optimization level (0, 1 or 2) */
+int surgescript_parser_get_optimization_level(surgescript_parser_t* parser); /* get the optimization level */
+void surgescript_parser_set_cache_directory(surgescript_parser_t* parser, const char* directory); /* enable a bytecode cache in the given directory (NULL disables it) */
+const char* surgescript_parser_get_cache_directory(surgescript_parser_t* parser); /* get the directory of the bytecode cache (may be NULL) */
 
 #endif
\ No newline at end of file
@@ -19,22 +19,33 @@
  * SurgeScript heap
  */
 
+#include <string.h>
 #include "heap.h"
 #include "variable.h"
 #include "../util/util.h"
+#include "../util/slab.h"
 
 /* constants */
 static const size_t SSHEAP_INITIAL_SIZE = 8;
 static const size_t SSHEAP_MAX_SIZE = 10 * 1024 * 1024; /* 10M cells max */
 
+/* free cells are linked together; link[i] tells whether mem[i] is in use */
+#define IN_USE                  ((surgescript_heapptr_t)(~0u))      /* mem[i] is allocated */
+#define END_OF_LIST             ((surgescript_heapptr_t)(~0u - 1))  /* mem[i] is the last free cell */
+
 /* heap structure */
 struct surgescript_heap_t
 {
     size_t size;                /* size of the heap */
-    surgescript_heapptr_t ptr;  /* allocation pointer */
-    surgescript_var_t** mem;    /* data memory */
+    surgescript_heapptr_t ptr;  /* allocation pointer: the first free cell, or END_OF_LIST */
+    surgescript_var_t* mem;     /* data memory (variables are stored inline) */
+    surgescript_heapptr_t* link; /* link[i] is IN_USE or the free cell that follows mem[i] */
+    surgescript_slab_t* slab;   /* memory allocator */
 };
 
+static void resize(surgescript_heap_t* heap, size_t new_size);
+static inline bool in_use(const surgescript_heap_t* heap, surgescript_heapptr_t ptr);
+
 
 /* -------------------------------
  * public methods
@@ -44,16 +55,17 @@ struct surgescript_heap_t
  * surgescript_heap_create()
  * Creates a new heap
  */
-surgescript_heap_t* surgescript_heap_create()
+surgescript_heap_t* surgescript_heap_create(surgescript_slab_t* slab, size_t size)
 {
-    surgescript_heap_t* heap = ssmalloc(sizeof *heap);
-    size_t size = SSHEAP_INITIAL_SIZE;
+    surgescript_heap_t* heap = surgescript_slab_alloc(slab, sizeof *heap);
+    size = ssclamp(size, SSHEAP_INITIAL_SIZE, SSHEAP_MAX_SIZE - 1);
 
-    heap->mem = ssmalloc(size * sizeof(*(heap->mem)));
-    heap->size = size;
-    heap->ptr = size;
-    while(heap->ptr)
-        heap->mem[--heap->ptr] = NULL;
+    heap->slab = slab;
+    heap->mem = NULL;
+    heap->link = NULL;
+    heap->size = 0;
+    heap->ptr = END_OF_LIST;
+    resize(heap, size);
 
     return heap;
 }
@@ -64,13 +76,14 @@ surgescript_heap_t* surgescript_heap_create()
  */
 surgescript_heap_t* surgescript_heap_destroy(surgescript_heap_t* heap)
 {
-    for(heap->ptr = 0; heap->ptr < heap->size; heap->ptr++) {
-        if(heap->mem[heap->ptr] != NULL)
-            surgescript_var_destroy(heap->mem[heap->ptr]);
+    for(surgescript_heapptr_t ptr = 0; ptr < heap->size; ptr++) {
+        if(heap->link[ptr] == IN_USE)
+            surgescript_var_set_null(&(heap->mem[ptr]));
     }
 
-    ssfree(heap->mem);
-    return ssfree(heap);
+    surgescript_slab_free(heap->slab, heap->link, heap->size * sizeof(*(heap->link)));
+    surgescript_slab_free(heap->slab, heap->mem, heap->size * sizeof(*(heap->mem)));
+    return surgescript_slab_free(heap->slab, heap, sizeof *heap);
 }
 
 /*
@@ -79,26 +92,23 @@ surgescript_heap_t* surgescript_heap_destroy(surgescript_heap_t* heap)
  */
 surgescript_heapptr_t surgescript_heap_malloc(surgescript_heap_t* heap)
 {
-    for(; heap->ptr < heap->size; heap->ptr++) {
-        if(heap->mem[heap->ptr] == NULL) {
-            heap->mem[heap->ptr] = surgescript_var_create();
-            return heap->ptr;
+    surgescript_heapptr_t ptr;
+
+    /* no free cells? */
+    if(heap->ptr == END_OF_LIST) {
+        if(heap->size * 2 >= SSHEAP_MAX_SIZE) { /* just in case... */
+            ssfatal("surgescript_heap_malloc(): max size exceeded.");
+            return heap->size - 1;
         }
-    }
 
-    if(heap->size * 2 >= SSHEAP_MAX_SIZE) { /* just in case... */
-        ssfatal("surgescript_heap_malloc(): max size exceeded.");
-        return heap->size - 1;
+        resize(heap, heap->size * 2);
     }
 
-
-    if(heap->size * 2 >= 256)
-        sslog("surgescript_heap_malloc(): resizing heap to %d cells.", heap->size * 2);
-    heap->mem = ssrealloc(heap->mem, (heap->size * 2) * sizeof(*(heap->mem)));
-    while(heap->ptr)
-        heap->mem[heap->size + --(heap->ptr)] = NULL;
-    heap->size *= 2;
-    return surgescript_heap_malloc(heap);
+    /* pick the first free cell (free cells are null) */
+    ptr = heap->ptr;
+    heap->ptr = heap->link[ptr];
+    heap->link[ptr] = IN_USE;
+    return ptr;
 }
 
 /*
@@ -107,22 +117,41 @@ surgescript_heapptr_t surgescript_heap_malloc(surgescript_heap_t* heap)
  */
 surgescript_heapptr_t surgescript_heap_free(surgescript_heap_t* heap, surgescript_heapptr_t ptr)
 {
-    if(ptr >= 0 && ptr < heap->size && heap->mem[ptr] != NULL) {
-        heap->mem[ptr] = surgescript_var_destroy(heap->mem[ptr]);
+    if(in_use(heap, ptr)) {
+        surgescript_var_set_null(&(heap->mem[ptr]));
+        heap->link[ptr] = heap->ptr;
         heap->ptr = ptr;
     }
 
     return 0;
 }
 
+/*
+ * surgescript_heap_reserve()
+ * Makes room for at least n cells, so that the heap
+ * won't be resized until it stores more than n cells
+ */
+void surgescript_heap_reserve(surgescript_heap_t* heap, size_t n)
+{
+    if(n > heap->size) {
+        if(n >= SSHEAP_MAX_SIZE) {
+            ssfatal("surgescript_heap_reserve(): max size exceeded.");
+            return;
+        }
+
+        resize(heap, n);
+    }
+}
+
 /*
  * surgescript_heap_at()
- * Returns the memory cell pointed by ptr
+ * Returns the memory cell pointed by ptr. The returned
+ * pointer is invalidated by surgescript_heap_malloc()
  */
 surgescript_var_t* surgescript_heap_at(const surgescript_heap_t* heap, surgescript_heapptr_t ptr)
 {
-    if(ptr >= 0 && ptr < heap->size && heap->mem[ptr] != NULL)
-        return heap->mem[ptr];
+    if(in_use(heap, ptr))
+        return &(heap->mem[ptr]);
 
     ssfatal("surgescript_heap_at(0x%X): null pointer exception.", ptr);
     return NULL;
@@ -135,11 +164,11 @@ surgescript_var_t* surgescript_heap_at(const surgescript_heap_t* heap, surgescri
 void surgescript_heap_scan_objects(surgescript_heap_t* heap, void* userdata, bool (*callback)(unsigned,void*))
 {
     for(surgescript_heapptr_t ptr = 0; ptr < heap->size; ptr++) {
-        if(heap->mem[ptr] != NULL) {
-            unsigned handle = surgescript_var_get_objecthandle(heap->mem[ptr]);
+        if(heap->link[ptr] == IN_USE) {
+            unsigned handle = surgescript_var_get_objecthandle(&(heap->mem[ptr]));
             if(handle != 0) { /* if heap->mem[ptr] is an object and not null */
                 if(!callback(handle, userdata)) /* if the handle is broken */
-                    surgescript_var_set_null(heap->mem[ptr]); /* fix it */
+                    surgescript_var_set_null(&(heap->mem[ptr])); /* fix it */
             }
         }
     }
@@ -160,7 +189,7 @@ size_t surgescript_heap_size(const surgescript_heap_t* heap)
  */
 bool surgescript_heap_validaddress(const surgescript_heap_t* heap, surgescript_heapptr_t ptr)
 {
-    return (ptr >= 0 && ptr < heap->size && heap->mem[ptr] != NULL);
+    return in_use(heap, ptr);
 }
 
 /*
@@ -172,9 +201,36 @@ size_t surgescript_heap_memspent(const surgescript_heap_t* heap)
     size_t size = 0;
 
     for(surgescript_heapptr_t ptr = 0; ptr < heap->size; ptr++) {
-        if(heap->mem[ptr] != NULL)
-            size += surgescript_var_size(heap->mem[ptr]);
+        if(heap->link[ptr] == IN_USE)
+            size += surgescript_var_size(&(heap->mem[ptr]));
     }
 
     return size;
-}
\ No newline at end of file
+}
+
+
+
+/* -------------------------------
+ * private methods
+ * ------------------------------- */
+
+/* resizes the heap to new_size cells (new_size >= size). New cells are free
+   and are put in front of the free list, in increasing order of address */
+void resize(surgescript_heap_t* heap, size_t new_size)
+{
+    heap->mem = surgescript_slab_realloc(heap->slab, heap->mem, heap->size * sizeof(*(heap->mem)), new_size * sizeof(*(heap->mem)));
+    heap->link = surgescript_slab_realloc(heap->slab, heap->link, heap->size * sizeof(*(heap->link)), new_size * sizeof(*(heap->link)));
+    memset(heap->mem + heap->size, 0, (new_size - heap->size) * sizeof(*(heap->mem))); /* null variables */
+
+    for(size_t i = heap->size; i < new_size - 1; i++)
+        heap->link[i] = i + 1;
+    heap->link[new_size - 1] = heap->ptr;
+    heap->ptr = heap->size;
+    heap->size = new_size;
+}
+
+/* is the memory cell pointed by ptr allocated? */
+bool in_use(const surgescript_heap_t* heap, surgescript_heapptr_t ptr)
+{
+    return ptr < heap->size && heap->link[ptr] == IN_USE;
+}
@@ -32,12 +32,14 @@ typedef unsigned surgescript_heapptr_t;
 
 /* forward declarations */
 struct surgescript_var_t;
+struct surgescript_slab_t;
 
 /* public methods */
-surgescript_heap_t* surgescript_heap_create();
+surgescript_heap_t* surgescript_heap_create(struct surgescript_slab_t* slab, size_t size); /* creates a heap with room for (at least) size cells, taken from the given slab allocator */
 surgescript_heap_t* surgescript_heap_destroy(surgescript_heap_t* heap);
 surgescript_heapptr_t surgescript_heap_malloc(surgescript_heap_t* heap);
 surgescript_heapptr_t surgescript_heap_free(surgescript_heap_t* heap, surgescript_heapptr_t ptr);
+void surgescript_heap_reserve(surgescript_heap_t* heap, size_t n); /* makes room for at least n cells */
 struct surgescript_var_t* surgescript_heap_at(const surgescript_heap_t* heap, surgescript_heapptr_t ptr);
 void surgescript_heap_scan_objects(surgescript_heap_t* heap, void* userdata, bool (*callback)(unsigned,void*));
 size_t surgescript_heap_size(const surgescript_heap_t* heap);
@@ -31,12 +31,17 @@
 #include "../util/transform.h"
 #include "../util/ssarray.h"
 #include "../util/util.h"
+#include "../util/slab.h"
+
+#define FASTHASH_INLINE
+#include "../util/fasthash.h"
 
 /* object structure */
 struct surgescript_object_t
 {
     /* general properties */
-    char* name; /* my name */
+    const char* name; /* my name (interned by the program pool) */
+    int class_id; /* interned id of my name */
     surgescript_heap_t* heap; /* each object has its own heap */
     surgescript_renv_t* renv; /* runtime environment */
 
@@ -45,13 +50,20 @@ struct surgescript_object_t
     unsigned parent; /* handle to the parent in the object manager */
     SSARRAY(unsigned, child); /* handles to the children */
     int depth; /* object depth */
+    int sibling_index; /* my position in the child array of my parent */
+    int removed_children; /* null handles left in my child array by removed children */
+    unsigned prev_of_kind, next_of_kind; /* my siblings with my name, in order (only if my parent indexes its children) */
+    fasthash_t* child_kind; /* class id -> surgescript_objectkind_t, if I index my children; NULL otherwise */
 
     /* inner state */
     surgescript_program_t* current_state; /* current state */
     char* state_name; /* current state name */
     bool is_active; /* can i run programs? */
+    bool is_parallel; /* are my children updated in parallel? */
     bool is_killed; /* am i scheduled to be destroyed? */
     bool is_reachable; /* is this object reachable through some other? (garbage-collection) */
+    bool is_young; /* is this object in the nursery? (garbage-collection) */
+    bool is_remembered; /* is this object in the remembered set? (garbage-collection) */
     uint64_t last_state_change; /* moment of the last state change */
     uint64_t time_spent; /* how much time did this object consume since the last state change */
 
@@ -60,18 +72,46 @@ struct surgescript_object_t
 
     /* user-data */
     void* user_data; /* custom user-data */
+    void (*user_data_scanner)(surgescript_object_t*,void*,bool (*)(unsigned,void*)); /* scans the user-data for object handles */
+};
+
+/* children of the same kind (i.e., name) */
+typedef struct surgescript_objectkind_t surgescript_objectkind_t;
+struct surgescript_objectkind_t
+{
+    unsigned first, last; /* handles to the first & last children of this kind */
 };
 
 /* functions */
 void surgescript_object_release(surgescript_object_t* object);
+extern void surgescript_objectmanager_link(surgescript_objectmanager_t* manager, const unsigned* handle, int n);
+extern void surgescript_objectmanager_unlink(surgescript_objectmanager_t* manager, unsigned handle);
+void surgescript_object_set_thread_stack(surgescript_stack_t* stack);
 
 /* private stuff */
 #define MAIN_STATE "main"
-static char* state2fun(const char* state);
+#define PARALLEL_FUN "__ssparallel" /* present in the objects annotated with @Parallel */
+#define STATE2FUN_BUFSIZE 64
+static char* state2fun(const char* state, char* buf, size_t bufsize);
+static char* copy_state_name(surgescript_slab_t* slab, const char* state_name);
+static void* release_state_name(surgescript_slab_t* slab, char* state_name);
 static uint64_t run_current_state(const surgescript_object_t* object);
 static surgescript_program_t* get_state_program(const surgescript_object_t* object, const char* state_name);
 static bool object_exists(surgescript_programpool_t* program_pool, const char* object_name);
+static surgescript_heap_t* create_heap(const surgescript_object_t* object, surgescript_slab_t* slab, surgescript_programpool_t* program_pool);
 static bool simple_traversal(surgescript_object_t* object, void* data);
+static void index_child(surgescript_object_t* object, surgescript_object_t* child);
+static void unindex_child(surgescript_object_t* object, surgescript_object_t* child);
+static void create_child_index(surgescript_object_t* object);
+static surgescript_objectkind_t* find_kind(const surgescript_object_t* object, const char* name);
+static void release_kind(void* kind);
+#define CHILD_INDEX_THRESHOLD 16 /* index the children by name when there are this many */
+static inline surgescript_object_t* child_at(const surgescript_object_t* object, int index);
+static void compact_children(surgescript_object_t* object);
+static void get_constructors(const surgescript_object_t* object, surgescript_program_t** pre_constructor, surgescript_program_t** constructor);
+static void call_constructors(surgescript_object_t* object, surgescript_program_t* pre_constructor, surgescript_program_t* constructor);
+static inline surgescript_renv_t* thread_renv(const surgescript_object_t* object, surgescript_renv_t* buf);
+static SS_THREADLOCAL surgescript_stack_t* thread_stack = NULL; /* the stack of a thread that updates objects in parallel; NULL on the main thread */
 
 /* -------------------------------
  * public methods
@@ -91,30 +131,42 @@ static bool simple_traversal(surgescript_object_t* object, void* data);
  */
 surgescript_object_t* surgescript_object_create(const char* name, unsigned handle, surgescript_objectmanager_t* object_manager, surgescript_programpool_t* program_pool, surgescript_stack_t* stack, void* user_data)
 {
-    surgescript_object_t* obj = ssmalloc(sizeof *obj);
+    surgescript_slab_t* slab = surgescript_objectmanager_slab(object_manager);
+    surgescript_object_t* obj = surgescript_slab_alloc(slab, sizeof *obj);
 
     if(!object_exists(program_pool, name))
         ssfatal("Runtime Error: can't spawn object \"%s\" - it doesn't exist!", name);
 
-    obj->name = ssstrdup(name);
-    obj->heap = surgescript_heap_create();
+    obj->class_id = surgescript_programpool_class_id(program_pool, name);
+    obj->name = surgescript_programpool_class_name(program_pool, obj->class_id);
+    obj->heap = create_heap(obj, slab, program_pool);
     obj->renv = surgescript_renv_create(obj, stack, obj->heap, program_pool, object_manager, NULL);
 
     obj->handle = handle; /* handle == parent implies I am a root */
     obj->parent = handle;
-    ssarray_init(obj->child);
+    obj->child_len = 0;
+    obj->child_cap = 4;
+    obj->child = surgescript_slab_alloc(slab, obj->child_cap * sizeof(*(obj->child)));
     obj->depth = 0;
+    obj->sibling_index = 0;
+    obj->removed_children = 0;
+    obj->prev_of_kind = obj->next_of_kind = surgescript_objectmanager_null(object_manager);
+    obj->child_kind = NULL;
 
-    obj->state_name = ssstrdup(MAIN_STATE);
+    obj->state_name = copy_state_name(slab, MAIN_STATE);
     obj->current_state = get_state_program(obj, obj->state_name);
     obj->last_state_change = surgescript_util_gettickcount();
     obj->time_spent = 0;
     obj->is_active = true;
+    obj->is_parallel = surgescript_programpool_shallowcheck(program_pool, name, PARALLEL_FUN);
     obj->is_killed = false;
     obj->is_reachable = false;
+    obj->is_young = false;
+    obj->is_remembered = false;
 
     obj->transform = NULL;
     obj->user_data = user_data;
+    obj->user_data_scanner = NULL;
 
     return obj;
 }
@@ -126,6 +178,7 @@ surgescript_object_t* surgescript_object_create(const char* name, unsigned handl
 surgescript_object_t* surgescript_object_destroy(surgescript_object_t* obj)
 {
     surgescript_objectmanager_t* manager = surgescript_renv_objectmanager(obj->renv);
+    surgescript_slab_t* slab = surgescript_objectmanager_slab(manager);
     int i;
 
     /* call destructor */
@@ -139,11 +192,15 @@ surgescript_object_t* surgescript_object_destroy(surgescript_object_t* obj)
 
     /* clear up the children */
     for(i = 0; i < ssarray_length(obj->child); i++) {
-        surgescript_object_t* child = surgescript_objectmanager_get(manager, obj->child[i]);
+        surgescript_object_t* child = child_at(obj, i);
+        if(child == NULL)
+            continue;
         child->parent = child->handle; /* the child is a root now */
         surgescript_objectmanager_delete(manager, child->handle); /* clear up everyone! */
     }
-    ssarray_release(obj->child);
+    surgescript_slab_free(slab, obj->child, obj->child_cap * sizeof(*(obj->child)));
+    if(obj->child_kind != NULL)
+        fasthash_destroy(obj->child_kind);
 
     /* clear up the local transform, if any */
     if(obj->transform != NULL)
@@ -152,9 +209,8 @@ surgescript_object_t* surgescript_object_destroy(surgescript_object_t* obj)
     /* clear up some data */
     surgescript_renv_destroy(obj->renv);
     surgescript_heap_destroy(obj->heap);
-    ssfree(obj->state_name);
-    ssfree(obj->name);
-    ssfree(obj);
+    release_state_name(slab, obj->state_name);
+    surgescript_slab_free(slab, obj, sizeof *obj);
 
     /* done! */
     return NULL;
@@ -177,6 +233,15 @@ const char* surgescript_object_name(const surgescript_object_t* object)
     return object->name;
 }
 
+/*
+ * surgescript_object_class_id()
+ * The interned id of my name. Objects having the same name share the same id
+ */
+int surgescript_object_class_id(const surgescript_object_t* object)
+{
+    return object->class_id;
+}
+
 /*
  * surgescript_object_heap()
  * Each object has its own heap. This gets mine.
@@ -206,13 +271,39 @@ void* surgescript_object_userdata(const surgescript_object_t* object)
 
 /*
  * surgescript_object_set_userdata()
- * Set custom user data
+ * Set custom user data. Whenever native code stores an object handle in the
+ * user data (or in the heap) of an object, it must call
+ * surgescript_objectmanager_write_barrier() on that object afterwards;
+ * otherwise the garbage collector may dispose the referenced object
  */
 void surgescript_object_set_userdata(surgescript_object_t* object, void* data)
 {
     object->user_data = data;
 }
 
+/*
+ * surgescript_object_set_userdata_scanner()
+ * Native objects that store object handles in their user data (outside the
+ * heap) must provide a scanner, so that the garbage collector can see them.
+ * The scanner calls callback(handle, data) for each handle; if the callback
+ * returns false, the handle is broken and should be set to null
+ */
+void surgescript_object_set_userdata_scanner(surgescript_object_t* object, void (*scanner)(surgescript_object_t*,void*,bool (*)(unsigned,void*)))
+{
+    object->user_data_scanner = scanner;
+}
+
+/*
+ * surgescript_object_scan_objects()
+ * Scans the heap & the user data of the object, calling callback for each object handle
+ */
+void surgescript_object_scan_objects(surgescript_object_t* object, void* data, bool (*callback)(unsigned,void*))
+{
+    surgescript_heap_scan_objects(object->heap, data, callback);
+    if(object->user_data_scanner != NULL)
+        object->user_data_scanner(object, data, callback);
+}
+
 /*
  * surgescript_object_has_tag()
  * Is this object tagged tag_name?
@@ -264,6 +355,10 @@ unsigned surgescript_object_parent(const surgescript_object_t* object)
  */
 unsigned surgescript_object_nth_child(const surgescript_object_t* object, int index)
 {
+    /* removing the null handles doesn't change the order of the children */
+    if(object->removed_children > 0)
+        compact_children((surgescript_object_t*)object);
+
     if(index >= 0 && index < ssarray_length(object->child))
         return object->child[index];
     else
@@ -276,7 +371,7 @@ unsigned surgescript_object_nth_child(const surgescript_object_t* object, int in
  */
 int surgescript_object_child_count(const surgescript_object_t* object)
 {
-    return ssarray_length(object->child);
+    return ssarray_length(object->child) - object->removed_children;
 }
 
 /*
@@ -287,8 +382,16 @@ unsigned surgescript_object_child(const surgescript_object_t* object, const char
 {
     surgescript_objectmanager_t* manager = surgescript_renv_objectmanager(object->renv);
 
+    /* use the index, if any */
+    if(object->child_kind != NULL) {
+        surgescript_objectkind_t* kind = find_kind(object, name);
+        return kind != NULL ? kind->first : surgescript_objectmanager_null(manager);
+    }
+
     for(int i = 0; i < ssarray_length(object->child); i++) {
-        surgescript_object_t* child = surgescript_objectmanager_get(manager, object->child[i]);
+        surgescript_object_t* child = child_at(object, i);
+        if(child == NULL)
+            continue;
         if(strcmp(name, child->name) == 0)
             return child->handle;
     }
@@ -306,8 +409,23 @@ int surgescript_object_children(const surgescript_object_t* object, const char*
     surgescript_objectmanager_t* manager = surgescript_renv_objectmanager(object->renv);
     int count = 0;
 
+    /* use the index, if any */
+    if(object->child_kind != NULL) {
+        surgescript_objectkind_t* kind = find_kind(object, name);
+        surgescript_objecthandle_t null_handle = surgescript_objectmanager_null(manager);
+        for(unsigned handle = kind != NULL ? kind->first : null_handle; handle != null_handle; ) {
+            surgescript_object_t* child = surgescript_objectmanager_get(manager, handle);
+            handle = child->next_of_kind;
+            ++count;
+            callback(child->handle, data);
+        }
+        return count;
+    }
+
     for(int i = 0; i < ssarray_length(object->child); i++) {
-        surgescript_object_t* child = surgescript_objectmanager_get(manager, object->child[i]);
+        surgescript_object_t* child = child_at(object, i);
+        if(child == NULL)
+            continue;
         if(strcmp(name, child->name) == 0) {
             ++count;
             callback(child->handle, data);
@@ -326,7 +444,9 @@ unsigned surgescript_object_tagged_child(const surgescript_object_t* object, con
     surgescript_objectmanager_t* manager = surgescript_renv_objectmanager(object->renv);
 
     for(int i = 0; i < ssarray_length(object->child); i++) {
-        surgescript_object_t* child = surgescript_objectmanager_get(manager, object->child[i]);
+        surgescript_object_t* child = child_at(object, i);
+        if(child == NULL)
+            continue;
         if(surgescript_object_has_tag(child, tag_name))
             return child->handle;
     }
@@ -341,11 +461,12 @@ unsigned surgescript_object_tagged_child(const surgescript_object_t* object, con
  */
 int surgescript_object_tagged_children(const surgescript_object_t* object, const char* tag_name, void* data, void (*callback)(unsigned,void*))
 {
-    surgescript_objectmanager_t* manager = surgescript_renv_objectmanager(object->renv);
     int count = 0;
 
     for(int i = 0; i < ssarray_length(object->child); i++) {
-        surgescript_object_t* child = surgescript_objectmanager_get(manager, object->child[i]);
+        surgescript_object_t* child = child_at(object, i);
+        if(child == NULL)
+            continue;
         if(surgescript_object_has_tag(child, tag_name)) {
             ++count;
             callback(child->handle, data);
@@ -364,19 +485,20 @@ unsigned surgescript_object_find_descendant(const surgescript_object_t* object,
 {
     surgescript_objectmanager_t* manager = surgescript_renv_objectmanager(object->renv);
     surgescript_objecthandle_t null_handle = surgescript_objectmanager_null(manager);
-    int i;
+    unsigned handle = surgescript_object_child(object, name);
 
-    for(i = 0; i < ssarray_length(object->child); i++) {
-        surgescript_object_t* child = surgescript_objectmanager_get(manager, object->child[i]);
-        if(strcmp(name, child->name) == 0)
-            return child->handle;
-    }
+    if(handle != null_handle)
+        return handle;
 
-    for(i = 0; i < ssarray_length(object->child); i++) {
-        surgescript_object_t* child = surgescript_objectmanager_get(manager, object->child[i]);
-        unsigned handle = surgescript_object_find_descendant(child, name);
-        if(handle != null_handle)
-            return handle;
+    for(int i = 0; i < ssarray_length(object->child); i++) {
+        surgescript_object_t* child = child_at(object, i);
+        if(child == NULL)
+            continue;
+        if(ssarray_length(child->child) > 0) {
+            handle = surgescript_object_find_descendant(child, name);
+            if(handle != null_handle)
+                return handle;
+        }
     }
 
     return null_handle;
@@ -390,21 +512,14 @@ unsigned surgescript_object_find_descendant(const surgescript_object_t* object,
  */
 int surgescript_object_find_descendants(const surgescript_object_t* object, const char* name, void* data, void (*callback)(unsigned,void*))
 {
-    surgescript_objectmanager_t* manager = surgescript_renv_objectmanager(object->renv);
-    surgescript_objecthandle_t null_handle = surgescript_objectmanager_null(manager);
-    int i, count = 0;
+    int count = surgescript_object_children(object, name, data, callback);
 
-    for(i = 0; i < ssarray_length(object->child); i++) {
-        surgescript_object_t* child = surgescript_objectmanager_get(manager, object->child[i]);
-        if(strcmp(name, child->name) == 0) {
-            ++count;
-            callback(child->handle, data);
-        }
-    }
-
-    for(i = 0; i < ssarray_length(object->child); i++) {
-        surgescript_object_t* child = surgescript_objectmanager_get(manager, object->child[i]);
-        count += surgescript_object_find_descendants(child, name, data, callback);
+    for(int i = 0; i < ssarray_length(object->child); i++) {
+        surgescript_object_t* child = child_at(object, i);
+        if(child == NULL)
+            continue;
+        if(ssarray_length(child->child) > 0)
+            count += surgescript_object_find_descendants(child, name, data, callback);
     }
 
     return count;
@@ -422,13 +537,17 @@ unsigned surgescript_object_find_tagged_descendant(const surgescript_object_t* o
     int i;
 
     for(i = 0; i < ssarray_length(object->child); i++) {
-        surgescript_object_t* child = surgescript_objectmanager_get(manager, object->child[i]);
+        surgescript_object_t* child = child_at(object, i);
+        if(child == NULL)
+            continue;
         if(surgescript_object_has_tag(child, tag_name))
             return child->handle;
     }
 
     for(i = 0; i < ssarray_length(object->child); i++) {
-        surgescript_object_t* child = surgescript_objectmanager_get(manager, object->child[i]);
+        surgescript_object_t* child = child_at(object, i);
+        if(child == NULL)
+            continue;
         unsigned handle = surgescript_object_find_tagged_descendant(child, tag_name);
         if(handle != null_handle)
             return handle;
@@ -445,12 +564,12 @@ unsigned surgescript_object_find_tagged_descendant(const surgescript_object_t* o
  */
 int surgescript_object_find_tagged_descendants(const surgescript_object_t* object, const char* tag_name, void* data, void (*callback)(unsigned,void*))
 {
-    surgescript_objectmanager_t* manager = surgescript_renv_objectmanager(object->renv);
-    surgescript_objecthandle_t null_handle = surgescript_objectmanager_null(manager);
     int i, count = 0;
 
     for(i = 0; i < ssarray_length(object->child); i++) {
-        surgescript_object_t* child = surgescript_objectmanager_get(manager, object->child[i]);
+        surgescript_object_t* child = child_at(object, i);
+        if(child == NULL)
+            continue;
         if(surgescript_object_has_tag(child, tag_name)) {
             ++count;
             callback(child->handle, data);
@@ -458,7 +577,9 @@ int surgescript_object_find_tagged_descendants(const surgescript_object_t* objec
     }
 
     for(i = 0; i < ssarray_length(object->child); i++) {
-        surgescript_object_t* child = surgescript_objectmanager_get(manager, object->child[i]);
+        surgescript_object_t* child = child_at(object, i);
+        if(child == NULL)
+            continue;
         count += surgescript_object_find_tagged_descendants(child, tag_name, data, callback);
     }
 
@@ -474,44 +595,110 @@ void surgescript_object_add_child(surgescript_object_t* object, unsigned child_h
     surgescript_objectmanager_t* manager = surgescript_renv_objectmanager(object->renv);
     surgescript_object_t* child;
 
-    /* check if it doesn't exist already */
-    for(int i = 0; i < ssarray_length(object->child); i++) {
-        if(object->child[i] == child_handle)
-            return;
-    }
-
     /* check if the child isn't myself */
     if(object->handle == child_handle) {
         ssfatal("Runtime Error: object 0x%X (\"%s\") can't be a child of itself.", object->handle, object->name);
         return;
     }
 
-    /* check if the child belongs to someone else */
+    /* check if it doesn't exist already */
     child = surgescript_objectmanager_get(manager, child_handle);
+    if(child->parent == object->handle)
+        return;
+
+    /* check if the child belongs to someone else */
     if(child->parent != child->handle) {
         ssfatal("Runtime Error: can't add child 0x%X (\"%s\") to object 0x%X (\"%s\") - child already registered", child->handle, child->name, object->handle, object->name);
         return;
     }
 
     /* add it */
-    ssarray_push(object->child, child->handle);
+    if(object->child_len >= object->child_cap) {
+        size_t old_size = object->child_cap * sizeof(*(object->child));
+        object->child_cap *= 2;
+        object->child = surgescript_slab_realloc(surgescript_objectmanager_slab(manager), object->child, old_size, object->child_cap * sizeof(*(object->child)));
+    }
+    child->sibling_index = ssarray_push(object->child, child->handle) - 1;
     child->parent = object->handle;
     child->depth = 1 + object->depth;
+
+    /* index the child by name */
+    if(object->child_kind != NULL)
+        index_child(object, child);
+    else if(surgescript_object_child_count(object) >= CHILD_INDEX_THRESHOLD)
+        create_child_index(object);
+
+    /* update the child and its descendants after this object */
+    surgescript_objectmanager_link(manager, &(child->handle), 1);
+}
+
+/*
+ * surgescript_object_add_children()
+ * Adds many newly created objects (roots with no children) as children of
+ * this object, in one go. Used by the object manager
+ */
+void surgescript_object_add_children(surgescript_object_t* object, const unsigned* child_handle, int count)
+{
+    surgescript_objectmanager_t* manager = surgescript_renv_objectmanager(object->renv);
+
+    /* make room for the children */
+    if(object->child_len + count > object->child_cap) {
+        size_t old_size = object->child_cap * sizeof(*(object->child));
+        while(object->child_len + count > object->child_cap)
+            object->child_cap *= 2;
+        object->child = surgescript_slab_realloc(surgescript_objectmanager_slab(manager), object->child, old_size, object->child_cap * sizeof(*(object->child)));
+    }
+
+    /* add them */
+    for(int i = 0; i < count; i++) {
+        surgescript_object_t* child = surgescript_objectmanager_get(manager, child_handle[i]);
+        ssassert(child->parent == child->handle && child != object);
+        child->sibling_index = ssarray_push(object->child, child->handle) - 1;
+        child->parent = object->handle;
+        child->depth = 1 + object->depth;
+        if(object->child_kind != NULL)
+            index_child(object, child);
+    }
+
+    /* index the children by name */
+    if(object->child_kind == NULL && surgescript_object_child_count(object) >= CHILD_INDEX_THRESHOLD)
+        create_child_index(object);
+
+    /* update them after this object */
+    surgescript_objectmanager_link(manager, child_handle, count);
 }
 
 /*
  * surgescript_object_remove_child()
- * Removes a child having this handle from this object (removes the link only)
+ * Removes a child having this handle from this object (removes the link only).
+ * This is done in amortized constant time: the removed child leaves a null
+ * handle behind, and the child array is compacted once half of it is null.
+ * The order of the remaining children is kept
  */
 bool surgescript_object_remove_child(surgescript_object_t* object, unsigned child_handle)
 {
     surgescript_objectmanager_t* manager = surgescript_renv_objectmanager(object->renv);
 
     /* find the child */
-    for(int i = 0; i < ssarray_length(object->child); i++) {
-        if(object->child[i] == child_handle) {
-            surgescript_object_t* child = surgescript_objectmanager_get(manager, child_handle);
-            ssarray_remove(object->child, i);
+    if(surgescript_objectmanager_exists(manager, child_handle)) {
+        surgescript_object_t* child = surgescript_objectmanager_get(manager, child_handle);
+        int i = child->sibling_index;
+
+        if(child->parent == object->handle && child != object && i < ssarray_length(object->child) && object->child[i] == child_handle) {
+            int last = ssarray_length(object->child) - 1;
+
+            /* remove the links */
+            surgescript_objectmanager_unlink(manager, child_handle);
+            if(object->child_kind != NULL)
+                unindex_child(object, child);
+
+            /* leave a null handle behind */
+            object->child[i] = surgescript_objectmanager_null(manager);
+            if(i == last)
+                ssarray_truncate(object->child, last);
+            else if(2 * (++object->removed_children) > last)
+                compact_children(object);
+
             child->parent = child->handle; /* the child is now a root */
             return true;
         }
@@ -555,6 +742,26 @@ void surgescript_object_set_active(surgescript_object_t* object, bool active)
     object->is_active = active;
 }
 
+/*
+ * surgescript_object_is_parallel()
+ * Are my children updated in parallel? See surgescript_objectmanager_set_update_threads()
+ */
+bool surgescript_object_is_parallel(const surgescript_object_t* object)
+{
+    return object->is_parallel;
+}
+
+/*
+ * surgescript_object_set_parallel()
+ * Sets whether my children are updated in parallel or not; default is false,
+ * unless my object is annotated with @Parallel. My children must then follow
+ * the rules described in vm.h
+ */
+void surgescript_object_set_parallel(surgescript_object_t* object, bool parallel)
+{
+    object->is_parallel = parallel;
+}
+
 /*
  * surgescript_object_state()
  * each object is a state machine. in which state am i in?
@@ -571,8 +778,9 @@ const char* surgescript_object_state(const surgescript_object_t *object)
 void surgescript_object_set_state(surgescript_object_t* object, const char* state_name)
 {
     if(strcmp(object->state_name, state_name) != 0) {
-        ssfree(object->state_name);
-        object->state_name = ssstrdup(state_name ? state_name : MAIN_STATE);
+        surgescript_slab_t* slab = surgescript_objectmanager_slab(surgescript_renv_objectmanager(object->renv));
+        release_state_name(slab, object->state_name);
+        object->state_name = copy_state_name(slab, state_name ? state_name : MAIN_STATE);
         object->current_state = get_state_program(object, object->state_name);
         object->last_state_change = surgescript_util_gettickcount();
         object->time_spent = 0;
@@ -624,6 +832,52 @@ void surgescript_object_set_reachable(surgescript_object_t* object, bool reachab
     object->is_reachable = reachable;
 }
 
+/*
+ * surgescript_object_is_young()
+ * Is this object in the nursery? garbage-collector stuff
+ */
+bool surgescript_object_is_young(const surgescript_object_t* object)
+{
+    return object->is_young;
+}
+
+/*
+ * surgescript_object_set_young()
+ * Sets whether this object is in the nursery or not
+ */
+void surgescript_object_set_young(surgescript_object_t* object, bool young)
+{
+    object->is_young = young;
+}
+
+/*
+ * surgescript_object_is_remembered()
+ * Is this object in the remembered set? garbage-collector stuff
+ */
+bool surgescript_object_is_remembered(const surgescript_object_t* object)
+{
+    return object->is_remembered;
+}
+
+/*
+ * surgescript_object_set_remembered()
+ * Sets whether this object is in the remembered set or not
+ */
+void surgescript_object_set_remembered(surgescript_object_t* object, bool remembered)
+{
+    object->is_remembered = remembered;
+}
+
+/*
+ * surgescript_object_set_thread_stack()
+ * Objects updated in parallel: the calling thread will run the programs of the
+ * objects using its own stack. Pass NULL to use the stack of the object manager
+ */
+void surgescript_object_set_thread_stack(surgescript_stack_t* stack)
+{
+    thread_stack = stack;
+}
+
 
 /* misc */
 
@@ -686,25 +940,29 @@ bool surgescript_object_transform_changed(const surgescript_object_t* object)
  */
 void surgescript_object_init(surgescript_object_t* object)
 {
-    static const char* CONSTRUCTOR_FUN = "constructor"; /* regular constructor */
-    static const char* PRE_CONSTRUCTOR_FUN = "__ssconstructor"; /* a constructor reserved for the VM */
-    surgescript_stack_t* stack = surgescript_renv_stack(object->renv);
-    surgescript_programpool_t* program_pool = surgescript_renv_programpool(object->renv);
-    surgescript_stack_push(stack, surgescript_var_set_objecthandle(surgescript_var_create(), object->handle));
+    surgescript_program_t *pre_constructor, *constructor;
+    get_constructors(object, &pre_constructor, &constructor);
+    call_constructors(object, pre_constructor, constructor);
+}
 
-    if(surgescript_programpool_exists(program_pool, object->name, PRE_CONSTRUCTOR_FUN)) {
-        surgescript_program_t* pre_constructor = surgescript_programpool_get(program_pool, object->name, PRE_CONSTRUCTOR_FUN);
-        surgescript_program_call(pre_constructor, object->renv, 0);
-    }
+/*
+ * surgescript_object_init_batch()
+ * Initializes many objects of the same kind, in order. The constructors
+ * are looked up only once. Used by the object manager
+ */
+void surgescript_object_init_batch(surgescript_objectmanager_t* manager, const unsigned* handle, int count)
+{
+    surgescript_program_t *pre_constructor, *constructor;
 
-    if(surgescript_programpool_exists(program_pool, object->name, CONSTRUCTOR_FUN)) {
-        surgescript_program_t* constructor = surgescript_programpool_get(program_pool, object->name, CONSTRUCTOR_FUN);
-        if(surgescript_program_arity(constructor) != 0)
-            ssfatal("Runtime Error: Object \"%s\"'s %s() cannot receive parameters", object->name, CONSTRUCTOR_FUN);
-        surgescript_program_call(constructor, object->renv, 0);
-    }
+    if(count <= 0)
+        return;
 
-    surgescript_stack_pop(stack);
+    get_constructors(surgescript_objectmanager_get(manager, handle[0]), &pre_constructor, &constructor);
+    for(int i = 0; i < count; i++) {
+        /* a constructor may have destroyed a sibling */
+        if(surgescript_objectmanager_exists(manager, handle[i]))
+            call_constructors(surgescript_objectmanager_get(manager, handle[i]), pre_constructor, constructor);
+    }
 }
 
 /*
@@ -717,14 +975,15 @@ void surgescript_object_release(surgescript_object_t* object)
     surgescript_programpool_t* program_pool = surgescript_renv_programpool(object->renv);
 
     if(surgescript_programpool_exists(program_pool, object->name, DESTRUCTOR_FUN)) {
-        surgescript_stack_t* stack = surgescript_renv_stack(object->renv);
+        surgescript_renv_t buf, *renv = thread_renv(object, &buf);
+        surgescript_stack_t* stack = surgescript_renv_stack(renv);
         surgescript_program_t* destructor = surgescript_programpool_get(program_pool, object->name, DESTRUCTOR_FUN);
         
         if(surgescript_program_arity(destructor) != 0)
             ssfatal("Runtime Error: Object \"%s\"'s %s() cannot receive parameters", object->name, DESTRUCTOR_FUN);
 
         surgescript_stack_push(stack, surgescript_var_set_objecthandle(surgescript_var_create(), object->handle));
-        surgescript_program_call(destructor, object->renv, 0);
+        surgescript_program_call(destructor, renv, 0);
         surgescript_stack_pop(stack);
     }
 }
@@ -771,9 +1030,10 @@ bool surgescript_object_traverse_tree(surgescript_object_t* object, bool (*callb
 bool surgescript_object_traverse_tree_ex(surgescript_object_t* object, void* data, bool (*callback)(surgescript_object_t*,void*))
 {
     if(callback(object, data)) {
-        surgescript_objectmanager_t* manager = surgescript_renv_objectmanager(object->renv);
         for(int i = 0; i < ssarray_length(object->child); i++) {
-            surgescript_object_t* child = surgescript_objectmanager_get(manager, object->child[i]);
+            surgescript_object_t* child = child_at(object, i);
+            if(child == NULL)
+                continue;
             surgescript_object_traverse_tree_ex(child, data, callback);
         }
         return true;
@@ -791,7 +1051,8 @@ bool surgescript_object_traverse_tree_ex(surgescript_object_t* object, void* dat
 void surgescript_object_call_function(surgescript_object_t* object, const char* fun_name, const surgescript_var_t* param[], int num_params, surgescript_var_t* return_value)
 {
     surgescript_program_t* program = surgescript_programpool_get(surgescript_renv_programpool(object->renv), object->name, fun_name);
-    surgescript_stack_t* stack = surgescript_renv_stack(object->renv);
+    surgescript_renv_t buf, *renv = thread_renv(object, &buf);
+    surgescript_stack_t* stack = surgescript_renv_stack(renv);
     int i;
 
     /* sanity check */
@@ -805,9 +1066,9 @@ void surgescript_object_call_function(surgescript_object_t* object, const char*
 
     /* call the program */
     if(program != NULL) {
-        surgescript_program_call(program, object->renv, num_params);
+        surgescript_program_call(program, renv, num_params);
         if(return_value != NULL)
-            surgescript_var_copy(return_value, *(surgescript_renv_tmp(object->renv) + 0)); /* the return value of the function (if any) */
+            surgescript_var_copy(return_value, *(surgescript_renv_tmp(renv) + 0)); /* the return value of the function (if any) */
     }
     else
         ssfatal("Runtime Error: function %s.%s/%d doesn't exist.", object->name, fun_name, num_params);
@@ -822,9 +1083,11 @@ void surgescript_object_call_function(surgescript_object_t* object, const char*
  */
 void surgescript_object_call_state(surgescript_object_t* object, const char* state_name)
 {
-    char* fun_name = state2fun(state_name);
+    char buf[STATE2FUN_BUFSIZE];
+    char* fun_name = state2fun(state_name, buf, sizeof(buf));
     surgescript_object_call_function(object, fun_name, NULL, 0, NULL);
-    ssfree(fun_name);
+    if(fun_name != buf)
+        ssfree(fun_name);
 }
 
 
@@ -849,20 +1112,35 @@ size_t surgescript_object_memspent(const surgescript_object_t* object)
 }
 
 /* private stuff */
-char* state2fun(const char* state)
+char* state2fun(const char* state, char* buf, size_t bufsize)
 {
-    /* fun = STATE2FUN + state */
+    /* fun = STATE2FUN + state; buf is used if it's large enough */
     static const char prefix[] = "state:";
-    char *fun_name = ssmalloc((strlen(state) + strlen(prefix) + 1) * sizeof(char));
+    size_t size = (strlen(state) + strlen(prefix) + 1) * sizeof(char);
+    char *fun_name = size <= bufsize ? buf : ssmalloc(size);
     return strcat(strcpy(fun_name, prefix), state);
 }
 
+/* copies a state name to memory taken from the slab */
+char* copy_state_name(surgescript_slab_t* slab, const char* state_name)
+{
+    size_t size = strlen(state_name) + 1;
+    return memcpy(surgescript_slab_alloc(slab, size), state_name, size);
+}
+
+/* releases a state name created with copy_state_name() */
+void* release_state_name(surgescript_slab_t* slab, char* state_name)
+{
+    return surgescript_slab_free(slab, state_name, strlen(state_name) + 1);
+}
+
 uint64_t run_current_state(const surgescript_object_t* object)
 {
     uint64_t start = surgescript_util_gettickcount(), end;
-    surgescript_stack_t* stack = surgescript_renv_stack(object->renv);
+    surgescript_renv_t buf, *renv = thread_renv(object, &buf);
+    surgescript_stack_t* stack = surgescript_renv_stack(renv);
     surgescript_stack_push(stack, surgescript_var_set_objecthandle(surgescript_var_create(), object->handle));
-    surgescript_program_call(object->current_state, object->renv, 0);
+    surgescript_program_call(object->current_state, renv, 0);
     surgescript_stack_pop(stack);
     end = surgescript_util_gettickcount();
     return end > start ? end - start : 0;
@@ -870,17 +1148,35 @@ uint64_t run_current_state(const surgescript_object_t* object)
 
 surgescript_program_t* get_state_program(const surgescript_object_t* object, const char* state_name)
 {
-    char* fun_name = state2fun(state_name);
+    char buf[STATE2FUN_BUFSIZE];
+    char* fun_name = state2fun(state_name, buf, sizeof(buf));
     surgescript_programpool_t* program_pool = surgescript_renv_programpool(object->renv);
     surgescript_program_t* program = surgescript_programpool_get(program_pool, object->name, fun_name);
 
     if(program == NULL)
         ssfatal("Runtime Error: state \"%s\" of object \"%s\" doesn't exist.", state_name, object->name);
 
-    ssfree(fun_name);
+    if(fun_name != buf)
+        ssfree(fun_name);
     return program;
 }
 
+/* creates the heap of an object, allocating & initializing
+   its fields according to the heap layout of its class */
+surgescript_heap_t* create_heap(const surgescript_object_t* object, surgescript_slab_t* slab, surgescript_programpool_t* program_pool)
+{
+    int field_count;
+    const surgescript_var_t* initial_value = surgescript_programpool_layout(program_pool, object->class_id, &field_count);
+    surgescript_heap_t* heap = surgescript_heap_create(slab, field_count);
+
+    for(int i = 0; i < field_count; i++) {
+        surgescript_heapptr_t ptr = surgescript_heap_malloc(heap);
+        surgescript_var_copy(surgescript_heap_at(heap, ptr), &initial_value[i]);
+    }
+
+    return heap;
+}
+
 bool object_exists(surgescript_programpool_t* program_pool, const char* object_name)
 {
     return NULL != surgescript_programpool_get(program_pool, object_name, "state:" MAIN_STATE);
@@ -890,3 +1186,142 @@ bool simple_traversal(surgescript_object_t* object, void* callback)
 {
     return ((bool (*)(surgescript_object_t*))callback)(object);
 }
+
+/* finds the constructors of an object (NULL if they don't exist) */
+void get_constructors(const surgescript_object_t* object, surgescript_program_t** pre_constructor, surgescript_program_t** constructor)
+{
+    static const char* CONSTRUCTOR_FUN = "constructor"; /* regular constructor */
+    static const char* PRE_CONSTRUCTOR_FUN = "__ssconstructor"; /* a constructor reserved for the VM */
+    surgescript_programpool_t* program_pool = surgescript_renv_programpool(object->renv);
+
+    *pre_constructor = NULL;
+    if(surgescript_programpool_exists(program_pool, object->name, PRE_CONSTRUCTOR_FUN))
+        *pre_constructor = surgescript_programpool_get(program_pool, object->name, PRE_CONSTRUCTOR_FUN);
+
+    *constructor = NULL;
+    if(surgescript_programpool_exists(program_pool, object->name, CONSTRUCTOR_FUN)) {
+        *constructor = surgescript_programpool_get(program_pool, object->name, CONSTRUCTOR_FUN);
+        if(surgescript_program_arity(*constructor) != 0)
+            ssfatal("Runtime Error: Object \"%s\"'s %s() cannot receive parameters", object->name, CONSTRUCTOR_FUN);
+    }
+}
+
+/* the runtime environment of an object on the calling thread; buf may be filled */
+surgescript_renv_t* thread_renv(const surgescript_object_t* object, surgescript_renv_t* buf)
+{
+    if(thread_stack == NULL)
+        return object->renv;
+
+    *buf = *(object->renv);
+    buf->stack = thread_stack;
+    return buf;
+}
+
+/* calls the constructors of an object */
+void call_constructors(surgescript_object_t* object, surgescript_program_t* pre_constructor, surgescript_program_t* constructor)
+{
+    surgescript_renv_t buf, *renv = thread_renv(object, &buf);
+    surgescript_stack_t* stack = surgescript_renv_stack(renv);
+    surgescript_stack_push(stack, surgescript_var_set_objecthandle(surgescript_var_create(), object->handle));
+
+    if(pre_constructor != NULL)
+        surgescript_program_call(pre_constructor, renv, 0);
+
+    if(constructor != NULL)
+        surgescript_program_call(constructor, renv, 0);
+
+    surgescript_stack_pop(stack);
+}
+
+/* appends a child to the list of children of its kind (the index must exist) */
+void index_child(surgescript_object_t* object, surgescript_object_t* child)
+{
+    surgescript_objectmanager_t* manager = surgescript_renv_objectmanager(object->renv);
+    surgescript_objectkind_t* kind = fasthash_get(object->child_kind, child->class_id);
+
+    child->next_of_kind = surgescript_objectmanager_null(manager);
+    if(kind == NULL) {
+        kind = ssmalloc(sizeof *kind);
+        kind->first = kind->last = child->handle;
+        child->prev_of_kind = surgescript_objectmanager_null(manager);
+        fasthash_put(object->child_kind, child->class_id, kind);
+    }
+    else {
+        surgescript_objectmanager_get(manager, kind->last)->next_of_kind = child->handle;
+        child->prev_of_kind = kind->last;
+        kind->last = child->handle;
+    }
+}
+
+/* removes a child from the list of children of its kind (the index must exist) */
+void unindex_child(surgescript_object_t* object, surgescript_object_t* child)
+{
+    surgescript_objectmanager_t* manager = surgescript_renv_objectmanager(object->renv);
+    surgescript_objectkind_t* kind = fasthash_get(object->child_kind, child->class_id);
+    surgescript_objecthandle_t null_handle = surgescript_objectmanager_null(manager);
+
+    if(child->prev_of_kind != null_handle)
+        surgescript_objectmanager_get(manager, child->prev_of_kind)->next_of_kind = child->next_of_kind;
+    else
+        kind->first = child->next_of_kind;
+
+    if(child->next_of_kind != null_handle)
+        surgescript_objectmanager_get(manager, child->next_of_kind)->prev_of_kind = child->prev_of_kind;
+    else
+        kind->last = child->prev_of_kind;
+
+    if(kind->first == null_handle)
+        fasthash_delete(object->child_kind, child->class_id); /* releases kind */
+
+    child->prev_of_kind = child->next_of_kind = null_handle;
+}
+
+/* the index-th entry of the child array of an object, or NULL if that child has been removed */
+surgescript_object_t* child_at(const surgescript_object_t* object, int index)
+{
+    surgescript_objectmanager_t* manager = surgescript_renv_objectmanager(object->renv);
+    unsigned handle = object->child[index];
+    return handle != surgescript_objectmanager_null(manager) ? surgescript_objectmanager_get(manager, handle) : NULL;
+}
+
+/* removes the null handles left in the child array of an object by removed children, keeping the order */
+void compact_children(surgescript_object_t* object)
+{
+    int n = 0;
+
+    for(int i = 0; i < ssarray_length(object->child); i++) {
+        surgescript_object_t* child = child_at(object, i);
+        if(child != NULL) {
+            object->child[n] = object->child[i];
+            child->sibling_index = n++;
+        }
+    }
+
+    ssarray_truncate(object->child, n);
+    object->removed_children = 0;
+}
+
+/* indexes the children of an object by name */
+void create_child_index(surgescript_object_t* object)
+{
+    object->child_kind = fasthash_create(release_kind, 4);
+    for(int i = 0; i < ssarray_length(object->child); i++) {
+        surgescript_object_t* child = child_at(object, i);
+        if(child != NULL)
+            index_child(object, child);
+    }
+}
+
+/* finds the children of an object named name using the index, or returns NULL */
+surgescript_objectkind_t* find_kind(const surgescript_object_t* object, const char* name)
+{
+    surgescript_programpool_t* program_pool = surgescript_renv_programpool(object->renv);
+    int class_id = surgescript_programpool_find_class_id(program_pool, name);
+    return class_id >= 0 ? fasthash_peek(object->child_kind, class_id) : NULL;
+}
+
+/* releases an entry of the index of children */
+void release_kind(void* kind)
+{
+    ssfree(kind);
+}
@@ -47,10 +47,13 @@ bool surgescript_object_update(surgescript_object_t* object); /* runs my program
 
 /* properties */
 const char* surgescript_object_name(const surgescript_object_t* object); /* what's my name? */
+int surgescript_object_class_id(const surgescript_object_t* object); /* interned id of my name (see the program pool) */
 struct surgescript_heap_t* surgescript_object_heap(const surgescript_object_t* object); /* each object has its own heap */
 struct surgescript_objectmanager_t* surgescript_object_manager(const surgescript_object_t* object); /* pointer to the object manager */
 void* surgescript_object_userdata(const surgescript_object_t* object); /* custom user data (if any) */
-void surgescript_object_set_userdata(surgescript_object_t* object, void* data); /* set custom user data */
+void surgescript_object_set_userdata(surgescript_object_t* object, void* data); /* set custom user data; call surgescript_objectmanager_write_barrier() after storing object handles in it */
+void surgescript_object_set_userdata_scanner(surgescript_object_t* object, void (*scanner)(surgescript_object_t*,void*,bool (*)(unsigned,void*))); /* user data that stores object handles must be scanned by the garbage collector */
+void surgescript_object_scan_objects(surgescript_object_t* object, void* data, bool (*callback)(unsigned,void*)); /* scans the heap & the user data, calling callback for each object handle */
 bool surgescript_object_has_tag(const surgescript_object_t* object, const char* tag_name); /* is this object tagged tag_name? */
 bool surgescript_object_has_function(const surgescript_object_t* object, const char* fun_name); /* does the object have the specified function? */
 double surgescript_object_elapsed_time(const surgescript_object_t* object); /* elapsed time (in seconds) since last state change */
@@ -81,6 +84,8 @@ const char* surgescript_object_state(const surgescript_object_t *object); /* eac
 void surgescript_object_set_state(surgescript_object_t* object, const char* state_name); /* sets a state; default is "main" */
 bool surgescript_object_is_active(const surgescript_object_t* object); /* am i active? an object runs its programs iff it's active */
 void surgescript_object_set_active(surgescript_object_t* object, bool active); /* sets whether i am active or not; default is true */
+bool surgescript_object_is_parallel(const surgescript_object_t* object); /* are my children updated in parallel? (see vm.h) */
+void surgescript_object_set_parallel(surgescript_object_t* object, bool parallel); /* sets whether my children are updated in parallel; default is true iff I'm annotated with @Parallel */
 bool surgescript_object_is_killed(const surgescript_object_t* object); /* has this object been killed? */
 void surgescript_object_kill(surgescript_object_t* object); /* will destroy the object as soon as the opportunity arises */
 
@@ -29,16 +29,54 @@
 #include "variable.h"
 #include "../util/ssarray.h"
 #include "../util/util.h"
+#include "../util/slab.h"
+#include "../util/thread.h"
+#include "../util/transform.h"
 
 /* types */
 typedef struct surgescript_vmargs_t surgescript_vmargs_t;
+typedef struct surgescript_objectslot_t surgescript_objectslot_t;
+typedef struct surgescript_updateentry_t surgescript_updateentry_t;
+typedef struct surgescript_updatethread_t surgescript_updatethread_t;
+typedef struct surgescript_paralleljob_t surgescript_paralleljob_t;
+
+/* a slot of the object table */
+struct surgescript_objectslot_t
+{
+    surgescript_object_t* object; /* NULL if the slot is free */
+    unsigned generation; /* incremented whenever the slot is freed */
+    int next_free; /* the next free slot (free list) */
+    int update_index; /* position of the object in the update list, or -1 */
+};
+
+/* an entry of the update list */
+struct surgescript_updateentry_t
+{
+    surgescript_object_t* object; /* NULL if the object has been removed from the list */
+    int end; /* the position that follows the last descendant of the object */
+};
+
+/* a thread that updates objects in parallel */
+struct surgescript_updatethread_t
+{
+    surgescript_stack_t* stack; /* each thread has its own stack */
+    struct surgescript_varpool_t* varpool; /* the variable pool of the thread, once it has ended */
+};
+
+/* a parallel update of the children of an object */
+struct surgescript_paralleljob_t
+{
+    surgescript_objectmanager_t* manager;
+    void* data;
+    bool (*callback)(surgescript_object_t*,void*);
+};
 
 /* object manager */
 struct surgescript_objectmanager_t
 {
     int count; /* how many objects are allocated at the moment */
-    surgescript_objecthandle_t handle_ptr; /* memory allocation */
-    SSARRAY(surgescript_object_t*, data); /* object table */
+    int first_free; /* the first free slot of the object table, or -1 if there is none */
+    SSARRAY(surgescript_objectslot_t, slot); /* object table */
     surgescript_programpool_t* program_pool; /* reference to the program pool */
     surgescript_stack_t* stack; /* reference to the stack */
     surgescript_tagsystem_t* tag_system; /* tag system */
@@ -47,13 +85,49 @@ struct surgescript_objectmanager_t
     int first_object_to_be_scanned; /* an index of objects_to_be_scanned */
     int reachables_count; /* garbage-collector stuff */
     int garbage_count; /* last number of garbage-collected objects */
+    int garbage_budget; /* time budget of garbagecheck(), in microseconds */
+    int allocation_count; /* how many objects have been spawned since the last call to garbagecheck() */
+    int cycle_garbage_count; /* how many objects the nursery disposed in the current cycle */
+    int scan_count; /* how many objects have been scanned in the current cycle */
+    int last_scan_count; /* how many objects have been scanned in the last cycle */
+    int pause_histogram[SURGESCRIPT_OBJECTMANAGER_PAUSE_BUCKETS]; /* durations of the steps of the garbage collector */
+    SSARRAY(surgescript_objecthandle_t, nursery); /* young objects spawned since the last minor collection */
+    SSARRAY(surgescript_objecthandle_t, remembered_set); /* objects that stored handles since the last minor collection */
+    SSARRAY(surgescript_objecthandle_t, survivors); /* young objects found to be reachable */
     SSARRAY(char*, plugin_list); /* plugin list */
+    SSARRAY(surgescript_updateentry_t, update_list); /* the objects of the tree in depth-first order */
+    int update_cursor; /* the position of the object being updated, or -1 */
+    int update_garbage; /* how many entries of the update list are NULL */
+    surgescript_slab_t* slab; /* memory allocator of the objects */
+
+    /* parallel update */
+    int update_threads; /* how many threads update the children of the parallel objects */
+    surgescript_threadpool_t* thread_pool; /* NULL if update_threads <= 1 */
+    surgescript_updatethread_t* thread; /* threads 1, 2, ..., update_threads - 1 of the pool */
+    surgescript_mutex_t* mutex; /* guards the object manager while objects are updated in parallel */
+    surgescript_mutex_t* lock; /* the mutex during a parallel update; NULL otherwise */
+    uint64_t thread_seed; /* the seeds of the pseudo-random number generators of the threads */
+    bool inverted_y; /* the orientation of the y-axis of the threads */
+    SSARRAY(surgescript_objecthandle_t, parallel_children); /* the children being updated in parallel */
+    SSARRAY(surgescript_objecthandle_t, deferred); /* objects deleted during a parallel update */
 };
 
 /* fixed objects */
 #define NULL_HANDLE                 0   /* must always be zero */
 #define ROOT_HANDLE                 1
 
+/* the lower bits of a handle index the object table and the upper bits
+   store the generation of the slot, so that stale handles are detected.
+   Up to 2^HANDLE_INDEX_BITS - 1 objects may exist at the same time (the
+   slot of the null handle is never used); more index bits would mean
+   fewer generations, and stale handles would alias new objects sooner */
+#define HANDLE_INDEX_BITS           20
+#define HANDLE_INDEX_MASK           ((1u << HANDLE_INDEX_BITS) - 1)
+#define HANDLE_GENERATION_MASK      (~0u >> HANDLE_INDEX_BITS)
+#define handle_index(handle)        ((handle) & HANDLE_INDEX_MASK)
+#define handle_generation(handle)   ((handle) >> HANDLE_INDEX_BITS)
+#define make_handle(index, gen)     ((surgescript_objecthandle_t)(index) | ((surgescript_objecthandle_t)(gen) << HANDLE_INDEX_BITS))
+
 /* system objects are children of the root and
    their addresses must be known at compile-time */
 #define SURGESCRIPT_SYSTEM_OBJECTS(F) \
@@ -82,27 +156,64 @@ static const char* SYSTEM_OBJECTS[] = {
 /* object methods acessible by me */
 extern surgescript_object_t* surgescript_object_create(const char* name, unsigned handle, struct surgescript_objectmanager_t* object_manager, struct surgescript_programpool_t* program_pool, struct surgescript_stack_t* stack, void* user_data); /* creates a new blank object */
 extern surgescript_object_t* surgescript_object_destroy(surgescript_object_t* object); /* destroys an object */
+extern void surgescript_object_add_children(surgescript_object_t* object, const unsigned* child_handle, int count); /* adds many new objects as children */
 
 /* the life-cycle of the objects is handled by me */
 extern void surgescript_object_init(surgescript_object_t* object); /* initializes the object (calls constructor, and so on) */
+extern void surgescript_object_init_batch(surgescript_objectmanager_t* manager, const unsigned* handle, int count); /* initializes many objects of the same kind */
 extern void surgescript_object_release(surgescript_object_t* object); /* releases the object (calls destructor, and so on) */
 
 /* garbage collection is handled by me also */
 extern bool surgescript_object_is_reachable(const surgescript_object_t* object); /* is this object reachable through some other? */
 extern void surgescript_object_set_reachable(surgescript_object_t* object, bool reachable); /* sets whether this object is reachable or not */
+extern bool surgescript_object_is_young(const surgescript_object_t* object); /* is this object in the nursery? */
+extern void surgescript_object_set_young(surgescript_object_t* object, bool young); /* sets whether this object is in the nursery or not */
+extern bool surgescript_object_is_remembered(const surgescript_object_t* object); /* is this object in the remembered set? */
+extern void surgescript_object_set_remembered(surgescript_object_t* object, bool remembered); /* sets whether this object is in the remembered set or not */
 
 /* garbage collector: private stuff */
+#define DEFAULT_GARBAGE_BUDGET      500 /* microseconds per call to garbagecheck() */
+#define GARBAGECHECK_GRANULARITY    16  /* how many objects garbagecheck() scans between readings of the clock */
+#define PACING_RATIO                4   /* how many objects garbagecheck() should scan for each spawned object */
+#define MAX_PACING_FACTOR           4   /* how much garbagecheck() may stretch its budget to keep up with allocations */
+#define PAUSE_HISTOGRAM_BASE        64  /* upper bound of the first bucket of the pause histogram, in microseconds */
 static bool mark_as_reachable(unsigned handle, void* mgr);
 static bool sweep_unreachables(surgescript_object_t* object);
+static bool mark_as_survivor(unsigned handle, void* mgr);
+static void finish_marking(surgescript_objectmanager_t* manager);
+static surgescript_objecthandle_t spawn_young(surgescript_objectmanager_t* manager, surgescript_objecthandle_t parent, const char* object_name);
 
 /* other */
-#define is_power_of_two(x)                !((x) & ((x) - 1)) /* this assumes x > 0 */
 static surgescript_objecthandle_t new_handle(surgescript_objectmanager_t* mgr);
+static inline surgescript_object_t* lookup(const surgescript_objectmanager_t* manager, surgescript_objecthandle_t handle);
 static void add_to_plugin_list(surgescript_objectmanager_t* manager, const char* object_name);
 static void release_plugin_list(surgescript_objectmanager_t* manager);
 static char** compile_plugins_list(const surgescript_objectmanager_t* manager);
 static inline surgescript_object_t* plugin_object(const surgescript_objectmanager_t* manager);
 
+/* update list */
+static int fill_update_list(surgescript_objectmanager_t* manager, surgescript_object_t* object, int position);
+static void compact_update_list(surgescript_objectmanager_t* manager);
+static int subtree_size(surgescript_objectmanager_t* manager, surgescript_object_t* object);
+
+/* parallel update */
+#define MAX_UPDATE_THREADS 256
+extern void surgescript_object_set_thread_stack(struct surgescript_stack_t* stack); /* the stack of the calling thread */
+extern void surgescript_program_set_shared_lock(surgescript_mutex_t* mutex); /* the programs are shared with other threads */
+extern struct surgescript_varpool_t* surgescript_var_detach_pool(); /* gives up the variable pool of the calling thread */
+extern void surgescript_var_attach_pool(struct surgescript_varpool_t* pool); /* takes over the variable pool of an ended thread */
+extern void surgescript_var_share_strings(bool shared); /* strings are shared with other threads */
+static void update_in_parallel(surgescript_objectmanager_t* manager, surgescript_object_t* object, void* data, bool (*callback)(surgescript_object_t*,void*));
+static void update_subtree(int task, int thread, void* job);
+static void begin_parallel_update(surgescript_objectmanager_t* manager);
+static void end_parallel_update(surgescript_objectmanager_t* manager);
+static void start_thread(int thread, void* mgr);
+static void stop_thread(int thread, void* mgr);
+static void release_threads(surgescript_objectmanager_t* manager);
+static void grow_object_table(surgescript_objectmanager_t* manager);
+static inline void lock_manager(const surgescript_objectmanager_t* manager);
+static inline void unlock_manager(const surgescript_objectmanager_t* manager);
+
 /* -------------------------------
  * public methods
  * ------------------------------- */
@@ -115,23 +226,49 @@ surgescript_objectmanager_t* surgescript_objectmanager_create(surgescript_progra
 {
     surgescript_objectmanager_t* manager = ssmalloc(sizeof *manager);
 
-    ssarray_init(manager->data);
-    ssarray_push(manager->data, NULL); /* NULL is *always* the first element */
+    ssarray_init(manager->slot);
+    ssarray_push(manager->slot, ((surgescript_objectslot_t){ NULL, 0, -1, -1 })); /* NULL is *always* the first element */
 
     manager->count = 0;
     manager->program_pool = program_pool;
     manager->tag_system = tag_system;
     manager->stack = stack;
     manager->args = args;
-    manager->handle_ptr = ROOT_HANDLE;
+    manager->first_free = -1;
+    manager->slab = surgescript_slab_create();
 
     ssarray_init(manager->objects_to_be_scanned);
     manager->first_object_to_be_scanned = 0;
     manager->reachables_count = 0;
     manager->garbage_count = 0;
+    manager->garbage_budget = DEFAULT_GARBAGE_BUDGET;
+    manager->allocation_count = 0;
+    manager->cycle_garbage_count = 0;
+    manager->scan_count = 0;
+    manager->last_scan_count = 0;
+    for(int i = 0; i < SURGESCRIPT_OBJECTMANAGER_PAUSE_BUCKETS; i++)
+        manager->pause_histogram[i] = 0;
+
+    ssarray_init(manager->nursery);
+    ssarray_init(manager->remembered_set);
+    ssarray_init(manager->survivors);
 
     ssarray_init(manager->plugin_list);
 
+    ssarray_init(manager->update_list);
+    manager->update_cursor = -1;
+    manager->update_garbage = 0;
+
+    manager->update_threads = 1;
+    manager->thread_pool = NULL;
+    manager->thread = NULL;
+    manager->mutex = surgescript_mutex_create();
+    manager->lock = NULL;
+    manager->thread_seed = 0;
+    manager->inverted_y = false;
+    ssarray_init(manager->parallel_children);
+    ssarray_init(manager->deferred);
+
     return manager;
 }
 
@@ -141,14 +278,26 @@ surgescript_objectmanager_t* surgescript_objectmanager_create(surgescript_progra
  */
 surgescript_objectmanager_t* surgescript_objectmanager_destroy(surgescript_objectmanager_t* manager)
 {
-    surgescript_objecthandle_t handle = ssarray_length(manager->data);
-    
-    while(handle != 0)
-        surgescript_objectmanager_delete(manager, --handle);
+    int index = ssarray_length(manager->slot);
 
-    ssarray_release(manager->data);
+    while(index != 0) {
+        index--;
+        surgescript_objectmanager_delete(manager, make_handle(index, manager->slot[index].generation));
+    }
+
+    release_threads(manager); /* after deleting the objects; see stop_thread() */
+    surgescript_mutex_destroy(manager->mutex);
+    ssarray_release(manager->deferred);
+    ssarray_release(manager->parallel_children);
+
+    ssarray_release(manager->slot);
+    ssarray_release(manager->survivors);
+    ssarray_release(manager->remembered_set);
+    ssarray_release(manager->nursery);
     ssarray_release(manager->objects_to_be_scanned);
     release_plugin_list(manager);
+    ssarray_release(manager->update_list);
+    surgescript_slab_destroy(manager->slab);
 
     return ssfree(manager);
 }
@@ -160,30 +309,30 @@ surgescript_objectmanager_t* surgescript_objectmanager_destroy(surgescript_objec
  */
 surgescript_objecthandle_t surgescript_objectmanager_spawn(surgescript_objectmanager_t* manager, surgescript_objecthandle_t parent, const char* object_name, void* user_data)
 {
-    surgescript_objecthandle_t handle = new_handle(manager);
     surgescript_object_t *parent_object = surgescript_objectmanager_get(manager, parent);
-    surgescript_object_t *object = surgescript_object_create(object_name, handle, manager, manager->program_pool, manager->stack, user_data);
+    surgescript_objecthandle_t handle;
+    surgescript_object_t *object;
 
-    /* store the object */
-    if(handle >= ssarray_length(manager->data) && handle > ROOT_HANDLE) {
-        /* new slot */
-        ssarray_push(manager->data, object);
-        if(is_power_of_two(handle))
-            manager->handle_ptr = ssmax(2, manager->handle_ptr / 2); /* handle_ptr must never be zero */
-    }
-    else if(handle > ROOT_HANDLE) {
-        /* reuse unused slot */
-        manager->data[handle] = object;
-    }
-    else
+    /* the root must be spawned first */
+    if(ssarray_length(manager->slot) <= ROOT_HANDLE)
         ssfatal("Can't spawn the root object.");
 
+    /* store the object */
+    lock_manager(manager);
+    handle = new_handle(manager);
+    unlock_manager(manager);
+    object = surgescript_object_create(object_name, handle, manager, manager->program_pool, manager->stack, user_data);
+
     /* register the object */
+    lock_manager(manager);
+    manager->slot[handle_index(handle)].object = object;
     manager->count++;
+    manager->allocation_count++;
     surgescript_object_add_child(parent_object, handle);
 
     /* this is important for garbage collection (will be cleared up later) */
     surgescript_object_set_reachable(object, true); /* assume the object is reachable at this frame */
+    unlock_manager(manager);
 
     /* call constructor and so on */
     surgescript_object_init(object);
@@ -192,20 +341,66 @@ surgescript_objecthandle_t surgescript_objectmanager_spawn(surgescript_objectman
     return handle;
 }
 
+/*
+ * surgescript_objectmanager_spawn_batch()
+ * Spawns count objects named object_name as children of parent, writing
+ * their handles to handles[] (it may be NULL). All objects are created and
+ * added to the parent first; their constructors are called afterwards, in
+ * order. This is faster than spawning the objects one by one
+ */
+void surgescript_objectmanager_spawn_batch(surgescript_objectmanager_t* manager, surgescript_objecthandle_t parent, const char* object_name, int count, surgescript_objecthandle_t* handles)
+{
+    surgescript_object_t *parent_object = surgescript_objectmanager_get(manager, parent);
+    surgescript_objecthandle_t* handle = handles;
+
+    /* the root must be spawned first */
+    if(ssarray_length(manager->slot) <= ROOT_HANDLE)
+        ssfatal("Can't spawn the root object.");
+    else if(count <= 0)
+        return;
+
+    /* store the objects; the object table grows at most once */
+    if(handles == NULL)
+        handle = ssmalloc(count * sizeof(*handle));
+    lock_manager(manager);
+    ssarray_reserve(manager->slot, ssmin(ssarray_length(manager->slot) + count, HANDLE_INDEX_MASK + 1));
+    for(int i = 0; i < count; i++) {
+        surgescript_object_t* object;
+        handle[i] = new_handle(manager);
+        object = surgescript_object_create(object_name, handle[i], manager, manager->program_pool, manager->stack, NULL);
+        manager->slot[handle_index(handle[i])].object = object;
+        surgescript_object_set_reachable(object, true); /* assume the object is reachable at this frame */
+    }
+
+    /* register the objects */
+    manager->count += count;
+    manager->allocation_count += count;
+    surgescript_object_add_children(parent_object, handle, count);
+    unlock_manager(manager);
+
+    /* call the constructors */
+    surgescript_object_init_batch(manager, handle, count);
+
+    /* done! */
+    if(handles == NULL)
+        ssfree(handle);
+}
+
 /*
  * surgescript_objectmanager_spawn_root()
  * Spawns the root object
  */
 surgescript_objecthandle_t surgescript_objectmanager_spawn_root(surgescript_objectmanager_t* manager)
 {
-    if(manager->handle_ptr == ROOT_HANDLE) {
+    if(ssarray_length(manager->slot) == ROOT_HANDLE) {
         /* preparing the data */
         char** plugins = compile_plugins_list(manager);
         char** data[] = { (char**)SYSTEM_OBJECTS, plugins };
 
         /* spawn the root object */
         surgescript_object_t *object = surgescript_object_create(ROOT_OBJECT, ROOT_HANDLE, manager, manager->program_pool, manager->stack, data);
-        ssarray_push(manager->data, object);
+        ssarray_push(manager->slot, ((surgescript_objectslot_t){ object, 0, -1, 0 }));
+        ssarray_push(manager->update_list, ((surgescript_updateentry_t){ object, 1 }));
         manager->count++;
 
         /* initialize the root and call its constructor */
@@ -226,7 +421,7 @@ surgescript_objecthandle_t surgescript_objectmanager_spawn_root(surgescript_obje
  */
 bool surgescript_objectmanager_exists(const surgescript_objectmanager_t* manager, surgescript_objecthandle_t handle)
 {
-    return handle < ssarray_length(manager->data) && manager->data[handle] != NULL;
+    return lookup(manager, handle) != NULL;
 }
 
 /*
@@ -235,10 +430,9 @@ bool surgescript_objectmanager_exists(const surgescript_objectmanager_t* manager
  */
 surgescript_object_t* surgescript_objectmanager_get(const surgescript_objectmanager_t* manager, surgescript_objecthandle_t handle)
 {
-    if(handle < ssarray_length(manager->data)) { /* handle is unsigned; therefore, not lower than zero */
-        if(manager->data[handle] != NULL)
-            return manager->data[handle];
-    }
+    surgescript_object_t* object = lookup(manager, handle);
+    if(object != NULL)
+        return object;
 
     ssfatal("Runtime Error: null pointer exception (can't find object 0x%X)", handle);
     return NULL;
@@ -250,17 +444,205 @@ surgescript_object_t* surgescript_objectmanager_get(const surgescript_objectmana
  */
 bool surgescript_objectmanager_delete(surgescript_objectmanager_t* manager, surgescript_objecthandle_t handle)
 {
-    if(handle < ssarray_length(manager->data)) {
-        if(manager->data[handle] != NULL) {
-            manager->data[handle] = surgescript_object_destroy(manager->data[handle]);
-            manager->count--;
-            return true;
+    surgescript_object_t* object = lookup(manager, handle);
+
+    /* objects are deleted after a parallel update */
+    if(manager->lock != NULL) {
+        lock_manager(manager);
+        if(object != NULL)
+            ssarray_push(manager->deferred, handle);
+        unlock_manager(manager);
+        return object != NULL;
+    }
+
+    if(object != NULL) {
+        /* put the slot in the free list; its handles become stale */
+        surgescript_objectslot_t* slot = &(manager->slot[handle_index(handle)]);
+        if(slot->update_index >= 0) {
+            manager->update_list[slot->update_index].object = NULL;
+            manager->update_garbage++;
+            slot->update_index = -1;
         }
+        slot->object = surgescript_object_destroy(object);
+        slot->generation = (slot->generation + 1) & HANDLE_GENERATION_MASK;
+        slot->next_free = manager->first_free;
+        manager->first_free = handle_index(handle);
+        manager->count--;
+        return true;
     }
 
     return false;
 }
 
+/*
+ * surgescript_objectmanager_traverse()
+ * Visits the objects of the tree in depth-first order, parents before their
+ * children, as surgescript_object_traverse_tree_ex() would, but iterating
+ * over a flat list. If the callback returns false, the descendants of the
+ * object are skipped. Objects spawned during the traversal are visited if
+ * their parents haven't been left behind. The children of the objects that
+ * are updated in parallel are visited on the threads of the pool (see
+ * surgescript_objectmanager_set_update_threads())
+ */
+void surgescript_objectmanager_traverse(surgescript_objectmanager_t* manager, void* data, bool (*callback)(surgescript_object_t*,void*))
+{
+    /* get rid of the removed entries */
+    if(manager->update_garbage > ssarray_length(manager->update_list) / 2)
+        compact_update_list(manager);
+
+    /* the list may change during the traversal (update_cursor is adjusted) */
+    for(manager->update_cursor = 0; manager->update_cursor < ssarray_length(manager->update_list); ) {
+        surgescript_object_t* object = manager->update_list[manager->update_cursor].object;
+
+        if(object == NULL)
+            manager->update_cursor++;
+        else if(!callback(object, data))
+            manager->update_cursor = manager->update_list[manager->update_cursor].end; /* skip the descendants */
+        else if(manager->thread_pool != NULL && surgescript_object_is_parallel(object) && surgescript_object_child_count(object) > 0) {
+            update_in_parallel(manager, object, data, callback);
+            manager->update_cursor = manager->update_list[manager->update_cursor].end; /* the descendants have been visited */
+        }
+        else
+            manager->update_cursor++;
+    }
+
+    manager->update_cursor = -1;
+}
+
+/*
+ * surgescript_objectmanager_link()
+ * Puts objects and their descendants in the update list, right after the
+ * descendants of their parent (the objects must be siblings). Call it after
+ * adding the objects to their parent
+ */
+void surgescript_objectmanager_link(surgescript_objectmanager_t* manager, const surgescript_objecthandle_t* handle, int n)
+{
+    surgescript_object_t* parent = NULL;
+    int parent_index, position, count = 0, length;
+
+    /* count the new entries */
+    lock_manager(manager);
+    for(int j = 0; j < n; j++) {
+        surgescript_object_t* object = lookup(manager, handle[j]);
+        if(object != NULL && manager->slot[handle_index(handle[j])].update_index < 0) {
+            parent = lookup(manager, surgescript_object_parent(object));
+            count += subtree_size(manager, object);
+        }
+    }
+
+    /* the parent must be in the list */
+    if(count == 0 || parent == NULL || (parent_index = manager->slot[handle_index(surgescript_object_handle(parent))].update_index) < 0) {
+        unlock_manager(manager);
+        return;
+    }
+
+    /* make room for the new entries */
+    position = manager->update_list[parent_index].end;
+    length = ssarray_length(manager->update_list);
+    ssarray_reserve(manager->update_list, length + count);
+    ssarray_truncate(manager->update_list, length + count);
+    if(position < length) {
+        memmove(manager->update_list + position + count, manager->update_list + position, (length - position) * sizeof(*(manager->update_list)));
+        for(int i = position + count; i < length + count; i++) {
+            surgescript_updateentry_t* entry = &(manager->update_list[i]);
+            entry->end += count;
+            if(entry->object != NULL)
+                manager->slot[handle_index(surgescript_object_handle(entry->object))].update_index = i;
+        }
+    }
+
+    /* fill the entries */
+    for(int j = 0, i = position; j < n; j++) {
+        surgescript_object_t* object = lookup(manager, handle[j]);
+        if(object != NULL && manager->slot[handle_index(handle[j])].update_index < 0)
+            i = fill_update_list(manager, object, i);
+    }
+
+    /* the parent and its ancestors have new descendants */
+    while(parent != NULL) {
+        surgescript_objecthandle_t parent_handle = surgescript_object_handle(parent);
+        int index = manager->slot[handle_index(parent_handle)].update_index;
+        if(index < 0 || surgescript_object_parent(parent) == parent_handle) {
+            if(index >= 0)
+                manager->update_list[index].end += count;
+            break;
+        }
+        manager->update_list[index].end += count;
+        parent = lookup(manager, surgescript_object_parent(parent));
+    }
+
+    /* don't visit the object being updated again */
+    if(manager->update_cursor >= position)
+        manager->update_cursor += count;
+
+    unlock_manager(manager);
+}
+
+/*
+ * surgescript_objectmanager_unlink()
+ * Removes an object and its descendants from the update list.
+ * Call it before removing the object from its parent
+ */
+void surgescript_objectmanager_unlink(surgescript_objectmanager_t* manager, surgescript_objecthandle_t handle)
+{
+    int index, end;
+
+    lock_manager(manager);
+    if(lookup(manager, handle) == NULL || (index = manager->slot[handle_index(handle)].update_index) < 0) {
+        unlock_manager(manager);
+        return;
+    }
+
+    end = manager->update_list[index].end;
+    for(int i = index; i < end; i++) {
+        surgescript_updateentry_t* entry = &(manager->update_list[i]);
+        if(entry->object != NULL) {
+            manager->slot[handle_index(surgescript_object_handle(entry->object))].update_index = -1;
+            entry->object = NULL;
+            manager->update_garbage++;
+        }
+    }
+    unlock_manager(manager);
+}
+
+/*
+ * surgescript_objectmanager_set_update_threads()
+ * Sets how many threads update the children of the parallel objects (see
+ * surgescript_object_set_parallel()), including the thread that updates the
+ * VM. If threads <= 1, the children are updated sequentially (default).
+ * Updating objects in parallel reserves the whole object table (2^20 slots,
+ * about 24 MB). Don't call this while updating the objects
+ */
+void surgescript_objectmanager_set_update_threads(surgescript_objectmanager_t* manager, int threads)
+{
+    threads = ssclamp(threads, 1, MAX_UPDATE_THREADS);
+    if(threads == manager->update_threads || manager->lock != NULL)
+        return;
+
+    /* stop the current threads */
+    release_threads(manager);
+    manager->update_threads = threads;
+
+    /* start the new ones */
+    if(threads > 1) {
+        manager->thread_seed = surgescript_util_random64();
+        manager->inverted_y = surgescript_transform_is_using_inverted_y();
+        manager->thread = ssmalloc(threads * sizeof(*(manager->thread)));
+        for(int i = 0; i < threads; i++)
+            manager->thread[i] = (surgescript_updatethread_t){ NULL, NULL };
+        manager->thread_pool = surgescript_threadpool_create(threads, manager, start_thread, stop_thread);
+    }
+}
+
+/*
+ * surgescript_objectmanager_update_threads()
+ * How many threads update the children of the parallel objects
+ */
+int surgescript_objectmanager_update_threads(const surgescript_objectmanager_t* manager)
+{
+    return manager->update_threads;
+}
+
 /*
  * surgescript_objectmanager_null()
  * Returns a handle to a NULL pointer in the object manager
@@ -385,6 +767,15 @@ surgescript_tagsystem_t* surgescript_objectmanager_tagsystem(const surgescript_o
     return manager->tag_system;
 }
 
+/*
+ * surgescript_objectmanager_slab()
+ * the memory allocator of the objects
+ */
+surgescript_slab_t* surgescript_objectmanager_slab(const surgescript_objectmanager_t* manager)
+{
+    return manager->slab;
+}
+
 /*
  * surgescript_objectmanager_vmargs()
  * VM command-line arguments
@@ -397,22 +788,38 @@ surgescript_vmargs_t* surgescript_objectmanager_vmargs(const surgescript_objectm
 /*
  * surgescript_objectmanager_garbagecollect()
  * Runs the garbage collector (incremental mark-and-sweep algorithm)
- * Returns true if something has been disposed, false otherwise
+ * Returns true if something has been disposed, false otherwise. It does
+ * nothing while objects are updated in parallel
  */
 bool surgescript_objectmanager_garbagecollect(surgescript_objectmanager_t* manager)
 {
     bool disposed = false;
 
+    /* the stacks of the other threads aren't scanned */
+    if(manager->lock != NULL)
+        return false;
+
     /* if there are no objects to be scanned, scan the root */
     if(ssarray_length(manager->objects_to_be_scanned) == manager->first_object_to_be_scanned) {
         if(surgescript_objectmanager_exists(manager, ROOT_HANDLE)) {
+            surgescript_object_t* root = surgescript_objectmanager_get(manager, ROOT_HANDLE);
+
             /* I have already scanned some objects */
-            if(ssarray_length(manager->objects_to_be_scanned) > 0) {
+            if(surgescript_object_is_reachable(root)) {
+                /* the stack isn't covered by the write barrier, so we scan it again */
+                surgescript_stack_scan_objects(manager->stack, manager, mark_as_reachable);
+                if(ssarray_length(manager->objects_to_be_scanned) > manager->first_object_to_be_scanned)
+                    return false; /* marking isn't over yet */
+
                 /* clear the unreachable objects */
-                surgescript_object_t* root = surgescript_objectmanager_get(manager, ROOT_HANDLE);
-                manager->garbage_count = 0;
+                manager->garbage_count = manager->cycle_garbage_count;
                 surgescript_object_traverse_tree(root, sweep_unreachables);
                 disposed = true;
+
+                /* statistics */
+                manager->last_scan_count = manager->scan_count;
+                manager->cycle_garbage_count = 0;
+                manager->scan_count = 0;
             }
 
             /* start a new cycle */
@@ -429,21 +836,214 @@ bool surgescript_objectmanager_garbagecollect(surgescript_objectmanager_t* manag
 }
 
 /*
- * surgescript_objectmanager_garbagechceck()
- * Incrementally looks for garbage in the system
+ * surgescript_objectmanager_fullgarbagecollect()
+ * Runs the garbage collector without pacing: marking is finished at once
+ * and the unreachable objects are disposed. Unlike garbagecollect(), this
+ * sweeps even if the write barrier has turned objects gray in the meantime.
+ * Returns true if something has been disposed, false otherwise
+ */
+bool surgescript_objectmanager_fullgarbagecollect(surgescript_objectmanager_t* manager)
+{
+    /* the stacks of the other threads aren't scanned */
+    if(manager->lock != NULL || !surgescript_objectmanager_exists(manager, ROOT_HANDLE))
+        return false;
+
+    /* rescanning the stack may find new gray objects, so we repeat */
+    do {
+        finish_marking(manager);
+    } while(!surgescript_objectmanager_garbagecollect(manager));
+
+    /* done! */
+    return true;
+}
+
+/*
+ * surgescript_objectmanager_garbagecheck()
+ * Incrementally looks for garbage in the system, within the time budget
+ *
+ * Marking follows the tri-colour abstraction: objects that are not marked
+ * as reachable are white, the ones waiting in objects_to_be_scanned are
+ * gray and the ones that have been scanned are black. The write barrier
+ * turns black objects gray again when they store an object handle, so
+ * that no black object references a white one when the sweep begins
  */
 void surgescript_objectmanager_garbagecheck(surgescript_objectmanager_t* manager)
 {
+    uint64_t start = surgescript_util_getmicroseconds();
+    uint64_t deadline = start + manager->garbage_budget;
+    uint64_t hard_deadline = start + manager->garbage_budget * MAX_PACING_FACTOR;
+    int debt = manager->allocation_count * PACING_RATIO;
+    int scanned = 0;
+
     /* for each object o to be scanned, check the ones that are reachable from o */
-    int old_length = ssarray_length(manager->objects_to_be_scanned);
-    for(int i = manager->first_object_to_be_scanned; i < old_length; i++) {
-        surgescript_objecthandle_t handle = manager->objects_to_be_scanned[i];
-        if(manager->data[handle] != NULL) {
-            surgescript_heap_t* heap = surgescript_object_heap(manager->data[handle]);
-            surgescript_heap_scan_objects(heap, manager, mark_as_reachable);
+    while(manager->first_object_to_be_scanned < ssarray_length(manager->objects_to_be_scanned)) {
+        surgescript_objecthandle_t handle = manager->objects_to_be_scanned[manager->first_object_to_be_scanned++];
+        surgescript_object_t* object = lookup(manager, handle);
+        if(object != NULL)
+            surgescript_object_scan_objects(object, manager, mark_as_reachable);
+
+        /* reading the clock is not free. If the objects are being
+           spawned faster than we mark them, we stretch the budget */
+        if(++scanned % GARBAGECHECK_GRANULARITY == 0) {
+            uint64_t now = surgescript_util_getmicroseconds();
+            if(now >= hard_deadline || (now >= deadline && scanned >= debt))
+                break;
+        }
+    }
+
+    manager->allocation_count = 0;
+    manager->scan_count += scanned;
+}
+
+/*
+ * surgescript_objectmanager_garbagestep()
+ * Does the work of the garbage collector for one frame: disposes the
+ * unreachable young objects, marks objects within the time budget and,
+ * if sweep is true and marking is over, disposes the unreachable objects.
+ * Returns true if the unreachable objects have been disposed
+ */
+bool surgescript_objectmanager_garbagestep(surgescript_objectmanager_t* manager, bool sweep)
+{
+    uint64_t start = surgescript_util_getmicroseconds();
+    bool disposed = false;
+    int bucket = 0;
+
+    /* do the work */
+    surgescript_objectmanager_nurserycollect(manager);
+    surgescript_objectmanager_garbagecheck(manager);
+    if(sweep)
+        disposed = surgescript_objectmanager_garbagecollect(manager);
+
+    /* update the pause histogram */
+    for(uint64_t pause = surgescript_util_getmicroseconds() - start; pause >= PAUSE_HISTOGRAM_BASE; pause /= 2) {
+        if(++bucket == SURGESCRIPT_OBJECTMANAGER_PAUSE_BUCKETS - 1)
+            break;
+    }
+    manager->pause_histogram[bucket]++;
+
+    /* done! */
+    return disposed;
+}
+
+/*
+ * surgescript_objectmanager_garbagescancount()
+ * How many objects have been scanned in the last garbage collection cycle
+ */
+int surgescript_objectmanager_garbagescancount(const surgescript_objectmanager_t* manager)
+{
+    return manager->last_scan_count;
+}
+
+/*
+ * surgescript_objectmanager_garbagepausecount()
+ * How many steps of the garbage collector took between 64 * 2^(bucket-1)
+ * and 64 * 2^bucket microseconds. The first bucket counts the steps that
+ * took less than 64us and the last one, the steps that took longer
+ */
+int surgescript_objectmanager_garbagepausecount(const surgescript_objectmanager_t* manager, int bucket)
+{
+    if(bucket >= 0 && bucket < SURGESCRIPT_OBJECTMANAGER_PAUSE_BUCKETS)
+        return manager->pause_histogram[bucket];
+    else
+        return 0;
+}
+
+/*
+ * surgescript_objectmanager_garbagebudget()
+ * How much time, in microseconds, garbagecheck() may take per call
+ * (it may take longer if the objects are being spawned too quickly)
+ */
+int surgescript_objectmanager_garbagebudget(const surgescript_objectmanager_t* manager)
+{
+    return manager->garbage_budget;
+}
+
+/*
+ * surgescript_objectmanager_set_garbagebudget()
+ * Sets how much time, in microseconds, garbagecheck() may take per call
+ */
+void surgescript_objectmanager_set_garbagebudget(surgescript_objectmanager_t* manager, int microseconds)
+{
+    manager->garbage_budget = ssmax(1, microseconds);
+}
+
+/*
+ * surgescript_objectmanager_nurserycollect()
+ * Disposes the young objects (temporary objects spawned since the last call)
+ * that are not reachable from the stack nor from the objects that have been
+ * written to in the meantime. Survivors are promoted. Returns the number of
+ * disposed objects. Call it between frames, since registers aren't scanned
+ */
+int surgescript_objectmanager_nurserycollect(surgescript_objectmanager_t* manager)
+{
+    int garbage = 0;
+
+    if(ssarray_length(manager->nursery) > 0) {
+        /* mark the young objects referenced by the roots */
+        ssarray_reset(manager->survivors);
+        surgescript_stack_scan_objects(manager->stack, manager, mark_as_survivor);
+        for(int i = 0; i < ssarray_length(manager->remembered_set); i++) {
+            surgescript_object_t* object = lookup(manager, manager->remembered_set[i]);
+            if(object != NULL && !surgescript_object_is_young(object))
+                surgescript_object_scan_objects(object, manager, mark_as_survivor);
+        }
+
+        /* the survivors may reference other young objects */
+        for(int i = 0; i < ssarray_length(manager->survivors); i++) {
+            surgescript_object_t* object = lookup(manager, manager->survivors[i]);
+            surgescript_object_scan_objects(object, manager, mark_as_survivor);
         }
+
+        /* dispose the young objects that haven't been marked */
+        for(int i = 0; i < ssarray_length(manager->nursery); i++) {
+            surgescript_objecthandle_t handle = manager->nursery[i];
+            surgescript_object_t* object = lookup(manager, handle);
+            if(object != NULL && surgescript_object_is_young(object)) {
+                surgescript_object_set_young(object, false);
+                if(!surgescript_object_is_killed(object)) {
+                    surgescript_object_kill(object);
+                    garbage++;
+                }
+            }
+        }
+
+        ssarray_reset(manager->nursery);
+        manager->cycle_garbage_count += garbage;
+    }
+
+    /* clear the remembered set */
+    for(int i = 0; i < ssarray_length(manager->remembered_set); i++) {
+        surgescript_object_t* object = lookup(manager, manager->remembered_set[i]);
+        if(object != NULL)
+            surgescript_object_set_remembered(object, false);
+    }
+    ssarray_reset(manager->remembered_set);
+
+    /* done! */
+    return garbage;
+}
+
+/*
+ * surgescript_objectmanager_write_barrier()
+ * Call this after storing an object handle in the heap or in the user data
+ * of an object, so that the objects it references are kept alive. Compiled
+ * scripts do this on their own; native code (bindings, plugins) must do it
+ * explicitly, since young objects referenced only by an old object that
+ * hasn't been remembered are disposed between frames
+ */
+void surgescript_objectmanager_write_barrier(surgescript_objectmanager_t* manager, surgescript_object_t* object)
+{
+    if(!surgescript_object_is_remembered(object)) {
+        surgescript_objecthandle_t handle = surgescript_object_handle(object);
+        lock_manager(manager);
+        surgescript_object_set_remembered(object, true);
+        ssarray_push(manager->remembered_set, handle);
+
+        /* a marked object must be scanned again (black to gray) */
+        if(surgescript_object_is_reachable(object))
+            ssarray_push(manager->objects_to_be_scanned, handle);
+        unlock_manager(manager);
     }
-    manager->first_object_to_be_scanned = old_length;
 }
 
 /*
@@ -462,7 +1062,7 @@ int surgescript_objectmanager_garbagecount(const surgescript_objectmanager_t* ma
 surgescript_objecthandle_t surgescript_objectmanager_spawn_array(surgescript_objectmanager_t* manager)
 {
     surgescript_objecthandle_t temp = surgescript_objectmanager_system_object(manager, "__Temp");
-    return surgescript_objectmanager_spawn(manager, temp, "Array", NULL);
+    return spawn_young(manager, temp, "Array");
 }
 
 /*
@@ -472,7 +1072,7 @@ surgescript_objecthandle_t surgescript_objectmanager_spawn_array(surgescript_obj
 surgescript_objecthandle_t surgescript_objectmanager_spawn_dictionary(surgescript_objectmanager_t* manager)
 {
     surgescript_objecthandle_t temp = surgescript_objectmanager_system_object(manager, "__Temp");
-    return surgescript_objectmanager_spawn(manager, temp, "Dictionary", NULL);
+    return spawn_young(manager, temp, "Dictionary");
 }
 
 /*
@@ -482,7 +1082,16 @@ surgescript_objecthandle_t surgescript_objectmanager_spawn_dictionary(surgescrip
 surgescript_objecthandle_t surgescript_objectmanager_spawn_temp(surgescript_objectmanager_t* manager, const char* object_name)
 {
     surgescript_objecthandle_t temp = surgescript_objectmanager_system_object(manager, "__Temp");
-    return surgescript_objectmanager_spawn(manager, temp, object_name, NULL);
+    return spawn_young(manager, temp, object_name);
+}
+
+/*
+ * surgescript_objectmanager_spawn_iterator()
+ * Spawns a (short-lived) iterator as a child of a collection and returns its handle
+ */
+surgescript_objecthandle_t surgescript_objectmanager_spawn_iterator(surgescript_objectmanager_t* manager, surgescript_objecthandle_t collection, const char* object_name)
+{
+    return spawn_young(manager, collection, object_name);
 }
 
 /*
@@ -535,12 +1144,77 @@ bool sweep_unreachables(surgescript_object_t* object)
     return true;
 }
 
-/* gets a handle at a unused space */
+bool mark_as_survivor(unsigned handle, void* mgr)
+{
+    surgescript_objectmanager_t* manager = (surgescript_objectmanager_t*)mgr;
+    if(surgescript_objectmanager_exists(manager, handle)) {
+        surgescript_object_t* object = surgescript_objectmanager_get(manager, handle);
+        if(surgescript_object_is_young(object)) {
+            surgescript_object_set_young(object, false); /* promote */
+            ssarray_push(manager->survivors, handle);
+        }
+        return true;
+    }
+    else
+        return false; /* returns false if the handle is broken */
+}
+
+/* scans the gray objects until there are none left */
+void finish_marking(surgescript_objectmanager_t* manager)
+{
+    int scanned = 0;
+
+    while(manager->first_object_to_be_scanned < ssarray_length(manager->objects_to_be_scanned)) {
+        surgescript_objecthandle_t handle = manager->objects_to_be_scanned[manager->first_object_to_be_scanned++];
+        surgescript_object_t* object = lookup(manager, handle);
+        if(object != NULL)
+            surgescript_object_scan_objects(object, manager, mark_as_reachable);
+        scanned++;
+    }
+
+    manager->scan_count += scanned;
+}
+
+/* spawns an object in the nursery */
+surgescript_objecthandle_t spawn_young(surgescript_objectmanager_t* manager, surgescript_objecthandle_t parent, const char* object_name)
+{
+    surgescript_objecthandle_t handle = surgescript_objectmanager_spawn(manager, parent, object_name, NULL);
+    lock_manager(manager);
+    surgescript_object_set_young(lookup(manager, handle), true);
+    ssarray_push(manager->nursery, handle);
+    unlock_manager(manager);
+    return handle;
+}
+
+/* gets a handle at a unused slot of the object table, in O(1) */
 surgescript_objecthandle_t new_handle(surgescript_objectmanager_t* mgr)
 {
-    while(mgr->handle_ptr < ssarray_length(mgr->data) && mgr->data[mgr->handle_ptr] != NULL)
-        mgr->handle_ptr++;
-    return mgr->handle_ptr;
+    int index = mgr->first_free;
+
+    /* reuse a free slot */
+    if(index >= 0) {
+        mgr->first_free = mgr->slot[index].next_free;
+        mgr->slot[index].next_free = -1;
+        return make_handle(index, mgr->slot[index].generation);
+    }
+
+    /* add a new slot */
+    index = ssarray_length(mgr->slot);
+    if(index > HANDLE_INDEX_MASK)
+        ssfatal("Can't spawn more than %u objects at the same time.", HANDLE_INDEX_MASK);
+    ssarray_push(mgr->slot, ((surgescript_objectslot_t){ NULL, 0, -1, -1 }));
+    return make_handle(index, 0);
+}
+
+/* the object a handle refers to, or NULL if the handle is null or stale */
+surgescript_object_t* lookup(const surgescript_objectmanager_t* manager, surgescript_objecthandle_t handle)
+{
+    unsigned index = handle_index(handle); /* unsigned; therefore, not lower than zero */
+
+    if(index < ssarray_length(manager->slot) && manager->slot[index].generation == handle_generation(handle))
+        return manager->slot[index].object;
+
+    return NULL;
 }
 
 /* adds an object to the plugin list */
@@ -582,13 +1256,201 @@ char** compile_plugins_list(const surgescript_objectmanager_t* manager) {
     return buf;
 }
 
-/* returns the plugin object -- fast */
+/* returns the plugin object */
 surgescript_object_t* plugin_object(const surgescript_objectmanager_t* manager)
 {
-    static surgescript_objecthandle_t handle = NULL_HANDLE;
+    surgescript_objecthandle_t handle = surgescript_objectmanager_system_object(manager, "Plugin");
+    return surgescript_objectmanager_get(manager, handle);
+}
 
-    if(handle == NULL_HANDLE) /* cache the handle */
-        handle = surgescript_objectmanager_system_object(NULL, "Plugin");
+/* writes the entries of an object and of its descendants to the update list,
+   starting at the given position. Returns the position that follows them */
+int fill_update_list(surgescript_objectmanager_t* manager, surgescript_object_t* object, int position)
+{
+    int index = position++;
+    int child_count = surgescript_object_child_count(object);
 
-    return surgescript_objectmanager_get(manager, handle);
+    for(int i = 0; i < child_count; i++) {
+        surgescript_object_t* child = lookup(manager, surgescript_object_nth_child(object, i));
+        if(child != NULL)
+            position = fill_update_list(manager, child, position);
+    }
+
+    manager->update_list[index].object = object;
+    manager->update_list[index].end = position;
+    manager->slot[handle_index(surgescript_object_handle(object))].update_index = index;
+    return position;
+}
+
+/* removes the NULL entries of the update list */
+void compact_update_list(surgescript_objectmanager_t* manager)
+{
+    surgescript_updateentry_t* entry = manager->update_list;
+    int i, k, n = ssarray_length(manager->update_list);
+    int* new_index = ssmalloc((n + 1) * sizeof(*new_index));
+
+    /* new_index[i] is the new position of entry i (or of the next kept entry) */
+    for(i = k = 0; i < n; i++) {
+        new_index[i] = k;
+        if(entry[i].object != NULL)
+            k++;
+    }
+    new_index[n] = k;
+
+    /* compact the list */
+    for(i = k = 0; i < n; i++) {
+        if(entry[i].object != NULL) {
+            entry[k].object = entry[i].object;
+            entry[k].end = new_index[entry[i].end];
+            manager->slot[handle_index(surgescript_object_handle(entry[k].object))].update_index = k;
+            k++;
+        }
+    }
+    ssarray_truncate(manager->update_list, k);
+    manager->update_garbage = 0;
+
+    ssfree(new_index);
+}
+
+/* the number of objects of the subtree rooted at the given object */
+int subtree_size(surgescript_objectmanager_t* manager, surgescript_object_t* object)
+{
+    int size = 1;
+    int child_count = surgescript_object_child_count(object);
+
+    for(int i = 0; i < child_count; i++) {
+        surgescript_object_t* child = lookup(manager, surgescript_object_nth_child(object, i));
+        if(child != NULL)
+            size += subtree_size(manager, child);
+    }
+
+    return size;
+}
+
+/* parallel update */
+
+/* updates the subtrees of the children of an object on the thread pool */
+void update_in_parallel(surgescript_objectmanager_t* manager, surgescript_object_t* object, void* data, bool (*callback)(surgescript_object_t*,void*))
+{
+    surgescript_paralleljob_t job = { manager, data, callback };
+    int child_count = surgescript_object_child_count(object);
+
+    /* the children are taken before the threads spawn new ones */
+    ssarray_reset(manager->parallel_children);
+    for(int i = 0; i < child_count; i++)
+        ssarray_push(manager->parallel_children, surgescript_object_nth_child(object, i));
+
+    /* run */
+    grow_object_table(manager);
+    begin_parallel_update(manager);
+    surgescript_threadpool_run(manager->thread_pool, child_count, &job, update_subtree);
+    end_parallel_update(manager);
+}
+
+/* updates the subtree of a child of a parallel object */
+void update_subtree(int task, int thread, void* job)
+{
+    surgescript_paralleljob_t* parallel_job = (surgescript_paralleljob_t*)job;
+    surgescript_objectmanager_t* manager = parallel_job->manager;
+    surgescript_object_t* child = lookup(manager, manager->parallel_children[task]);
+
+    if(child != NULL)
+        surgescript_object_traverse_tree_ex(child, parallel_job->data, parallel_job->callback);
+}
+
+/* the thread of the VM shares the object manager with the threads of the pool */
+void begin_parallel_update(surgescript_objectmanager_t* manager)
+{
+    manager->lock = manager->mutex;
+    surgescript_slab_set_mutex(manager->slab, manager->mutex);
+    surgescript_program_set_shared_lock(manager->mutex);
+    surgescript_var_share_strings(true);
+}
+
+/* the thread of the VM owns the object manager again; deletes the deferred objects */
+void end_parallel_update(surgescript_objectmanager_t* manager)
+{
+    surgescript_var_share_strings(false);
+    surgescript_program_set_shared_lock(NULL);
+    surgescript_slab_set_mutex(manager->slab, NULL);
+    manager->lock = NULL;
+
+    for(int i = 0; i < ssarray_length(manager->deferred); i++)
+        surgescript_objectmanager_delete(manager, manager->deferred[i]);
+    ssarray_reset(manager->deferred);
+}
+
+/* sets up a thread of the pool */
+void start_thread(int thread, void* mgr)
+{
+    surgescript_objectmanager_t* manager = (surgescript_objectmanager_t*)mgr;
+    surgescript_updatethread_t* t = &(manager->thread[thread]);
+
+    surgescript_var_init_pool();
+    surgescript_var_share_strings(true);
+    surgescript_program_set_shared_lock(manager->mutex);
+    surgescript_util_srand(manager->thread_seed + thread);
+    surgescript_transform_use_inverted_y(manager->inverted_y);
+
+    t->stack = surgescript_stack_create();
+    surgescript_object_set_thread_stack(t->stack);
+}
+
+/* the variables created by a thread of the pool may outlive
+   it; its variable pool is taken over by the thread of the VM */
+void stop_thread(int thread, void* mgr)
+{
+    surgescript_objectmanager_t* manager = (surgescript_objectmanager_t*)mgr;
+    surgescript_updatethread_t* t = &(manager->thread[thread]);
+
+    surgescript_object_set_thread_stack(NULL);
+    t->stack = surgescript_stack_destroy(t->stack);
+
+    surgescript_program_set_shared_lock(NULL);
+    t->varpool = surgescript_var_detach_pool();
+}
+
+/* stops the threads of the pool, if any */
+void release_threads(surgescript_objectmanager_t* manager)
+{
+    if(manager->thread_pool == NULL)
+        return;
+
+    manager->thread_pool = surgescript_threadpool_destroy(manager->thread_pool);
+    for(int i = 1; i < manager->update_threads; i++)
+        surgescript_var_attach_pool(manager->thread[i].varpool);
+
+    manager->thread = ssfree(manager->thread);
+    manager->update_threads = 1;
+}
+
+/* objects are looked up while other threads spawn new ones, so the
+   object table must not be reallocated: all slots are created at once */
+void grow_object_table(surgescript_objectmanager_t* manager)
+{
+    int length = ssarray_length(manager->slot);
+
+    if(length > HANDLE_INDEX_MASK)
+        return;
+
+    ssarray_reserve(manager->slot, HANDLE_INDEX_MASK + 1);
+    ssarray_truncate(manager->slot, HANDLE_INDEX_MASK + 1);
+    for(int index = HANDLE_INDEX_MASK; index >= length; index--) {
+        manager->slot[index] = (surgescript_objectslot_t){ NULL, 0, manager->first_free, -1 };
+        manager->first_free = index;
+    }
+}
+
+/* locks the object manager during a parallel update */
+void lock_manager(const surgescript_objectmanager_t* manager)
+{
+    if(manager->lock != NULL)
+        surgescript_mutex_lock(manager->lock);
+}
+
+/* unlocks the object manager during a parallel update */
+void unlock_manager(const surgescript_objectmanager_t* manager)
+{
+    if(manager->lock != NULL)
+        surgescript_mutex_unlock(manager->lock);
 }
@@ -24,6 +24,9 @@
 
 #include <stdbool.h>
 
+/* the durations of the steps of the garbage collector are put in buckets */
+#define SURGESCRIPT_OBJECTMANAGER_PAUSE_BUCKETS 8
+
 /* opaque types */
 typedef struct surgescript_objectmanager_t surgescript_objectmanager_t;
 typedef unsigned surgescript_objecthandle_t;
@@ -34,6 +37,7 @@ struct surgescript_programpool_t;
 struct surgescript_stack_t;
 struct surgescript_tagsystem_t;
 struct surgescript_vmargs_t;
+struct surgescript_slab_t;
 
 
 /* public methods */
@@ -44,22 +48,37 @@ surgescript_objectmanager_t* surgescript_objectmanager_destroy(surgescript_objec
 
 /* operations */
 surgescript_objecthandle_t surgescript_objectmanager_spawn_root(surgescript_objectmanager_t* manager); /* spawns the root object */
-surgescript_objecthandle_t surgescript_objectmanager_spawn(surgescript_objectmanager_t* manager, surgescript_objecthandle_t parent, const char* object_name, void* user_data); /* spawns a new object; user_data may be NULL */
+surgescript_objecthandle_t surgescript_objectmanager_spawn(surgescript_objectmanager_t* manager, surgescript_objecthandle_t parent, const char* object_name, void* user_data); /* spawns a new object; user_data may be NULL. At most 2^20 - 1 objects may exist at the same time */
+void surgescript_objectmanager_spawn_batch(surgescript_objectmanager_t* manager, surgescript_objecthandle_t parent, const char* object_name, int count, surgescript_objecthandle_t* handles); /* spawns count objects at once, writing their handles to handles[] (it may be NULL) */
 bool surgescript_objectmanager_exists(const surgescript_objectmanager_t* manager, surgescript_objecthandle_t handle); /* does the specified handle points to a valid object? */
 struct surgescript_object_t* surgescript_objectmanager_get(const surgescript_objectmanager_t* manager, surgescript_objecthandle_t handle); /* returns NULL if the object is not found */
 bool surgescript_objectmanager_delete(surgescript_objectmanager_t* manager, surgescript_objecthandle_t handle); /* deletes an existing object; returns true on success */
 int surgescript_objectmanager_count(const surgescript_objectmanager_t* manager); /* how many objects there are? */
 void surgescript_objectmanager_install_plugin(surgescript_objectmanager_t* manager, const char* object_name); /* installs a plugin */
+void surgescript_objectmanager_traverse(surgescript_objectmanager_t* manager, void* data, bool (*callback)(struct surgescript_object_t*,void*)); /* visits the object tree in depth-first order; if the callback returns false, the descendants of the object are skipped */
+
+/* parallel update (see vm.h) */
+void surgescript_objectmanager_set_update_threads(surgescript_objectmanager_t* manager, int threads); /* how many threads update the children of the parallel objects; 1 (default) means sequentially */
+int surgescript_objectmanager_update_threads(const surgescript_objectmanager_t* manager); /* how many threads update the children of the parallel objects */
 
 /* components */
 struct surgescript_programpool_t* surgescript_objectmanager_programpool(const surgescript_objectmanager_t* manager); /* pointer to the program pool */
 struct surgescript_tagsystem_t* surgescript_objectmanager_tagsystem(const surgescript_objectmanager_t* manager); /* pointer to the tag manager */
+struct surgescript_slab_t* surgescript_objectmanager_slab(const surgescript_objectmanager_t* manager); /* memory allocator of the objects */
 struct surgescript_vmargs_t* surgescript_objectmanager_vmargs(const surgescript_objectmanager_t* manager); /* VM command-line arguments */
 
 /* garbage collector */
 void surgescript_objectmanager_garbagecheck(surgescript_objectmanager_t* manager); /* checks for garbage (incrementally) */
 bool surgescript_objectmanager_garbagecollect(surgescript_objectmanager_t* manager); /* runs the garbage collector */
+bool surgescript_objectmanager_fullgarbagecollect(surgescript_objectmanager_t* manager); /* finishes marking at once and disposes the unreachable objects */
 int surgescript_objectmanager_garbagecount(const surgescript_objectmanager_t* manager); /* last number of garbage collected objects */
+int surgescript_objectmanager_garbagebudget(const surgescript_objectmanager_t* manager); /* time budget of garbagecheck(), in microseconds */
+void surgescript_objectmanager_set_garbagebudget(surgescript_objectmanager_t* manager, int microseconds); /* sets the time budget of garbagecheck() */
+bool surgescript_objectmanager_garbagestep(surgescript_objectmanager_t* manager, bool sweep); /* the work of the garbage collector for one frame */
+int surgescript_objectmanager_garbagescancount(const surgescript_objectmanager_t* manager); /* how many objects have been scanned in the last cycle */
+int surgescript_objectmanager_garbagepausecount(const surgescript_objectmanager_t* manager, int bucket); /* how many steps took between 64 * 2^(bucket-1) and 64 * 2^bucket microseconds */
+int surgescript_objectmanager_nurserycollect(surgescript_objectmanager_t* manager); /* disposes unreachable young objects; call it between frames */
+void surgescript_objectmanager_write_barrier(surgescript_objectmanager_t* manager, struct surgescript_object_t* object); /* call it after storing an object handle in the heap or in the user data of an object */
 
 /* root & built-in objects */
 surgescript_objecthandle_t surgescript_objectmanager_null(const surgescript_objectmanager_t* manager); /* handle to a null object */
@@ -73,5 +92,6 @@ const char** surgescript_objectmanager_builtin_objects(const surgescript_objectm
 surgescript_objecthandle_t surgescript_objectmanager_spawn_array(surgescript_objectmanager_t* manager); /* handle to a new Array */
 surgescript_objecthandle_t surgescript_objectmanager_spawn_dictionary(surgescript_objectmanager_t* manager); /* handle to a new Dictionary */
 surgescript_objecthandle_t surgescript_objectmanager_spawn_temp(surgescript_objectmanager_t* manager, const char* object_name); /* handle to a new child of Temp */
+surgescript_objecthandle_t surgescript_objectmanager_spawn_iterator(surgescript_objectmanager_t* manager, surgescript_objecthandle_t collection, const char* object_name); /* handle to a new iterator of a collection */
 
 #endif
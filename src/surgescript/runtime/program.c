@@ -34,6 +34,8 @@
 #include "program_pool.h"
 #include "../util/util.h"
 #include "../util/ssarray.h"
+#include "../util/uthash.h"
+#include "../util/thread.h"
 
 /* require alloca */
 #if !(defined(__APPLE__) || defined(MACOSX) || defined(macintosh) || defined(Macintosh))
@@ -51,6 +53,44 @@ struct surgescript_program_operation_t
     surgescript_program_operand_t a, b;
 };
 
+/* threaded dispatch: computed gotos are available on GCC-compatible compilers */
+/*#define SURGESCRIPT_DISABLE_THREADED_DISPATCH*/
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(SURGESCRIPT_DISABLE_THREADED_DISPATCH) && !defined(SURGESCRIPT_DEBUG_MODE)
+#define SURGESCRIPT_THREADED_DISPATCH
+#endif
+
+/* inline cache of a call site: monomorphic at first, then polymorphic */
+#define SURGESCRIPT_PROGRAM_CALLSITE_WAYS 4
+typedef struct surgescript_program_callsite_t surgescript_program_callsite_t;
+struct surgescript_program_callsite_t
+{
+    int method_id; /* interned name of the program to be called */
+    unsigned version; /* version of the program pool when the entries were cached */
+    int count; /* number of cached entries */
+    struct {
+        int class_id; /* key */
+        surgescript_program_t* program; /* value */
+    } entry[SURGESCRIPT_PROGRAM_CALLSITE_WAYS];
+};
+
+/* a pre-decoded operation: the address of its handler replaces the operator */
+typedef struct surgescript_program_decodedop_t surgescript_program_decodedop_t;
+struct surgescript_program_decodedop_t
+{
+    const void* handler;
+    surgescript_program_operand_t a, b;
+    surgescript_program_callsite_t* callsite; /* inline cache (calls only) */
+};
+
+/* an entry of the index of the text section: text -> index */
+typedef struct surgescript_program_textentry_t surgescript_program_textentry_t;
+struct surgescript_program_textentry_t
+{
+    const char* text; /* key: the contents of a string of the text section */
+    int index; /* value */
+    UT_hash_handle hh;
+};
+
 /* the program structure */
 struct surgescript_program_t
 {
@@ -58,7 +98,11 @@ struct surgescript_program_t
     void (*run)(surgescript_program_t*, surgescript_renv_t*); /* run function; strategy pattern */
     SSARRAY(surgescript_program_operation_t, line); /* a set of operations (or lines of code) */
     SSARRAY(surgescript_program_label_t, label); /* labels (label[j] is the index of a line of code, j is a label) */
-    SSARRAY(char*, text); /* read-only text data */
+    SSARRAY(surgescript_var_t*, text); /* read-only text data (shared strings) */
+    surgescript_program_textentry_t* text_index; /* text -> index */
+    surgescript_program_decodedop_t* decoded; /* pre-decoded instruction stream (built on the first run) */
+    surgescript_program_callsite_t* callsite; /* inline caches of the call sites of the decoded stream */
+    int callsite_count;
 };
 
 /* a program that encapsulates a C-function */
@@ -79,10 +123,23 @@ static const char* instruction_name[] = {
 static surgescript_program_t* init_program(surgescript_program_t* program, int arity, void (*run_function)(surgescript_program_t*, surgescript_renv_t*));
 static void run_program(surgescript_program_t* program, surgescript_renv_t* runtime_environment);
 static void run_cprogram(surgescript_program_t* program, surgescript_renv_t* runtime_environment);
-static inline void run_instruction(surgescript_program_t* program, surgescript_renv_t* runtime_environment, surgescript_program_operator_t instruction, surgescript_program_operand_t a, surgescript_program_operand_t b, int* ip);
-static inline void call_program(surgescript_renv_t* caller_runtime_environment, const char* program_name, int number_of_given_params);
+static inline void run_instruction(surgescript_program_t* program, surgescript_renv_t* runtime_environment, surgescript_program_operator_t instruction, surgescript_program_operand_t a, surgescript_program_operand_t b, surgescript_program_callsite_t* callsite, int* ip);
+static inline void call_program(surgescript_renv_t* caller_runtime_environment, const char* program_name, int number_of_given_params, surgescript_program_callsite_t* callsite);
+static inline surgescript_program_t* lookup_program(surgescript_programpool_t* pool, surgescript_program_callsite_t* callsite, int class_id, const char* program_name);
+static inline void get_field(surgescript_program_t* program, surgescript_renv_t* runtime_environment, surgescript_program_operand_t a, surgescript_program_callsite_t* callsite);
+static inline void set_field(surgescript_program_t* program, surgescript_renv_t* runtime_environment, surgescript_program_operand_t a, surgescript_program_callsite_t* callsite);
+static inline surgescript_var_t* find_field(surgescript_renv_t* runtime_environment, const surgescript_var_t* callee, surgescript_program_callsite_t* callsite, surgescript_program_operator_t access, const char* program_name);
+static inline void write_barrier(surgescript_renv_t* runtime_environment, surgescript_object_t* object, const surgescript_var_t* value);
+static int trivial_accessor_field(const surgescript_program_t* program, surgescript_program_operator_t access);
+static inline bool is_call_instruction(surgescript_program_operator_t instruction);
 static inline bool is_jump_instruction(surgescript_program_operator_t instruction);
+static inline int compare_registers(surgescript_var_t** _t, surgescript_program_operand_t b);
 static inline bool remove_labels(surgescript_program_t* program);
+static surgescript_program_decodedop_t* decode_program(surgescript_program_t* program, surgescript_programpool_t* pool, const void* const* handler, const void* end_handler);
+static const surgescript_program_decodedop_t* decode_once(surgescript_program_t* program, surgescript_programpool_t* pool, const void* const* handler, const void* end_handler);
+static inline void invalidate_decoded_stream(surgescript_program_t* program);
+static void index_text(surgescript_program_t* program);
+static void clear_text_index(surgescript_program_t* program);
 static char* hexdump(unsigned data, char* buf); /* writes the bytes stored in data to buf, in hex format */
 static void fputs_escaped(const char* str, FILE* fp); /* works like fputs, but escapes the string */
 static inline int fast_sign(double f);
@@ -90,6 +147,40 @@ static inline int fast_sign1(double f);
 static inline int fast_notzero(double f);
 static const int MAX_PROGRAM_ARITY = 256;
 
+/* objects updated in parallel: other threads may be running the same programs */
+void surgescript_program_set_shared_lock(surgescript_mutex_t* mutex);
+static SS_THREADLOCAL surgescript_mutex_t* shared_lock = NULL; /* if not NULL, the programs are shared with other threads */
+
+/* peephole optimizer */
+typedef struct surgescript_program_liveness_t surgescript_program_liveness_t;
+struct surgescript_program_liveness_t /* live registers & stack slots at each line */
+{
+    uint64_t* use; /* registers (bits 0-3) and stack slots (bits 4-63) read by each line */
+    uint64_t* def; /* registers and stack slots written by each line */
+    uint64_t* in; /* live_in[0 .. n]; live_in[n] is the exit of the program */
+    int slot[60]; /* the stack slots that are tracked (the bit of slot[j] is 4 + j) */
+    int slot_count;
+};
+static const int MAX_OPTIMIZER_PASSES = 16;
+static bool thread_jumps(surgescript_program_t* program);
+static bool simplify_moves(surgescript_program_t* program);
+static bool fold_constants(surgescript_program_t* program);
+static bool fuse_compare_and_jump(surgescript_program_t* program);
+static bool remove_dead_writes(surgescript_program_t* program);
+static bool remove_unreachable_code(surgescript_program_t* program);
+static bool remove_nops(surgescript_program_t* program);
+static int* count_jump_targets(const surgescript_program_t* program);
+static int successors(const surgescript_program_t* program, int line, int succ[2]);
+static surgescript_program_liveness_t* compute_liveness(const surgescript_program_t* program);
+static surgescript_program_liveness_t* release_liveness(surgescript_program_liveness_t* liveness);
+static uint64_t live_out(const surgescript_program_t* program, const surgescript_program_liveness_t* liveness, int line);
+static uint64_t slot_bit(surgescript_program_liveness_t* liveness, int slot);
+static inline bool is_conditional_jump(surgescript_program_operator_t instruction);
+static inline surgescript_program_operator_t negate_jump(surgescript_program_operator_t instruction);
+static inline surgescript_program_operator_t fuse_jump(surgescript_program_operator_t instruction);
+static inline bool is_pure_instruction(surgescript_program_operator_t instruction);
+static inline void make_nop(surgescript_program_operation_t* line);
+
 /* debug mode? */
 /*#define SURGESCRIPT_DEBUG_MODE*/
 #ifdef SURGESCRIPT_DEBUG_MODE
@@ -129,8 +220,10 @@ surgescript_program_t* surgescript_program_create_native(int arity, surgescript_
 surgescript_program_t* surgescript_program_destroy(surgescript_program_t* program)
 {
     for(int j = 0; j < ssarray_length(program->text); j++)
-        ssfree(program->text[j]);
+        surgescript_var_destroy(program->text[j]);
 
+    clear_text_index(program);
+    invalidate_decoded_stream(program);
     ssarray_release(program->text);
     ssarray_release(program->label);
     ssarray_release(program->line);
@@ -146,6 +239,7 @@ surgescript_program_t* surgescript_program_destroy(surgescript_program_t* progra
 int surgescript_program_add_line(surgescript_program_t* program, surgescript_program_operator_t op, surgescript_program_operand_t a, surgescript_program_operand_t b)
 {
     surgescript_program_operation_t line = { op, a, b };
+    invalidate_decoded_stream(program);
     ssarray_push(program->line, line);
     return ssarray_length(program->line) - 1;
 }
@@ -158,6 +252,7 @@ int surgescript_program_chg_line(surgescript_program_t* program, int line, surge
 {
     surgescript_program_operation_t newline = { op, a, b };
     if(line >= 0 && line < ssarray_length(program->line)) {
+        invalidate_decoded_stream(program);
         program->line[line] = newline;
         return line;
     }
@@ -171,6 +266,7 @@ int surgescript_program_chg_line(surgescript_program_t* program, int line, surge
  */
 void surgescript_program_add_label(surgescript_program_t* program, surgescript_program_label_t label)
 {
+    invalidate_decoded_stream(program);
     program->label[label] = ssarray_length(program->line);
 }
 
@@ -182,11 +278,40 @@ int surgescript_program_add_text(surgescript_program_t* program, const char* tex
 {
     int idx = surgescript_program_find_text(program, text);
     if(idx < 0) { /* if the text isn't already there */
-        ssarray_push(program->text, ssstrdup(text));
-        return ssarray_length(program->text) - 1;
+        surgescript_program_textentry_t* entry = ssmalloc(sizeof *entry);
+        surgescript_var_t* var = surgescript_var_set_string(surgescript_var_create(), text);
+        ssarray_push(program->text, var);
+        entry->text = surgescript_var_fast_get_string(var); /* var won't move */
+        entry->index = idx = ssarray_length(program->text) - 1;
+        HASH_ADD_KEYPTR(hh, program->text_index, entry->text, strlen(entry->text), entry);
     }
-    else
-        return idx;
+
+    return idx;
+}
+
+/*
+ * surgescript_program_intern_text()
+ * Replaces the strings of the text section of the program by equal strings
+ * shared by all programs of the pool (this is called by the program pool)
+ */
+void surgescript_program_intern_text(surgescript_program_t* program, surgescript_programpool_t* pool)
+{
+    for(int j = 0; j < ssarray_length(program->text); j++)
+        surgescript_var_copy(program->text[j], surgescript_programpool_intern_text(pool, program->text[j]));
+
+    index_text(program); /* the keys may have changed */
+}
+
+/*
+ * surgescript_program_release_text()
+ * Stops sharing the strings of the text section of the program with the
+ * other programs of the pool (this is called by the program pool before
+ * the program is deleted)
+ */
+void surgescript_program_release_text(surgescript_program_t* program, surgescript_programpool_t* pool)
+{
+    for(int j = 0; j < ssarray_length(program->text); j++)
+        surgescript_programpool_release_text(pool, program->text[j]);
 }
 
 /*
@@ -205,14 +330,9 @@ surgescript_program_label_t surgescript_program_new_label(surgescript_program_t*
  */
 int surgescript_program_find_text(const surgescript_program_t* program, const char* text)
 {
-    int i, len = ssarray_length(program->text);
-
-    for(i = 0; i < len; i++) {
-        if(strcmp(program->text[i], text) == 0)
-            return i;
-    }
-
-    return -1;
+    surgescript_program_textentry_t* entry = NULL;
+    HASH_FIND(hh, program->text_index, text, strlen(text), entry);
+    return entry != NULL ? entry->index : -1;
 }
 
 /*
@@ -222,7 +342,7 @@ int surgescript_program_find_text(const surgescript_program_t* program, const ch
 const char* surgescript_program_get_text(const surgescript_program_t* program, int index)
 {
     if(index >= 0 && index < ssarray_length(program->text))
-        return program->text[index];
+        return surgescript_var_fast_get_string(program->text[index]);
     else
         return "";
 }
@@ -236,6 +356,38 @@ int surgescript_program_text_count(const surgescript_program_t* program)
     return ssarray_length(program->text);
 }
 
+/*
+ * surgescript_program_line_count()
+ * How many lines of code does the program have?
+ */
+int surgescript_program_line_count(const surgescript_program_t* program)
+{
+    return ssarray_length(program->line);
+}
+
+/*
+ * surgescript_program_read_line()
+ * Reads a line of code of the program. The jump instructions
+ * will refer to line numbers, not to labels
+ */
+void surgescript_program_read_line(surgescript_program_t* program, int line, surgescript_program_operator_t* op, surgescript_program_operand_t* a, surgescript_program_operand_t* b)
+{
+    /* read the line */
+    if(line >= 0 && line < ssarray_length(program->line)) {
+        /* fix the jumps (only jumps are affected by labels) */
+        if(ssarray_length(program->label) > 0 && is_jump_instruction(program->line[line].instruction)) {
+            invalidate_decoded_stream(program);
+            remove_labels(program);
+        }
+
+        *op = program->line[line].instruction;
+        *a = program->line[line].a;
+        *b = program->line[line].b;
+    }
+    else
+        ssfatal("Runtime Error: can't read line %d of a program with %d lines.", line, ssarray_length(program->line));
+}
+
 /*
  * surgescript_program_arity()
  * What's the arity of this program?
@@ -281,7 +433,7 @@ void surgescript_program_dump(surgescript_program_t* program, FILE* fp)
 
     for(i = 0; i < ssarray_length(program->text); i++) {
         fputs("        \"", fp);
-        fputs_escaped(program->text[i], fp);
+        fputs_escaped(surgescript_var_fast_get_string(program->text[i]), fp);
         fputs((i < ssarray_length(program->text) - 1) ? "\",\n" : "\"\n", fp);
     }
 
@@ -319,6 +471,49 @@ bool surgescript_program_is_native(const surgescript_program_t* program)
     return program->run == run_cprogram;
 }
 
+/*
+ * surgescript_program_optimize()
+ * Runs a peephole optimizer on the program. This is meant to be called once,
+ * after the program is compiled. Level 0 does nothing. Level 1 threads jumps,
+ * removes dead code, redundant moves & nops and fuses compare-and-branch
+ * sequences into superinstructions. Level 2 also folds numeric constants.
+ */
+void surgescript_program_optimize(surgescript_program_t* program, int level)
+{
+    bool changed = true;
+
+    if(level <= 0 || surgescript_program_is_native(program))
+        return;
+
+    /* jumps will refer to line numbers */
+    invalidate_decoded_stream(program);
+    remove_labels(program);
+
+    /* optimize until there is nothing else to do */
+    for(int pass = 0; changed && pass < MAX_OPTIMIZER_PASSES; pass++) {
+        changed = false;
+        changed = thread_jumps(program) || changed;
+        changed = simplify_moves(program) || changed;
+        if(level >= 2)
+            changed = fold_constants(program) || changed;
+        changed = fuse_compare_and_jump(program) || changed;
+        changed = remove_dead_writes(program) || changed;
+        changed = remove_unreachable_code(program) || changed;
+        changed = remove_nops(program) || changed;
+    }
+}
+
+/*
+ * surgescript_program_set_shared_lock()
+ * Objects updated in parallel: tells the calling thread that other threads may be
+ * running the same programs. Programs are then decoded under mutex and their inline
+ * caches are left untouched. Pass NULL when the parallel update ends (friend function)
+ */
+void surgescript_program_set_shared_lock(surgescript_mutex_t* mutex)
+{
+    shared_lock = mutex;
+}
+
 
 
 /* -------------------------------
@@ -335,23 +530,82 @@ surgescript_program_t* init_program(surgescript_program_t* program, int arity, v
     /* initialization */
     program->arity = ssmax(0, arity);
     program->run = run_function;
+    program->decoded = NULL;
+    program->callsite = NULL;
+    program->callsite_count = 0;
 
     ssarray_init(program->line);
     ssarray_init(program->label);
     ssarray_init(program->text);
+    program->text_index = NULL;
 
     return program;
 }
 
 /* runs a program */
+#ifndef SURGESCRIPT_THREADED_DISPATCH
 void run_program(surgescript_program_t* program, surgescript_renv_t* runtime_environment)
 {
     int ip = 0; /* instruction pointer */
-    remove_labels(program);
+    const surgescript_program_decodedop_t* code = ssatomic_load(&program->decoded);
+
+    if(code == NULL)
+        code = decode_once(program, surgescript_renv_programpool(runtime_environment), NULL, NULL);
 
     while(ip < ssarray_length(program->line))
-        run_instruction(program, runtime_environment, program->line[ip].instruction, program->line[ip].a, program->line[ip].b, &ip);
+        run_instruction(program, runtime_environment, program->line[ip].instruction, program->line[ip].a, program->line[ip].b, code[ip].callsite, &ip);
 }
+#else
+void run_program(surgescript_program_t* program, surgescript_renv_t* runtime_environment)
+{
+    /* the dispatch table (labels-as-values) */
+    static const void* const handler[] = {
+        #define HANDLER_ADDRESS(x, y) &&L_##x,
+        SURGESCRIPT_PROGRAM_OPERATORS(HANDLER_ADDRESS)
+    };
+
+    /* temporary variables */
+    surgescript_var_t** _t = surgescript_renv_tmp(runtime_environment);
+    const surgescript_program_decodedop_t* code, *op;
+
+    /* helper macros */
+    #ifdef t
+    #undef t
+    #endif
+    #define t(k)             _t[(k).u & 3]
+    #define DISPATCH()       goto *(op->handler)
+    #define NEXT()           do { ++op; DISPATCH(); } while(0)
+    #define JUMP(line)       do { op = code + (line); DISPATCH(); } while(0)
+    #define RETURN()         return
+    #define OP(x)            L_##x:
+    #define A                op->a
+    #define B                op->b
+    #define CALLSITE         op->callsite
+
+    /* pre-decode the program on its first run */
+    if(NULL == (code = ssatomic_load(&program->decoded)))
+        code = decode_once(program, surgescript_renv_programpool(runtime_environment), handler, &&L_END);
+
+    /* run the program */
+    op = code;
+    DISPATCH();
+
+    /* instructions */
+    #include "program_handlers.h"
+
+    L_END:
+        return;
+
+    #undef CALLSITE
+    #undef B
+    #undef A
+    #undef OP
+    #undef RETURN
+    #undef JUMP
+    #undef NEXT
+    #undef DISPATCH
+}
+#endif
 
 /* runs a C-program */
 void run_cprogram(surgescript_program_t* program, surgescript_renv_t* runtime_environment)
@@ -377,7 +631,7 @@ void run_cprogram(surgescript_program_t* program, surgescript_renv_t* runtime_en
 }
 
 /* runs an instruction */
-void run_instruction(surgescript_program_t* program, surgescript_renv_t* runtime_environment, surgescript_program_operator_t instruction, surgescript_program_operand_t a, surgescript_program_operand_t b, int* ip)
+void run_instruction(surgescript_program_t* program, surgescript_renv_t* runtime_environment, surgescript_program_operator_t instruction, surgescript_program_operand_t a, surgescript_program_operand_t b, surgescript_program_callsite_t* callsite, int* ip)
 {
     /* temporary variables */
     surgescript_var_t** _t = surgescript_renv_tmp(runtime_environment);
@@ -395,253 +649,21 @@ void run_instruction(surgescript_program_t* program, surgescript_renv_t* runtime
 
     /* run the instruction */
     switch(instruction) {
-        /* basics */
-        case SSOP_NOP: /* no-operation */
-            break;
-
-        case SSOP_SELF: /* owner object ("this" pointer) */
-            surgescript_var_set_objecthandle(t(a), surgescript_object_handle(surgescript_renv_owner(runtime_environment)));
-            break;
-
-        case SSOP_STATE: /* t[a] receives the current state. If b == -1, then the current state is set to t[a] instead. */
-            if(b.i == -1) {
-                char state[256] = "";
-                surgescript_var_to_string(t(a), state, sizeof(state));
-                surgescript_object_set_state(surgescript_renv_owner(runtime_environment), state);
-            }
-            else
-                surgescript_var_set_string(t(a), surgescript_object_state(surgescript_renv_owner(runtime_environment)));
-            break;
-
-        case SSOP_CALLER: /* caller object */
-            surgescript_var_set_objecthandle(t(a), surgescript_renv_caller(runtime_environment));
-            break;
-
-        /* assignment operations */
-        case SSOP_MOVN: /* move null */
-            surgescript_var_set_null(t(a));
-            break;
-
-        case SSOP_MOVB: /* move boolean */
-            surgescript_var_set_bool(t(a), b.b);
-            break;
-
-        case SSOP_MOVF: /* move number */
-            surgescript_var_set_number(t(a), b.f);
-            break;
-
-        case SSOP_MOVS: /* move string */
-            if(b.u < ssarray_length(program->text))
-                surgescript_var_set_string(t(a), program->text[b.u]);
-            break;
-
-        case SSOP_MOVO: /* move object handle */
-            surgescript_var_set_objecthandle(t(a), b.u);
-            break;
-
-        case SSOP_MOVX: /* move int64 */
-            surgescript_var_set_rawbits(t(a), b.u);
-            break;
-
-        case SSOP_MOV: /* move temp */
-            surgescript_var_copy(t(a), t(b));
-            break;
-
-        case SSOP_XCHG: /* fast exchange */
-            surgescript_var_swap(t(a), t(b));
-            break;
-
-        /* heap operations */
-        case SSOP_ALLOC:
-            surgescript_var_set_number(t(a), surgescript_heap_malloc(surgescript_renv_heap(runtime_environment)));
-            break;
-
-        case SSOP_PEEK:
-            surgescript_var_copy(t(a), surgescript_heap_at(surgescript_renv_heap(runtime_environment), b.u));
-            break;
-
-        case SSOP_POKE:
-            surgescript_var_copy(surgescript_heap_at(surgescript_renv_heap(runtime_environment), b.u), t(a));
-            break;
-
-        /* stack operations */
-        case SSOP_PUSH:
-            surgescript_stack_push(surgescript_renv_stack(runtime_environment), surgescript_var_clone(t(a)));
-            break;
-
-        case SSOP_POP:
-            surgescript_var_copy(t(a), surgescript_stack_top(surgescript_renv_stack(runtime_environment)));
-            surgescript_stack_pop(surgescript_renv_stack(runtime_environment));
-            break;
-
-        case SSOP_SPEEK:
-            surgescript_var_copy(t(a), surgescript_stack_peek(surgescript_renv_stack(runtime_environment), b.i));
-            break;
-
-        case SSOP_SPOKE:
-            surgescript_stack_poke(surgescript_renv_stack(runtime_environment), b.i, t(a));
-            break;
-
-        case SSOP_PUSHN:
-            surgescript_stack_pushn(surgescript_renv_stack(runtime_environment), a.u);
-            break;
-
-        case SSOP_POPN:
-            surgescript_stack_popn(surgescript_renv_stack(runtime_environment), a.u);
-            break;
-
-        /* basic arithmetic */
-        case SSOP_INC:
-            if(a.u != 2)
-                surgescript_var_set_number(t(a), surgescript_var_get_number(t(a)) + 1);
-            else
-                surgescript_var_set_rawbits(t(a), surgescript_var_get_rawbits(t(a)) + 1);
-            break;
-
-        case SSOP_DEC:
-            if(a.u != 2)
-                surgescript_var_set_number(t(a), surgescript_var_get_number(t(a)) - 1);
-            else
-                surgescript_var_set_rawbits(t(a), surgescript_var_get_rawbits(t(a)) - 1);
-            break;
-
-        case SSOP_ADD:
-            surgescript_var_set_number(t(a), surgescript_var_get_number(t(a)) + surgescript_var_get_number(t(b)));
-            break;
-
-        case SSOP_SUB:
-            surgescript_var_set_number(t(a), surgescript_var_get_number(t(a)) - surgescript_var_get_number(t(b)));
-            break;
-
-        case SSOP_MUL:
-            surgescript_var_set_number(t(a), surgescript_var_get_number(t(a)) * surgescript_var_get_number(t(b)));
-            break;
-
-        case SSOP_DIV:
-            if(fast_notzero(surgescript_var_get_number(t(b))))
-                surgescript_var_set_number(t(a), surgescript_var_get_number(t(a)) / surgescript_var_get_number(t(b)));
-            else if(fast_sign(surgescript_var_get_number(t(a))) >= 0)
-                surgescript_var_set_number(t(a), INFINITY * fast_sign1(surgescript_var_get_number(t(b))));
-            else
-                surgescript_var_set_number(t(a), -INFINITY * fast_sign1(surgescript_var_get_number(t(b))));
-            break;
-
-        case SSOP_MOD:
-            surgescript_var_set_number(t(a), fmod(surgescript_var_get_number(t(a)), surgescript_var_get_number(t(b))));
-            break;
-
-        case SSOP_NEG:
-            surgescript_var_set_number(t(a), -surgescript_var_get_number(t(b)));
-            break;
-
-        case SSOP_LNOT:
-            surgescript_var_set_bool(t(a), !surgescript_var_get_bool(t(b)));
-            break;
-
-        case SSOP_LNOT2:
-            surgescript_var_set_bool(t(a), surgescript_var_get_bool(t(b)));
-            break;
-
-        /* bitwise operations */
-        case SSOP_NOT:
-            surgescript_var_set_rawbits(t(a), ~surgescript_var_get_rawbits(t(b)));
-            break;
-
-        case SSOP_AND:
-            surgescript_var_set_rawbits(t(a), surgescript_var_get_rawbits(t(a)) & surgescript_var_get_rawbits(t(b)));
-            break;
-
-        case SSOP_OR:
-            surgescript_var_set_rawbits(t(a), surgescript_var_get_rawbits(t(a)) | surgescript_var_get_rawbits(t(b)));
-            break;
-
-        case SSOP_XOR:
-            surgescript_var_set_rawbits(t(a), surgescript_var_get_rawbits(t(a)) ^ surgescript_var_get_rawbits(t(b)));
-            break;
-
-        /* comparing & testing */
-        case SSOP_TEST:
-            surgescript_var_set_rawbits(_t[2], surgescript_var_get_rawbits(t(a)) & surgescript_var_get_rawbits(t(b)));
-            break;
-
-        case SSOP_TCHK:
-            surgescript_var_set_rawbits(_t[2], surgescript_var_typecheck(t(a), b.i));
-            break;
-
-        case SSOP_TC01:
-            surgescript_var_set_rawbits(_t[2], surgescript_var_typecheck(_t[0], a.i) & surgescript_var_typecheck(_t[1], a.i));
-            break;
-
-        case SSOP_TCMP:
-            surgescript_var_set_rawbits(_t[2], surgescript_var_typecode(t(a)) ^ surgescript_var_typecode(t(b)));
-            break;
-
-        case SSOP_CMP:
-            surgescript_var_set_rawbits(_t[2], surgescript_var_compare(t(a), t(b)));
-            break;
-
-        /* jumping */
-        case SSOP_JMP:
-            *ip = a.u;
-            return;
-
-        case SSOP_JE:
-            if(!surgescript_var_get_rawbits(_t[2])) {
-                *ip = a.u;
-                return;
-            }
-            else
-                break;
-
-        case SSOP_JNE:
-            if(surgescript_var_get_rawbits(_t[2])) {
-                *ip = a.u;
-                return;
-            }
-            else
-                break;
-
-        case SSOP_JL:
-            if(surgescript_var_get_rawbits(_t[2]) < 0) {
-                *ip = a.u;
-                return;
-            }
-            else
-                break;
-
-        case SSOP_JG:
-            if(surgescript_var_get_rawbits(_t[2]) > 0) {
-                *ip = a.u;
-                return;
-            }
-            else
-                break;
-
-        case SSOP_JLE:
-            if(surgescript_var_get_rawbits(_t[2]) <= 0) {
-                *ip = a.u;
-                return;
-            }
-            else
-                break;
-
-        case SSOP_JGE:
-            if(surgescript_var_get_rawbits(_t[2]) >= 0) {
-                *ip = a.u;
-                return;
-            }
-            else
-                break;
-
-        /* function calls */
-        case SSOP_CALL:
-            if(a.u < ssarray_length(program->text))
-                call_program(runtime_environment, program->text[a.u], b.u);
-            break;
-
-        case SSOP_RET:
-            *ip = ssarray_length(program->line);
-            return;
+        #define OP(x)            case x:
+        #define A                a
+        #define B                b
+        #define CALLSITE         callsite
+        #define NEXT()           break
+        #define JUMP(line)       do { *ip = (line); return; } while(0)
+        #define RETURN()         do { *ip = ssarray_length(program->line); return; } while(0)
+        #include "program_handlers.h"
+        #undef RETURN
+        #undef JUMP
+        #undef NEXT
+        #undef CALLSITE
+        #undef B
+        #undef A
+        #undef OP
     }
 
     /* next line */
@@ -649,7 +671,7 @@ void run_instruction(surgescript_program_t* program, surgescript_renv_t* runtime
 }
 
 /* calls a program */
-void call_program(surgescript_renv_t* caller_runtime_environment, const char* program_name, int number_of_given_params)
+void call_program(surgescript_renv_t* caller_runtime_environment, const char* program_name, int number_of_given_params, surgescript_program_callsite_t* callsite)
 {
     /* preparing the stack */
     surgescript_stack_t* stack = surgescript_renv_stack(caller_runtime_environment);
@@ -669,7 +691,7 @@ void call_program(surgescript_renv_t* caller_runtime_environment, const char* pr
         surgescript_object_t* object = surgescript_objectmanager_get(manager, object_handle);
         const char* object_name = surgescript_object_name(object);
         surgescript_programpool_t* pool = surgescript_renv_programpool(caller_runtime_environment);
-        surgescript_program_t* program = surgescript_programpool_get(pool, object_name, program_name); /* bottleneck? */
+        surgescript_program_t* program = lookup_program(pool, callsite, surgescript_object_class_id(object), program_name);
         
         /* does the selected program exist? */
         if(program != NULL) {
@@ -705,6 +727,145 @@ void call_program(surgescript_renv_t* caller_runtime_environment, const char* pr
     surgescript_stack_popenv(stack); /* clear stack frame, including a unknown number of local variables */
 }
 
+/* finds the program to be called at a call site, using its inline cache */
+surgescript_program_t* lookup_program(surgescript_programpool_t* pool, surgescript_program_callsite_t* callsite, int class_id, const char* program_name)
+{
+    unsigned version = surgescript_programpool_version(pool);
+    surgescript_program_t* program;
+    int i;
+
+    /* cache hit? */
+    if(callsite->version == version) {
+        for(i = 0; i < callsite->count; i++) {
+            if(callsite->entry[i].class_id == class_id)
+                return callsite->entry[i].program;
+        }
+    }
+    else if(shared_lock == NULL) {
+        /* the program pool has changed; the cached programs may no longer exist */
+        callsite->count = 0;
+        callsite->version = version;
+    }
+
+    /* program_name wasn't interned when the program was decoded by a thread
+       sharing it with others (see decode_program). Intern it now */
+    if(callsite->method_id < 0 && shared_lock == NULL)
+        callsite->method_id = surgescript_programpool_method_id(pool, program_name);
+
+    /* cache miss: look up the program pool. Once the call site
+       becomes megamorphic, we stop caching its programs. The
+       caches are left untouched while other threads read them */
+    program = surgescript_programpool_get_by_id(pool, class_id, callsite->method_id);
+    if(program != NULL && callsite->count < SURGESCRIPT_PROGRAM_CALLSITE_WAYS && shared_lock == NULL) {
+        callsite->entry[callsite->count].class_id = class_id;
+        callsite->entry[callsite->count].program = program;
+        callsite->count++;
+    }
+
+    return program;
+}
+
+/* t[0] = t[0].getter(), reading the heap of t[0] directly if getter() is trivial */
+void get_field(surgescript_program_t* program, surgescript_renv_t* runtime_environment, surgescript_program_operand_t a, surgescript_program_callsite_t* callsite)
+{
+    surgescript_var_t** _t = surgescript_renv_tmp(runtime_environment);
+    surgescript_var_t* field = find_field(runtime_environment, _t[0], callsite, SSOP_PEEK, surgescript_program_get_text(program, a.u));
+
+    if(field == NULL) {
+        /* push t[0]; call getter 0; popn 1 */
+        surgescript_stack_t* stack = surgescript_renv_stack(runtime_environment);
+        surgescript_stack_pushcopy(stack, _t[0]);
+        if(a.u < ssarray_length(program->text))
+            call_program(runtime_environment, surgescript_var_fast_get_string(program->text[a.u]), 0, callsite);
+        surgescript_stack_popn(stack, 1);
+    }
+    else
+        surgescript_var_copy(_t[0], field);
+}
+
+/* stack[top].setter(t[0]), writing to the heap of stack[top] directly if setter() is trivial */
+void set_field(surgescript_program_t* program, surgescript_renv_t* runtime_environment, surgescript_program_operand_t a, surgescript_program_callsite_t* callsite)
+{
+    surgescript_var_t** _t = surgescript_renv_tmp(runtime_environment);
+    surgescript_stack_t* stack = surgescript_renv_stack(runtime_environment);
+    surgescript_var_t* field = find_field(runtime_environment, surgescript_stack_top(stack), callsite, SSOP_POKE, surgescript_program_get_text(program, a.u));
+
+    if(field == NULL) {
+        /* push t[0]; call setter 1; pop t[0] */
+        surgescript_stack_pushcopy(stack, _t[0]);
+        if(a.u < ssarray_length(program->text))
+            call_program(runtime_environment, surgescript_var_fast_get_string(program->text[a.u]), 1, callsite);
+        surgescript_var_copy(_t[0], surgescript_stack_top(stack));
+        surgescript_stack_pop(stack);
+    }
+    else {
+        surgescript_objectmanager_t* manager = surgescript_renv_objectmanager(runtime_environment);
+        surgescript_objecthandle_t handle = surgescript_var_get_objecthandle(surgescript_stack_top(stack));
+        surgescript_var_copy(field, _t[0]);
+        write_barrier(runtime_environment, surgescript_objectmanager_get(manager, handle), _t[0]);
+    }
+}
+
+/* notifies the garbage collector that value has been stored in the heap of object */
+void write_barrier(surgescript_renv_t* runtime_environment, surgescript_object_t* object, const surgescript_var_t* value)
+{
+    if(surgescript_var_is_objecthandle(value))
+        surgescript_objectmanager_write_barrier(surgescript_renv_objectmanager(runtime_environment), object);
+}
+
+/* if the accessor of a call site is a trivial getter (access == SSOP_PEEK) or setter
+   (access == SSOP_POKE) of the callee, find the variable it accesses. Returns NULL if
+   the accessor must be called instead */
+surgescript_var_t* find_field(surgescript_renv_t* runtime_environment, const surgescript_var_t* callee, surgescript_program_callsite_t* callsite, surgescript_program_operator_t access, const char* program_name)
+{
+    if(surgescript_var_is_objecthandle(callee)) {
+        surgescript_objectmanager_t* manager = surgescript_renv_objectmanager(runtime_environment);
+        surgescript_objecthandle_t handle = surgescript_var_get_objecthandle(callee);
+
+        if(surgescript_objectmanager_exists(manager, handle)) {
+            surgescript_object_t* object = surgescript_objectmanager_get(manager, handle);
+            surgescript_program_t* program = lookup_program(surgescript_renv_programpool(runtime_environment), callsite, surgescript_object_class_id(object), program_name);
+            int address = (program != NULL) ? trivial_accessor_field(program, access) : -1;
+
+            if(address >= 0 && surgescript_heap_validaddress(surgescript_object_heap(object), address))
+                return surgescript_heap_at(surgescript_object_heap(object), address);
+        }
+    }
+
+    return NULL;
+}
+
+/* the heap address of the variable accessed by a program, if the program is a trivial
+   getter (PEEK; RET) or setter (SPEEK; POKE; RET) at any optimization level. -1 if it isn't */
+int trivial_accessor_field(const surgescript_program_t* program, surgescript_program_operator_t access)
+{
+    const surgescript_program_operation_t* line = program->line;
+    int n = ssarray_length(program->line), i = 0;
+
+    /* skip the NOPs of unoptimized code. Whatever follows the RET is unreachable */
+    if(program->run != run_program)
+        return -1;
+    while(i < n && line[i].instruction == SSOP_NOP)
+        i++;
+
+    if(access == SSOP_PEEK) {
+        /* peek t[0], b ; ret */
+        if(program->arity == 0 && i + 1 < n &&
+        line[i].instruction == SSOP_PEEK && line[i].a.u == 0 && line[i+1].instruction == SSOP_RET)
+            return line[i].b.u;
+    }
+    else if(access == SSOP_POKE) {
+        /* speek t[0], -1 ; poke t[0], b ; [movn t[0]] ; ret (the caller discards the return value of a setter) */
+        if(program->arity == 1 && i + 2 < n &&
+        line[i].instruction == SSOP_SPEEK && line[i].a.u == 0 && line[i].b.i == -1 &&
+        line[i+1].instruction == SSOP_POKE && line[i+1].a.u == 0 &&
+        (line[i+2].instruction == SSOP_RET || (line[i+2].instruction == SSOP_MOVN && line[i+2].a.u == 0 && i + 3 < n && line[i+3].instruction == SSOP_RET)))
+            return line[i+1].b.u;
+    }
+
+    return -1;
+}
+
 /* writes data to buf, in hex/big-endian format (writes (1 + 2 * sizeof(unsigned)) bytes to buf) */
 char* hexdump(unsigned data, char* buf)
 {
@@ -754,12 +915,131 @@ bool is_jump_instruction(surgescript_program_operator_t instruction)
         case SSOP_JGE:
         case SSOP_JL:
         case SSOP_JLE:
+        case SSOP_CJE:
+        case SSOP_CJNE:
+        case SSOP_CJG:
+        case SSOP_CJGE:
+        case SSOP_CJL:
+        case SSOP_CJLE:
             return true;
         default:
             return false;
     }
 }
 
+/* does the instruction call a program? (calls have inline caches) */
+bool is_call_instruction(surgescript_program_operator_t instruction)
+{
+    return instruction == SSOP_CALL || instruction == SSOP_GETFIELD || instruction == SSOP_SETFIELD;
+}
+
+/* compare-and-jump superinstructions: t[2] = compare(t[b & 3], t[b >> 8]) */
+int compare_registers(surgescript_var_t** _t, surgescript_program_operand_t b)
+{
+    int cmp = surgescript_var_compare(_t[b.u & 3], _t[(b.u >> 8) & 3]);
+    surgescript_var_set_rawbits(_t[2], cmp);
+    return cmp;
+}
+
+/* pre-decodes the program, returning an instruction stream that ends with a
+   sentinel, so that no bounds checking is needed when dispatching. handler
+   may be NULL if the operators aren't to be replaced by their handlers */
+surgescript_program_decodedop_t* decode_program(surgescript_program_t* program, surgescript_programpool_t* pool, const void* const* handler, const void* end_handler)
+{
+    surgescript_program_decodedop_t* decoded;
+    int i, j, n = ssarray_length(program->line);
+
+    /* fix the jumps */
+    invalidate_decoded_stream(program);
+    remove_labels(program);
+
+    /* allocate the inline caches. Names aren't interned while
+       other threads may look them up; see lookup_program() */
+    for(i = 0; i < n; i++)
+        program->callsite_count += is_call_instruction(program->line[i].instruction);
+    if(program->callsite_count > 0) {
+        program->callsite = ssmalloc(program->callsite_count * sizeof(*(program->callsite)));
+        for(i = j = 0; i < n; i++) {
+            if(is_call_instruction(program->line[i].instruction)) {
+                const char* program_name = surgescript_program_get_text(program, program->line[i].a.u);
+                program->callsite[j].method_id = (shared_lock == NULL) ? surgescript_programpool_method_id(pool, program_name) : surgescript_programpool_find_method_id(pool, program_name);
+                program->callsite[j].version = 0;
+                program->callsite[j].count = 0;
+                j++;
+            }
+        }
+    }
+
+    /* decode */
+    decoded = ssmalloc((n + 1) * sizeof(*decoded));
+    for(i = j = 0; i < n; i++) {
+        decoded[i].handler = handler ? handler[program->line[i].instruction] : NULL;
+        decoded[i].a = program->line[i].a;
+        decoded[i].b = program->line[i].b;
+        decoded[i].callsite = is_call_instruction(program->line[i].instruction) ? &(program->callsite[j++]) : NULL;
+    }
+
+    /* sentinel */
+    decoded[n].handler = end_handler;
+    decoded[n].a = decoded[n].b = SSOP();
+    decoded[n].callsite = NULL;
+
+    /* publish the stream only when it's complete */
+    ssatomic_store(&program->decoded, decoded);
+    return decoded;
+}
+
+/* decodes the program if no other thread has done it in the meantime */
+const surgescript_program_decodedop_t* decode_once(surgescript_program_t* program, surgescript_programpool_t* pool, const void* const* handler, const void* end_handler)
+{
+    const surgescript_program_decodedop_t* decoded;
+
+    if(shared_lock == NULL)
+        return decode_program(program, pool, handler, end_handler);
+
+    surgescript_mutex_lock(shared_lock);
+    if(NULL == (decoded = ssatomic_load(&program->decoded)))
+        decoded = decode_program(program, pool, handler, end_handler);
+    surgescript_mutex_unlock(shared_lock);
+
+    return decoded;
+}
+
+/* discards the pre-decoded instruction stream; it will be rebuilt on the next run */
+void invalidate_decoded_stream(surgescript_program_t* program)
+{
+    if(program->decoded != NULL)
+        program->decoded = ssfree(program->decoded);
+
+    if(program->callsite != NULL)
+        program->callsite = ssfree(program->callsite);
+
+    program->callsite_count = 0;
+}
+
+/* (re)builds the index of the text section */
+void index_text(surgescript_program_t* program)
+{
+    clear_text_index(program);
+    for(int j = 0; j < ssarray_length(program->text); j++) {
+        surgescript_program_textentry_t* entry = ssmalloc(sizeof *entry);
+        entry->text = surgescript_var_fast_get_string(program->text[j]);
+        entry->index = j;
+        HASH_ADD_KEYPTR(hh, program->text_index, entry->text, strlen(entry->text), entry);
+    }
+}
+
+/* clears the index of the text section */
+void clear_text_index(surgescript_program_t* program)
+{
+    surgescript_program_textentry_t *it, *tmp;
+
+    HASH_ITER(hh, program->text_index, it, tmp) {
+        HASH_DEL(program->text_index, it);
+        ssfree(it);
+    }
+}
+
 /* removes all labels from the program, placing the correct line numbers
    on all jump instructions. Returns true if there were any removed labels. */
 bool remove_labels(surgescript_program_t* program)
@@ -784,6 +1064,720 @@ bool remove_labels(surgescript_program_t* program)
         return false;
 }
 
+/* peephole optimizer: follows chains of jumps and simplifies branches */
+bool thread_jumps(surgescript_program_t* program)
+{
+    surgescript_program_operation_t* line = program->line;
+    int i, n = ssarray_length(program->line);
+    bool changed = false;
+    int* targets;
+
+    /* jump-to-jump */
+    for(i = 0; i < n; i++) {
+        if(is_jump_instruction(line[i].instruction)) {
+            unsigned target = line[i].a.u;
+            for(int steps = 0; target < n && line[target].instruction == SSOP_JMP && line[target].a.u != target && steps < n; steps++)
+                target = line[target].a.u;
+            if(target != line[i].a.u) {
+                line[i].a.u = target;
+                changed = true;
+            }
+        }
+    }
+
+    /* jumps to the next line & branches over jumps */
+    targets = count_jump_targets(program);
+    for(i = 0; i < n; i++) {
+        surgescript_program_operator_t instruction = line[i].instruction;
+        if(is_jump_instruction(instruction) && line[i].a.u == i + 1) {
+            /* conditional jumps to the next line only compare things */
+            if(instruction >= SSOP_CJE && instruction <= SSOP_CJLE) {
+                line[i].instruction = SSOP_CMP;
+                line[i].a.u = line[i].b.u & 3;
+                line[i].b.u = (line[i].b.u >> 8) & 3;
+            }
+            else
+                make_nop(&line[i]);
+            targets[i+1]--;
+            changed = true;
+        }
+        else if(is_conditional_jump(instruction) && line[i].a.u == i + 2 && line[i+1].instruction == SSOP_JMP && !targets[i+1]) {
+            /* jxx L; jmp M; L: ...  becomes  j!xx M; L: ... */
+            unsigned target = line[i+1].a.u;
+            if(target != i + 1 && !(target < n && line[target].instruction == SSOP_JMP)) {
+                line[i].instruction = negate_jump(instruction);
+                line[i].a.u = target;
+                make_nop(&line[i+1]);
+                targets[i+2]--;
+                changed = true;
+            }
+        }
+    }
+
+    ssfree(targets);
+    return changed;
+}
+
+/* peephole optimizer: removes redundant MOVs and XCHGs */
+bool simplify_moves(surgescript_program_t* program)
+{
+    surgescript_program_operation_t* line = program->line;
+    int n = ssarray_length(program->line);
+    int* targets = count_jump_targets(program);
+    bool changed = false;
+
+    for(int i = 0; i < n; i++) {
+        surgescript_program_operator_t instruction = line[i].instruction;
+        unsigned a = line[i].a.u & 3, b = line[i].b.u & 3;
+
+        if(instruction != SSOP_MOV && instruction != SSOP_XCHG)
+            continue;
+
+        if(a == b) {
+            /* mov a, a ; xchg a, a */
+            make_nop(&line[i]);
+            changed = true;
+        }
+        else if(i + 1 < n && !targets[i+1] && line[i+1].instruction == instruction) {
+            unsigned c = line[i+1].a.u & 3, d = line[i+1].b.u & 3;
+            if(instruction == SSOP_XCHG && ((a == c && b == d) || (a == d && b == c))) {
+                /* xchg a, b ; xchg a, b */
+                make_nop(&line[i]);
+                make_nop(&line[i+1]);
+                changed = true;
+            }
+            else if(instruction == SSOP_MOV && ((a == c && b == d) || (a == d && b == c))) {
+                /* mov a, b ; mov a, b */
+                make_nop(&line[i+1]);
+                changed = true;
+            }
+        }
+    }
+
+    ssfree(targets);
+    return changed;
+}
+
+/* peephole optimizer: folds arithmetic on numeric constants */
+bool fold_constants(surgescript_program_t* program)
+{
+    const uint64_t T1 = 1 << 1, T2 = 1 << 2;
+    surgescript_program_operation_t* line = program->line;
+    int n = ssarray_length(program->line);
+    int* targets = count_jump_targets(program);
+    surgescript_program_liveness_t* liveness = compute_liveness(program);
+    bool changed = false;
+
+    for(int i = 0; i + 1 < n; i++) {
+        int j, last = -1;
+        double x, y, result = 0.0;
+        bool pushed, keep_store;
+
+        if(line[i].instruction != SSOP_MOVF || line[i].a.u != 0)
+            continue;
+
+        /* unary minus: movf t0, x ; neg t0, t0 */
+        if(line[i+1].instruction == SSOP_NEG && line[i+1].a.u == 0 && line[i+1].b.u == 0 && !targets[i+1]) {
+            line[i+1].instruction = SSOP_MOVF;
+            line[i+1].b = SSOPf(-line[i].b.f);
+            make_nop(&line[i]);
+            changed = true;
+            continue;
+        }
+
+        /* binary operators: movf t0, x ; save t0 ; movf t0, y ; load t1 ; <op> */
+        if(i + 4 >= n || line[i+2].instruction != SSOP_MOVF || line[i+2].a.u != 0)
+            continue;
+        else if(line[i+1].instruction == SSOP_PUSH && line[i+1].a.u == 0 && line[i+3].instruction == SSOP_POP && line[i+3].a.u == 1)
+            pushed = true;
+        else if(line[i+1].instruction == SSOP_SPOKE && line[i+1].a.u == 0 && line[i+3].instruction == SSOP_SPEEK && line[i+3].a.u == 1 && line[i+3].b.i == line[i+1].b.i)
+            pushed = false;
+        else
+            continue;
+
+        x = line[i].b.f;
+        y = line[i+2].b.f;
+        switch(line[i+4].instruction) {
+            case SSOP_MUL:
+                if(line[i+4].a.u == 0 && line[i+4].b.u == 1) {
+                    result = x * y;
+                    last = i + 4;
+                }
+                break;
+
+            case SSOP_SUB:
+            case SSOP_DIV:
+            case SSOP_MOD:
+                if(i + 5 < n && line[i+4].a.u == 1 && line[i+4].b.u == 0 && line[i+5].instruction == SSOP_XCHG && (line[i+5].a.u ^ line[i+5].b.u) == 1) {
+                    if(line[i+4].instruction == SSOP_SUB)
+                        result = x - y;
+                    else if(line[i+4].instruction == SSOP_MOD)
+                        result = fmod(x, y);
+                    else if(fast_notzero(y))
+                        result = x / y;
+                    else
+                        break;
+                    last = i + 5;
+                }
+                break;
+
+            case SSOP_TC01:
+                /* tc01 string ; je cat ; add t0, t1 ; jmp end ; cat: (concat) ; end: */
+                if(i + 7 < n && line[i+4].a.i == surgescript_var_type2code("string") && line[i+5].instruction == SSOP_JE &&
+                line[i+6].instruction == SSOP_ADD && line[i+6].a.u == 0 && line[i+6].b.u == 1 && line[i+7].instruction == SSOP_JMP) {
+                    result = x + y;
+                    last = i + 6;
+                }
+                break;
+
+            default:
+                break;
+        }
+
+        /* no jumps into the sequence; t1 and t2 are scratch */
+        for(j = i + 1; j <= last; j++) {
+            if(targets[j])
+                last = -1;
+        }
+        if(last < 0 || (live_out(program, liveness, last) & (T1 | T2)))
+            continue;
+
+        /* fold */
+        if(!pushed) {
+            uint64_t bit = slot_bit(liveness, line[i+1].b.i);
+            keep_store = !bit || (live_out(program, liveness, i + 3) & bit);
+        }
+        else
+            keep_store = false;
+        for(j = keep_store ? i + 2 : i; j < last; j++)
+            make_nop(&line[j]);
+        line[last].instruction = SSOP_MOVF;
+        line[last].a = SSOPu(0);
+        line[last].b = SSOPf(result);
+        changed = true;
+        i = last;
+    }
+
+    release_liveness(liveness);
+    ssfree(targets);
+    return changed;
+}
+
+/* peephole optimizer: fuses comparisons and conditional jumps */
+bool fuse_compare_and_jump(surgescript_program_t* program)
+{
+    const uint64_t T0 = 1 << 0, T2 = 1 << 2;
+    surgescript_program_operation_t* line = program->line;
+    int n = ssarray_length(program->line);
+    int* targets = count_jump_targets(program);
+    surgescript_program_liveness_t* liveness = compute_liveness(program);
+    bool changed = false;
+
+    for(int i = 0; i + 1 < n; i++) {
+        surgescript_program_operand_t regs;
+        surgescript_program_operator_t instruction;
+
+        if(line[i].instruction != SSOP_CMP)
+            continue;
+        regs = SSOPu((line[i].a.u & 3) | ((line[i].b.u & 3) << 8));
+
+        if(i + 5 < n &&
+            line[i+1].instruction == SSOP_MOVB && line[i+1].a.u == 0 && line[i+1].b.b &&
+            is_conditional_jump(line[i+2].instruction) && !(line[i+2].instruction >= SSOP_CJE && line[i+2].instruction <= SSOP_CJLE) && line[i+2].a.u == i + 4 &&
+            line[i+3].instruction == SSOP_MOVB && line[i+3].a.u == 0 && !line[i+3].b.b &&
+            line[i+4].instruction == SSOP_TEST && line[i+4].a.u == 0 && line[i+4].b.u == 0 &&
+            (line[i+5].instruction == SSOP_JE || line[i+5].instruction == SSOP_JNE) &&
+            !targets[i+1] && !targets[i+2] && !targets[i+3] && targets[i+4] == 1 && !targets[i+5] &&
+            !(live_out(program, liveness, i + 5) & (T0 | T2))
+        ) {
+            /* relational expression as a condition:
+               cmp a, b ; movb t0, true ; jxx L ; movb t0, false ; L: test t0, t0 ; je M */
+            instruction = fuse_jump(line[i+2].instruction);
+            if(line[i+5].instruction == SSOP_JE)
+                instruction = negate_jump(instruction);
+            line[i].instruction = instruction;
+            line[i].a = line[i+5].a;
+            line[i].b = regs;
+            for(int j = 1; j <= 5; j++)
+                make_nop(&line[i+j]);
+            changed = true;
+        }
+        else if(i + 3 < n &&
+            (line[i+1].instruction == SSOP_LNOT || line[i+1].instruction == SSOP_LNOT2) && line[i+1].a.u == 0 && line[i+1].b.u == 2 &&
+            line[i+2].instruction == SSOP_TEST && line[i+2].a.u == 0 && line[i+2].b.u == 0 &&
+            (line[i+3].instruction == SSOP_JE || line[i+3].instruction == SSOP_JNE) &&
+            !targets[i+1] && !targets[i+2] && !targets[i+3] &&
+            !(live_out(program, liveness, i + 3) & (T0 | T2))
+        ) {
+            /* equality expression as a condition:
+               cmp a, b ; lnot t0, t2 ; test t0, t0 ; je M */
+            instruction = (line[i+1].instruction == SSOP_LNOT) ? SSOP_CJE : SSOP_CJNE;
+            if(line[i+3].instruction == SSOP_JE)
+                instruction = negate_jump(instruction);
+            line[i].instruction = instruction;
+            line[i].a = line[i+3].a;
+            line[i].b = regs;
+            for(int j = 1; j <= 3; j++)
+                make_nop(&line[i+j]);
+            changed = true;
+        }
+        else if(is_conditional_jump(line[i+1].instruction) && !(line[i+1].instruction >= SSOP_CJE && line[i+1].instruction <= SSOP_CJLE) && !targets[i+1]) {
+            /* cmp a, b ; jxx M */
+            line[i].instruction = fuse_jump(line[i+1].instruction);
+            line[i].a = line[i+1].a;
+            line[i].b = regs;
+            make_nop(&line[i+1]);
+            changed = true;
+        }
+    }
+
+    release_liveness(liveness);
+    ssfree(targets);
+    return changed;
+}
+
+/* peephole optimizer: removes instructions whose results are never used */
+bool remove_dead_writes(surgescript_program_t* program)
+{
+    surgescript_program_operation_t* line = program->line;
+    int n = ssarray_length(program->line);
+    surgescript_program_liveness_t* liveness = compute_liveness(program);
+    bool changed = false;
+
+    for(int i = 0; i < n; i++) {
+        if(is_pure_instruction(line[i].instruction) && liveness->def[i] != 0 && !(liveness->def[i] & live_out(program, liveness, i))) {
+            make_nop(&line[i]);
+            changed = true;
+        }
+    }
+
+    release_liveness(liveness);
+    return changed;
+}
+
+/* peephole optimizer: removes code that can't be reached */
+bool remove_unreachable_code(surgescript_program_t* program)
+{
+    surgescript_program_operation_t* line = program->line;
+    int n = ssarray_length(program->line);
+    bool* reachable = ssmalloc((n + 1) * sizeof(*reachable));
+    int* pending = ssmalloc((n + 1) * sizeof(*pending));
+    int i, count = 0, succ[2];
+    bool changed = false;
+
+    /* depth-first search from the first line */
+    for(i = 0; i <= n; i++)
+        reachable[i] = false;
+    reachable[0] = true;
+    pending[count++] = 0;
+    while(count > 0) {
+        int current = pending[--count];
+        if(current < n) {
+            for(int k = successors(program, current, succ) - 1; k >= 0; k--) {
+                if(!reachable[succ[k]]) {
+                    reachable[succ[k]] = true;
+                    pending[count++] = succ[k];
+                }
+            }
+        }
+    }
+
+    /* remove the unreachable lines */
+    for(i = 0; i < n; i++) {
+        if(!reachable[i] && !(line[i].instruction == SSOP_NOP && line[i].a.i == 0)) {
+            make_nop(&line[i]);
+            line[i].a.i = 0; /* remove breakpoints too */
+            changed = true;
+        }
+    }
+
+    ssfree(pending);
+    ssfree(reachable);
+    return changed;
+}
+
+/* peephole optimizer: removes NOPs (except breakpoints), fixing the jumps */
+bool remove_nops(surgescript_program_t* program)
+{
+    surgescript_program_operation_t* line = program->line;
+    int i, k, n = ssarray_length(program->line);
+    int* new_index = ssmalloc((n + 1) * sizeof(*new_index));
+
+    /* new_index[i] is the new line number of line i (or of the next kept line) */
+    for(i = k = 0; i < n; i++) {
+        new_index[i] = k;
+        if(!(line[i].instruction == SSOP_NOP && line[i].a.i != -1))
+            k++;
+    }
+    new_index[n] = k;
+
+    /* compact the code */
+    if(k < n) {
+        for(i = k = 0; i < n; i++) {
+            if(!(line[i].instruction == SSOP_NOP && line[i].a.i != -1)) {
+                line[k] = line[i];
+                if(is_jump_instruction(line[k].instruction))
+                    line[k].a.u = new_index[ssmin(line[k].a.u, (unsigned)n)];
+                k++;
+            }
+        }
+        ssarray_truncate(program->line, k);
+    }
+
+    ssfree(new_index);
+    return k < n;
+}
+
+/* counts how many jumps lead to each line: targets[0 .. n] */
+int* count_jump_targets(const surgescript_program_t* program)
+{
+    int i, n = ssarray_length(program->line);
+    int* targets = ssmalloc((n + 1) * sizeof(*targets));
+
+    for(i = 0; i <= n; i++)
+        targets[i] = 0;
+
+    for(i = 0; i < n; i++) {
+        if(is_jump_instruction(program->line[i].instruction))
+            targets[ssmin(program->line[i].a.u, (unsigned)n)]++;
+    }
+
+    return targets;
+}
+
+/* the lines that may be executed after a given line. Returns 0, 1 or 2 */
+int successors(const surgescript_program_t* program, int line, int succ[2])
+{
+    const surgescript_program_operation_t* op = &(program->line[line]);
+    unsigned n = ssarray_length(program->line);
+
+    if(op->instruction == SSOP_RET)
+        return 0;
+    else if(op->instruction == SSOP_JMP) {
+        succ[0] = ssmin(op->a.u, n);
+        return 1;
+    }
+    else if(is_conditional_jump(op->instruction)) {
+        succ[0] = line + 1;
+        succ[1] = ssmin(op->a.u, n);
+        return 2;
+    }
+    else {
+        succ[0] = line + 1;
+        return 1;
+    }
+}
+
+/* computes the live registers and stack slots at each line of the program */
+surgescript_program_liveness_t* compute_liveness(const surgescript_program_t* program)
+{
+    #define REG(operand) ((uint64_t)1 << ((operand).u & 3))
+    const uint64_t T0 = 1 << 0, T1 = 1 << 1, T2 = 1 << 2, TMPS = 0xF, SLOTS = ~TMPS;
+    int i, n = ssarray_length(program->line);
+    surgescript_program_liveness_t* liveness = ssmalloc(sizeof *liveness);
+    bool changed = true;
+
+    liveness->use = ssmalloc(n * sizeof(*(liveness->use)));
+    liveness->def = ssmalloc(n * sizeof(*(liveness->def)));
+    liveness->in = ssmalloc((n + 1) * sizeof(*(liveness->in)));
+    liveness->slot_count = 0;
+
+    /* what does each line read and write? */
+    for(i = 0; i < n; i++) {
+        const surgescript_program_operation_t* op = &(program->line[i]);
+        uint64_t use = 0, def = 0;
+
+        switch(op->instruction) {
+            case SSOP_NOP:
+            case SSOP_JMP:
+            case SSOP_PUSHN:
+            case SSOP_POPN:
+                break;
+
+            case SSOP_SELF:
+            case SSOP_CALLER:
+            case SSOP_MOVN:
+            case SSOP_MOVB:
+            case SSOP_MOVF:
+            case SSOP_MOVS:
+            case SSOP_MOVO:
+            case SSOP_MOVX:
+            case SSOP_ALLOC:
+            case SSOP_PEEK: /* heap cells aren't tracked */
+                def = REG(op->a);
+                break;
+
+            case SSOP_POP:
+                use = SLOTS; /* the top of the stack may be any slot */
+                def = REG(op->a);
+                break;
+
+            case SSOP_STATE:
+                if(op->b.i == -1)
+                    use = REG(op->a);
+                else
+                    def = REG(op->a);
+                break;
+
+            case SSOP_MOV:
+            case SSOP_NEG:
+            case SSOP_LNOT:
+            case SSOP_LNOT2:
+            case SSOP_NOT:
+                use = REG(op->b);
+                def = REG(op->a);
+                break;
+
+            case SSOP_XCHG:
+                use = def = REG(op->a) | REG(op->b);
+                break;
+
+            case SSOP_POKE:
+            case SSOP_PUSH:
+                use = REG(op->a);
+                break;
+
+            case SSOP_SPEEK:
+                use = slot_bit(liveness, op->b.i);
+                def = REG(op->a);
+                break;
+
+            case SSOP_SPOKE:
+                use = REG(op->a);
+                def = slot_bit(liveness, op->b.i);
+                break;
+
+            case SSOP_INC:
+            case SSOP_DEC:
+                use = def = REG(op->a);
+                break;
+
+            case SSOP_ADD:
+            case SSOP_SUB:
+            case SSOP_MUL:
+            case SSOP_DIV:
+            case SSOP_MOD:
+            case SSOP_AND:
+            case SSOP_OR:
+            case SSOP_XOR:
+                use = REG(op->a) | REG(op->b);
+                def = REG(op->a);
+                break;
+
+            case SSOP_TEST:
+            case SSOP_TCMP:
+            case SSOP_CMP:
+                use = REG(op->a) | REG(op->b);
+                def = T2;
+                break;
+
+            case SSOP_TCHK:
+                use = REG(op->a);
+                def = T2;
+                break;
+
+            case SSOP_TC01:
+                use = T0 | T1;
+                def = T2;
+                break;
+
+            case SSOP_JE:
+            case SSOP_JNE:
+            case SSOP_JG:
+            case SSOP_JGE:
+            case SSOP_JL:
+            case SSOP_JLE:
+                use = T2;
+                break;
+
+            case SSOP_CJE:
+            case SSOP_CJNE:
+            case SSOP_CJG:
+            case SSOP_CJGE:
+            case SSOP_CJL:
+            case SSOP_CJLE:
+                use = REG(op->b) | REG(SSOPu(op->b.u >> 8));
+                def = T2;
+                break;
+
+            case SSOP_CALL:
+                use = SLOTS; /* reads the stack */
+                def = TMPS; /* the callee shares the registers of the caller and may overwrite any of them; t[0] holds the return value */
+                break;
+
+            case SSOP_GETFIELD:
+                use = T0;
+                def = TMPS; /* may call a getter */
+                break;
+
+            case SSOP_SETFIELD:
+                use = SLOTS | T0; /* the object is at the top of the stack */
+                def = TMPS; /* may call a setter */
+                break;
+
+            case SSOP_RET:
+                use = T0; /* return value */
+                break;
+
+            default:
+                use = ~(uint64_t)0; /* be conservative */
+                break;
+        }
+
+        liveness->use[i] = use;
+        liveness->def[i] = def;
+    }
+
+    /* backwards dataflow analysis: live_in = use | (live_out - def) */
+    for(i = 0; i < n; i++)
+        liveness->in[i] = 0;
+    liveness->in[n] = T0; /* return value */
+    while(changed) {
+        changed = false;
+        for(i = n - 1; i >= 0; i--) {
+            uint64_t in = liveness->use[i] | (live_out(program, liveness, i) & ~(liveness->def[i]));
+            if(in != liveness->in[i]) {
+                liveness->in[i] = in;
+                changed = true;
+            }
+        }
+    }
+
+    /* done! */
+    return liveness;
+    #undef REG
+}
+
+/* releases the results of the liveness analysis */
+surgescript_program_liveness_t* release_liveness(surgescript_program_liveness_t* liveness)
+{
+    ssfree(liveness->in);
+    ssfree(liveness->def);
+    ssfree(liveness->use);
+    return ssfree(liveness);
+}
+
+/* the registers and stack slots that are live after executing a line */
+uint64_t live_out(const surgescript_program_t* program, const surgescript_program_liveness_t* liveness, int line)
+{
+    uint64_t out = 0;
+    int succ[2];
+
+    for(int k = successors(program, line, succ) - 1; k >= 0; k--)
+        out |= liveness->in[succ[k]];
+
+    return out;
+}
+
+/* the bit of a stack slot in the liveness analysis (zero if it's not tracked) */
+uint64_t slot_bit(surgescript_program_liveness_t* liveness, int slot)
+{
+    const int max_slots = sizeof(liveness->slot) / sizeof(*(liveness->slot));
+    int j;
+
+    for(j = 0; j < liveness->slot_count; j++) {
+        if(liveness->slot[j] == slot)
+            return (uint64_t)1 << (4 + j);
+    }
+
+    if(j < max_slots) {
+        liveness->slot[liveness->slot_count++] = slot;
+        return (uint64_t)1 << (4 + j);
+    }
+
+    return 0;
+}
+
+/* is this a conditional jump? */
+bool is_conditional_jump(surgescript_program_operator_t instruction)
+{
+    return is_jump_instruction(instruction) && instruction != SSOP_JMP;
+}
+
+/* the conditional jump that jumps if, and only if, the given one doesn't */
+surgescript_program_operator_t negate_jump(surgescript_program_operator_t instruction)
+{
+    switch(instruction) {
+        case SSOP_JE:   return SSOP_JNE;
+        case SSOP_JNE:  return SSOP_JE;
+        case SSOP_JG:   return SSOP_JLE;
+        case SSOP_JLE:  return SSOP_JG;
+        case SSOP_JGE:  return SSOP_JL;
+        case SSOP_JL:   return SSOP_JGE;
+        case SSOP_CJE:  return SSOP_CJNE;
+        case SSOP_CJNE: return SSOP_CJE;
+        case SSOP_CJG:  return SSOP_CJLE;
+        case SSOP_CJLE: return SSOP_CJG;
+        case SSOP_CJGE: return SSOP_CJL;
+        case SSOP_CJL:  return SSOP_CJGE;
+        default:        return instruction;
+    }
+}
+
+/* the compare-and-jump superinstruction of a conditional jump */
+surgescript_program_operator_t fuse_jump(surgescript_program_operator_t instruction)
+{
+    switch(instruction) {
+        case SSOP_JE:   return SSOP_CJE;
+        case SSOP_JNE:  return SSOP_CJNE;
+        case SSOP_JG:   return SSOP_CJG;
+        case SSOP_JGE:  return SSOP_CJGE;
+        case SSOP_JL:   return SSOP_CJL;
+        case SSOP_JLE:  return SSOP_CJLE;
+        default:        return instruction;
+    }
+}
+
+/* does this instruction only write to registers / stack slots? (no side effects) */
+bool is_pure_instruction(surgescript_program_operator_t instruction)
+{
+    switch(instruction) {
+        case SSOP_SELF:
+        case SSOP_CALLER:
+        case SSOP_MOV:
+        case SSOP_MOVN:
+        case SSOP_MOVB:
+        case SSOP_MOVF:
+        case SSOP_MOVS:
+        case SSOP_MOVO:
+        case SSOP_MOVX:
+        case SSOP_XCHG:
+        case SSOP_SPEEK:
+        case SSOP_SPOKE:
+        case SSOP_INC:
+        case SSOP_DEC:
+        case SSOP_ADD:
+        case SSOP_SUB:
+        case SSOP_MUL:
+        case SSOP_DIV:
+        case SSOP_MOD:
+        case SSOP_NEG:
+        case SSOP_LNOT:
+        case SSOP_LNOT2:
+        case SSOP_NOT:
+        case SSOP_AND:
+        case SSOP_OR:
+        case SSOP_XOR:
+        case SSOP_TEST:
+        case SSOP_TCHK:
+        case SSOP_TC01:
+        case SSOP_TCMP:
+        case SSOP_CMP:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/* turns a line of code into a no-operation */
+void make_nop(surgescript_program_operation_t* line)
+{
+    bool breakpoint = (line->instruction == SSOP_NOP && line->a.i == -1);
+    line->instruction = SSOP_NOP;
+    line->a = breakpoint ? SSOPi(-1) : SSOP();
+    line->b = breakpoint ? line->b : SSOP();
+}
+
 /* debug mode */
 #ifdef SURGESCRIPT_DEBUG_MODE
 void debug(surgescript_program_t* program, surgescript_renv_t* runtime_environment, surgescript_program_operator_t instruction, surgescript_program_operand_t a, surgescript_program_operand_t b, surgescript_var_t** _t)
@@ -828,7 +1822,7 @@ void debug(surgescript_program_t* program, surgescript_renv_t* runtime_environme
 
         /* print text data */
         for(i = 0; i < ssarray_length(program->text); i++)
-            printf("\n..\tTXT%d\t%s", i, program->text[i]);
+            printf("\n..\tTXT%d\t%s", i, surgescript_var_fast_get_string(program->text[i]));
         printf("\n..");
 
         /* done! */
@@ -40,6 +40,7 @@
 /* programs */
 typedef struct surgescript_program_t surgescript_program_t;
 struct surgescript_program_t;
+struct surgescript_programpool_t;
 
 /* C-functions can also be encapsulated in programs */
 typedef surgescript_var_t* (*surgescript_program_cfunction_t)(surgescript_object_t*, const surgescript_var_t**, int);
@@ -99,7 +100,14 @@ const char* surgescript_program_get_text(const surgescript_program_t* program, i
 int surgescript_program_add_text(surgescript_program_t* program, const char* text); /* adds a read-only string to the program, returning its index */
 int surgescript_program_find_text(const surgescript_program_t* program, const char* text); /* finds the first index such that text[index] == text, or -1 if not found */
 int surgescript_program_text_count(const surgescript_program_t* program); /* how many string literals exist in the program? */
+int surgescript_program_line_count(const surgescript_program_t* program); /* how many lines of code does the program have? */
+void surgescript_program_read_line(surgescript_program_t* program, int line, surgescript_program_operator_t* op, surgescript_program_operand_t* a, surgescript_program_operand_t* b); /* reads a line of code; jumps refer to line numbers */
+void surgescript_program_intern_text(surgescript_program_t* program, struct surgescript_programpool_t* pool); /* shares the string literals of the program with the other programs of the pool */
+void surgescript_program_release_text(surgescript_program_t* program, struct surgescript_programpool_t* pool); /* stops sharing the string literals of the program with the pool */
 void surgescript_program_dump(surgescript_program_t* program, FILE* fp); /* dump the program to a file */
 bool surgescript_program_is_native(const surgescript_program_t* program); /* is the program native (i.e., written in C)? */
 
+/* optimization */
+void surgescript_program_optimize(surgescript_program_t* program, int level); /* peephole optimizer: call it once, after compiling the program. Level 0 does nothing */
+
 #endif
\ No newline at end of file
@@ -0,0 +1,303 @@
+/*
+ * SurgeScript
+ * A scripting language for games
+ * Copyright 2016-2026 Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * runtime/program_handlers.h
+ * SurgeScript program: the bodies of the instructions
+ */
+
+/*
+    This file has no include guard: program.c includes it once for each
+    dispatch strategy (threaded code and switch). The includer defines:
+
+        OP(x)       starts the body of instruction x
+        NEXT()      proceeds to the next instruction
+        JUMP(line)  proceeds to the given line of code
+        RETURN()    leaves the program
+        A, B        the operands of the current instruction
+        CALLSITE    the inline cache of the current instruction
+
+    as well as _t, t(k), program and runtime_environment.
+*/
+
+/* basics */
+OP(SSOP_NOP) /* no-operation */
+    NEXT();
+
+OP(SSOP_SELF) /* owner object ("this" pointer) */
+    surgescript_var_set_objecthandle(t(A), surgescript_object_handle(surgescript_renv_owner(runtime_environment)));
+    NEXT();
+
+OP(SSOP_STATE) /* t[a] receives the current state. If b == -1, then the current state is set to t[a] instead. */
+    if(B.i == -1) {
+        char state[256] = "";
+        surgescript_var_to_string(t(A), state, sizeof(state));
+        surgescript_object_set_state(surgescript_renv_owner(runtime_environment), state);
+    }
+    else
+        surgescript_var_set_string(t(A), surgescript_object_state(surgescript_renv_owner(runtime_environment)));
+    NEXT();
+
+OP(SSOP_CALLER) /* caller object */
+    surgescript_var_set_objecthandle(t(A), surgescript_renv_caller(runtime_environment));
+    NEXT();
+
+/* assignment operations */
+OP(SSOP_MOVN) /* move null */
+    surgescript_var_set_null(t(A));
+    NEXT();
+
+OP(SSOP_MOVB) /* move boolean */
+    surgescript_var_set_bool(t(A), B.b);
+    NEXT();
+
+OP(SSOP_MOVF) /* move number */
+    surgescript_var_set_number(t(A), B.f);
+    NEXT();
+
+OP(SSOP_MOVS) /* move string */
+    if(B.u < ssarray_length(program->text))
+        surgescript_var_copy(t(A), program->text[B.u]);
+    NEXT();
+
+OP(SSOP_MOVO) /* move object handle */
+    surgescript_var_set_objecthandle(t(A), B.u);
+    NEXT();
+
+OP(SSOP_MOVX) /* move int64 */
+    surgescript_var_set_rawbits(t(A), B.u);
+    NEXT();
+
+OP(SSOP_MOV) /* move temp */
+    surgescript_var_copy(t(A), t(B));
+    NEXT();
+
+OP(SSOP_XCHG) /* fast exchange */
+    surgescript_var_swap(t(A), t(B));
+    NEXT();
+
+/* heap operations */
+OP(SSOP_ALLOC)
+    surgescript_heap_reserve(surgescript_renv_heap(runtime_environment), B.u);
+    surgescript_var_set_number(t(A), surgescript_heap_malloc(surgescript_renv_heap(runtime_environment)));
+    NEXT();
+
+OP(SSOP_PEEK)
+    surgescript_var_copy(t(A), surgescript_heap_at(surgescript_renv_heap(runtime_environment), B.u));
+    NEXT();
+
+OP(SSOP_POKE)
+    surgescript_var_copy(surgescript_heap_at(surgescript_renv_heap(runtime_environment), B.u), t(A));
+    write_barrier(runtime_environment, surgescript_renv_owner(runtime_environment), t(A));
+    NEXT();
+
+/* stack operations */
+OP(SSOP_PUSH)
+    surgescript_stack_pushcopy(surgescript_renv_stack(runtime_environment), t(A));
+    NEXT();
+
+OP(SSOP_POP)
+    surgescript_var_copy(t(A), surgescript_stack_top(surgescript_renv_stack(runtime_environment)));
+    surgescript_stack_pop(surgescript_renv_stack(runtime_environment));
+    NEXT();
+
+OP(SSOP_SPEEK)
+    surgescript_var_copy(t(A), surgescript_stack_peek(surgescript_renv_stack(runtime_environment), B.i));
+    NEXT();
+
+OP(SSOP_SPOKE)
+    surgescript_stack_poke(surgescript_renv_stack(runtime_environment), B.i, t(A));
+    NEXT();
+
+OP(SSOP_PUSHN)
+    surgescript_stack_pushn(surgescript_renv_stack(runtime_environment), A.u);
+    NEXT();
+
+OP(SSOP_POPN)
+    surgescript_stack_popn(surgescript_renv_stack(runtime_environment), A.u);
+    NEXT();
+
+/* basic arithmetic */
+OP(SSOP_INC)
+    if(A.u != 2)
+        surgescript_var_set_number(t(A), surgescript_var_get_number(t(A)) + 1);
+    else
+        surgescript_var_set_rawbits(t(A), surgescript_var_get_rawbits(t(A)) + 1);
+    NEXT();
+
+OP(SSOP_DEC)
+    if(A.u != 2)
+        surgescript_var_set_number(t(A), surgescript_var_get_number(t(A)) - 1);
+    else
+        surgescript_var_set_rawbits(t(A), surgescript_var_get_rawbits(t(A)) - 1);
+    NEXT();
+
+OP(SSOP_ADD)
+    surgescript_var_set_number(t(A), surgescript_var_get_number(t(A)) + surgescript_var_get_number(t(B)));
+    NEXT();
+
+OP(SSOP_SUB)
+    surgescript_var_set_number(t(A), surgescript_var_get_number(t(A)) - surgescript_var_get_number(t(B)));
+    NEXT();
+
+OP(SSOP_MUL)
+    surgescript_var_set_number(t(A), surgescript_var_get_number(t(A)) * surgescript_var_get_number(t(B)));
+    NEXT();
+
+OP(SSOP_DIV)
+    if(fast_notzero(surgescript_var_get_number(t(B))))
+        surgescript_var_set_number(t(A), surgescript_var_get_number(t(A)) / surgescript_var_get_number(t(B)));
+    else if(fast_sign(surgescript_var_get_number(t(A))) >= 0)
+        surgescript_var_set_number(t(A), INFINITY * fast_sign1(surgescript_var_get_number(t(B))));
+    else
+        surgescript_var_set_number(t(A), -INFINITY * fast_sign1(surgescript_var_get_number(t(B))));
+    NEXT();
+
+OP(SSOP_MOD)
+    surgescript_var_set_number(t(A), fmod(surgescript_var_get_number(t(A)), surgescript_var_get_number(t(B))));
+    NEXT();
+
+OP(SSOP_NEG)
+    surgescript_var_set_number(t(A), -surgescript_var_get_number(t(B)));
+    NEXT();
+
+OP(SSOP_LNOT)
+    surgescript_var_set_bool(t(A), !surgescript_var_get_bool(t(B)));
+    NEXT();
+
+OP(SSOP_LNOT2)
+    surgescript_var_set_bool(t(A), surgescript_var_get_bool(t(B)));
+    NEXT();
+
+/* bitwise operations */
+OP(SSOP_NOT)
+    surgescript_var_set_rawbits(t(A), ~surgescript_var_get_rawbits(t(B)));
+    NEXT();
+
+OP(SSOP_AND)
+    surgescript_var_set_rawbits(t(A), surgescript_var_get_rawbits(t(A)) & surgescript_var_get_rawbits(t(B)));
+    NEXT();
+
+OP(SSOP_OR)
+    surgescript_var_set_rawbits(t(A), surgescript_var_get_rawbits(t(A)) | surgescript_var_get_rawbits(t(B)));
+    NEXT();
+
+OP(SSOP_XOR)
+    surgescript_var_set_rawbits(t(A), surgescript_var_get_rawbits(t(A)) ^ surgescript_var_get_rawbits(t(B)));
+    NEXT();
+
+/* comparing & testing */
+OP(SSOP_TEST)
+    surgescript_var_set_rawbits(_t[2], surgescript_var_get_rawbits(t(A)) & surgescript_var_get_rawbits(t(B)));
+    NEXT();
+
+OP(SSOP_TCHK)
+    surgescript_var_set_rawbits(_t[2], surgescript_var_typecheck(t(A), B.i));
+    NEXT();
+
+OP(SSOP_TC01)
+    surgescript_var_set_rawbits(_t[2], surgescript_var_typecheck(_t[0], A.i) & surgescript_var_typecheck(_t[1], A.i));
+    NEXT();
+
+OP(SSOP_TCMP)
+    surgescript_var_set_rawbits(_t[2], surgescript_var_typecode(t(A)) ^ surgescript_var_typecode(t(B)));
+    NEXT();
+
+OP(SSOP_CMP)
+    surgescript_var_set_rawbits(_t[2], surgescript_var_compare(t(A), t(B)));
+    NEXT();
+
+/* jumping */
+OP(SSOP_JMP)
+    JUMP(A.u);
+
+OP(SSOP_JE)
+    if(!surgescript_var_get_rawbits(_t[2]))
+        JUMP(A.u);
+    NEXT();
+
+OP(SSOP_JNE)
+    if(surgescript_var_get_rawbits(_t[2]))
+        JUMP(A.u);
+    NEXT();
+
+OP(SSOP_JL)
+    if(surgescript_var_get_rawbits(_t[2]) < 0)
+        JUMP(A.u);
+    NEXT();
+
+OP(SSOP_JG)
+    if(surgescript_var_get_rawbits(_t[2]) > 0)
+        JUMP(A.u);
+    NEXT();
+
+OP(SSOP_JLE)
+    if(surgescript_var_get_rawbits(_t[2]) <= 0)
+        JUMP(A.u);
+    NEXT();
+
+OP(SSOP_JGE)
+    if(surgescript_var_get_rawbits(_t[2]) >= 0)
+        JUMP(A.u);
+    NEXT();
+
+/* compare-and-jump */
+OP(SSOP_CJE)
+    if(compare_registers(_t, B) == 0)
+        JUMP(A.u);
+    NEXT();
+
+OP(SSOP_CJNE)
+    if(compare_registers(_t, B) != 0)
+        JUMP(A.u);
+    NEXT();
+
+OP(SSOP_CJL)
+    if(compare_registers(_t, B) < 0)
+        JUMP(A.u);
+    NEXT();
+
+OP(SSOP_CJG)
+    if(compare_registers(_t, B) > 0)
+        JUMP(A.u);
+    NEXT();
+
+OP(SSOP_CJLE)
+    if(compare_registers(_t, B) <= 0)
+        JUMP(A.u);
+    NEXT();
+
+OP(SSOP_CJGE)
+    if(compare_registers(_t, B) >= 0)
+        JUMP(A.u);
+    NEXT();
+
+/* function calls */
+OP(SSOP_CALL)
+    if(A.u < ssarray_length(program->text))
+        call_program(runtime_environment, surgescript_var_fast_get_string(program->text[A.u]), B.u, CALLSITE);
+    NEXT();
+
+OP(SSOP_GETFIELD)
+    get_field(program, runtime_environment, A, CALLSITE);
+    NEXT();
+
+OP(SSOP_SETFIELD)
+    set_field(program, runtime_environment, A, CALLSITE);
+    NEXT();
+
+OP(SSOP_RET)
+    RETURN();
@@ -48,7 +48,7 @@
     F( SSOP_MOVX, "movx" )                            /* t[a] = (int64)b */ \
     F( SSOP_XCHG, "xchg" )                           /* swap(t[a], t[b]) */ \
                                                                             \
-    F( SSOP_ALLOC, "alloc" )                   /* t[a] = allocate_cell() */ \
+    F( SSOP_ALLOC, "alloc" )  /* t[a] = allocate_cell(); reserve b cells */ \
     F( SSOP_PEEK, "peek" )                                /* t[a] = (*b) */ \
     F( SSOP_POKE, "poke" )                                /* (*b) = t[a] */ \
                                                                             \
@@ -88,11 +88,22 @@
     F( SSOP_JL, "jl" )                     /* jump to line a if t[2] < 0 */ \
     F( SSOP_JLE, "jle" )                  /* jump to line a if t[2] <= 0 */ \
                                                                             \
+    F( SSOP_CJE, "cje" )               /* cmp t[b & 3], t[b >> 8] ; je a */ \
+    F( SSOP_CJNE, "cjne" )            /* cmp t[b & 3], t[b >> 8] ; jne a */ \
+    F( SSOP_CJG, "cjg" )               /* cmp t[b & 3], t[b >> 8] ; jg a */ \
+    F( SSOP_CJGE, "cjge" )            /* cmp t[b & 3], t[b >> 8] ; jge a */ \
+    F( SSOP_CJL, "cjl" )               /* cmp t[b & 3], t[b >> 8] ; jl a */ \
+    F( SSOP_CJLE, "cjle" )            /* cmp t[b & 3], t[b >> 8] ; jle a */ \
+                                                                            \
     F( SSOP_CALL, "call" )                /* call program named text[a], */ \
                                          /* with b parameters, of object */ \
                                        /* stack[top-b] and store in t[0] */ \
                                       /* the return value of the program */ \
                                  /* parameters are stacked left-to-right */ \
+    F( SSOP_GETFIELD, "getfield" )              /* t[0] = t[0].text[a]() */ \
+                                                      /* (call a getter) */ \
+    F( SSOP_SETFIELD, "setfield" )           /* stack[top].text[a](t[0]) */ \
+                                                      /* (call a setter) */ \
     F( SSOP_RET, "ret" )                 /* returns, halting the program */
 
 #endif
\ No newline at end of file
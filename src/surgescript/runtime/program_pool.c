@@ -27,19 +27,78 @@
 #include "../util/util.h"
 #include "../util/ssarray.h"
 
-#define XXH_INLINE_ALL
-#include "../util/xxhash.h"
-
 #define FASTHASH_INLINE
 #include "../util/fasthash.h"
 
 
+/*
+ * Object names (classes) and program names (methods) are interned:
+ * each distinct name is stored once and is given a dense integer id.
+ * Interned names are permanent: their ids are stored in objects and in
+ * inline caches, so they're never released while the pool exists. Purging
+ * or replacing programs (e.g., when reloading scripts) reuses the ids of
+ * the names that are already interned, so the tables grow only with the
+ * number of distinct names
+ */
+typedef struct surgescript_programpool_name_t surgescript_programpool_name_t;
+struct surgescript_programpool_name_t
+{
+    char* name; /* key */
+    int id; /* value */
+    UT_hash_handle hh;
+};
+
+typedef struct surgescript_programpool_nametable_t surgescript_programpool_nametable_t;
+struct surgescript_programpool_nametable_t
+{
+    surgescript_programpool_name_t* hash; /* name -> id */
+    SSARRAY(surgescript_programpool_name_t*, entry); /* id -> name */
+};
+
+static void init_nametable(surgescript_programpool_nametable_t* table);
+static void release_nametable(surgescript_programpool_nametable_t* table);
+static int intern_name(surgescript_programpool_nametable_t* table, const char* name);
+static int find_name(const surgescript_programpool_nametable_t* table, const char* name);
+#define BASE_OBJECT "Object" /* a common base for all objects */
+#define BASE_CLASS_ID 0 /* class id of the base object */
+
+
+/*
+ * The string literals of the programs are interned: equal strings
+ * are shared by all programs of the pool. A string is released when
+ * the last program that uses it is deleted
+ */
+typedef struct surgescript_programpool_text_t surgescript_programpool_text_t;
+struct surgescript_programpool_text_t
+{
+    surgescript_var_t* text; /* key: the contents of this string */
+    int refcount; /* how many programs of the pool use this string */
+    UT_hash_handle hh;
+};
+
+static void release_texts(surgescript_programpool_text_t** texts);
+
+
+/*
+ * The heap layout of an object (class) tells how many fields it has and
+ * their initial values, so that its heap is set up in one go when spawned
+ */
+typedef struct surgescript_programpool_layout_t surgescript_programpool_layout_t;
+struct surgescript_programpool_layout_t
+{
+    int field_count; /* the size of the heap */
+    surgescript_var_t* initial_value; /* field_count variables; fields that aren't initialized with constants are null */
+};
+
+static void set_layout(surgescript_programpool_t* pool, int class_id, int field_count, const surgescript_var_t** initial_value);
+
+
 /*
  * Each function in SurgeScript defines a function signature
  * that depends on the containing object and on the function name
  */
 typedef uint64_t surgescript_programpool_signature_t;
-static inline surgescript_programpool_signature_t generate_signature(const char* object_name, const char* program_name); /* generates a function signature, given an object name and a program name */
+static inline surgescript_programpool_signature_t generate_signature(int class_id, int method_id); /* generates a function signature, given a class id and a method id */
 
 
 /* metadata */
@@ -73,11 +132,17 @@ struct surgescript_programpool_t
 {
     fasthash_t* hash; /* a hash table of hashpair_t's */
     surgescript_programpool_metadata_t* meta;
+    surgescript_programpool_nametable_t classes; /* interned object names */
+    surgescript_programpool_nametable_t methods; /* interned program names */
+    surgescript_programpool_text_t* texts; /* interned string literals */
+    SSARRAY(surgescript_programpool_layout_t, layout); /* heap layouts, indexed by class id */
+    unsigned version; /* used to invalidate the inline caches of the programs */
 };
 
 /* misc */
 static void delete_pair(void* pair);
 static void delete_program(const char* program_name, void* data);
+static void delete_signature(surgescript_programpool_t* pool, surgescript_programpool_signature_t signature);
 
 
 
@@ -95,6 +160,12 @@ surgescript_programpool_t* surgescript_programpool_create()
     surgescript_programpool_t* pool = ssmalloc(sizeof *pool);
     pool->hash = fasthash_create(delete_pair, 16);
     pool->meta = NULL;
+    pool->texts = NULL;
+    pool->version = 0;
+    ssarray_init(pool->layout);
+    init_nametable(&pool->classes);
+    init_nametable(&pool->methods);
+    intern_name(&pool->classes, BASE_OBJECT); /* BASE_CLASS_ID */
     return pool;
 }
 
@@ -106,6 +177,12 @@ surgescript_programpool_t* surgescript_programpool_destroy(surgescript_programpo
 {
     fasthash_destroy(pool->hash);
     clear_metadata(pool);
+    release_nametable(&pool->methods);
+    release_nametable(&pool->classes);
+    release_texts(&pool->texts);
+    for(int class_id = 0; class_id < ssarray_length(pool->layout); class_id++)
+        set_layout(pool, class_id, 0, NULL);
+    ssarray_release(pool->layout);
     return ssfree(pool);
 }
 
@@ -124,9 +201,15 @@ bool surgescript_programpool_exists(surgescript_programpool_t* pool, const char*
  */
 bool surgescript_programpool_shallowcheck(surgescript_programpool_t* pool, const char* object_name, const char* program_name)
 {
-    surgescript_programpool_signature_t signature = generate_signature(object_name, program_name);
-    surgescript_programpool_hashpair_t* pair = fasthash_get(pool->hash, signature);
-    return pair != NULL;
+    int class_id = find_name(&pool->classes, object_name);
+    int method_id = find_name(&pool->methods, program_name);
+
+    if(class_id >= 0 && method_id >= 0) {
+        surgescript_programpool_signature_t signature = generate_signature(class_id, method_id);
+        return fasthash_peek(pool->hash, signature) != NULL;
+    }
+
+    return false;
 }
 
 /*
@@ -137,10 +220,14 @@ bool surgescript_programpool_put(surgescript_programpool_t* pool, const char* ob
 {
     if(!surgescript_programpool_shallowcheck(pool, object_name, program_name)) {
         surgescript_programpool_hashpair_t* pair = ssmalloc(sizeof *pair);
-        pair->signature = generate_signature(object_name, program_name);
+        int class_id = intern_name(&pool->classes, object_name);
+        int method_id = intern_name(&pool->methods, program_name);
+        pair->signature = generate_signature(class_id, method_id);
         pair->program = program;
+        surgescript_program_intern_text(program, pool);
         fasthash_put(pool->hash, pair->signature, pair);
         insert_metadata(pool, object_name, program_name);
+        pool->version++; /* the new program may shadow one of the base object */
         return true;
     }
     else {
@@ -153,18 +240,35 @@ bool surgescript_programpool_put(surgescript_programpool_t* pool, const char* ob
 /*
  * surgescript_programpool_get()
  * Gets a program from the pool (returns NULL if not found)
- * This needs to be fast!
  */
 surgescript_program_t* surgescript_programpool_get(surgescript_programpool_t* pool, const char* object_name, const char* program_name)
 {
-    surgescript_programpool_signature_t signature = generate_signature(object_name, program_name);
-    surgescript_programpool_hashpair_t* pair = fasthash_get(pool->hash, signature); /* find the program */
-    
+    int class_id = find_name(&pool->classes, object_name);
+    int method_id = find_name(&pool->methods, program_name);
+    return surgescript_programpool_get_by_id(pool, class_id, method_id);
+}
+
+/*
+ * surgescript_programpool_get_by_id()
+ * Gets a program from the pool, given the interned ids of its object and of
+ * its name (returns NULL if not found). No strings are hashed: this is fast!
+ */
+surgescript_program_t* surgescript_programpool_get_by_id(surgescript_programpool_t* pool, int class_id, int method_id)
+{
+    surgescript_programpool_hashpair_t* pair = NULL;
+
+    /* no program has ever been given this name */
+    if(method_id < 0)
+        return NULL;
+
+    /* find the program (peek: objects updated in parallel may look it up at the same time) */
+    if(class_id >= 0)
+        pair = fasthash_peek(pool->hash, generate_signature(class_id, method_id));
+
     /* if there is no such program */
     if(!pair) {
         /* try locating it in a common base for all objects */
-        signature = generate_signature("Object", program_name);
-        pair = fasthash_get(pool->hash, signature);
+        pair = fasthash_peek(pool->hash, generate_signature(BASE_CLASS_ID, method_id));
 
         /* really, the program doesn't exist */
         if(!pair)
@@ -175,6 +279,98 @@ surgescript_program_t* surgescript_programpool_get(surgescript_programpool_t* po
     return pair->program;
 }
 
+/*
+ * surgescript_programpool_intern_text()
+ * Returns a string equal to text that is shared by all programs of the pool
+ */
+const surgescript_var_t* surgescript_programpool_intern_text(surgescript_programpool_t* pool, const surgescript_var_t* text)
+{
+    surgescript_programpool_text_t* entry = NULL;
+    const char* key = surgescript_var_fast_get_string(text);
+    size_t keylen = surgescript_var_fast_get_string_length(text);
+    unsigned hash = surgescript_var_fast_get_string_hash(text); /* precomputed */
+
+    HASH_FIND_BYHASHVALUE(hh, pool->texts, key, keylen, hash, entry);
+    if(entry == NULL) {
+        entry = ssmalloc(sizeof *entry);
+        entry->text = surgescript_var_clone(text);
+        entry->refcount = 0;
+        key = surgescript_var_fast_get_string(entry->text); /* entry->text won't move */
+        HASH_ADD_KEYPTR_BYHASHVALUE(hh, pool->texts, key, keylen, hash, entry);
+    }
+
+    entry->refcount++;
+    return entry->text;
+}
+
+/*
+ * surgescript_programpool_release_text()
+ * Called when a program that shares text is about to be deleted. The
+ * interned string is released when it's no longer used by any program
+ */
+void surgescript_programpool_release_text(surgescript_programpool_t* pool, const surgescript_var_t* text)
+{
+    surgescript_programpool_text_t* entry = NULL;
+    const char* key = surgescript_var_fast_get_string(text);
+    size_t keylen = surgescript_var_fast_get_string_length(text);
+    unsigned hash = surgescript_var_fast_get_string_hash(text);
+
+    HASH_FIND_BYHASHVALUE(hh, pool->texts, key, keylen, hash, entry);
+    if(entry != NULL && --entry->refcount == 0) {
+        HASH_DEL(pool->texts, entry);
+        surgescript_var_destroy(entry->text);
+        ssfree(entry);
+    }
+}
+
+/*
+ * surgescript_programpool_class_id()
+ * Interns an object name, returning its class id: a dense integer
+ */
+int surgescript_programpool_class_id(surgescript_programpool_t* pool, const char* object_name)
+{
+    return intern_name(&pool->classes, object_name);
+}
+
+/*
+ * surgescript_programpool_find_class_id()
+ * The class id of object_name, or -1 if object_name hasn't been interned
+ */
+int surgescript_programpool_find_class_id(const surgescript_programpool_t* pool, const char* object_name)
+{
+    return find_name(&pool->classes, object_name);
+}
+
+/*
+ * surgescript_programpool_class_name()
+ * The interned object name of the given class id. It is valid for the lifetime of the pool
+ */
+const char* surgescript_programpool_class_name(const surgescript_programpool_t* pool, int class_id)
+{
+    if(class_id >= 0 && class_id < ssarray_length(pool->classes.entry))
+        return pool->classes.entry[class_id]->name;
+    else
+        return "";
+}
+
+/*
+ * surgescript_programpool_method_id()
+ * Interns a program name, returning its method id: a dense integer
+ */
+int surgescript_programpool_method_id(surgescript_programpool_t* pool, const char* program_name)
+{
+    return intern_name(&pool->methods, program_name);
+}
+
+/*
+ * surgescript_programpool_find_method_id()
+ * The method id of program_name, or -1 if program_name hasn't been interned
+ */
+int surgescript_programpool_find_method_id(const surgescript_programpool_t* pool, const char* program_name)
+{
+    return find_name(&pool->methods, program_name);
+}
+
 /*
  * surgescript_programpool_foreach()
  * For each program of object_name, calls the callback
@@ -201,13 +397,17 @@ void surgescript_programpool_foreach_ex(surgescript_programpool_t* pool, const c
  */
 bool surgescript_programpool_replace(surgescript_programpool_t* pool, const char* object_name, const char* program_name, surgescript_program_t* program)
 {
-    surgescript_programpool_signature_t signature = generate_signature(object_name, program_name);
+    int class_id = intern_name(&pool->classes, object_name);
+    int method_id = intern_name(&pool->methods, program_name);
+    surgescript_programpool_signature_t signature = generate_signature(class_id, method_id);
     surgescript_programpool_hashpair_t* pair = fasthash_get(pool->hash, signature); /* find the program */
     
     /* replace the program */
     if(pair != NULL) {
+        surgescript_program_release_text(pair->program, pool);
         surgescript_program_destroy(pair->program);
         pair->program = program;
+        pool->version++;
         return true;
     }
     else
@@ -224,6 +424,8 @@ void surgescript_programpool_purge(surgescript_programpool_t* pool, const char*
     void* data[] = { pool, (void*)object_name };
     surgescript_programpool_foreach_ex(pool, object_name, data, delete_program);
     remove_object_metadata(pool, object_name);
+    surgescript_programpool_put_layout(pool, object_name, 0, NULL);
+    pool->version++;
 }
 
 
@@ -233,13 +435,16 @@ void surgescript_programpool_purge(surgescript_programpool_t* pool, const char*
  */
 void surgescript_programpool_delete(surgescript_programpool_t* pool, const char* object_name, const char* program_name)
 {
-    surgescript_programpool_signature_t signature = generate_signature(object_name, program_name);
-    
+    int class_id = find_name(&pool->classes, object_name);
+    int method_id = find_name(&pool->methods, program_name);
+
     /* delete the program */
-    fasthash_delete(pool->hash, signature);
+    if(class_id >= 0 && method_id >= 0)
+        delete_signature(pool, generate_signature(class_id, method_id));
 
     /* delete metadata */
     remove_metadata(pool, object_name, program_name);
+    pool->version++;
 }
 
 
@@ -257,6 +462,54 @@ bool surgescript_programpool_is_compiled(surgescript_programpool_t* pool, const
 
 
 
+/*
+ * surgescript_programpool_put_layout()
+ * Sets the heap layout of object_name: its number of fields and their initial
+ * values. initial_value[i] may be NULL, meaning that the i-th field starts out
+ * null. The values are copied. A layout with no fields is the same as no layout
+ */
+void surgescript_programpool_put_layout(surgescript_programpool_t* pool, const char* object_name, int field_count, const surgescript_var_t** initial_value)
+{
+    int class_id = intern_name(&pool->classes, object_name);
+    surgescript_programpool_layout_t no_layout = { .field_count = 0, .initial_value = NULL };
+
+    while(ssarray_length(pool->layout) <= class_id)
+        ssarray_push(pool->layout, no_layout);
+
+    set_layout(pool, class_id, field_count, initial_value);
+}
+
+/*
+ * surgescript_programpool_layout()
+ * The initial values of the fields of the objects of the given class.
+ * Returns NULL if there is no such layout
+ */
+const surgescript_var_t* surgescript_programpool_layout(const surgescript_programpool_t* pool, int class_id, int* field_count)
+{
+    if(class_id >= 0 && class_id < ssarray_length(pool->layout) && pool->layout[class_id].field_count > 0) {
+        *field_count = pool->layout[class_id].field_count;
+        return pool->layout[class_id].initial_value;
+    }
+
+    *field_count = 0;
+    return NULL;
+}
+
+
+
+/*
+ * surgescript_programpool_version()
+ * The version of the pool changes whenever programs are added, replaced or
+ * removed. Anything that caches the results of surgescript_programpool_get()
+ * must check it before trusting its cached data.
+ */
+unsigned surgescript_programpool_version(const surgescript_programpool_t* pool)
+{
+    return pool->version;
+}
+
+
+
 /* -------------------------------
  * private methods
  * ------------------------------- */
@@ -362,23 +615,108 @@ void delete_program(const char* program_name, void* data)
 {
     surgescript_programpool_t* pool = (surgescript_programpool_t*)(((void**)data)[0]);
     const char* object_name = (const char*)(((void**)data)[1]);
-    surgescript_programpool_signature_t signature = generate_signature(object_name, program_name);
+    int class_id = find_name(&pool->classes, object_name);
+    int method_id = find_name(&pool->methods, program_name);
 
     /* delete the program */
-    fasthash_delete(pool->hash, signature);
+    if(class_id >= 0 && method_id >= 0)
+        delete_signature(pool, generate_signature(class_id, method_id));
+}
+
+
+void delete_signature(surgescript_programpool_t* pool, surgescript_programpool_signature_t signature)
+{
+    surgescript_programpool_hashpair_t* pair = fasthash_get(pool->hash, signature);
+
+    if(pair != NULL) {
+        surgescript_program_release_text(pair->program, pool);
+        fasthash_delete(pool->hash, signature);
+    }
 }
 
 
 /* program signature generator: must be extremely fast */
-surgescript_programpool_signature_t generate_signature(const char* object_name, const char* program_name)
-{
-    /* Our app must enforce signature uniqueness */
-    char buf[2 * SS_NAMEMAX + 2] = { 0 };
-    uint32_t ha = 0, hb = 0;
-    size_t l1 = strlen(object_name), l2 = strlen(program_name);
-    memcpy(buf, object_name, l1);
-    memcpy(buf + l1 + 1, program_name, l2);
-    ha = XXH32(buf, l1 + 1, l1) + (uint8_t)program_name[0];
-    hb = XXH32(buf, l1 + l2 + 1, ha + (uint8_t)object_name[0]);
-    return (uint64_t)hb | (((uint64_t)ha) << 32); /* probably unique */
-}
\ No newline at end of file
+surgescript_programpool_signature_t generate_signature(int class_id, int method_id)
+{
+    /* signatures are unique, since the ids are */
+    return (uint64_t)((uint32_t)method_id) | (((uint64_t)((uint32_t)class_id)) << 32);
+}
+
+
+/* interned names */
+void init_nametable(surgescript_programpool_nametable_t* table)
+{
+    table->hash = NULL;
+    ssarray_init(table->entry);
+}
+
+void release_nametable(surgescript_programpool_nametable_t* table)
+{
+    surgescript_programpool_name_t *it, *tmp;
+
+    HASH_ITER(hh, table->hash, it, tmp) {
+        HASH_DEL(table->hash, it);
+        ssfree(it->name);
+        ssfree(it);
+    }
+
+    ssarray_release(table->entry);
+}
+
+void set_layout(surgescript_programpool_t* pool, int class_id, int field_count, const surgescript_var_t** initial_value)
+{
+    surgescript_programpool_layout_t* layout = &(pool->layout[class_id]);
+
+    /* release the previous layout */
+    for(int i = 0; i < layout->field_count; i++)
+        surgescript_var_set_null(&(layout->initial_value[i]));
+    if(layout->initial_value != NULL)
+        layout->initial_value = ssfree(layout->initial_value);
+    layout->field_count = 0;
+
+    /* copy the new one. A zero-filled variable is null */
+    if(field_count > 0) {
+        layout->initial_value = ssmalloc(field_count * sizeof(*(layout->initial_value)));
+        memset(layout->initial_value, 0, field_count * sizeof(*(layout->initial_value)));
+        for(int i = 0; i < field_count; i++) {
+            if(initial_value != NULL && initial_value[i] != NULL)
+                surgescript_var_copy(&(layout->initial_value[i]), initial_value[i]);
+        }
+        layout->field_count = field_count;
+    }
+}
+
+void release_texts(surgescript_programpool_text_t** texts)
+{
+    surgescript_programpool_text_t *it, *tmp;
+
+    HASH_ITER(hh, *texts, it, tmp) {
+        HASH_DEL(*texts, it);
+        surgescript_var_destroy(it->text);
+        ssfree(it);
+    }
+}
+
+int intern_name(surgescript_programpool_nametable_t* table, const char* name)
+{
+    surgescript_programpool_name_t *n = NULL;
+    HASH_FIND_STR(table->hash, name, n);
+
+    /* a new name */
+    if(n == NULL) {
+        n = ssmalloc(sizeof *n);
+        n->name = ssstrdup(name);
+        n->id = ssarray_length(table->entry);
+        HASH_ADD_KEYPTR(hh, table->hash, n->name, strlen(n->name), n);
+        ssarray_push(table->entry, n);
+    }
+
+    return n->id;
+}
+
+int find_name(const surgescript_programpool_nametable_t* table, const char* name)
+{
+    surgescript_programpool_name_t *n = NULL;
+    HASH_FIND_STR(table->hash, name, n);
+    return n != NULL ? n->id : -1;
+}
@@ -29,6 +29,7 @@ typedef struct surgescript_programpool_t surgescript_programpool_t;
 
 /* forward declarations */
 struct surgescript_program_t;
+struct surgescript_var_t;
 
 /* public methods */
 surgescript_programpool_t* surgescript_programpool_create();
@@ -43,5 +44,22 @@ bool surgescript_programpool_replace(surgescript_programpool_t* pool, const char
 void surgescript_programpool_delete(surgescript_programpool_t* pool, const char* object_name, const char* program_name); /* deletes a programs from the specified object */
 void surgescript_programpool_purge(surgescript_programpool_t* pool, const char* object_name); /* deletes all programs from the specified object */
 bool surgescript_programpool_is_compiled(surgescript_programpool_t* pool, const char* object_name); /* is there any code for object_name? */
+unsigned surgescript_programpool_version(const surgescript_programpool_t* pool); /* changes whenever programs are added, replaced or removed */
+
+/* interned names: each object name (class) and each program name (method) is given a dense integer id */
+int surgescript_programpool_class_id(surgescript_programpool_t* pool, const char* object_name); /* interns object_name, returning its class id */
+int surgescript_programpool_find_class_id(const surgescript_programpool_t* pool, const char* object_name); /* the class id of object_name, or -1 if it hasn't been interned */
+const char* surgescript_programpool_class_name(const surgescript_programpool_t* pool, int class_id); /* the interned object name of class_id */
+int surgescript_programpool_method_id(surgescript_programpool_t* pool, const char* program_name); /* interns program_name, returning its method id */
+int surgescript_programpool_find_method_id(const surgescript_programpool_t* pool, const char* program_name); /* the method id of program_name, or -1 if it hasn't been interned */
+struct surgescript_program_t* surgescript_programpool_get_by_id(surgescript_programpool_t* pool, int class_id, int method_id); /* fast lookup; may return NULL */
+
+/* heap layout: the number of fields of the objects of a class and their initial values */
+void surgescript_programpool_put_layout(surgescript_programpool_t* pool, const char* object_name, int field_count, const struct surgescript_var_t** initial_value); /* initial_value[i] may be NULL (null field); field_count = 0 removes the layout */
+const struct surgescript_var_t* surgescript_programpool_layout(const surgescript_programpool_t* pool, int class_id, int* field_count); /* returns NULL if there is no layout */
+
+/* interned text: equal string literals of all programs are stored once */
+const struct surgescript_var_t* surgescript_programpool_intern_text(surgescript_programpool_t* pool, const struct surgescript_var_t* text); /* returns a string equal to text, shared by the pool */
+void surgescript_programpool_release_text(surgescript_programpool_t* pool, const struct surgescript_var_t* text); /* a program no longer shares text; it's released when no program uses it */
 
 #endif
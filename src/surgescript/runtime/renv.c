@@ -27,6 +27,7 @@
 #include "program_pool.h"
 #include "object_manager.h"
 #include "../util/util.h"
+#include "../util/slab.h"
 
 /* how many temporary vars does a runtime environment have? */
 static const int MAX_TMPVARS = 4; /* used for calculations */
@@ -40,7 +41,8 @@ static surgescript_renv_t* partial_destructor(surgescript_renv_t* runtime_enviro
  */
 surgescript_renv_t* surgescript_renv_create(surgescript_object_t* owner, surgescript_stack_t* stack, surgescript_heap_t* heap, surgescript_programpool_t* program_pool, surgescript_objectmanager_t* object_manager, surgescript_var_t** tmp)
 {
-    surgescript_renv_t* runtime_environment = ssmalloc(sizeof *runtime_environment);
+    surgescript_slab_t* slab = surgescript_objectmanager_slab(object_manager);
+    surgescript_renv_t* runtime_environment = surgescript_slab_alloc(slab, sizeof *runtime_environment);
 
     runtime_environment->owner = owner; 
     runtime_environment->stack = stack;
@@ -51,7 +53,7 @@ surgescript_renv_t* surgescript_renv_create(surgescript_object_t* owner, surgesc
 
     if(!tmp) {
         int i;
-        runtime_environment->tmp = ssmalloc(MAX_TMPVARS * sizeof *(runtime_environment->tmp));
+        runtime_environment->tmp = surgescript_slab_alloc(slab, MAX_TMPVARS * sizeof *(runtime_environment->tmp));
         for(i = 0; i < MAX_TMPVARS; i++)
             runtime_environment->tmp[i] = surgescript_var_create();
         runtime_environment->_destructor = full_destructor;
@@ -79,13 +81,15 @@ surgescript_renv_t* surgescript_renv_destroy(surgescript_renv_t* runtime_environ
 
 surgescript_renv_t* full_destructor(surgescript_renv_t* runtime_environment)
 {
+    surgescript_slab_t* slab = surgescript_objectmanager_slab(runtime_environment->object_manager);
     for(int i = 0; i < MAX_TMPVARS; i++)
         surgescript_var_destroy(runtime_environment->tmp[i]);
-    ssfree(runtime_environment->tmp);
-    return ssfree(runtime_environment);
+    surgescript_slab_free(slab, runtime_environment->tmp, MAX_TMPVARS * sizeof *(runtime_environment->tmp));
+    return surgescript_slab_free(slab, runtime_environment, sizeof *runtime_environment);
 }
 
 surgescript_renv_t* partial_destructor(surgescript_renv_t* runtime_environment)
 {
-    return ssfree(runtime_environment);
+    surgescript_slab_t* slab = surgescript_objectmanager_slab(runtime_environment->object_manager);
+    return surgescript_slab_free(slab, runtime_environment, sizeof *runtime_environment);
 }
\ No newline at end of file
@@ -58,18 +58,53 @@ static surgescript_var_t* fun_it_hasnext(surgescript_object_t* object, const sur
 static surgescript_var_t* fun_it_tostring(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
 
 /* sorting functions */
-typedef int (*surgescript_sortcmp_t)(surgescript_object_t* object, const surgescript_var_t*, const surgescript_var_t*);
-static int default_sort_function(surgescript_object_t* object, const surgescript_var_t* a, const surgescript_var_t* b);
-static int custom_sort_function(surgescript_object_t* object, const surgescript_var_t* a, const surgescript_var_t* b);
+typedef int (*sortcmp_t)(const surgescript_var_t* a, const surgescript_var_t* b, void* context); /* works like strcmp() */
+static int compare_numbers(const surgescript_var_t* a, const surgescript_var_t* b, void* context);
+static int compare_strings(const surgescript_var_t* a, const surgescript_var_t* b, void* context);
+static int compare_variables(const surgescript_var_t* a, const surgescript_var_t* b, void* context); /* variables of mixed types */
+static int compare_custom(const surgescript_var_t* a, const surgescript_var_t* b, void* context); /* context is the functor */
+static void sort(surgescript_var_t* v, int n, sortcmp_t cmp, void* context, surgescript_var_t* buf);
+static void insertion_sort(surgescript_var_t* v, int begin, int end, sortcmp_t cmp, void* context);
+static void heap_sort(surgescript_var_t* v, int n, sortcmp_t cmp, void* context);
+static void sift_down(surgescript_var_t* v, int root, int n, sortcmp_t cmp, void* context);
+static int partition(surgescript_var_t* v, int begin, int end, sortcmp_t cmp, void* context);
+static void intro_sort(surgescript_var_t* v, int n, sortcmp_t cmp, void* context);
+static bool merge_sort(surgescript_var_t* v, int n, sortcmp_t cmp, void* context, surgescript_var_t* buf);
+static const int SORT_SMALL = 16; /* partitions up to this size are sorted by insertion sort */
+static const int SORT_MIN_RUN = 16; /* average length of the runs of presorted data */
+
+/*
+ * The elements of an Array are stored inline in a growable ring buffer
+ * kept in its user data. Its capacity is a power of two, so that push(),
+ * pop(), shift() and unshift() take amortized O(1) time.
+ */
+typedef struct array_t array_t;
+struct array_t
+{
+    surgescript_var_t* data; /* ring buffer */
+    int capacity; /* size of data[]: a power of two */
+    int head; /* position of the first element in data[] */
+    int length; /* number of elements */
+    struct sortcopy_t* sorting; /* copies being sorted by script comparators, scanned by the GC */
+};
+
+/* a copy of the elements of an Array that is sorted with a script comparator */
+typedef struct sortcopy_t sortcopy_t;
+struct sortcopy_t
+{
+    surgescript_var_t* data;
+    int length;
+    surgescript_var_t* buf; /* scratch space of the merge sort: length / 2 + 1 elements */
+    sortcopy_t* next; /* nested calls to sort() */
+};
 
 /* utilities */
 #define ORDINAL(j)              (((j) == 1) ? "st" : (((j) == 2) ? "nd" : (((j) == 3) ? "rd" : "th")))
-#define ARRAY_LENGTH(heap)      ((int)surgescript_var_get_number(surgescript_heap_at((heap), LENGTH_ADDR)))
-static void quicksort(surgescript_heap_t* heap, surgescript_heapptr_t begin, surgescript_heapptr_t end, surgescript_sortcmp_t compare, surgescript_object_t* compare_object);
-static inline surgescript_heapptr_t partition(surgescript_heap_t* heap, surgescript_heapptr_t begin, surgescript_heapptr_t end, surgescript_sortcmp_t compare, surgescript_object_t* compare_object);
-static inline surgescript_var_t* med3(surgescript_var_t* a, surgescript_var_t* b, surgescript_var_t* c);
-static const surgescript_heapptr_t LENGTH_ADDR = 0; /* the length of the array is allocated on the first address */
-static const surgescript_heapptr_t BASE_ADDR = 1; /* array elements come later */
+#define ARRAY_AT(arr, i)        (&((arr)->data[((arr)->head + (i)) & ((arr)->capacity - 1)])) /* pointer to the i-th element, 0 <= i < length */
+static void reserve(array_t* arr, int capacity);
+static surgescript_var_t* linearize(array_t* arr);
+static void scan_objects(surgescript_object_t* object, void* data, bool (*callback)(unsigned,void*));
+static const int MIN_CAPACITY = 4; /* must be a power of two */
 static const surgescript_heapptr_t IT_LENGTH_ADDR = 0;
 static const surgescript_heapptr_t IT_COUNTER_ADDR = 1;
 
@@ -117,19 +152,31 @@ void surgescript_sslib_register_array(surgescript_vm_t* vm)
 /* array constructor */
 surgescript_var_t* fun_constructor(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
-    /* since we don't ever free() anything from the heap (except the last cell),
-       memory cells are allocated contiguously */
-    surgescript_heap_t* heap = surgescript_object_heap(object);
-    surgescript_heapptr_t length_addr = surgescript_heap_malloc(heap);
-    surgescript_var_set_number(surgescript_heap_at(heap, length_addr), 0);
-    ssassert(length_addr == LENGTH_ADDR);
+    array_t* arr = ssmalloc(sizeof *arr);
+
+    arr->data = NULL;
+    arr->capacity = 0;
+    arr->head = 0;
+    arr->length = 0;
+    arr->sorting = NULL;
+    reserve(arr, MIN_CAPACITY);
+
+    surgescript_object_set_userdata(object, arr);
+    surgescript_object_set_userdata_scanner(object, scan_objects);
     return NULL;
 }
 
 /* destructor */
 surgescript_var_t* fun_destructor(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
-    /* the heap gets freed anyway, so why bother? */
+    array_t* arr = (array_t*)surgescript_object_userdata(object);
+
+    for(int i = 0; i < arr->length; i++)
+        surgescript_var_set_null(ARRAY_AT(arr, i));
+
+    ssfree(arr->data);
+    surgescript_object_set_userdata(object, ssfree(arr));
+    surgescript_object_set_userdata_scanner(object, NULL);
     return NULL;
 }
 
@@ -143,18 +190,18 @@ surgescript_var_t* fun_main(surgescript_object_t* object, const surgescript_var_
 /* returns the length of the array */
 surgescript_var_t* fun_getlength(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
-    surgescript_heap_t* heap = surgescript_object_heap(object);
-    return surgescript_var_clone(surgescript_heap_at(heap, LENGTH_ADDR));
+    array_t* arr = (array_t*)surgescript_object_userdata(object);
+    return surgescript_var_set_number(surgescript_var_create(), arr->length);
 }
 
 /* gets i-th element of the array (indexes are 0-based) */
 surgescript_var_t* fun_get(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
-    surgescript_heap_t* heap = surgescript_object_heap(object);
+    array_t* arr = (array_t*)surgescript_object_userdata(object);
     int index = surgescript_var_get_number(param[0]);
 
-    if(index >= 0 && index < ARRAY_LENGTH(heap))
-        return surgescript_var_clone(surgescript_heap_at(heap, BASE_ADDR + index));
+    if(index >= 0 && index < arr->length)
+        return surgescript_var_clone(ARRAY_AT(arr, index));
 
     /* index out of bounds: fail silently */
     return NULL;
@@ -163,26 +210,26 @@ surgescript_var_t* fun_get(surgescript_object_t* object, const surgescript_var_t
 /* sets the i-th element of the array */
 surgescript_var_t* fun_set(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
-    surgescript_heap_t* heap = surgescript_object_heap(object);
+    array_t* arr = (array_t*)surgescript_object_userdata(object);
     int index = surgescript_var_get_number(param[0]);
-    int length = ARRAY_LENGTH(heap);
     const surgescript_var_t* value = param[1];
 
     /* sanity check & leak prevention */
-    if(index < 0 || index >= length + 1024) {
+    if(index < 0 || index >= arr->length + 1024) {
         ssfatal("Can't set %d-%s element of the array: the index is out of bounds.", index, ORDINAL(index));
         return NULL;
     }
 
-    /* create memory addresses as needed */
-    while(index >= length) {
-        surgescript_heapptr_t ptr = surgescript_heap_malloc(heap); /* fast */
-        surgescript_var_set_number(surgescript_heap_at(heap, LENGTH_ADDR), ++length);
-        ssassert(ptr == BASE_ADDR + (length - 1));
+    /* create null elements as needed */
+    if(index >= arr->length) {
+        reserve(arr, index + 1);
+        arr->length = index + 1; /* free cells are null */
     }
 
     /* set the value to the correct address */
-    surgescript_var_copy(surgescript_heap_at(heap, BASE_ADDR + index), value);
+    surgescript_var_copy(ARRAY_AT(arr, index), value);
+    if(surgescript_var_is_objecthandle(value))
+        surgescript_objectmanager_write_barrier(surgescript_object_manager(object), object);
 
     /* done! */
     return NULL; /*surgescript_var_clone(value);*/ /* the C expression (arr[i] = value) returns value */
@@ -191,14 +238,14 @@ surgescript_var_t* fun_set(surgescript_object_t* object, const surgescript_var_t
 /* pushes a new element into the last position of the array */
 surgescript_var_t* fun_push(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
-    surgescript_heap_t* heap = surgescript_object_heap(object);
+    array_t* arr = (array_t*)surgescript_object_userdata(object);
     const surgescript_var_t* value = param[0];
-    int length = ARRAY_LENGTH(heap);
 
-    surgescript_heapptr_t ptr = surgescript_heap_malloc(heap);
-    surgescript_var_copy(surgescript_heap_at(heap, ptr), value);
-    surgescript_var_set_number(surgescript_heap_at(heap, LENGTH_ADDR), ++length);
-    ssassert(ptr == BASE_ADDR + (length - 1));
+    reserve(arr, arr->length + 1);
+    surgescript_var_copy(ARRAY_AT(arr, arr->length), value);
+    if(surgescript_var_is_objecthandle(value))
+        surgescript_objectmanager_write_barrier(surgescript_object_manager(object), object);
+    arr->length++;
 
     return NULL;
 }
@@ -206,13 +253,13 @@ surgescript_var_t* fun_push(surgescript_object_t* object, const surgescript_var_
 /* pops the last element from the array */
 surgescript_var_t* fun_pop(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
-    surgescript_heap_t* heap = surgescript_object_heap(object);
-    int length = ARRAY_LENGTH(heap);
+    array_t* arr = (array_t*)surgescript_object_userdata(object);
 
-    if(length > 0) {
-        surgescript_var_t* value = surgescript_var_clone(surgescript_heap_at(heap, BASE_ADDR + (length - 1)));
-        surgescript_var_set_number(surgescript_heap_at(heap, LENGTH_ADDR), length - 1);
-        surgescript_heap_free(heap, BASE_ADDR + (length - 1));
+    if(arr->length > 0) {
+        surgescript_var_t* last = ARRAY_AT(arr, arr->length - 1);
+        surgescript_var_t* value = surgescript_var_clone(last);
+        surgescript_var_set_null(last);
+        arr->length--;
         return value;
     }
 
@@ -222,17 +269,14 @@ surgescript_var_t* fun_pop(surgescript_object_t* object, const surgescript_var_t
 /* removes (and returns) the first element and shifts all others to a lower index */
 surgescript_var_t* fun_shift(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
-    surgescript_heap_t* heap = surgescript_object_heap(object);
-    int length = ARRAY_LENGTH(heap);
-
-    if(length > 0) {
-        surgescript_var_t* value = surgescript_var_clone(surgescript_heap_at(heap, BASE_ADDR + 0));
-
-        for(int i = 0; i < length - 1; i++)
-            surgescript_var_copy(surgescript_heap_at(heap, BASE_ADDR + i), surgescript_heap_at(heap, BASE_ADDR + (i + 1)));
-
-        surgescript_var_set_number(surgescript_heap_at(heap, LENGTH_ADDR), length - 1);
-        surgescript_heap_free(heap, BASE_ADDR + (length - 1));
+    array_t* arr = (array_t*)surgescript_object_userdata(object);
+
+    if(arr->length > 0) {
+        surgescript_var_t* first = ARRAY_AT(arr, 0);
+        surgescript_var_t* value = surgescript_var_clone(first);
+        surgescript_var_set_null(first);
+        arr->head = (arr->head + 1) & (arr->capacity - 1);
+        arr->length--;
         return value;
     }
 
@@ -242,17 +286,15 @@ surgescript_var_t* fun_shift(surgescript_object_t* object, const surgescript_var
 /* adds an element to the beginning of the array and shifts all others to a higher index */
 surgescript_var_t* fun_unshift(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
-    surgescript_heap_t* heap = surgescript_object_heap(object);
+    array_t* arr = (array_t*)surgescript_object_userdata(object);
     const surgescript_var_t* value = param[0];
-    int length = ARRAY_LENGTH(heap);
-
-    surgescript_heapptr_t ptr = surgescript_heap_malloc(heap);
-    surgescript_var_set_number(surgescript_heap_at(heap, LENGTH_ADDR), ++length);
-    ssassert(ptr == BASE_ADDR + (length - 1));
 
-    for(int i = length - 1; i > 0; i--)
-        surgescript_var_copy(surgescript_heap_at(heap, BASE_ADDR + i), surgescript_heap_at(heap, BASE_ADDR + (i - 1)));
-    surgescript_var_copy(surgescript_heap_at(heap, BASE_ADDR + 0), value);
+    reserve(arr, arr->length + 1);
+    arr->head = (arr->head - 1) & (arr->capacity - 1);
+    arr->length++;
+    surgescript_var_copy(ARRAY_AT(arr, 0), value);
+    if(surgescript_var_is_objecthandle(value))
+        surgescript_objectmanager_write_barrier(surgescript_object_manager(object), object);
 
     return NULL;
 }
@@ -260,12 +302,12 @@ surgescript_var_t* fun_unshift(surgescript_object_t* object, const surgescript_v
 /* reverses the array. Returns the reversed array. */
 surgescript_var_t* fun_reverse(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
-    surgescript_heap_t* heap = surgescript_object_heap(object);
-    int length = ARRAY_LENGTH(heap);
+    array_t* arr = (array_t*)surgescript_object_userdata(object);
+    int length = arr->length;
 
     for(int i = 0; i < length / 2; i++) {
-        surgescript_var_t* a = surgescript_heap_at(heap, BASE_ADDR + i);
-        surgescript_var_t* b = surgescript_heap_at(heap, BASE_ADDR + (length - 1 - i));
+        surgescript_var_t* a = ARRAY_AT(arr, i);
+        surgescript_var_t* b = ARRAY_AT(arr, length - 1 - i);
         surgescript_var_swap(a, b);
     }
 
@@ -275,12 +317,61 @@ surgescript_var_t* fun_reverse(surgescript_object_t* object, const surgescript_v
 /* sorts the array. Returns the sorted array */
 surgescript_var_t* fun_sort(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
-    surgescript_heap_t* heap = surgescript_object_heap(object);
+    array_t* arr = (array_t*)surgescript_object_userdata(object);
     surgescript_objectmanager_t* manager = surgescript_object_manager(object);
-    surgescript_sortcmp_t compare = surgescript_var_is_null(param[0]) ? default_sort_function : custom_sort_function;
-    surgescript_object_t* compare_object = (compare == custom_sort_function) ? surgescript_objectmanager_get(manager, surgescript_var_get_objecthandle(param[0])) : NULL;
+    int length = arr->length;
+
+    if(!surgescript_var_is_null(param[0])) {
+        /* the functor may modify the array, so we sort a copy of it. The functor
+           may also run the garbage collector, so the copy and the scratch space
+           are linked to the array, where scan_objects() sees them */
+        surgescript_object_t* compare_object = surgescript_objectmanager_get(manager, surgescript_var_get_objecthandle(param[0]));
+        sortcopy_t copy = { .data = ssmalloc(length * sizeof(surgescript_var_t) + 1), .length = length, .next = arr->sorting };
+        bool has_objects = false;
+
+        copy.buf = ssmalloc((length / 2 + 1) * sizeof(surgescript_var_t));
+        memset(copy.buf, 0, (length / 2 + 1) * sizeof(surgescript_var_t));
+        memset(copy.data, 0, length * sizeof(surgescript_var_t));
+        for(int i = 0; i < length; i++)
+            surgescript_var_copy(&copy.data[i], ARRAY_AT(arr, i));
+
+        arr->sorting = &copy;
+        sort(copy.data, length, compare_custom, compare_object, copy.buf);
+        arr->sorting = copy.next;
+
+        for(int i = 0; i < length; i++) {
+            if(i < arr->length) {
+                has_objects = has_objects || surgescript_var_is_objecthandle(&copy.data[i]);
+                surgescript_var_copy(ARRAY_AT(arr, i), &copy.data[i]);
+            }
+            surgescript_var_set_null(&copy.data[i]);
+        }
+        ssfree(copy.buf); /* buf[] holds shallow copies */
+        ssfree(copy.data);
+
+        if(has_objects)
+            surgescript_objectmanager_write_barrier(manager, object);
+    }
+    else {
+        /* no script code runs: sort the array in place */
+        surgescript_var_t* v = linearize(arr);
+        surgescript_var_t* buf = ssmalloc((length / 2 + 1) * sizeof(*buf));
+        bool all_numbers = true, all_strings = true;
+
+        for(int i = 0; i < length && (all_numbers || all_strings); i++) {
+            all_numbers = all_numbers && surgescript_var_is_number(&v[i]);
+            all_strings = all_strings && surgescript_var_is_string(&v[i]);
+        }
+
+        if(all_numbers)
+            sort(v, length, compare_numbers, NULL, buf);
+        else if(all_strings)
+            sort(v, length, compare_strings, NULL, buf);
+        else
+            sort(v, length, compare_variables, NULL, buf);
 
-    quicksort(heap, BASE_ADDR, BASE_ADDR + ARRAY_LENGTH(heap) - 1, compare, compare_object);
+        ssfree(buf);
+    }
 
     return surgescript_var_set_objecthandle(surgescript_var_create(), surgescript_object_handle(object));
 }
@@ -288,12 +379,12 @@ surgescript_var_t* fun_sort(surgescript_object_t* object, const surgescript_var_
 /* shuffles the array. Returns the shuffled array. */
 surgescript_var_t* fun_shuffle(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
-    surgescript_heap_t* heap = surgescript_object_heap(object);
-    int length = ARRAY_LENGTH(heap);
+    array_t* arr = (array_t*)surgescript_object_userdata(object);
+    int length = arr->length;
 
     for(int i = length; i > 0; i--) {
-        surgescript_var_t* a = surgescript_heap_at(heap, BASE_ADDR + (i - 1));
-        surgescript_var_t* b = surgescript_heap_at(heap, BASE_ADDR + (surgescript_util_random64() % i));
+        surgescript_var_t* a = ARRAY_AT(arr, i - 1);
+        surgescript_var_t* b = ARRAY_AT(arr, surgescript_util_random64() % i);
         surgescript_var_swap(a, b);
     }
 
@@ -303,12 +394,12 @@ surgescript_var_t* fun_shuffle(surgescript_object_t* object, const surgescript_v
 /* finds the first i such that array[i] == param[0], or -1 if there is no such a match */
 surgescript_var_t* fun_indexof(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
-    surgescript_heap_t* haystack = surgescript_object_heap(object);
+    array_t* haystack = (array_t*)surgescript_object_userdata(object);
     const surgescript_var_t* needle = param[0];
-    int length = ARRAY_LENGTH(haystack);
+    int length = haystack->length;
 
     for(int i = 0; i < length; i++) {
-        surgescript_var_t* element = surgescript_heap_at(haystack, BASE_ADDR + i);
+        surgescript_var_t* element = ARRAY_AT(haystack, i);
         if(surgescript_var_compare(element, needle) == 0)
             return surgescript_var_set_number(surgescript_var_create(), i);
     }
@@ -319,14 +410,12 @@ surgescript_var_t* fun_indexof(surgescript_object_t* object, const surgescript_v
 /* clears the array */
 surgescript_var_t* fun_clear(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
-    surgescript_heap_t* heap = surgescript_object_heap(object);
-    int length = ARRAY_LENGTH(heap);
+    array_t* arr = (array_t*)surgescript_object_userdata(object);
 
-    if(length > 0) {
-        for(int i = length - 1; i >= 0; i--)
-            surgescript_heap_free(heap, BASE_ADDR + i);
-        surgescript_var_set_number(surgescript_heap_at(heap, LENGTH_ADDR), 0);
-    }
+    for(int i = 0; i < arr->length; i++)
+        surgescript_var_set_null(ARRAY_AT(arr, i));
+    arr->head = 0;
+    arr->length = 0;
 
     return NULL;
 }
@@ -335,7 +424,7 @@ surgescript_var_t* fun_clear(surgescript_object_t* object, const surgescript_var
 surgescript_var_t* fun_iterator(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
     surgescript_objectmanager_t* manager = surgescript_object_manager(object);
-    surgescript_objecthandle_t it_handle = surgescript_objectmanager_spawn(manager, surgescript_object_handle(object), "ArrayIterator", NULL);
+    surgescript_objecthandle_t it_handle = surgescript_objectmanager_spawn_iterator(manager, surgescript_object_handle(object), "ArrayIterator");
     return surgescript_var_set_objecthandle(surgescript_var_create(), it_handle);
 }
 
@@ -345,9 +434,10 @@ surgescript_var_t* fun_tostring(surgescript_object_t* object, const surgescript_
     SSARRAY(char, sb); /* string builder */
     surgescript_objectmanager_t* manager = surgescript_object_manager(object);
     surgescript_var_t* stringified_array = surgescript_var_create();
-    surgescript_heap_t* heap = surgescript_object_heap(object);
-    int length = ARRAY_LENGTH(heap);
-    static int depth = 0;
+    surgescript_var_t* tmp = surgescript_var_create();
+    array_t* arr = (array_t*)surgescript_object_userdata(object);
+    int length = arr->length;
+    static SS_THREADLOCAL int depth = 0;
     bool can_descend = (++depth < 16); /* handle circular links */
 
     /* helper macro */
@@ -382,8 +472,8 @@ surgescript_var_t* fun_tostring(surgescript_object_t* object, const surgescript_
     ssarray_push(sb, '[');
 
     /* for each element */
-    for(int i = 0; i < length; i++) {
-        surgescript_var_t* element = surgescript_heap_at(heap, BASE_ADDR + i);
+    for(int i = 0; i < length && i < arr->length; i++) { /* toString() may modify the array */
+        surgescript_var_t* element = surgescript_var_copy(tmp, ARRAY_AT(arr, i));
 
         /* add whitespace */
         ssarray_push(sb, ' ');
@@ -407,6 +497,8 @@ surgescript_var_t* fun_tostring(surgescript_object_t* object, const surgescript_
         ssarray_push(sb, i < length - 1 ? ',' : ' ');
     }
 
+    surgescript_var_destroy(tmp);
+
     /* convert sb to string */
     ssarray_push(sb, ']');
     ssarray_push(sb, '\0');
@@ -429,7 +521,6 @@ surgescript_var_t* fun_it_constructor(surgescript_object_t* object, const surges
     surgescript_objectmanager_t* manager = surgescript_object_manager(object);
     surgescript_objecthandle_t parent_handle = surgescript_object_parent(object);
     surgescript_object_t* parent = surgescript_objectmanager_get(manager, parent_handle);
-    surgescript_heap_t* parent_heap = surgescript_object_heap(parent);
     const char* parent_name = surgescript_object_name(parent);
 
     ssassert(IT_LENGTH_ADDR == surgescript_heap_malloc(heap));
@@ -437,8 +528,10 @@ surgescript_var_t* fun_it_constructor(surgescript_object_t* object, const surges
 
     surgescript_var_set_number(surgescript_heap_at(heap, IT_LENGTH_ADDR), 0.0);
     surgescript_var_set_number(surgescript_heap_at(heap, IT_COUNTER_ADDR), 0.0);
-    if(strcmp(parent_name, "Array") == 0)
-        surgescript_var_set_number(surgescript_heap_at(heap, IT_LENGTH_ADDR), ARRAY_LENGTH(parent_heap));
+    if(strcmp(parent_name, "Array") == 0) {
+        array_t* arr = (array_t*)surgescript_object_userdata(parent);
+        surgescript_var_set_number(surgescript_heap_at(heap, IT_LENGTH_ADDR), arr->length);
+    }
 
     return NULL;
 }
@@ -458,10 +551,10 @@ surgescript_var_t* fun_it_next(surgescript_object_t* object, const surgescript_v
         surgescript_objectmanager_t* manager = surgescript_object_manager(object);
         surgescript_objecthandle_t parent_handle = surgescript_object_parent(object);
         surgescript_object_t* parent = surgescript_objectmanager_get(manager, parent_handle);
-        surgescript_heap_t* parent_heap = surgescript_object_heap(parent);
-        surgescript_var_t* element = surgescript_var_clone(surgescript_heap_at(parent_heap, BASE_ADDR + cnt));
+        array_t* arr = (array_t*)surgescript_object_userdata(parent);
         surgescript_var_set_number(surgescript_heap_at(heap, IT_COUNTER_ADDR), cnt + 1);
-        return element;
+        if(cnt < arr->length) /* the array may have shrunk */
+            return surgescript_var_clone(ARRAY_AT(arr, cnt));
     }
 
     return NULL;
@@ -483,65 +576,295 @@ surgescript_var_t* fun_it_tostring(surgescript_object_t* object, const surgescri
 
 /* utilities */
 
-/* quicksort algorithm: sorts heap[begin .. end] */
-void quicksort(surgescript_heap_t* heap, surgescript_heapptr_t begin, surgescript_heapptr_t end, surgescript_sortcmp_t compare, surgescript_object_t* compare_object)
+/* compares two numbers */
+int compare_numbers(const surgescript_var_t* a, const surgescript_var_t* b, void* context)
+{
+    double x = surgescript_var_get_number(a), y = surgescript_var_get_number(b);
+    return (x > y) - (x < y);
+}
+
+/* compares two strings */
+int compare_strings(const surgescript_var_t* a, const surgescript_var_t* b, void* context)
+{
+    return strcmp(surgescript_var_fast_get_string(a), surgescript_var_fast_get_string(b));
+}
+
+/* compares variables of mixed types: null < numbers & booleans < strings < objects */
+int compare_variables(const surgescript_var_t* a, const surgescript_var_t* b, void* context)
 {
-    if(begin < end) {
-        surgescript_heapptr_t p = partition(heap, begin, end, compare, compare_object);
-        quicksort(heap, begin, p-1, compare, compare_object);
-        quicksort(heap, p+1, end, compare, compare_object);
+    #define RANK(var) ( \
+        surgescript_var_is_null(var) ? 0 : \
+        (surgescript_var_is_number(var) || surgescript_var_is_bool(var)) ? 1 : \
+        surgescript_var_is_string(var) ? 2 : \
+        3 \
+    )
+
+    int rank_a = RANK(a), rank_b = RANK(b);
+    if(rank_a != rank_b)
+        return rank_a - rank_b;
+
+    /* surgescript_var_compare() compares numbers & booleans numerically */
+    return surgescript_var_compare(a, b);
+
+    #undef RANK
+}
+
+/* compares two variables by calling the functor given as context */
+int compare_custom(const surgescript_var_t* a, const surgescript_var_t* b, void* context)
+{
+    surgescript_object_t* functor = (surgescript_object_t*)context;
+    const surgescript_var_t* param[] = { a, b };
+    double return_value = 0;
+
+    surgescript_var_t* ret = surgescript_var_create();
+    surgescript_object_call_function(functor, "call", param, 2, ret);
+    return_value = surgescript_var_get_number(ret);
+    surgescript_var_destroy(ret);
+
+    return (return_value > 0) - (return_value < 0);
+}
+
+/*
+ * Sorts v[0 .. n-1] with a hybrid algorithm: presorted data (a few ascending
+ * or strictly descending runs) is sorted by a stable natural merge sort; other
+ * data is sorted by a non-recursive introsort (quicksort with a heapsort
+ * fallback on bad pivots), and small partitions are sorted by insertion sort.
+ * cmp() need not be consistent. buf[] is scratch space for n / 2 + 1 elements.
+ * Elements are only ever swapped or moved between v[] and buf[], so that every
+ * element is in one of them whenever cmp() is called.
+ */
+void sort(surgescript_var_t* v, int n, sortcmp_t cmp, void* context, surgescript_var_t* buf)
+{
+    if(n <= SORT_SMALL)
+        insertion_sort(v, 0, n - 1, cmp, context);
+    else if(!merge_sort(v, n, cmp, context, buf))
+        intro_sort(v, n, cmp, context);
+}
+
+/* insertion sort of v[begin .. end] */
+void insertion_sort(surgescript_var_t* v, int begin, int end, sortcmp_t cmp, void* context)
+{
+    for(int i = begin + 1; i <= end; i++) {
+        for(int j = i; j > begin && cmp(&v[j], &v[j-1], context) < 0; j--)
+            surgescript_var_swap(&v[j], &v[j-1]);
     }
 }
 
-/* returns ptr such that heap[begin .. ptr-1] <= heap[ptr] < heap[ptr+1 .. end], where begin <= end */
-surgescript_heapptr_t partition(surgescript_heap_t* heap, surgescript_heapptr_t begin, surgescript_heapptr_t end, surgescript_sortcmp_t compare, surgescript_object_t* compare_object)
+/* heap sort of v[0 .. n-1] */
+void heap_sort(surgescript_var_t* v, int n, sortcmp_t cmp, void* context)
 {
-    surgescript_var_t* pivot = surgescript_heap_at(heap, end);
-    surgescript_heapptr_t p = begin;
+    for(int i = n / 2 - 1; i >= 0; i--)
+        sift_down(v, i, n, cmp, context);
 
-    surgescript_var_swap(pivot, med3(surgescript_heap_at(heap, begin), surgescript_heap_at(heap, begin + (end-begin)/2), pivot));
-    for(surgescript_heapptr_t i = begin; i <= end - 1; i++) {
-        if(compare(compare_object, surgescript_heap_at(heap, i), pivot) <= 0) {
-            surgescript_var_swap(surgescript_heap_at(heap, i), surgescript_heap_at(heap, p));
-            p++;
-        }
+    for(int i = n - 1; i > 0; i--) {
+        surgescript_var_swap(&v[0], &v[i]);
+        sift_down(v, 0, i, cmp, context);
     }
+}
 
-    surgescript_var_swap(surgescript_heap_at(heap, p), pivot);
+/* restores the max-heap property of v[0 .. n-1] below the root */
+void sift_down(surgescript_var_t* v, int root, int n, sortcmp_t cmp, void* context)
+{
+    for(int child; (child = 2 * root + 1) < n; root = child) {
+        if(child + 1 < n && cmp(&v[child], &v[child+1], context) < 0)
+            child++;
+        if(cmp(&v[root], &v[child], context) >= 0)
+            break;
+        surgescript_var_swap(&v[root], &v[child]);
+    }
+}
+
+/* partitions v[begin .. end], begin < end, around a median of 3. Returns the position of the pivot */
+int partition(surgescript_var_t* v, int begin, int end, sortcmp_t cmp, void* context)
+{
+    int mid = begin + (end - begin) / 2, p = begin;
+
+    if(cmp(&v[mid], &v[begin], context) < 0)
+        surgescript_var_swap(&v[mid], &v[begin]);
+    if(cmp(&v[end], &v[mid], context) < 0)
+        surgescript_var_swap(&v[end], &v[mid]);
+    if(cmp(&v[mid], &v[begin], context) < 0)
+        surgescript_var_swap(&v[mid], &v[begin]);
+    surgescript_var_swap(&v[mid], &v[end]); /* v[end] is the pivot */
+
+    for(int i = begin; i < end; i++) {
+        if(cmp(&v[i], &v[end], context) <= 0)
+            surgescript_var_swap(&v[i], &v[p++]);
+    }
+
+    surgescript_var_swap(&v[p], &v[end]);
     return p;
 }
 
-/* returns the median of 3 variables */
-surgescript_var_t* med3(surgescript_var_t* a, surgescript_var_t* b, surgescript_var_t* c)
+/* non-recursive introsort of v[0 .. n-1] */
+void intro_sort(surgescript_var_t* v, int n, sortcmp_t cmp, void* context)
 {
-    int ab = surgescript_var_compare(a, b);
-    int bc = surgescript_var_compare(b, c);
-    int ac = surgescript_var_compare(a, c);
+    struct { int begin, end, depth; } stack[64];
+    int top = 0, depth = 0;
+
+    for(int k = n; k > 1; k >>= 1)
+        depth += 2;
+
+    stack[top].begin = 0; stack[top].end = n - 1; stack[top++].depth = depth;
+    while(top > 0) {
+        int begin = stack[--top].begin, end = stack[top].end;
+        depth = stack[top].depth;
+
+        while(end - begin + 1 > SORT_SMALL) {
+            int p;
+
+            if(depth-- == 0) {
+                heap_sort(v + begin, end - begin + 1, cmp, context);
+                begin = end; /* done */
+                break;
+            }
+
+            p = partition(v, begin, end, cmp, context);
+            if(p - begin < end - p) { /* push the larger part, so that the stack stays small */
+                stack[top].begin = p + 1; stack[top].end = end; stack[top++].depth = depth;
+                end = p - 1;
+            }
+            else {
+                stack[top].begin = begin; stack[top].end = p - 1; stack[top++].depth = depth;
+                begin = p + 1;
+            }
+        }
 
-    if(ab >= 0 && ac >= 0) /* a = max(a, b, c) */
-        return bc >= 0 ? b : c;
-    else if(ab <= 0 && bc >= 0) /* b = max(a, b, c) */
-        return ac >= 0 ? a : c;
-    else /* c = max(a, b, c) */
-        return ab >= 0 ? a : b;
+        insertion_sort(v, begin, end, cmp, context);
+    }
 }
 
-/* default sort function */
-int default_sort_function(surgescript_object_t* object, const surgescript_var_t* a, const surgescript_var_t* b)
+/* natural merge sort of v[0 .. n-1]. Returns false (and sorts nothing) if the data isn't presorted */
+bool merge_sort(surgescript_var_t* v, int n, sortcmp_t cmp, void* context, surgescript_var_t* buf)
 {
-    return surgescript_var_compare(a, b);
+    SSARRAY(int, run); /* run[k] is the first position of the k-th run */
+
+    /* find the runs; strictly descending runs are reversed */
+    ssarray_init(run);
+    for(int begin = 0, end; begin < n; begin = end) {
+        if(ssarray_length(run) * SORT_MIN_RUN > n) {
+            ssarray_release(run);
+            return false;
+        }
+
+        ssarray_push(run, begin);
+        end = begin + 1;
+        if(end < n && cmp(&v[end], &v[begin], context) < 0) {
+            while(++end < n && cmp(&v[end], &v[end-1], context) < 0);
+            for(int i = begin, j = end - 1; i < j; i++, j--)
+                surgescript_var_swap(&v[i], &v[j]);
+        }
+        else {
+            while(end < n && cmp(&v[end], &v[end-1], context) >= 0)
+                end++;
+        }
+    }
+    ssarray_push(run, n);
+
+    /* merge adjacent runs until there is only one */
+    while(ssarray_length(run) > 2) {
+        int k = 0, m = 0;
+
+        for(; k + 2 < ssarray_length(run); k += 2) {
+            int begin = run[k], mid = run[k+1], end = run[k+2];
+
+            if(cmp(&v[mid], &v[mid-1], context) < 0) {
+                if(mid - begin > end - mid) { /* merge from the right */
+                    int i = end - mid - 1, j = mid - 1, p = end - 1;
+                    memcpy(buf, v + mid, (end - mid) * sizeof(*buf));
+                    while(i >= 0 && j >= begin)
+                        v[p--] = (cmp(&buf[i], &v[j], context) < 0) ? v[j--] : buf[i--];
+                    while(i >= 0)
+                        v[p--] = buf[i--];
+                }
+                else { /* merge from the left */
+                    int i = 0, j = mid, p = begin, left = mid - begin;
+                    memcpy(buf, v + begin, left * sizeof(*buf));
+                    while(i < left && j < end)
+                        v[p++] = (cmp(&v[j], &buf[i], context) < 0) ? v[j++] : buf[i++];
+                    while(i < left)
+                        v[p++] = buf[i++];
+                }
+            }
+
+            run[m++] = begin;
+        }
+
+        for(; k < ssarray_length(run); k++)
+            run[m++] = run[k];
+        ssarray_truncate(run, m);
+    }
+
+    ssarray_release(run);
+    return true;
 }
 
-/* custom sort function (calls an object) */
-int custom_sort_function(surgescript_object_t* object, const surgescript_var_t* a, const surgescript_var_t* b)
+/* makes room for (at least) the given number of elements */
+void reserve(array_t* arr, int capacity)
 {
-    const surgescript_var_t* param[] = { a, b };
-    double return_value = 0;
+    if(capacity > arr->capacity) {
+        int new_capacity = arr->capacity > 0 ? arr->capacity : MIN_CAPACITY;
+        surgescript_var_t* data;
+
+        while(new_capacity < capacity)
+            new_capacity *= 2;
+
+        /* move the elements to the beginning of the new buffer; free cells are null */
+        data = ssmalloc(new_capacity * sizeof(*data));
+        for(int i = 0; i < arr->length; i++)
+            memcpy(&data[i], ARRAY_AT(arr, i), sizeof(*data));
+        memset(data + arr->length, 0, (new_capacity - arr->length) * sizeof(*data));
+
+        ssfree(arr->data);
+        arr->data = data;
+        arr->capacity = new_capacity;
+        arr->head = 0;
+    }
+}
 
-    surgescript_var_t* ret = surgescript_var_create();
-    surgescript_object_call_function(object, "call", param, 2, ret);
-    return_value = surgescript_var_get_number(ret);
-    surgescript_var_destroy(ret);
+/* makes the elements of the array contiguous and returns a pointer to the first one */
+surgescript_var_t* linearize(array_t* arr)
+{
+    if(arr->head + arr->length > arr->capacity) {
+        /* the elements wrap around the end of the buffer */
+        surgescript_var_t* data = ssmalloc(arr->capacity * sizeof(*data));
+        for(int i = 0; i < arr->length; i++)
+            memcpy(&data[i], ARRAY_AT(arr, i), sizeof(*data));
+        memset(data + arr->length, 0, (arr->capacity - arr->length) * sizeof(*data));
+
+        ssfree(arr->data);
+        arr->data = data;
+        arr->head = 0;
+    }
 
-    return (return_value > 0) - (return_value < 0);
+    return arr->data + arr->head;
+}
+
+/* lets the garbage collector scan the elements of the array */
+void scan_objects(surgescript_object_t* object, void* data, bool (*callback)(unsigned,void*))
+{
+    array_t* arr = (array_t*)surgescript_object_userdata(object);
+
+    for(int i = 0; i < arr->length; i++) {
+        surgescript_var_t* element = ARRAY_AT(arr, i);
+        unsigned handle = surgescript_var_get_objecthandle(element);
+        if(handle != 0) { /* if element is an object and not null */
+            if(!callback(handle, data)) /* if the handle is broken */
+                surgescript_var_set_null(element); /* fix it */
+        }
+    }
+
+    /* copies being sorted by script comparators */
+    for(sortcopy_t* copy = arr->sorting; copy != NULL; copy = copy->next) {
+        for(int i = 0; i < copy->length; i++) {
+            unsigned handle = surgescript_var_get_objecthandle(&copy->data[i]);
+            if(handle != 0 && !callback(handle, data))
+                surgescript_var_set_null(&copy->data[i]);
+        }
+        for(int i = 0; i < copy->length / 2 + 1; i++) {
+            unsigned handle = surgescript_var_get_objecthandle(&copy->buf[i]);
+            if(handle != 0 && !callback(handle, data))
+                surgescript_var_set_null(&copy->buf[i]);
+        }
+    }
 }
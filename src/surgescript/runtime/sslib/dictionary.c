@@ -20,6 +20,7 @@
  */
 
 #include <string.h>
+#include <stdint.h>
 #include "../vm.h"
 #include "../heap.h"
 #include "../object.h"
@@ -32,6 +33,7 @@
 
 /* Dictionary */
 static surgescript_var_t* fun_constructor(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
+static surgescript_var_t* fun_destructor(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
 static surgescript_var_t* fun_main(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
 static surgescript_var_t* fun_getcount(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
 static surgescript_var_t* fun_get(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
@@ -45,6 +47,7 @@ static surgescript_var_t* fun_tostring(surgescript_object_t* object, const surge
 
 /* DictionaryIterator */
 static surgescript_var_t* fun_it_constructor(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
+static surgescript_var_t* fun_it_destructor(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
 static surgescript_var_t* fun_it_main(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
 static surgescript_var_t* fun_it_next(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
 static surgescript_var_t* fun_it_hasnext(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
@@ -58,37 +61,53 @@ static surgescript_var_t* fun_entry_getvalue(surgescript_object_t* object, const
 static surgescript_var_t* fun_entry_setvalue(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
 static surgescript_var_t* fun_entry_tostring(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
 
-/* BSTNode: native implementation of a Binary Search Tree in SurgeScript */
-static surgescript_var_t* fun_bst_constructor(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_bst_main(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_bst_getkey(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_bst_getvalue(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_bst_getleft(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_bst_getright(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_bst_setvalue(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_bst_count(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_bst_find(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_bst_insert(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_bst_remove(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-
 /* addresses */
-static const surgescript_heapptr_t BST_KEY = 0; /* address of the 'key' field in the BST */
-static const surgescript_heapptr_t BST_VALUE = 1; /* and so on */
-static const surgescript_heapptr_t BST_LEFT = 2;
-static const surgescript_heapptr_t BST_RIGHT = 3;
 static const surgescript_heapptr_t IT_ENTRYREF = 0;
-static const surgescript_heapptr_t IT_STACKSIZE = 1;
-static const surgescript_heapptr_t IT_STACKBASE = 2;
-static const surgescript_heapptr_t ENTRY_BSTREF = 0;
-static const surgescript_heapptr_t DICT_BSTROOT = 0;
+static const surgescript_heapptr_t IT_POSITION = 1;
+static const surgescript_heapptr_t ENTRY_KEY = 0;
+
+/*
+ * A Dictionary is a hash table: the keys and the values are stored in the heap
+ * of the object (so that the garbage collector can see them), whereas the
+ * table itself is stored in its user data. The entries are kept in insertion
+ * order; the index maps hashes to positions of that list (open addressing).
+ * Iterators store positions of that list, so the deleted entries are only
+ * removed from it when no iterator is alive.
+ */
+typedef struct dictionary_t dictionary_t;
+typedef struct dictionary_entry_t dictionary_entry_t;
+
+struct dictionary_entry_t
+{
+    uint32_t hash; /* hash of the key */
+    surgescript_heapptr_t key; /* address of the key (a string) in the heap */
+    surgescript_heapptr_t value; /* address of the value in the heap */
+    bool deleted; /* has this entry been deleted? */
+};
+
+struct dictionary_t
+{
+    SSARRAY(dictionary_entry_t, entry); /* entries in insertion order */
+    int* index; /* positions of entry[], EMPTY_SLOT or DELETED_SLOT */
+    int capacity; /* size of index[]: a power of two */
+    int used; /* number of slots of index[] that are not empty */
+    int count; /* number of entries that haven't been deleted */
+    int iterators; /* number of live iterators */
+};
+
+static const int EMPTY_SLOT = -1;
+static const int DELETED_SLOT = -2;
+static const int MIN_CAPACITY = 8; /* must be a power of two */
 
 /* utilities */
 static surgescript_var_t* sanitize_key(surgescript_var_t* ssvar, const surgescript_objectmanager_t* manager);
-static surgescript_objecthandle_t new_bst_node(const surgescript_object_t* parent, const surgescript_var_t* key, const surgescript_var_t* value);
-static int bst_count(const surgescript_objectmanager_t* manager, const surgescript_object_t* object);
-static surgescript_var_t* bst_remove(surgescript_object_t* object, const char* param_key, int depth);
-static surgescript_var_t* bst_removeroot(surgescript_object_t* object);
-static surgescript_var_t* dictentry(surgescript_object_t* entry, const surgescript_object_t* bst);
+static dictionary_t* create_dictionary();
+static dictionary_t* destroy_dictionary(dictionary_t* dict);
+static int find_entry(const dictionary_t* dict, const surgescript_heap_t* heap, const surgescript_var_t* key, uint32_t hash, int* slot);
+static int find_key(const surgescript_object_t* object, const surgescript_var_t* key, int* slot);
+static int next_entry(const dictionary_t* dict, int position);
+static void rebuild_index(dictionary_t* dict, int capacity);
+static dictionary_t* iterator_dictionary(const surgescript_object_t* iterator, surgescript_object_t** dictionary);
 
 /*
  * surgescript_sslib_register_dictionary()
@@ -103,6 +122,7 @@ void surgescript_sslib_register_dictionary(surgescript_vm_t* vm)
 
     /* methods */
     surgescript_vm_bind(vm, "Dictionary", "constructor", fun_constructor, 0);
+    surgescript_vm_bind(vm, "Dictionary", "destructor", fun_destructor, 0);
     surgescript_vm_bind(vm, "Dictionary", "state:main", fun_main, 0);
     surgescript_vm_bind(vm, "Dictionary", "get_count", fun_getcount, 0);
     surgescript_vm_bind(vm, "Dictionary", "get", fun_get, 1);
@@ -115,6 +135,7 @@ void surgescript_sslib_register_dictionary(surgescript_vm_t* vm)
     surgescript_vm_bind(vm, "Dictionary", "toString", fun_tostring, 0);
 
     surgescript_vm_bind(vm, "DictionaryIterator", "constructor", fun_it_constructor, 0);
+    surgescript_vm_bind(vm, "DictionaryIterator", "destructor", fun_it_destructor, 0);
     surgescript_vm_bind(vm, "DictionaryIterator", "state:main", fun_it_main, 0);
     surgescript_vm_bind(vm, "DictionaryIterator", "next", fun_it_next, 0);
     surgescript_vm_bind(vm, "DictionaryIterator", "hasNext", fun_it_hasnext, 0);
@@ -126,36 +147,24 @@ void surgescript_sslib_register_dictionary(surgescript_vm_t* vm)
     surgescript_vm_bind(vm, "DictionaryEntry", "get_value", fun_entry_getvalue, 0);
     surgescript_vm_bind(vm, "DictionaryEntry", "set_value", fun_entry_setvalue, 1);
     surgescript_vm_bind(vm, "DictionaryEntry", "toString", fun_entry_tostring, 0);
-
-    surgescript_vm_bind(vm, "BSTNode", "constructor", fun_bst_constructor, 0);
-    surgescript_vm_bind(vm, "BSTNode", "state:main", fun_bst_main, 0);
-    surgescript_vm_bind(vm, "BSTNode", "get_key", fun_bst_getkey, 0);
-    surgescript_vm_bind(vm, "BSTNode", "get_value", fun_bst_getvalue, 0);
-    surgescript_vm_bind(vm, "BSTNode", "set_value", fun_bst_setvalue, 1);
-    surgescript_vm_bind(vm, "BSTNode", "get_left", fun_bst_getleft, 0);
-    surgescript_vm_bind(vm, "BSTNode", "get_right", fun_bst_getright, 0);
-    surgescript_vm_bind(vm, "BSTNode", "count", fun_bst_count, 0);
-    surgescript_vm_bind(vm, "BSTNode", "find", fun_bst_find, 1);
-    surgescript_vm_bind(vm, "BSTNode", "insert", fun_bst_insert, 2);
-    surgescript_vm_bind(vm, "BSTNode", "remove", fun_bst_remove, 1);
 }
 
 
 
 /* --- Dictionary --- */
 
-/* A Dictionary is just a facade that implements a Binary Search Tree (BSTNodes) */
-
 /* constructor(): initialize the Dictionary */
 surgescript_var_t* fun_constructor(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
-    surgescript_heap_t* heap = surgescript_object_heap(object);
-    surgescript_objectmanager_t* manager = surgescript_object_manager(object);
-    surgescript_objecthandle_t null_handle = surgescript_objectmanager_null(manager);
-
-    ssassert(DICT_BSTROOT == surgescript_heap_malloc(heap));
-    surgescript_var_set_objecthandle(surgescript_heap_at(heap, DICT_BSTROOT), null_handle);
+    surgescript_object_set_userdata(object, create_dictionary());
+    return NULL;
+}
 
+/* destructor(): release the hash table */
+surgescript_var_t* fun_destructor(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+{
+    dictionary_t* dict = (dictionary_t*)surgescript_object_userdata(object);
+    surgescript_object_set_userdata(object, destroy_dictionary(dict));
     return NULL;
 }
 
@@ -168,106 +177,110 @@ surgescript_var_t* fun_main(surgescript_object_t* object, const surgescript_var_
 /* getCount(): how many entries does this Dictionary have? */
 surgescript_var_t* fun_getcount(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
-    surgescript_heap_t* heap = surgescript_object_heap(object);
-    surgescript_objectmanager_t* manager = surgescript_object_manager(object);
-    surgescript_objecthandle_t bst = surgescript_var_get_objecthandle(surgescript_heap_at(heap, DICT_BSTROOT));
-
-    if(surgescript_objectmanager_exists(manager, bst)) {
-        surgescript_object_t* node = surgescript_objectmanager_get(manager, bst);
-        return fun_bst_count(node, NULL, 0);
-    }
-    else
-        return surgescript_var_set_number(surgescript_var_create(), 0);
+    dictionary_t* dict = (dictionary_t*)surgescript_object_userdata(object);
+    return surgescript_var_set_number(surgescript_var_create(), dict->count);
 }
 
 /* get(key): gets an entry from the Dictionary */
 surgescript_var_t* fun_get(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
-    surgescript_var_t* get = NULL;
+    dictionary_t* dict = (dictionary_t*)surgescript_object_userdata(object);
     surgescript_heap_t* heap = surgescript_object_heap(object);
-    surgescript_objectmanager_t* manager = surgescript_object_manager(object);
-    surgescript_objecthandle_t bst = surgescript_var_get_objecthandle(surgescript_heap_at(heap, DICT_BSTROOT));
-
-    if(surgescript_objectmanager_exists(manager, bst)) {
-        surgescript_object_t* node = surgescript_objectmanager_get(manager, bst);
-        surgescript_var_t* key = sanitize_key(surgescript_var_clone(param[0]), manager);
-        const surgescript_var_t* p[] = { key };
-        surgescript_var_t* result = fun_bst_find(node, p, 1);
-        surgescript_objecthandle_t result_handle = surgescript_var_get_objecthandle(result);
-
-        if(surgescript_objectmanager_exists(manager, result_handle)) {
-            surgescript_object_t* result_object = surgescript_objectmanager_get(manager, result_handle);
-            get = fun_bst_getvalue(result_object, NULL, 0);
-        }
-
-        surgescript_var_destroy(result);
-        surgescript_var_destroy(key);
-    }
+    int i = find_key(object, param[0], NULL);
 
-    return get;
+    if(i >= 0)
+        return surgescript_var_clone(surgescript_heap_at(heap, dict->entry[i].value));
+    else
+        return NULL;
 }
 
 /* set(key, value): sets a new entry */
 surgescript_var_t* fun_set(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
+    dictionary_t* dict = (dictionary_t*)surgescript_object_userdata(object);
     surgescript_heap_t* heap = surgescript_object_heap(object);
     surgescript_objectmanager_t* manager = surgescript_object_manager(object);
-    surgescript_var_t* root = surgescript_heap_at(heap, DICT_BSTROOT);
-    surgescript_objecthandle_t bst = surgescript_var_get_objecthandle(root);
-    surgescript_var_t* key = sanitize_key(surgescript_var_clone(param[0]), manager); /* keys must be sanitized */
-    const surgescript_var_t* value = param[1];
-
-    if(surgescript_objectmanager_exists(manager, bst)) { /* if there is a root... */
-        surgescript_object_t* node = surgescript_objectmanager_get(manager, bst);
-        const surgescript_var_t* p[] = { key, value };
-        surgescript_var_t* result = fun_bst_insert(node, p, 2);
-        surgescript_var_destroy(result);
+    surgescript_var_t* key = NULL;
+    dictionary_entry_t entry;
+    int i, slot;
+
+    /* keys must be sanitized */
+    if(!surgescript_var_is_string(param[0]))
+        key = sanitize_key(surgescript_var_clone(param[0]), manager);
+    entry.hash = surgescript_var_fast_get_string_hash(key ? key : param[0]);
+
+    /* is the key already in the Dictionary? */
+    if((i = find_entry(dict, heap, key ? key : param[0], entry.hash, &slot)) >= 0) {
+        surgescript_var_copy(surgescript_heap_at(heap, dict->entry[i].value), param[1]);
+        if(surgescript_var_is_objecthandle(param[1]))
+            surgescript_objectmanager_write_barrier(manager, object);
+        if(key != NULL)
+            surgescript_var_destroy(key);
+        return NULL;
     }
-    else /* if not, create one */
-        surgescript_var_set_objecthandle(root, new_bst_node(object, key, value));
 
-    surgescript_var_destroy(key);
+    /* make room for the new entry */
+    if(4 * (dict->used + 1) > 3 * dict->capacity) {
+        int capacity = MIN_CAPACITY;
+        while(2 * (dict->count + 1) > capacity)
+            capacity *= 2;
+        rebuild_index(dict, capacity);
+        find_entry(dict, heap, key ? key : param[0], entry.hash, &slot);
+    }
+
+    /* add the new entry */
+    entry.key = surgescript_heap_malloc(heap);
+    entry.value = surgescript_heap_malloc(heap);
+    entry.deleted = false;
+    surgescript_var_copy(surgescript_heap_at(heap, entry.key), key ? key : param[0]);
+    surgescript_var_copy(surgescript_heap_at(heap, entry.value), param[1]);
+    if(surgescript_var_is_objecthandle(param[1]))
+        surgescript_objectmanager_write_barrier(manager, object);
+    if(dict->index[slot] == EMPTY_SLOT)
+        dict->used++;
+    dict->index[slot] = ssarray_length(dict->entry);
+    ssarray_push(dict->entry, entry);
+    dict->count++;
+
+    /* done! */
+    if(key != NULL)
+        surgescript_var_destroy(key);
     return NULL;
 }
 
 /* clear(): clears the whole Dictionary, so that no entries are stored */
 surgescript_var_t* fun_clear(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
+    dictionary_t* dict = (dictionary_t*)surgescript_object_userdata(object);
     surgescript_heap_t* heap = surgescript_object_heap(object);
-    surgescript_objectmanager_t* manager = surgescript_object_manager(object);
-    surgescript_objecthandle_t null_handle = surgescript_objectmanager_null(manager);
-    surgescript_var_t* root = surgescript_heap_at(heap, DICT_BSTROOT);
-    surgescript_objecthandle_t bst = surgescript_var_get_objecthandle(root);
 
-    if(surgescript_objectmanager_exists(manager, bst)) {
-        surgescript_object_t* node = surgescript_objectmanager_get(manager, bst);
-        surgescript_object_kill(node);
+    for(int i = 0; i < ssarray_length(dict->entry); i++) {
+        if(!dict->entry[i].deleted) {
+            surgescript_heap_free(heap, dict->entry[i].key);
+            surgescript_heap_free(heap, dict->entry[i].value);
+        }
     }
 
-    surgescript_var_set_objecthandle(root, null_handle);
+    ssarray_reset(dict->entry);
+    dict->count = 0;
+    rebuild_index(dict, MIN_CAPACITY);
     return NULL;
 }
 
 /* delete(key): deletes a key from the Dictionary */
 surgescript_var_t* fun_delete(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
+    dictionary_t* dict = (dictionary_t*)surgescript_object_userdata(object);
     surgescript_heap_t* heap = surgescript_object_heap(object);
-    surgescript_objectmanager_t* manager = surgescript_object_manager(object);
-    surgescript_var_t* root = surgescript_heap_at(heap, DICT_BSTROOT);
-    surgescript_objecthandle_t bst = surgescript_var_get_objecthandle(root);
-
-    if(surgescript_objectmanager_exists(manager, bst)) {
-        surgescript_object_t* node = surgescript_objectmanager_get(manager, bst);
-        surgescript_var_t* key = sanitize_key(surgescript_var_clone(param[0]), manager);
-        const surgescript_var_t* p[] = { key };
-
-        surgescript_var_t* new_root = fun_bst_remove(node, p, 1);
-        if(new_root != NULL) {
-            surgescript_var_copy(root, new_root);
-            surgescript_var_destroy(new_root);
-        }
-
-        surgescript_var_destroy(key);
+    int slot, i = find_key(object, param[0], &slot);
+
+    if(i >= 0) {
+        /* the entry stays in the list (as deleted), so that iterators remain valid */
+        surgescript_heap_free(heap, dict->entry[i].key);
+        surgescript_heap_free(heap, dict->entry[i].value);
+        dict->entry[i].deleted = true;
+        dict->index[slot] = DELETED_SLOT;
+        dict->count--;
     }
 
     return NULL;
@@ -276,24 +289,7 @@ surgescript_var_t* fun_delete(surgescript_object_t* object, const surgescript_va
 /* has(key): does this dictionary have an entry with the given key? */
 surgescript_var_t* fun_has(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
-    bool has = false;
-    surgescript_heap_t* heap = surgescript_object_heap(object);
-    surgescript_objectmanager_t* manager = surgescript_object_manager(object);
-    surgescript_objecthandle_t bst = surgescript_var_get_objecthandle(surgescript_heap_at(heap, DICT_BSTROOT));
-
-    if(surgescript_objectmanager_exists(manager, bst)) {
-        surgescript_object_t* node = surgescript_objectmanager_get(manager, bst);
-        surgescript_var_t* key = sanitize_key(surgescript_var_clone(param[0]), manager);
-        const surgescript_var_t* p[] = { key };
-        surgescript_var_t* result = fun_bst_find(node, p, 1);
-        surgescript_objecthandle_t result_handle = surgescript_var_get_objecthandle(result);
-
-        has = surgescript_objectmanager_exists(manager, result_handle);
-
-        surgescript_var_destroy(result);
-        surgescript_var_destroy(key);
-    }
-
+    bool has = (find_key(object, param[0], NULL) >= 0);
     return surgescript_var_set_bool(surgescript_var_create(), has);
 }
 
@@ -302,18 +298,19 @@ surgescript_var_t* fun_iterator(surgescript_object_t* object, const surgescript_
 {
     /* The DictionaryIterator will set up itself */
     surgescript_objectmanager_t* manager = surgescript_object_manager(object);
-    surgescript_objecthandle_t it_handle = surgescript_objectmanager_spawn(manager, surgescript_object_handle(object), "DictionaryIterator", NULL);
+    surgescript_objecthandle_t it_handle = surgescript_objectmanager_spawn_iterator(manager, surgescript_object_handle(object), "DictionaryIterator");
     return surgescript_var_set_objecthandle(surgescript_var_create(), it_handle);
 }
 
 /* toString(): converts to string */
 surgescript_var_t* fun_tostring(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
+    dictionary_t* dict = (dictionary_t*)surgescript_object_userdata(object);
+    surgescript_heap_t* heap = surgescript_object_heap(object);
     surgescript_objectmanager_t* manager = surgescript_object_manager(object);
     surgescript_var_t* stringified_dictionary = surgescript_var_create();
-    surgescript_object_t* iterator = NULL;
     SSARRAY(char, sb); /* string builder */
-    static int depth = 0;
+    static SS_THREADLOCAL int depth = 0;
     bool can_descend = (++depth < 16); /* handle circular links */
 
     /* helper macros */
@@ -347,28 +344,22 @@ surgescript_var_t* fun_tostring(surgescript_object_t* object, const surgescript_
     ssarray_init(sb);
     ssarray_push(sb, '{');
 
-    /* iterate through the Dictionary */
+    /* iterate through the Dictionary (toString() may modify it) */
     do {
-        surgescript_object_t* entry;
         surgescript_var_t* tmp = surgescript_var_create();
-        surgescript_object_call_function(object, "iterator", NULL, 0, tmp),
-        iterator = surgescript_objectmanager_get(manager, surgescript_var_get_objecthandle(tmp));
-        while(surgescript_object_call_function(iterator, "hasNext", NULL, 0, tmp), surgescript_var_get_bool(tmp)) {
-            /* get entry */
-            surgescript_object_call_function(iterator, "next", NULL, 0, tmp);
-            entry = surgescript_objectmanager_get(manager, surgescript_var_get_objecthandle(tmp));
-
+        int i = next_entry(dict, 0);
+        while(i < ssarray_length(dict->entry)) {
             /* add whitespace */
             ssarray_push(sb, ' ');
 
             /* write key */
-            surgescript_object_call_function(entry, "get_key", NULL, 0, tmp);
+            surgescript_var_copy(tmp, surgescript_heap_at(heap, dict->entry[i].key));
             WRITE_ELEMENT(tmp, true);
             ssarray_push(sb, ':');
             ssarray_push(sb, ' ');
 
             /* write value */
-            surgescript_object_call_function(entry, "get_value", NULL, 0, tmp);
+            surgescript_var_copy(tmp, surgescript_heap_at(heap, dict->entry[i].value));
             if(surgescript_var_is_objecthandle(tmp)) {
                 surgescript_objecthandle_t handle = surgescript_var_get_objecthandle(tmp);
                 surgescript_object_t* object = surgescript_objectmanager_get(manager, handle);
@@ -384,7 +375,7 @@ surgescript_var_t* fun_tostring(surgescript_object_t* object, const surgescript_
                 WRITE_ELEMENT(tmp, surgescript_var_is_string(tmp));
 
             /* add separator */
-            if(!(surgescript_object_call_function(iterator, "hasNext", NULL, 0, tmp), surgescript_var_get_bool(tmp))) {
+            if((i = next_entry(dict, i + 1)) >= ssarray_length(dict->entry)) {
                 ssarray_push(sb, ' ');
                 break;
             }
@@ -408,21 +399,17 @@ surgescript_var_t* fun_tostring(surgescript_object_t* object, const surgescript_
 /* keys(): returns an array containing the keys of the dictionary */
 surgescript_var_t* fun_keys(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
+    dictionary_t* dict = (dictionary_t*)surgescript_object_userdata(object);
+    surgescript_heap_t* heap = surgescript_object_heap(object);
     surgescript_objectmanager_t* manager = surgescript_object_manager(object);
     surgescript_objecthandle_t array_handle = surgescript_objectmanager_spawn_array(manager);
     surgescript_object_t* array = surgescript_objectmanager_get(manager, array_handle);
-    surgescript_object_t* iterator = NULL;
     surgescript_var_t* tmp = surgescript_var_create();
     const surgescript_var_t* p[] = { tmp };
 
     /* iterate through the Dictionary */
-    surgescript_object_call_function(object, "iterator", NULL, 0, tmp),
-    iterator = surgescript_objectmanager_get(manager, surgescript_var_get_objecthandle(tmp));
-    while(surgescript_object_call_function(iterator, "hasNext", NULL, 0, tmp), surgescript_var_get_bool(tmp)) {
-        surgescript_object_t* entry = NULL;
-        surgescript_object_call_function(iterator, "next", NULL, 0, tmp);
-        entry = surgescript_objectmanager_get(manager, surgescript_var_get_objecthandle(tmp));
-        surgescript_object_call_function(entry, "get_key", NULL, 0, tmp);
+    for(int i = next_entry(dict, 0); i < ssarray_length(dict->entry); i = next_entry(dict, i + 1)) {
+        surgescript_var_copy(tmp, surgescript_heap_at(heap, dict->entry[i].key));
         surgescript_object_call_function(array, "push", p, 1, NULL);
     }
 
@@ -442,29 +429,38 @@ surgescript_var_t* fun_it_constructor(surgescript_object_t* object, const surges
     surgescript_objectmanager_t* manager = surgescript_object_manager(object);
     surgescript_objecthandle_t parent_handle = surgescript_object_parent(object);
     surgescript_object_t* parent = surgescript_objectmanager_get(manager, parent_handle);
-    surgescript_heap_t* parent_heap = surgescript_object_heap(parent);
-    surgescript_objecthandle_t bst = surgescript_var_get_objecthandle(surgescript_heap_at(parent_heap, DICT_BSTROOT));
     surgescript_objecthandle_t this_handle = surgescript_object_handle(object);
     surgescript_objecthandle_t entry_handle = surgescript_objectmanager_spawn(manager, this_handle, "DictionaryEntry", NULL);
     const char* parent_name = surgescript_object_name(parent);
 
     ssassert(IT_ENTRYREF == surgescript_heap_malloc(heap));
-    ssassert(IT_STACKSIZE == surgescript_heap_malloc(heap)); /* this can't represent 2^24+1 ~ 16.77 M */
-    ssassert(IT_STACKBASE == surgescript_heap_malloc(heap));
+    ssassert(IT_POSITION == surgescript_heap_malloc(heap));
 
     surgescript_var_set_objecthandle(surgescript_heap_at(heap, IT_ENTRYREF), entry_handle);
-    if(surgescript_objectmanager_exists(manager, bst) && 0 == strcmp(parent_name, "Dictionary")) {
-        surgescript_var_set_number(surgescript_heap_at(heap, IT_STACKSIZE), 1.0);
-        surgescript_var_set_objecthandle(surgescript_heap_at(heap, IT_STACKBASE), bst);
-    }
-    else {
-        surgescript_var_set_number(surgescript_heap_at(heap, IT_STACKSIZE), 0.0);
-        surgescript_var_set_objecthandle(surgescript_heap_at(heap, IT_STACKBASE), surgescript_objectmanager_null(manager));
+    surgescript_var_set_number(surgescript_heap_at(heap, IT_POSITION), 0.0);
+
+    /* the iterator is valid only if its parent is a Dictionary */
+    if(0 == strcmp(parent_name, "Dictionary")) {
+        dictionary_t* dict = (dictionary_t*)surgescript_object_userdata(parent);
+        surgescript_object_set_userdata(object, parent);
+        dict->iterators++;
     }
 
     return NULL;
 }
 
+/* destructor(): the positions of the entries of the Dictionary may change when no iterator is alive */
+surgescript_var_t* fun_it_destructor(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+{
+    dictionary_t* dict = iterator_dictionary(object, NULL);
+
+    /* dict is NULL if the Dictionary has been destroyed */
+    if(dict != NULL)
+        dict->iterators--;
+
+    return NULL;
+}
+
 /* "main" state */
 surgescript_var_t* fun_it_main(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
@@ -475,46 +471,28 @@ surgescript_var_t* fun_it_main(surgescript_object_t* object, const surgescript_v
 /* next(): advances the iterator and returns the item previously pointed to by the iterator */
 surgescript_var_t* fun_it_next(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
-    surgescript_heap_t* heap = surgescript_object_heap(object);
-    surgescript_var_t* stacksize = surgescript_heap_at(heap, IT_STACKSIZE);
-    surgescript_objectmanager_t* manager = surgescript_object_manager(object);
+    surgescript_object_t* dictionary = NULL;
+    dictionary_t* dict = iterator_dictionary(object, &dictionary);
 
-    if(surgescript_var_get_number(stacksize) > 0) {
-        surgescript_var_t* stacktop = surgescript_heap_at(heap, IT_STACKBASE + (surgescript_var_get_number(stacksize) - 1));
-        surgescript_object_t* node = surgescript_objectmanager_get(manager, surgescript_var_get_objecthandle(stacktop));
-        surgescript_heap_t* node_heap = surgescript_object_heap(node);
-        surgescript_objecthandle_t left_handle, right_handle;
-        surgescript_var_t* new_top;
-        surgescript_heapptr_t top_ptr;
-        surgescript_objecthandle_t entry_handle = surgescript_var_get_objecthandle(surgescript_heap_at(heap, IT_ENTRYREF));
-        surgescript_object_t* entry = surgescript_objectmanager_get(manager, entry_handle);
-
-        /* pop stacktop */
-        surgescript_var_set_number(stacksize, surgescript_var_get_number(stacksize) - 1);
-
-        /* push right child */
-        right_handle = surgescript_var_get_objecthandle(surgescript_heap_at(node_heap, BST_RIGHT));
-        if(surgescript_objectmanager_exists(manager, right_handle)) {
-            top_ptr = IT_STACKBASE + surgescript_var_get_number(stacksize);
-            new_top = surgescript_heap_at(heap, top_ptr);
-            surgescript_var_set_objecthandle(new_top, right_handle);
-            surgescript_var_set_number(stacksize, surgescript_var_get_number(stacksize) + 1);
-        }
+    if(dict != NULL) {
+        surgescript_heap_t* heap = surgescript_object_heap(object);
+        surgescript_var_t* position = surgescript_heap_at(heap, IT_POSITION);
+        int i = next_entry(dict, surgescript_var_get_number(position));
 
-        /* push left child */
-        left_handle = surgescript_var_get_objecthandle(surgescript_heap_at(node_heap, BST_LEFT));
-        if(surgescript_objectmanager_exists(manager, left_handle)) {
-            top_ptr = IT_STACKBASE + surgescript_var_get_number(stacksize);
-            if(!surgescript_heap_validaddress(heap, top_ptr))
-                ssassert(top_ptr == surgescript_heap_malloc(heap));
-            new_top = surgescript_heap_at(heap, top_ptr);
-            surgescript_var_set_objecthandle(new_top, left_handle);
-            surgescript_var_set_number(stacksize, surgescript_var_get_number(stacksize) + 1);
-        }
+        if(i < ssarray_length(dict->entry)) {
+            surgescript_objectmanager_t* manager = surgescript_object_manager(object);
+            surgescript_objecthandle_t entry_handle = surgescript_var_get_objecthandle(surgescript_heap_at(heap, IT_ENTRYREF));
+            surgescript_object_t* entry = surgescript_objectmanager_get(manager, entry_handle);
+            surgescript_heap_t* entry_heap = surgescript_object_heap(entry);
+            surgescript_heap_t* dictionary_heap = surgescript_object_heap(dictionary);
+
+            /* advance the iterator */
+            surgescript_var_set_number(position, i + 1);
 
-        /* return previously pointed item */
-        /*return fun_bst_getkey(node, NULL, 0);*/
-        return dictentry(entry, node);
+            /* return previously pointed item */
+            surgescript_var_copy(surgescript_heap_at(entry_heap, ENTRY_KEY), surgescript_heap_at(dictionary_heap, dict->entry[i].key));
+            return surgescript_var_set_objecthandle(surgescript_var_create(), entry_handle);
+        }
     }
 
     return NULL;
@@ -523,9 +501,16 @@ surgescript_var_t* fun_it_next(surgescript_object_t* object, const surgescript_v
 /* hasNext(): returns true if the iterator has NOT reached the end of the collection */
 surgescript_var_t* fun_it_hasnext(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
-    surgescript_heap_t* heap = surgescript_object_heap(object);
-    surgescript_var_t* stacksize = surgescript_heap_at(heap, IT_STACKSIZE);
-    return surgescript_var_set_bool(surgescript_var_create(), surgescript_var_get_number(stacksize) > 0);
+    dictionary_t* dict = iterator_dictionary(object, NULL);
+    bool has_next = false;
+
+    if(dict != NULL) {
+        surgescript_heap_t* heap = surgescript_object_heap(object);
+        int position = surgescript_var_get_number(surgescript_heap_at(heap, IT_POSITION));
+        has_next = next_entry(dict, position) < ssarray_length(dict->entry);
+    }
+
+    return surgescript_var_set_bool(surgescript_var_create(), has_next);
 }
 
 /* toString(): converts to string */
@@ -536,13 +521,22 @@ surgescript_var_t* fun_it_tostring(surgescript_object_t* object, const surgescri
 
 
 /* --- DictionaryEntry functions --- */
+
+/* A DictionaryEntry stores a key; its value is looked up in the Dictionary that spawned its iterator */
+
 surgescript_var_t* fun_entry_constructor(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
     surgescript_heap_t* heap = surgescript_object_heap(object);
     surgescript_objectmanager_t* manager = surgescript_object_manager(object);
-    surgescript_objecthandle_t null_handle = surgescript_objectmanager_null(manager);
-    ssassert(ENTRY_BSTREF == surgescript_heap_malloc(heap));
-    surgescript_var_set_objecthandle(surgescript_heap_at(heap, ENTRY_BSTREF), null_handle);
+    surgescript_object_t* parent = surgescript_objectmanager_get(manager, surgescript_object_parent(object));
+
+    ssassert(ENTRY_KEY == surgescript_heap_malloc(heap));
+    surgescript_var_set_string(surgescript_heap_at(heap, ENTRY_KEY), "");
+
+    /* the entry is valid only if its parent is a DictionaryIterator */
+    if(0 == strcmp(surgescript_object_name(parent), "DictionaryIterator"))
+        surgescript_object_set_userdata(object, parent);
+
     return NULL;
 }
 
@@ -554,32 +548,42 @@ surgescript_var_t* fun_entry_main(surgescript_object_t* object, const surgescrip
 surgescript_var_t* fun_entry_getkey(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
     surgescript_heap_t* heap = surgescript_object_heap(object);
-    surgescript_objectmanager_t* manager = surgescript_object_manager(object);
-    surgescript_objecthandle_t entry_handle = surgescript_var_get_objecthandle(surgescript_heap_at(heap, ENTRY_BSTREF));
-    surgescript_object_t* entry = surgescript_objectmanager_get(manager, entry_handle);
-
-    return fun_bst_getkey(entry, NULL, 0);
+    return surgescript_var_clone(surgescript_heap_at(heap, ENTRY_KEY));
 }
 
 surgescript_var_t* fun_entry_getvalue(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
     surgescript_heap_t* heap = surgescript_object_heap(object);
-    surgescript_objectmanager_t* manager = surgescript_object_manager(object);
-    surgescript_objecthandle_t entry_handle = surgescript_var_get_objecthandle(surgescript_heap_at(heap, ENTRY_BSTREF));
-    surgescript_object_t* entry = surgescript_objectmanager_get(manager, entry_handle);
+    surgescript_object_t* iterator = (surgescript_object_t*)surgescript_object_userdata(object);
+    surgescript_object_t* dictionary = NULL;
 
-    return fun_bst_getvalue(entry, NULL, 0);
+    if(iterator != NULL && iterator_dictionary(iterator, &dictionary) != NULL) {
+        const surgescript_var_t* p[] = { surgescript_heap_at(heap, ENTRY_KEY) };
+        return fun_get(dictionary, p, 1);
+    }
+
+    return NULL;
 }
 
 surgescript_var_t* fun_entry_setvalue(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
     surgescript_heap_t* heap = surgescript_object_heap(object);
-    surgescript_objectmanager_t* manager = surgescript_object_manager(object);
-    surgescript_objecthandle_t entry_handle = surgescript_var_get_objecthandle(surgescript_heap_at(heap, ENTRY_BSTREF));
-    surgescript_object_t* entry = surgescript_objectmanager_get(manager, entry_handle);
-    const surgescript_var_t* p[] = { param[0] };
+    surgescript_object_t* iterator = (surgescript_object_t*)surgescript_object_userdata(object);
+    surgescript_object_t* dictionary = NULL;
+    dictionary_t* dict = (iterator != NULL) ? iterator_dictionary(iterator, &dictionary) : NULL;
+
+    /* entries that have been deleted are not brought back */
+    if(dict != NULL) {
+        int i = find_key(dictionary, surgescript_heap_at(heap, ENTRY_KEY), NULL);
+        if(i >= 0) {
+            surgescript_heap_t* dictionary_heap = surgescript_object_heap(dictionary);
+            surgescript_var_copy(surgescript_heap_at(dictionary_heap, dict->entry[i].value), param[0]);
+            if(surgescript_var_is_objecthandle(param[0]))
+                surgescript_objectmanager_write_barrier(surgescript_object_manager(object), dictionary);
+        }
+    }
 
-    return fun_bst_setvalue(entry, p, 1);
+    return NULL;
 }
 
 surgescript_var_t* fun_entry_tostring(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
@@ -588,282 +592,148 @@ surgescript_var_t* fun_entry_tostring(surgescript_object_t* object, const surges
 }
 
 
-/* --- BSTNode functions --- */
-
-/* constructor: initialize data */
-surgescript_var_t* fun_bst_constructor(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
-{
-    surgescript_heap_t* heap = surgescript_object_heap(object);
-    surgescript_objectmanager_t* manager = surgescript_object_manager(object);
-    surgescript_objecthandle_t null_handle = surgescript_objectmanager_null(manager);
 
-    ssassert(BST_KEY == surgescript_heap_malloc(heap));
-    ssassert(BST_VALUE == surgescript_heap_malloc(heap));
-    ssassert(BST_LEFT == surgescript_heap_malloc(heap));
-    ssassert(BST_RIGHT == surgescript_heap_malloc(heap));
-
-    surgescript_var_set_string(surgescript_heap_at(heap, BST_KEY), "[undefined]");
-    surgescript_var_set_null(surgescript_heap_at(heap, BST_VALUE));
-    surgescript_var_set_objecthandle(surgescript_heap_at(heap, BST_LEFT), null_handle);
-    surgescript_var_set_objecthandle(surgescript_heap_at(heap, BST_RIGHT), null_handle);
-
-    return NULL;
-}
+/* --- Utilities --- */
 
-/* main state */
-surgescript_var_t* fun_bst_main(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+/* transforms ssvar into a string; returns ssvar */
+surgescript_var_t* sanitize_key(surgescript_var_t* ssvar, const surgescript_objectmanager_t* manager)
 {
-    surgescript_object_set_active(object, false); /* optimization; we shouldn't spend time updating this object */
-    return NULL;
+    char* buf = surgescript_var_get_string(ssvar, manager);
+    surgescript_var_set_string(ssvar, buf);
+    ssfree(buf);
+    return ssvar;
 }
 
-/* get the key */
-surgescript_var_t* fun_bst_getkey(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+/* creates an empty hash table */
+dictionary_t* create_dictionary()
 {
-    surgescript_heap_t* heap = surgescript_object_heap(object);
-    return surgescript_var_clone(surgescript_heap_at(heap, BST_KEY));
-}
+    dictionary_t* dict = ssmalloc(sizeof *dict);
 
-/* get the value */
-surgescript_var_t* fun_bst_getvalue(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
-{
-    surgescript_heap_t* heap = surgescript_object_heap(object);
-    return surgescript_var_clone(surgescript_heap_at(heap, BST_VALUE));
-}
+    ssarray_init(dict->entry);
+    dict->index = NULL;
+    dict->capacity = 0;
+    dict->used = 0;
+    dict->count = 0;
+    dict->iterators = 0;
+    rebuild_index(dict, MIN_CAPACITY);
 
-/* get the left node */
-surgescript_var_t* fun_bst_getleft(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
-{
-    surgescript_heap_t* heap = surgescript_object_heap(object);
-    return surgescript_var_clone(surgescript_heap_at(heap, BST_LEFT));
+    return dict;
 }
 
-/* get the right node */
-surgescript_var_t* fun_bst_getright(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+/* destroys a hash table (the heap cells are released with the heap) */
+dictionary_t* destroy_dictionary(dictionary_t* dict)
 {
-    surgescript_heap_t* heap = surgescript_object_heap(object);
-    return surgescript_var_clone(surgescript_heap_at(heap, BST_RIGHT));
-}
+    if(dict != NULL) {
+        ssfree(dict->index);
+        ssarray_release(dict->entry);
+        ssfree(dict);
+    }
 
-/* set the value; param[0] can be of any type */
-surgescript_var_t* fun_bst_setvalue(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
-{
-    surgescript_heap_t* heap = surgescript_object_heap(object);
-    surgescript_var_copy(surgescript_heap_at(heap, BST_VALUE), param[0]);
     return NULL;
 }
 
-/* count the number of nodes */
-surgescript_var_t* fun_bst_count(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
-{
-    surgescript_objectmanager_t* manager = surgescript_object_manager(object);
-    return surgescript_var_set_number(surgescript_var_create(), bst_count(manager, object));
-}
-
-/* finds a node having a given key, param[0] */
-surgescript_var_t* fun_bst_find(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+/* finds the position of a (sanitized) key in entry[], or -1 if there is no such key.
+   If slot isn't NULL, it receives the slot of index[] that refers (or may refer) to the key */
+int find_entry(const dictionary_t* dict, const surgescript_heap_t* heap, const surgescript_var_t* key, uint32_t hash, int* slot)
 {
-    surgescript_heap_t* heap = surgescript_object_heap(object);
-    surgescript_objectmanager_t* manager = surgescript_object_manager(object);
-    surgescript_objecthandle_t left_handle = surgescript_var_get_objecthandle(surgescript_heap_at(heap, BST_LEFT));
-    surgescript_objecthandle_t right_handle = surgescript_var_get_objecthandle(surgescript_heap_at(heap, BST_RIGHT));
-    const char* key = surgescript_var_fast_get_string(surgescript_heap_at(heap, BST_KEY));
-    const char* search_key = surgescript_var_fast_get_string(param[0]);
-    int cmp = strcmp(search_key, key);
+    const char* str = surgescript_var_fast_get_string(key);
+    int mask = dict->capacity - 1, free_slot = -1;
 
-    if(cmp == 0) /* found it */
-        return surgescript_var_set_objecthandle(surgescript_var_create(), surgescript_object_handle(object));
-    else if(cmp < 0 && surgescript_objectmanager_exists(manager, left_handle)) /* maybe it's on the left */
-        return fun_bst_find(surgescript_objectmanager_get(manager, left_handle), param, num_params);
-    else if(cmp > 0 && surgescript_objectmanager_exists(manager, right_handle)) /* maybe it's on the right */
-        return fun_bst_find(surgescript_objectmanager_get(manager, right_handle), param, num_params);
-    else /* key not found */
-        return surgescript_var_set_objecthandle(surgescript_var_create(), surgescript_objectmanager_null(manager));
-}
-
-/* inserts a (key, value) pair into the BST and returns the new BSTNode; key = param[0] must be a string, value = param[1] can be of any type */
-surgescript_var_t* fun_bst_insert(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
-{
-    surgescript_heap_t* heap = surgescript_object_heap(object);
-    surgescript_objectmanager_t* manager = surgescript_object_manager(object);
-    surgescript_objecthandle_t left_handle = surgescript_var_get_objecthandle(surgescript_heap_at(heap, BST_LEFT));
-    surgescript_objecthandle_t right_handle = surgescript_var_get_objecthandle(surgescript_heap_at(heap, BST_RIGHT));
-    const char* key = surgescript_var_fast_get_string(surgescript_heap_at(heap, BST_KEY));
-    const char* new_key = surgescript_var_fast_get_string(param[0]); /* thus param[0] must be a string */
-    int cmp = strcmp(new_key, key);
-
-    if(cmp == 0) {
-        /* the key was already in the BST */
-        surgescript_var_copy(surgescript_heap_at(heap, BST_VALUE), param[1]);
-        return surgescript_var_set_objecthandle(surgescript_var_create(), surgescript_object_handle(object));
-    }
-    else if(cmp < 0) {
-        if(!surgescript_objectmanager_exists(manager, left_handle)) {
-            /* insert on the left */
-            surgescript_objecthandle_t new_node = new_bst_node(object, param[0], param[1]);
-            surgescript_var_set_objecthandle(surgescript_heap_at(heap, BST_LEFT), new_node);
-            return surgescript_var_set_objecthandle(surgescript_var_create(), new_node);
+    /* linear probing; the table always has an empty slot */
+    for(int s = hash & mask; ; s = (s + 1) & mask) {
+        int i = dict->index[s];
+        if(i == EMPTY_SLOT) {
+            if(slot != NULL)
+                *slot = (free_slot >= 0) ? free_slot : s;
+            return -1;
         }
-        else
-            return fun_bst_insert(surgescript_objectmanager_get(manager, left_handle), param, num_params);
-    }
-    else {
-        if(!surgescript_objectmanager_exists(manager, right_handle)) {
-            /* insert on the right */
-            surgescript_objecthandle_t new_node = new_bst_node(object, param[0], param[1]);
-            surgescript_var_set_objecthandle(surgescript_heap_at(heap, BST_RIGHT), new_node);
-            return surgescript_var_set_objecthandle(surgescript_var_create(), new_node);
+        else if(i == DELETED_SLOT) {
+            if(free_slot < 0)
+                free_slot = s;
+        }
+        else if(dict->entry[i].hash == hash && 0 == strcmp(str, surgescript_var_fast_get_string(surgescript_heap_at(heap, dict->entry[i].key)))) {
+            if(slot != NULL)
+                *slot = s;
+            return i;
         }
-        else
-            return fun_bst_insert(surgescript_objectmanager_get(manager, right_handle), param, num_params);
     }
 }
 
-/* removes an entry (key = param[0]) from the BST, and returns the root of the modified BST */
-surgescript_var_t* fun_bst_remove(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+/* finds the position of a key of any type in entry[], or -1 if there is no such key */
+int find_key(const surgescript_object_t* object, const surgescript_var_t* key, int* slot)
 {
-    const surgescript_objectmanager_t* manager = surgescript_object_manager(object);
-    char* key = surgescript_var_get_string(param[0], manager);
-    surgescript_var_t* new_root = bst_remove(object, key, 0);
-    ssfree(key);
-    return new_root;
-}
-
-
+    const dictionary_t* dict = (const dictionary_t*)surgescript_object_userdata(object);
+    const surgescript_heap_t* heap = surgescript_object_heap(object);
+    int i;
 
-/* --- Utilities --- */
+    if(!surgescript_var_is_string(key)) {
+        const surgescript_objectmanager_t* manager = surgescript_object_manager(object);
+        surgescript_var_t* sanitized_key = sanitize_key(surgescript_var_clone(key), manager);
+        i = find_entry(dict, heap, sanitized_key, surgescript_var_fast_get_string_hash(sanitized_key), slot);
+        surgescript_var_destroy(sanitized_key);
+    }
+    else
+        i = find_entry(dict, heap, key, surgescript_var_fast_get_string_hash(key), slot);
 
-/* transforms ssvar into a string; returns ssvar */
-surgescript_var_t* sanitize_key(surgescript_var_t* ssvar, const surgescript_objectmanager_t* manager)
-{
-    char* buf = surgescript_var_get_string(ssvar, manager);
-    surgescript_var_set_string(ssvar, buf);
-    ssfree(buf);
-    return ssvar;
+    return i;
 }
 
-/* spawns a new BSTNode */
-surgescript_objecthandle_t new_bst_node(const surgescript_object_t* parent, const surgescript_var_t* key, const surgescript_var_t* value)
+/* the first entry that hasn't been deleted at or after the given position */
+int next_entry(const dictionary_t* dict, int position)
 {
-    surgescript_objectmanager_t* manager = surgescript_object_manager(parent);
-    surgescript_objecthandle_t null_handle = surgescript_objectmanager_null(manager);
-    surgescript_objecthandle_t new_node = surgescript_objectmanager_spawn(manager, surgescript_object_handle(parent), "BSTNode", NULL);
-    surgescript_object_t* new_obj = surgescript_objectmanager_get(manager, new_node);
-    surgescript_heap_t* heap = surgescript_object_heap(new_obj);
+    int length = ssarray_length(dict->entry);
 
-    surgescript_var_copy(surgescript_heap_at(heap, BST_KEY), key); /* key must be a string */
-    surgescript_var_copy(surgescript_heap_at(heap, BST_VALUE), value); /* value can be of any type */
-    surgescript_var_set_objecthandle(surgescript_heap_at(heap, BST_LEFT), null_handle);
-    surgescript_var_set_objecthandle(surgescript_heap_at(heap, BST_RIGHT), null_handle);
-
-    return new_node;
-}
-
-/* counts the number of nodes in a BST */
-int bst_count(const surgescript_objectmanager_t* manager, const surgescript_object_t* object)
-{
-    surgescript_heap_t* heap = surgescript_object_heap(object);
-    surgescript_objecthandle_t left_handle = surgescript_var_get_objecthandle(surgescript_heap_at(heap, BST_LEFT));
-    surgescript_objecthandle_t right_handle = surgescript_var_get_objecthandle(surgescript_heap_at(heap, BST_RIGHT));
-    int count = 1;
+    if(position < 0)
+        position = 0;
 
-    if(surgescript_objectmanager_exists(manager, left_handle))
-        count += bst_count(manager, surgescript_objectmanager_get(manager, left_handle));
-    if(surgescript_objectmanager_exists(manager, right_handle))
-        count += bst_count(manager, surgescript_objectmanager_get(manager, right_handle));
+    while(position < length && dict->entry[position].deleted)
+        position++;
 
-    return count;
+    return position < length ? position : length;
 }
 
-/* removes the root of the BST and returns a handle to the new root. Performs any required modifications. */
-surgescript_var_t* bst_removeroot(surgescript_object_t* object)
+/* rebuilds the index with the given capacity (a power of two). The deleted
+   entries are removed from entry[] only if no iterator refers to its positions */
+void rebuild_index(dictionary_t* dict, int capacity)
 {
-    surgescript_heap_t* heap = surgescript_object_heap(object);
-    surgescript_objectmanager_t* manager = surgescript_object_manager(object);
-    surgescript_objecthandle_t left_handle = surgescript_var_get_objecthandle(surgescript_heap_at(heap, BST_LEFT));
-
-    if(!surgescript_objectmanager_exists(manager, left_handle)) {
-        surgescript_objecthandle_t right_handle = surgescript_var_get_objecthandle(surgescript_heap_at(heap, BST_RIGHT));
-        surgescript_object_kill(object);
-        return surgescript_var_set_objecthandle(surgescript_var_create(), right_handle);
-    }
-    else {
-        surgescript_object_t* node = object;
-        surgescript_heap_t* node_heap = heap;
-        surgescript_objecthandle_t child_handle = left_handle;
-        surgescript_object_t* child = surgescript_objectmanager_get(manager, child_handle);
-        surgescript_heap_t* child_heap = surgescript_object_heap(child);
-        surgescript_objecthandle_t grand_child = surgescript_var_get_objecthandle(surgescript_heap_at(child_heap, BST_RIGHT));
-
-        /* the right-most guy (that is to the left of the root) will be the new root */
-        while(surgescript_objectmanager_exists(manager, grand_child)) {
-            node = child;
-            node_heap = surgescript_object_heap(node);
-            child_handle = grand_child;
-            child = surgescript_objectmanager_get(manager, child_handle);
-            child_heap = surgescript_object_heap(child);
-            grand_child = surgescript_var_get_objecthandle(surgescript_heap_at(child_heap, BST_RIGHT));
-        }
+    int length = ssarray_length(dict->entry);
 
-        if(node != object) {
-            surgescript_var_copy(surgescript_heap_at(node_heap, BST_RIGHT), surgescript_heap_at(child_heap, BST_LEFT));
-            surgescript_var_copy(surgescript_heap_at(child_heap, BST_LEFT), surgescript_heap_at(heap, BST_LEFT));
-            surgescript_var_copy(surgescript_heap_at(child_heap, BST_RIGHT), surgescript_heap_at(heap, BST_RIGHT));
+    /* compact entry[] */
+    if(dict->iterators == 0) {
+        length = 0;
+        for(int i = 0; i < ssarray_length(dict->entry); i++) {
+            if(!dict->entry[i].deleted)
+                dict->entry[length++] = dict->entry[i];
         }
-        else
-            surgescript_var_copy(surgescript_heap_at(child_heap, BST_RIGHT), surgescript_heap_at(heap, BST_RIGHT));
-
-        surgescript_object_kill(object);
-        return surgescript_var_set_objecthandle(surgescript_var_create(), child_handle);
+        ssarray_truncate(dict->entry, length);
+        ssassert(length == dict->count);
     }
-}
-
-
-
-/* removes a node from the BST; returns the root of the modified BST or NULL if the key isn't found */
-surgescript_var_t* bst_remove(surgescript_object_t* object, const char* param_key, int depth)
-{
-    surgescript_heap_t* heap = surgescript_object_heap(object);
-    surgescript_objectmanager_t* manager = surgescript_object_manager(object);
-    surgescript_objecthandle_t left_handle = surgescript_var_get_objecthandle(surgescript_heap_at(heap, BST_LEFT));
-    surgescript_objecthandle_t right_handle = surgescript_var_get_objecthandle(surgescript_heap_at(heap, BST_RIGHT));
-    const char* key = surgescript_var_fast_get_string(surgescript_heap_at(heap, BST_KEY));
-    int cmp = strcmp(param_key, key);
 
-    /*printf("bst_remove(%s, %s) d=%d e cmp=%d\n", param_key, key, depth, cmp);*/
-
-    if(cmp == 0) {
-        surgescript_var_t* new_root = bst_removeroot(object);
-        return new_root;
+    /* rebuild index[] */
+    if(capacity != dict->capacity) {
+        dict->index = ssrealloc(dict->index, capacity * sizeof(*(dict->index)));
+        dict->capacity = capacity;
     }
-    else if((cmp < 0 && surgescript_objectmanager_exists(manager, left_handle)) || (cmp > 0 && surgescript_objectmanager_exists(manager, right_handle))) {
-        surgescript_objecthandle_t child_handle = (cmp < 0) ? left_handle : right_handle;
-        surgescript_object_t* child = surgescript_objectmanager_get(manager, child_handle);
-        surgescript_heap_t* child_heap = surgescript_object_heap(child);
-        const char* child_key = surgescript_var_fast_get_string(surgescript_heap_at(child_heap, BST_KEY));
-
-        if(0 == strcmp(param_key, child_key)) {
-            /*surgescript_var_t* new_root = bst_remove(child, param_key, depth + 1);*/
-            surgescript_var_t* new_root = bst_removeroot(child);
-            surgescript_var_copy(surgescript_heap_at(heap, (cmp < 0) ? BST_LEFT : BST_RIGHT), new_root);
-            surgescript_var_destroy(new_root);
-        }
-        else {
-            surgescript_var_t* new_root = bst_remove(child, param_key, depth + 1);
-            if(new_root != NULL)
-                surgescript_var_destroy(new_root);
-        }
-
-        return surgescript_var_set_objecthandle(surgescript_var_create(), surgescript_object_handle(object)); /* return myself */
+    for(int s = 0; s < capacity; s++)
+        dict->index[s] = EMPTY_SLOT;
+    for(int i = 0; i < length; i++) {
+        int s = dict->entry[i].hash & (capacity - 1);
+        if(dict->entry[i].deleted)
+            continue;
+        while(dict->index[s] != EMPTY_SLOT)
+            s = (s + 1) & (capacity - 1);
+        dict->index[s] = i;
     }
-    else
-        return NULL; /* key not found */
+    dict->used = dict->count;
 }
 
-/* given a DictionaryEntry, set its BST Node Reference and return a new variable with the handle to the entry */
-surgescript_var_t* dictentry(surgescript_object_t* entry, const surgescript_object_t* bst)
+/* the hash table of the Dictionary that spawned the given iterator, or NULL if there is no such Dictionary */
+dictionary_t* iterator_dictionary(const surgescript_object_t* iterator, surgescript_object_t** dictionary)
 {
-    surgescript_heap_t* heap = surgescript_object_heap(entry);
-    surgescript_var_set_objecthandle(surgescript_heap_at(heap, ENTRY_BSTREF), surgescript_object_handle(bst));
-    return surgescript_var_set_objecthandle(surgescript_var_create(), surgescript_object_handle(entry));
+    surgescript_object_t* parent = (surgescript_object_t*)surgescript_object_userdata(iterator);
+
+    if(dictionary != NULL)
+        *dictionary = parent;
+
+    return parent != NULL ? (dictionary_t*)surgescript_object_userdata(parent) : NULL;
 }
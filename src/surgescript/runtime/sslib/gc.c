@@ -36,6 +36,10 @@ static surgescript_var_t* fun_collect(surgescript_object_t* object, const surges
 static surgescript_var_t* fun_setinterval(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
 static surgescript_var_t* fun_getinterval(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
 static surgescript_var_t* fun_getobjectcount(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
+static surgescript_var_t* fun_getbudget(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
+static surgescript_var_t* fun_setbudget(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
+static surgescript_var_t* fun_getscancount(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
+static surgescript_var_t* fun_getpausehistogram(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
 static const surgescript_heapptr_t INTERVAL_ADDR = 0;
 static const surgescript_heapptr_t LASTCOLLECT_ADDR = 1;
 
@@ -53,6 +57,10 @@ void surgescript_sslib_register_gc(surgescript_vm_t* vm)
     surgescript_vm_bind(vm, "__GC", "get_interval", fun_getinterval, 0);
     surgescript_vm_bind(vm, "__GC", "set_interval", fun_setinterval, 1);
     surgescript_vm_bind(vm, "__GC", "get_objectCount", fun_getobjectcount, 0);
+    surgescript_vm_bind(vm, "__GC", "get_budget", fun_getbudget, 0);
+    surgescript_vm_bind(vm, "__GC", "set_budget", fun_setbudget, 1);
+    surgescript_vm_bind(vm, "__GC", "get_scanCount", fun_getscancount, 0);
+    surgescript_vm_bind(vm, "__GC", "get_pauseHistogram", fun_getpausehistogram, 0);
 }
 
 
@@ -83,11 +91,10 @@ surgescript_var_t* fun_main(surgescript_object_t* object, const surgescript_var_
     double last_collect = surgescript_var_get_number(surgescript_heap_at(heap, LASTCOLLECT_ADDR));
     double now = surgescript_util_gettickcount() * 0.001;
 
-    surgescript_objectmanager_garbagecheck(manager);
-    if(now - last_collect >= interval) {
-        surgescript_object_call_function(object, "collect", NULL, 0, NULL);
+    /* the unreachable objects are disposed at most once every interval
+       seconds, as soon as the (incremental) marking is over */
+    if(surgescript_objectmanager_garbagestep(manager, now - last_collect >= interval))
         surgescript_var_set_number(surgescript_heap_at(heap, LASTCOLLECT_ADDR), now);
-    }
 
     return NULL;
 }
@@ -110,7 +117,7 @@ surgescript_var_t* fun_destroy(surgescript_object_t* object, const surgescript_v
 surgescript_var_t* fun_collect(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
     surgescript_objectmanager_t* manager = surgescript_object_manager(object);
-    surgescript_objectmanager_garbagecollect(manager);
+    surgescript_objectmanager_fullgarbagecollect(manager);
     return NULL;
 }
 
@@ -136,4 +143,46 @@ surgescript_var_t* fun_getobjectcount(surgescript_object_t* object, const surges
     surgescript_objectmanager_t* manager = surgescript_object_manager(object);
     int count = surgescript_objectmanager_garbagecount(manager);
     return surgescript_var_set_number(surgescript_var_create(), count);
-}
\ No newline at end of file
+}
+
+/* get the time budget of the GC per frame (in milliseconds) */
+surgescript_var_t* fun_getbudget(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+{
+    surgescript_objectmanager_t* manager = surgescript_object_manager(object);
+    int budget = surgescript_objectmanager_garbagebudget(manager);
+    return surgescript_var_set_number(surgescript_var_create(), budget * 0.001);
+}
+
+/* set the time budget of the GC per frame (in milliseconds) */
+surgescript_var_t* fun_setbudget(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+{
+    surgescript_objectmanager_t* manager = surgescript_object_manager(object);
+    double budget = ssclamp(surgescript_var_get_number(param[0]), 0.0, 1000.0);
+    surgescript_objectmanager_set_garbagebudget(manager, (int)(budget * 1000.0));
+    return NULL;
+}
+
+/* returns the number of objects scanned in the last cycle of the GC */
+surgescript_var_t* fun_getscancount(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+{
+    surgescript_objectmanager_t* manager = surgescript_object_manager(object);
+    int count = surgescript_objectmanager_garbagescancount(manager);
+    return surgescript_var_set_number(surgescript_var_create(), count);
+}
+
+/* returns a new Array with the pause time histogram of the GC */
+surgescript_var_t* fun_getpausehistogram(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+{
+    surgescript_objectmanager_t* manager = surgescript_object_manager(object);
+    surgescript_objecthandle_t array_handle = surgescript_objectmanager_spawn_array(manager);
+    surgescript_object_t* array = surgescript_objectmanager_get(manager, array_handle);
+    surgescript_var_t* count = surgescript_var_create();
+
+    for(int i = 0; i < SURGESCRIPT_OBJECTMANAGER_PAUSE_BUCKETS; i++) {
+        const surgescript_var_t* args[] = { surgescript_var_set_number(count, surgescript_objectmanager_garbagepausecount(manager, i)) };
+        surgescript_object_call_function(array, "push", args, 1, NULL);
+    }
+
+    surgescript_var_destroy(count);
+    return surgescript_var_set_objecthandle(surgescript_var_create(), array_handle);
+}
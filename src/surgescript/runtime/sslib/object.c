@@ -20,6 +20,7 @@
  */
 
 #include <ctype.h>
+#include <limits.h>
 #include <string.h>
 #include "../vm.h"
 #include "../object.h"
@@ -38,6 +39,7 @@ static surgescript_var_t* fun_childrenwithtag(surgescript_object_t* object, cons
 static surgescript_var_t* fun_childcount(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
 static surgescript_var_t* fun_sibling(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
 static surgescript_var_t* fun_spawn(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
+static surgescript_var_t* fun_spawnmany(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
 static surgescript_var_t* fun_destroy(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
 static surgescript_var_t* fun_tostring(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
 static surgescript_var_t* fun_equals(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
@@ -73,6 +75,7 @@ static inline bool can_spawn_object(const char* object_name, surgescript_objectm
 void surgescript_sslib_register_object(surgescript_vm_t* vm)
 {
     surgescript_vm_bind(vm, "Object", "spawn", fun_spawn, 1);
+    surgescript_vm_bind(vm, "Object", "spawnMany", fun_spawnmany, 2);
     surgescript_vm_bind(vm, "Object", "destroy", fun_destroy, 0);
     surgescript_vm_bind(vm, "Object", "get_parent", fun_parent, 0);
     surgescript_vm_bind(vm, "Object", "child", fun_child, 1);
@@ -232,6 +235,46 @@ surgescript_var_t* fun_spawn(surgescript_object_t* object, const surgescript_var
     }
 }
 
+/* spawns param[1] children named param[0], returning a new array */
+surgescript_var_t* fun_spawnmany(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+{
+    const char* child_name = surgescript_var_fast_get_string(param[0]);
+    double requested_count = surgescript_var_get_number(param[1]);
+    surgescript_objectmanager_t* manager = surgescript_object_manager(object);
+
+    /* validate the count (NaN fails the test) */
+    if(!(requested_count >= 0.0 && requested_count <= (double)(INT_MAX / sizeof(surgescript_objecthandle_t)))) {
+        const char* object_name = surgescript_object_name(object);
+        ssfatal("Runtime Error: object \"%s\" can't spawn %g objects named \"%s\".", object_name, requested_count, child_name);
+        return NULL;
+    }
+
+    if(can_spawn_object(child_name, manager)) {
+        int count = (int)requested_count;
+        surgescript_objecthandle_t me = surgescript_object_handle(object);
+        surgescript_objecthandle_t* child = ssmalloc(ssmax(count, 1) * sizeof(*child));
+        surgescript_objecthandle_t array_handle;
+        surgescript_object_t* array;
+
+        /* spawn the children and store them in a new array */
+        surgescript_objectmanager_spawn_batch(manager, me, child_name, count, child);
+        array_handle = surgescript_objectmanager_spawn_array(manager);
+        array = surgescript_objectmanager_get(manager, array_handle);
+        for(int i = 0; i < count; i++) {
+            if(surgescript_objectmanager_exists(manager, child[i]))
+                add_to_array(child[i], array);
+        }
+
+        ssfree(child);
+        return surgescript_var_set_objecthandle(surgescript_var_create(), array_handle);
+    }
+    else {
+        const char* object_name = surgescript_object_name(object);
+        ssfatal("Runtime Error: object \"%s\" can't spawn \"%s\".", object_name, child_name);
+        return NULL;
+    }
+}
+
 /* destroys the object */
 surgescript_var_t* fun_destroy(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
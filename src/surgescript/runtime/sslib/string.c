@@ -101,26 +101,24 @@ surgescript_var_t* fun_spawn(surgescript_object_t* object, const surgescript_var
 /* returns my primitive */
 surgescript_var_t* fun_valueof(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
-    const char* str = surgescript_var_fast_get_string(param[0]); /* param[0] can be assumed to be a string, for sure */
-    surgescript_var_t* ret = surgescript_var_set_string(surgescript_var_create(), str);
-    return ret;
+    /* param[0] can be assumed to be a string, for sure */
+    return surgescript_var_clone(param[0]); /* strings are shared */
 }
 
 /* converts to string */
 surgescript_var_t* fun_tostring(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
-    const char* str = surgescript_var_fast_get_string(param[0]);
-    surgescript_var_t* ret = surgescript_var_set_string(surgescript_var_create(), str);
-    return ret;
+    return surgescript_var_clone(param[0]);
 }
 
 /* equals() method */
 surgescript_var_t* fun_equals(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
     if(surgescript_var_typecode(param[0]) == surgescript_var_typecode(param[1])) {
-        const char* a = surgescript_var_fast_get_string(param[0]); /* can be assumed to be a string, for sure */
-        const char* b = surgescript_var_fast_get_string(param[1]); /* it's a string, since param[0] is a string */
-        return surgescript_var_set_bool(surgescript_var_create(), strcmp(a, b) == 0);
+        /* param[0] can be assumed to be a string, for sure; so is param[1] */
+        bool equal = surgescript_var_fast_get_string_length(param[0]) == surgescript_var_fast_get_string_length(param[1]) &&
+                     surgescript_var_compare(param[0], param[1]) == 0;
+        return surgescript_var_set_bool(surgescript_var_create(), equal);
     }
     else
         return surgescript_var_set_bool(surgescript_var_create(), false);
@@ -140,7 +138,8 @@ surgescript_var_t* fun_call(surgescript_object_t* object, const surgescript_var_
 surgescript_var_t* fun_getlength(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
     const char* str = surgescript_var_fast_get_string(param[0]);
-    return surgescript_var_set_number(surgescript_var_create(), u8_strlen(str));
+    size_t length = surgescript_var_fast_is_ascii(param[0]) ? surgescript_var_fast_get_string_length(param[0]) : u8_strlen(str);
+    return surgescript_var_set_number(surgescript_var_create(), length);
 }
 
 /* character at */
@@ -150,7 +149,11 @@ surgescript_var_t* fun_get(surgescript_object_t* object, const surgescript_var_t
     int index = (int)surgescript_var_get_number(param[1]);
     char chr[7] = { 0 };
 
-    if(index >= 0 && index < u8_strlen(str)) {
+    if(surgescript_var_fast_is_ascii(param[0])) {
+        if(index >= 0 && index < surgescript_var_fast_get_string_length(param[0]))
+            chr[0] = str[index];
+    }
+    else if(index >= 0 && index < u8_strlen(str)) {
         size_t offset = u8_offset(str, index);
         size_t seq_len = u8_seqlen(str + offset);
         for(int i = 0; i < sizeof(chr) - 1 && seq_len--; i++)
@@ -174,7 +177,8 @@ surgescript_var_t* fun_indexof(surgescript_object_t* object, const surgescript_v
     const char* haystack = surgescript_var_fast_get_string(param[0]);
     char* needle = surgescript_var_get_string(param[1], manager);
     char* occurrence = strstr(haystack, needle);
-    int indexof = occurrence ? u8_charnum((char*)haystack, occurrence - haystack) : -1; /* all SurgeScript strings are UTF-8 encoded */
+    int indexof = !occurrence ? -1 : (surgescript_var_fast_is_ascii(param[0]) ? occurrence - haystack :
+        u8_charnum((char*)haystack, occurrence - haystack)); /* all SurgeScript strings are UTF-8 encoded */
     ssfree(needle);
     return surgescript_var_set_number(surgescript_var_create(), indexof);
 }
@@ -186,7 +190,8 @@ surgescript_var_t* fun_substr(surgescript_object_t* object, const surgescript_va
     int start = surgescript_var_get_number(param[1]);
     int length = surgescript_var_get_number(param[2]);
     surgescript_var_t* var = surgescript_var_create();
-    size_t utf8len = u8_strlen(str);
+    bool ascii = surgescript_var_fast_is_ascii(param[0]);
+    size_t utf8len = ascii ? surgescript_var_fast_get_string_length(param[0]) : u8_strlen(str);
     char* substr;
 
     /* sanity check */
@@ -197,8 +202,8 @@ surgescript_var_t* fun_substr(surgescript_object_t* object, const surgescript_va
     length = ssclamp(length, 0, (int)utf8len - start);
 
     /* extract the substring */
-    begin = str + u8_offset((char*)str, start);
-    end = str + u8_offset((char*)str, start + length);
+    begin = str + (ascii ? start : u8_offset((char*)str, start));
+    end = str + (ascii ? start + length : u8_offset((char*)str, start + length));
     ssassert(end >= begin);
     substr = ssmalloc((2 + end - begin) * sizeof(*substr));
     surgescript_util_strncpy(substr, begin, 1 + end - begin);
@@ -39,7 +39,7 @@ static surgescript_var_t* fun_main(surgescript_object_t* object, const surgescri
 
 /* helpers */
 static void install_plugins(surgescript_object_t* plugin_object, const char** plugins);
-static surgescript_heapptr_t ISACTIVE_ADDR = 0;
+static const surgescript_heapptr_t ISACTIVE_ADDR = 0;
 
 /*
  * surgescript_sslib_register_system()
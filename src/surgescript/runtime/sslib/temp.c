@@ -20,11 +20,15 @@
  */
 
 #include <time.h>
+#include <string.h>
 #include "../vm.h"
 #include "../object.h"
+#include "../object_manager.h"
+#include "../../util/util.h"
 
 /* private stuff */
 static surgescript_var_t* fun_main(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
+static surgescript_var_t* fun_spawn(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
 static surgescript_var_t* fun_destroy(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
 
 /*
@@ -34,6 +38,7 @@ static surgescript_var_t* fun_destroy(surgescript_object_t* object, const surges
 void surgescript_sslib_register_temp(surgescript_vm_t* vm)
 {
     surgescript_vm_bind(vm, "__Temp", "state:main", fun_main, 0);
+    surgescript_vm_bind(vm, "__Temp", "spawn", fun_spawn, 1);
     surgescript_vm_bind(vm, "__Temp", "destroy", fun_destroy, 0);
 }
 
@@ -47,6 +52,22 @@ surgescript_var_t* fun_main(surgescript_object_t* object, const surgescript_var_
     return NULL;
 }
 
+/* spawn: temporary objects are short-lived, so they're spawned in the nursery */
+surgescript_var_t* fun_spawn(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+{
+    const char* object_name = surgescript_var_fast_get_string(param[0]);
+    surgescript_objectmanager_t* manager = surgescript_object_manager(object);
+    surgescript_objecthandle_t handle;
+
+    if(strcmp(object_name, "System") == 0) {
+        ssfatal("Runtime Error: object \"%s\" can't spawn \"%s\".", surgescript_object_name(object), object_name);
+        return NULL;
+    }
+
+    handle = surgescript_objectmanager_spawn_temp(manager, object_name);
+    return surgescript_var_set_objecthandle(surgescript_var_create(), handle);
+}
+
 /* destroy */
 surgescript_var_t* fun_destroy(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
@@ -19,6 +19,7 @@
  * SurgeScript stack
  */
 
+#include <string.h>
 #include "stack.h"
 #include "variable.h"
 #include "../util/util.h"
@@ -38,6 +39,8 @@
  * |     some data       |
  * |   previous BP (0)   |
  * +---------------------+
+ *
+ * variables are stored inline in the stack. The slots above SP are always null.
  */
 
 /* constants */
@@ -48,7 +51,7 @@ struct surgescript_stack_t
 {
     size_t size;                     /* size of the stack */
     surgescript_stackptr_t sp, bp;   /* pointers */
-    surgescript_var_t** data;        /* stack data */
+    surgescript_var_t* data;         /* stack data */
 };
 
 
@@ -66,12 +69,11 @@ surgescript_stack_t* surgescript_stack_create()
     size_t size = SSSTACK_INITIAL_SIZE;
 
     stack->data = ssmalloc(size * sizeof(*(stack->data)));
+    memset(stack->data, 0, size * sizeof(*(stack->data))); /* null variables */
     stack->size = size;
     stack->sp = stack->bp = 0;
-    while(size)
-        stack->data[--size] = NULL;
 
-    stack->data[0] = surgescript_var_set_rawbits(surgescript_var_create(), stack->bp);
+    surgescript_var_set_rawbits(&(stack->data[0]), stack->bp);
     return stack;
 }
 
@@ -81,10 +83,8 @@ surgescript_stack_t* surgescript_stack_create()
  */
 surgescript_stack_t* surgescript_stack_destroy(surgescript_stack_t* stack)
 {
-    for(surgescript_stackptr_t i = stack->size - 1; i >= 0; i--) {
-        if(stack->data[i] != NULL)
-            surgescript_var_destroy(stack->data[i]);
-    }
+    for(surgescript_stackptr_t i = stack->sp; i >= 0; i--)
+        surgescript_var_set_null(&(stack->data[i]));
 
     ssfree(stack->data);
     ssfree(stack);
@@ -97,12 +97,27 @@ surgescript_stack_t* surgescript_stack_destroy(surgescript_stack_t* stack)
  */
 void surgescript_stack_push(surgescript_stack_t* stack, surgescript_var_t* data)
 {
-    if(++stack->sp < stack->size)
-        stack->data[stack->sp] = data;
+    if(++stack->sp < stack->size) {
+        /* move data to the (null) slot and get rid of the empty shell */
+        surgescript_var_swap(&(stack->data[stack->sp]), data);
+        surgescript_var_destroy(data);
+    }
     else
         ssfatal("Runtime Error: surgescript_stack_push() - stack overflow");
 }
 
+/*
+ * surgescript_stack_pushcopy()
+ * Pushes a copy of a variable onto the stack
+ */
+void surgescript_stack_pushcopy(surgescript_stack_t* stack, const surgescript_var_t* data)
+{
+    if(++stack->sp < stack->size)
+        surgescript_var_copy(&(stack->data[stack->sp]), data);
+    else
+        ssfatal("Runtime Error: surgescript_stack_pushcopy() - stack overflow");
+}
+
 /*
  * surgescript_stack_pop()
  * Pops a variable from the stack, deallocating it
@@ -110,7 +125,7 @@ void surgescript_stack_push(surgescript_stack_t* stack, surgescript_var_t* data)
 void surgescript_stack_pop(surgescript_stack_t* stack)
 {
     if(stack->sp > stack->bp) {
-        stack->data[stack->sp] = surgescript_var_destroy(stack->data[stack->sp]);
+        surgescript_var_set_null(&(stack->data[stack->sp]));
         stack->sp--;
     }
     else
@@ -124,9 +139,12 @@ void surgescript_stack_pop(surgescript_stack_t* stack)
 void surgescript_stack_pushenv(surgescript_stack_t* stack)
 {
     /* push prev BP & set new BP */
-    surgescript_var_t* prev_bp = surgescript_var_set_rawbits(surgescript_var_create(), stack->bp);
-    surgescript_stack_push(stack, prev_bp);
-    stack->bp = stack->sp; /* the base of the stack points to the previous bp */
+    if(++stack->sp < stack->size) {
+        surgescript_var_set_rawbits(&(stack->data[stack->sp]), stack->bp);
+        stack->bp = stack->sp; /* the base of the stack points to the previous bp */
+    }
+    else
+        ssfatal("Runtime Error: surgescript_stack_pushenv() - stack overflow");
 }
 
 /*
@@ -137,11 +155,9 @@ void surgescript_stack_popenv(surgescript_stack_t* stack)
 {
     if(stack->sp > 0) {
         /* get previous bp & deallocate everything in between */
-        surgescript_stackptr_t i, prev_bp = surgescript_var_get_rawbits(stack->data[stack->bp]);
-        for(i = stack->sp; i >= stack->bp; i--) {
-            if(stack->data[i] != NULL)
-                stack->data[i] = surgescript_var_destroy(stack->data[i]);
-        }
+        surgescript_stackptr_t i, prev_bp = surgescript_var_get_rawbits(&(stack->data[stack->bp]));
+        for(i = stack->sp; i >= stack->bp; i--)
+            surgescript_var_set_null(&(stack->data[i]));
 
         stack->sp = stack->bp - 1;
         stack->bp = prev_bp;
@@ -156,8 +172,11 @@ void surgescript_stack_popenv(surgescript_stack_t* stack)
  */
 void surgescript_stack_pushn(surgescript_stack_t* stack, size_t n)
 {
-    while(n--)
-        surgescript_stack_push(stack, surgescript_var_create());
+    /* the slots above SP are already null */
+    if(stack->sp + n < stack->size)
+        stack->sp += n;
+    else
+        ssfatal("Runtime Error: surgescript_stack_pushn() - stack overflow");
 }
 
 /*
@@ -176,7 +195,7 @@ void surgescript_stack_popn(surgescript_stack_t* stack, size_t n)
  */
 const surgescript_var_t* surgescript_stack_top(const surgescript_stack_t* stack)
 {
-    return stack->data[stack->sp];
+    return &(stack->data[stack->sp]);
 }
 
 
@@ -189,7 +208,7 @@ const surgescript_var_t* surgescript_stack_peek(const surgescript_stack_t* stack
     const surgescript_stackptr_t idx = stack->bp + offset;
 
     if(idx >= 0 && idx <= stack->sp)
-        return stack->data[idx];
+        return &(stack->data[idx]);
 
     ssfatal("Runtime Error: surgescript_stack_peek() can't read an element (%d) that is out of bounds [%d, %d]", idx, 0, stack->sp);
     return NULL;
@@ -204,7 +223,7 @@ void surgescript_stack_poke(surgescript_stack_t* stack, surgescript_stackptr_t o
     const surgescript_stackptr_t idx = stack->bp + offset;
 
     if(idx >= 0 && idx <= stack->sp)
-        surgescript_var_copy(stack->data[idx], data);
+        surgescript_var_copy(&(stack->data[idx]), data);
     else
         ssfatal("Runtime Error: surgescript_stack_poke() can't write to an element (%d) that is out of bounds [%d, %d]", idx, 0, stack->sp);
 }
@@ -225,12 +244,10 @@ int surgescript_stack_empty(const surgescript_stack_t* stack)
 void surgescript_stack_scan_objects(surgescript_stack_t* stack, void* userdata, bool (*callback)(unsigned,void*))
 {
     for(surgescript_stackptr_t i = stack->sp - 1; i >= 0; i--) { /* check all environments */
-        if(stack->data[i] != NULL) {
-            unsigned handle = surgescript_var_get_objecthandle(stack->data[i]);
-            if(handle != 0) { /* if it is an object and not null */
-                if(!callback(handle, userdata)) /* if the handle is broken */
-                    surgescript_var_set_null(stack->data[i]); /* fix it */
-            }
+        unsigned handle = surgescript_var_get_objecthandle(&(stack->data[i]));
+        if(handle != 0) { /* if it is an object and not null */
+            if(!callback(handle, userdata)) /* if the handle is broken */
+                surgescript_var_set_null(&(stack->data[i])); /* fix it */
         }
     }
 }
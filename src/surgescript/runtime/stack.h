@@ -36,7 +36,8 @@ struct surgescript_var_t;
 /* public methods */
 surgescript_stack_t* surgescript_stack_create();
 surgescript_stack_t* surgescript_stack_destroy(surgescript_stack_t* stack);
-void surgescript_stack_push(surgescript_stack_t* stack, struct surgescript_var_t* data); /* pushes data to the stack */
+void surgescript_stack_push(surgescript_stack_t* stack, struct surgescript_var_t* data); /* pushes data to the stack, taking ownership of it */
+void surgescript_stack_pushcopy(surgescript_stack_t* stack, const struct surgescript_var_t* data); /* pushes a copy of data to the stack */
 void surgescript_stack_pop(surgescript_stack_t* stack); /* pops and deallocates a var from the stack */
 void surgescript_stack_pushenv(surgescript_stack_t* stack); /* pushes an environment */
 void surgescript_stack_popenv(surgescript_stack_t* stack); /* pops an environment */
@@ -26,6 +26,7 @@
 #include <limits.h>
 #include <float.h>
 #include <ctype.h>
+#include <locale.h>
 #include "variable.h"
 #include "object.h"
 #include "object_manager.h"
@@ -35,33 +36,9 @@
 
 /* private stuff */
 
-/* possible variable types */
-enum surgescript_vartype_t {
-    SSVAR_NULL,
-    SSVAR_BOOL,
-    SSVAR_NUMBER,
-    SSVAR_STRING,
-    SSVAR_OBJECTHANDLE,
-    SSVAR_RAW,
-};
+/* type codes of the possible variable types */
 static const int typecode[] = { 0, 'b', 'n', 's', 'o', 'r' };
 
-/* the variable struct */
-struct surgescript_var_t
-{
-    /* data */
-    union {
-        char* string;
-        double number;
-        unsigned handle:32;
-        bool boolean;
-        int64_t raw;
-    };
-
-    /* metadata */
-    enum surgescript_vartype_t type;
-};
-
 /* var pool */
 /*#define DISABLE_VARPOOL*/
 #ifndef DISABLE_VARPOOL
@@ -89,17 +66,46 @@ static surgescript_varpool_t* delete_varpools(surgescript_varpool_t* head);
 static surgescript_varbucket_t* get_1stbucket(surgescript_varpool_t* pool);
 static inline surgescript_varbucket_t* allocate_bucket();
 static inline void free_bucket(surgescript_varbucket_t* bucket);
-static surgescript_varpool_t* varpool = NULL;
-static surgescript_varbucket_t* varpool_currbucket = NULL;
+static SS_THREADLOCAL surgescript_varpool_t* varpool = NULL; /* each thread has its own pool */
+static SS_THREADLOCAL surgescript_varbucket_t* varpool_currbucket = NULL;
+static SS_THREADLOCAL int varpool_refcount = 0; /* how many VMs use the pool */
 
 #endif
 
+/* objects updated in parallel */
+struct surgescript_varpool_t* surgescript_var_detach_pool();
+void surgescript_var_attach_pool(struct surgescript_varpool_t* pool);
+void surgescript_var_share_strings(bool shared);
+
+/* strings */
+struct surgescript_varstring_t
+{
+    unsigned refcount; /* how many variables share this string */
+    uint32_t hash; /* precomputed hash */
+    size_t length; /* length in bytes */
+    char data[]; /* zero-terminated, valid UTF-8 */
+};
+
+enum {
+    VARFLAG_SSO = 0x1, /* the string is stored inline */
+    VARFLAG_ASCII = 0x2 /* the string has ASCII characters only */
+};
+
+static inline const char* string_data(const surgescript_var_t* var);
+static inline void retain_string(surgescript_varstring_t* string);
+static inline void release_string(surgescript_varstring_t* string);
+static inline uint32_t hash_string(const char* str, size_t length);
+static SS_THREADLOCAL bool shared_strings = false; /* are the strings shared with other threads? (atomic reference counting) */
+
 /* helpers */
-#define RELEASE_DATA(var)       if((var)->type == SSVAR_STRING) \
-                                    (var)->string = ssfree((var)->string); \
-                                (var)->raw = 0; /* must clear all bits */
+#define RELEASE_DATA(var)       if((var)->type == SSVAR_STRING && !((var)->flags & VARFLAG_SSO)) \
+                                    release_string((var)->string); \
+                                (var)->raw = 0; /* must clear all bits */ \
+                                (var)->flags = 0;
+#define IS_NONZERO(var)         ((var)->type == SSVAR_STRING || (var)->raw != 0) /* strings are non-null pointers */
 static inline bool is_number(const char* str);
-static inline void convert_to_ascii(char* str);
+static void fix_decimal_point(char* str);
+static inline size_t convert_to_ascii(char* str);
 
 /* -------------------------------
  * public methods
@@ -116,11 +122,13 @@ surgescript_var_t* surgescript_var_create()
 #ifndef DISABLE_VARPOOL
     surgescript_var_t* var = (surgescript_var_t*)allocate_bucket();
     var->type = SSVAR_NULL;
+    var->flags = 0;
     var->raw = 0;
     return var;
 #else
     surgescript_var_t* var = ssmalloc(sizeof *var);
     var->type = SSVAR_NULL;
+    var->flags = 0;
     var->raw = 0;
     return var;
 #endif
@@ -191,24 +199,47 @@ surgescript_var_t* surgescript_var_set_number(surgescript_var_t* var, double num
 surgescript_var_t* surgescript_var_set_string(surgescript_var_t* var, const char* string)
 {
     static const int MAXLEN = 1048576 - 1; /* 1 MB */
+    surgescript_var_t tmp = { .raw = 0 };
+    size_t length = string != NULL ? strlen(string) : 0;
+    bool ascii = true;
 
-    RELEASE_DATA(var);
-    if(string != NULL && strlen(string) <= MAXLEN) {
-        var->type = SSVAR_STRING;
-        var->string = ssstrdup(string);
-        if(!u8_isvalid(var->string, strlen(var->string)))
-            convert_to_ascii(var->string);
+    /* validate the string */
+    if(length > MAXLEN) {
+        char buf[128];
+        surgescript_util_strncpy(buf, string, sizeof(buf));
+        ssfatal("Runtime Error: string \"%s...\" is too large!", buf);
+        return var;
     }
-    else if(string == NULL) {
-        var->type = SSVAR_STRING;
-        var->string = ssstrdup("");
+    for(size_t i = 0; i < length && ascii; i++)
+        ascii = !(string[i] & 0x80);
+
+    /* create the string (string may point to var itself) */
+    tmp.type = SSVAR_STRING;
+    if(length < SURGESCRIPT_VAR_SSO_SIZE) {
+        tmp.flags = VARFLAG_SSO;
+        memcpy(tmp.sso, string ? string : "", length + 1);
+        if(!ascii && !u8_isvalid(tmp.sso, length)) {
+            length = convert_to_ascii(tmp.sso);
+            ascii = true;
+        }
+        tmp.sso_tag = 1 + length;
     }
     else {
-        static char buf[128];
-        surgescript_util_strncpy(buf, string, sizeof(buf));
-        ssfatal("Runtime Error: string \"%s...\" is too large!", buf);
+        tmp.string = ssmalloc(sizeof(surgescript_varstring_t) + (length + 1) * sizeof(char));
+        tmp.string->refcount = 1;
+        memcpy(tmp.string->data, string, length + 1);
+        if(!ascii && !u8_isvalid(tmp.string->data, length)) {
+            length = convert_to_ascii(tmp.string->data);
+            ascii = true;
+        }
+        tmp.string->length = length;
+        tmp.string->hash = hash_string(tmp.string->data, length);
     }
+    tmp.flags |= ascii ? VARFLAG_ASCII : 0;
 
+    /* done! */
+    RELEASE_DATA(var);
+    *var = tmp;
     return var;
 }
 
@@ -252,7 +283,7 @@ bool surgescript_var_get_bool(const surgescript_var_t* var)
         case SSVAR_NUMBER:
             return var->raw != 0 && fpclassify(var->number) != FP_ZERO;
         case SSVAR_STRING:
-            return *(var->string) != 0;
+            return *string_data(var) != 0;
         case SSVAR_NULL:
             return false;
         case SSVAR_OBJECTHANDLE:
@@ -276,7 +307,7 @@ double surgescript_var_get_number(const surgescript_var_t* var)
         case SSVAR_BOOL:
             return var->boolean ? 1.0 : 0.0;
         case SSVAR_STRING:
-            return is_number(var->string) ? atof(var->string) : NAN;
+            return is_number(string_data(var)) ? surgescript_util_strtod(string_data(var), NULL) : NAN;
         case SSVAR_NULL:
             return 0.0;
         case SSVAR_OBJECTHANDLE:
@@ -302,7 +333,7 @@ char* surgescript_var_get_string(const surgescript_var_t* var, const surgescript
         case SSVAR_BOOL:
             return ssstrdup(var->boolean ? "true" : "false");
         case SSVAR_STRING:
-            return ssstrdup(var->string);
+            return ssstrdup(string_data(var));
         case SSVAR_NUMBER: {
             char buf[32];
             surgescript_var_to_string(var, buf, sizeof(buf));
@@ -358,28 +389,11 @@ unsigned surgescript_var_get_objecthandle(const surgescript_var_t* var)
  */
 surgescript_var_t* surgescript_var_copy(surgescript_var_t* dst, const surgescript_var_t* src)
 {
-    RELEASE_DATA(dst);
-    dst->type = src->type;
-
-    switch(src->type) {
-        case SSVAR_NULL:
-            dst->raw = 0;
-            break;
-        case SSVAR_BOOL:
-            dst->boolean = src->boolean;
-            break;
-        case SSVAR_NUMBER:
-            dst->number = src->number;
-            break;
-        case SSVAR_STRING:
-            dst->string = ssstrdup(src->string);
-            break;
-        case SSVAR_OBJECTHANDLE:
-            dst->handle = src->handle;
-            break;
-        case SSVAR_RAW:
-            dst->raw = src->raw;
-            break;
+    if(dst != src) {
+        if(src->type == SSVAR_STRING && !(src->flags & VARFLAG_SSO))
+            retain_string(src->string); /* strings are immutable: share them */
+        RELEASE_DATA(dst);
+        *dst = *src;
     }
 
     return dst;
@@ -468,7 +482,7 @@ char* surgescript_var_to_string(const surgescript_var_t* var, char* buf, size_t
 {
     switch(var->type) {
         case SSVAR_STRING:
-            return surgescript_util_strncpy(buf, var->string, bufsize);
+            return surgescript_util_strncpy(buf, string_data(var), bufsize);
         case SSVAR_BOOL:
             return surgescript_util_strncpy(buf, var->boolean ? "true" : "false", bufsize);
         case SSVAR_NULL:
@@ -479,8 +493,10 @@ char* surgescript_var_to_string(const surgescript_var_t* var, char* buf, size_t
             char tmp[32];
             if(var->number == ceil(var->number)) /* integer check */
                 snprintf(tmp, sizeof(tmp), "%.0lf", var->number);
-            else
+            else {
                 snprintf(tmp, sizeof(tmp), "%lf", var->number);
+                fix_decimal_point(tmp);
+            }
             return surgescript_util_strncpy(buf, tmp, bufsize);
         }
         case SSVAR_RAW:
@@ -496,7 +512,45 @@ char* surgescript_var_to_string(const surgescript_var_t* var, char* buf, size_t
  */
 const char* surgescript_var_fast_get_string(const surgescript_var_t* var)
 {
-    return var->type == SSVAR_STRING ? var->string : "";
+    return var->type == SSVAR_STRING ? string_data(var) : "";
+}
+
+/*
+ * surgescript_var_fast_get_string_length()
+ * the length, in bytes, of the string stored in var (0 if var is not a string)
+ */
+size_t surgescript_var_fast_get_string_length(const surgescript_var_t* var)
+{
+    if(var->type != SSVAR_STRING)
+        return 0;
+    else if(var->flags & VARFLAG_SSO)
+        return var->sso_tag - 1;
+    else
+        return var->string->length;
+}
+
+/*
+ * surgescript_var_fast_get_string_hash()
+ * the hash of the string stored in var (computed when the string is created)
+ */
+uint32_t surgescript_var_fast_get_string_hash(const surgescript_var_t* var)
+{
+    if(var->type != SSVAR_STRING)
+        return hash_string("", 0);
+    else if(var->flags & VARFLAG_SSO)
+        return hash_string(var->sso, var->sso_tag - 1);
+    else
+        return var->string->hash;
+}
+
+/*
+ * surgescript_var_fast_is_ascii()
+ * Is var a string made of ASCII characters only? If so, its length in
+ * characters equals its length in bytes
+ */
+bool surgescript_var_fast_is_ascii(const surgescript_var_t* var)
+{
+    return var->type == SSVAR_STRING && (var->flags & VARFLAG_ASCII);
 }
 
 /*
@@ -517,7 +571,9 @@ int surgescript_var_compare(const surgescript_var_t* a, const surgescript_var_t*
             case SSVAR_OBJECTHANDLE:
                 return (a->handle > b->handle) - (a->handle < b->handle);
             case SSVAR_STRING:
-                return strcmp(a->string, b->string);
+                if(!((a->flags | b->flags) & VARFLAG_SSO) && a->string == b->string)
+                    return 0; /* shared string */
+                return strcmp(string_data(a), string_data(b));
             case SSVAR_NUMBER: {
                 /* encourage users to use approximatelyEqual() */
                 /* epsilon comparisons may cause underlying problems, e.g., with infinity */
@@ -529,7 +585,7 @@ int surgescript_var_compare(const surgescript_var_t* a, const surgescript_var_t*
     }
     else {
         if(a->type == SSVAR_NULL || b->type == SSVAR_NULL) {
-            return (a->raw != 0) - (b->raw != 0);
+            return (int)IS_NONZERO(a) - (int)IS_NONZERO(b);
         }
         else if(a->type == SSVAR_RAW || b->type == SSVAR_RAW) {
             return (a->raw > b->raw) - (a->raw < b->raw);
@@ -538,11 +594,11 @@ int surgescript_var_compare(const surgescript_var_t* a, const surgescript_var_t*
             char buf[128];
             if(a->type == SSVAR_STRING) {
                 surgescript_var_to_string(b, buf, sizeof(buf));
-                return strcmp(a->string, buf);
+                return strcmp(string_data(a), buf);
             }
             else {
                 surgescript_var_to_string(a, buf, sizeof(buf));
-                return strcmp(buf, b->string);
+                return strcmp(buf, string_data(b));
             }
         }
         else if(a->type == SSVAR_NUMBER || b->type == SSVAR_NUMBER) {
@@ -604,8 +660,8 @@ surgescript_var_t* surgescript_var_set_rawbits(surgescript_var_t* var, int64_t r
  */
 size_t surgescript_var_size(const surgescript_var_t* var)
 {
-    if(var->type == SSVAR_STRING)
-        return sizeof(surgescript_var_t) + (1 + strlen(var->string)) * sizeof(char);
+    if(var->type == SSVAR_STRING && !(var->flags & VARFLAG_SSO))
+        return sizeof(surgescript_var_t) + sizeof(surgescript_varstring_t) + (1 + var->string->length) * sizeof(char);
     else
         return sizeof(surgescript_var_t);
 }
@@ -618,12 +674,14 @@ size_t surgescript_var_size(const surgescript_var_t* var)
 
 /*
  * surgescript_var_init_pool()
- * Initializes the pool
+ * Initializes the pool of the calling thread. Each VM calls this once,
+ * and the variables must be created & destroyed on the thread of the VM
+ * or on the threads that update its objects in parallel
  */
 void surgescript_var_init_pool()
 {
 #ifndef DISABLE_VARPOOL
-    if(varpool == NULL) {
+    if(varpool_refcount++ == 0) {
         varpool = new_varpool(NULL);
         varpool_currbucket = get_1stbucket(varpool);
     }
@@ -634,18 +692,70 @@ void surgescript_var_init_pool()
 
 /*
  * surgescript_var_release_pool()
- * Releases the pool
+ * Releases the pool of the calling thread when no VM uses it anymore
  */
 void surgescript_var_release_pool()
 {
 #ifndef DISABLE_VARPOOL
-    if(varpool != NULL) {
+    if(varpool_refcount > 0 && --varpool_refcount == 0) {
         varpool_currbucket = NULL;
         varpool = delete_varpools(varpool);
     }
 #endif
 }
 
+/*
+ * surgescript_var_detach_pool()
+ * The calling thread gives up its pool without releasing it, so that the
+ * variables it has created may outlive it. The thread of the VM must take
+ * over the returned pool with surgescript_var_attach_pool()
+ */
+struct surgescript_varpool_t* surgescript_var_detach_pool()
+{
+#ifndef DISABLE_VARPOOL
+    struct surgescript_varpool_t* pool = varpool;
+    varpool_currbucket = NULL;
+    varpool = NULL;
+    varpool_refcount = 0;
+    return pool;
+#else
+    return NULL;
+#endif
+}
+
+/*
+ * surgescript_var_attach_pool()
+ * Takes over a pool given up by another thread. It's released together with
+ * the pool of the calling thread
+ */
+void surgescript_var_attach_pool(struct surgescript_varpool_t* pool)
+{
+#ifndef DISABLE_VARPOOL
+    if(pool != NULL) {
+        struct surgescript_varpool_t* last = pool;
+        if(varpool == NULL) {
+            delete_varpools(pool); /* no variables are left */
+            return;
+        }
+
+        while(last->next != NULL)
+            last = last->next;
+        last->next = varpool->next;
+        varpool->next = pool;
+    }
+#endif
+}
+
+/*
+ * surgescript_var_share_strings()
+ * Set it to true if the variables of the calling thread may share their
+ * strings with variables of other threads (objects updated in parallel)
+ */
+void surgescript_var_share_strings(bool shared)
+{
+    shared_strings = shared;
+}
+
 
 /* private section */
 
@@ -679,8 +789,21 @@ bool is_number(const char* str)
     return true;
 }
 
-/* convert string to ascii */
-void convert_to_ascii(char* str)
+/* replaces the decimal separator of the locale by '.' in a formatted number */
+void fix_decimal_point(char* str)
+{
+    const char* point = localeconv()->decimal_point; /* SurgeScript never calls setlocale() */
+    char* p;
+
+    if(strcmp(point, ".") != 0 && (p = strstr(str, point)) != NULL) {
+        size_t point_length = strlen(point);
+        *p = '.';
+        memmove(p + 1, p + point_length, strlen(p + point_length) + 1);
+    }
+}
+
+/* convert string to ascii, returning its new length */
+size_t convert_to_ascii(char* str)
 {
     char *p, *q;
 
@@ -690,6 +813,42 @@ void convert_to_ascii(char* str)
     }
 
     *q = 0;
+    return q - str;
+}
+
+/* the contents of a string variable */
+const char* string_data(const surgescript_var_t* var)
+{
+    return (var->flags & VARFLAG_SSO) ? var->sso : var->string->data;
+}
+
+/* shares a string */
+void retain_string(surgescript_varstring_t* string)
+{
+    if(!shared_strings)
+        string->refcount++;
+    else
+        ssatomic_increment(&string->refcount);
+}
+
+/* releases a shared string, deleting it when it's no longer used */
+void release_string(surgescript_varstring_t* string)
+{
+    if(0 == (!shared_strings ? --string->refcount : ssatomic_decrement(&string->refcount)))
+        ssfree(string);
+}
+
+/* FNV-1a hash */
+uint32_t hash_string(const char* str, size_t length)
+{
+    uint32_t hash = 2166136261u;
+
+    while(length--) {
+        hash ^= (unsigned char)(*str++);
+        hash *= 16777619u;
+    }
+
+    return hash;
 }
 
 /* private var pool routines */
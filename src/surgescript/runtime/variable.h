@@ -29,6 +29,55 @@
 /* the variable type */
 typedef struct surgescript_var_t surgescript_var_t;
 
+/* possible variable types */
+enum surgescript_vartype_t {
+    SSVAR_NULL,
+    SSVAR_BOOL,
+    SSVAR_NUMBER,
+    SSVAR_STRING,
+    SSVAR_OBJECTHANDLE,
+    SSVAR_RAW,
+};
+
+/* strings are immutable & reference-counted */
+typedef struct surgescript_varstring_t surgescript_varstring_t;
+
+/* short strings (up to SURGESCRIPT_VAR_SSO_SIZE - 1 bytes) are stored inline */
+#define SURGESCRIPT_VAR_SSO_SIZE 13
+
+/*
+ * A variable is a 16-byte tagged value. Its layout is exposed so that
+ * variables may be stored inline in arrays (heap cells & stack slots),
+ * with no per-variable allocation. Please treat it as opaque and use
+ * the functions below. A zero-filled variable is a valid null variable.
+ */
+struct surgescript_var_t
+{
+    union {
+        struct {
+            /* data */
+            union {
+                surgescript_varstring_t* string;
+                double number;
+                unsigned handle:32;
+                bool boolean;
+                int64_t raw;
+            };
+            char _reserved[6];
+
+            /* metadata */
+            uint8_t flags;
+            uint8_t type; /* enum surgescript_vartype_t */
+        };
+
+        /* inline string */
+        struct {
+            uint8_t sso_tag; /* 1 + length: keeps the raw bits of an inline string non-zero */
+            char sso[SURGESCRIPT_VAR_SSO_SIZE];
+        };
+    };
+};
+
 /* misc */
 struct surgescript_objectmanager_t;
 
@@ -66,14 +115,17 @@ surgescript_var_t* surgescript_var_copy(surgescript_var_t* dst, const surgescrip
 surgescript_var_t* surgescript_var_clone(const surgescript_var_t* var); /* similar to strdup */
 char* surgescript_var_to_string(const surgescript_var_t* var, char* buf, size_t bufsize); /* copies var to buf and returns buf, converting var to string if necessary (similar to itoa / strncpy) */
 const char* surgescript_var_fast_get_string(const surgescript_var_t* var); /* gets the string contents of var without performing any type conversion */
+size_t surgescript_var_fast_get_string_length(const surgescript_var_t* var); /* the length, in bytes, of the string stored in var (0 if var is not a string) */
+uint32_t surgescript_var_fast_get_string_hash(const surgescript_var_t* var); /* the hash of the string stored in var */
+bool surgescript_var_fast_is_ascii(const surgescript_var_t* var); /* is var a string made of ASCII characters only? (i.e., 1 byte per character) */
 int surgescript_var_compare(const surgescript_var_t* a, const surgescript_var_t* b); /* similar to strcmp */
 void surgescript_var_swap(surgescript_var_t* a, surgescript_var_t* b); /* swaps a <-> b */
 int64_t surgescript_var_get_rawbits(const surgescript_var_t* var); /* the binary value stored in var */
 surgescript_var_t* surgescript_var_set_rawbits(surgescript_var_t* var, int64_t raw); /* sets its binary value */
 size_t surgescript_var_size(const surgescript_var_t* var); /* used memory in user space, in bytes */
 
-/* var pooling */
-void surgescript_var_init_pool();
-void surgescript_var_release_pool();
+/* var pooling (one pool per thread) */
+void surgescript_var_init_pool(); /* called by each VM when created */
+void surgescript_var_release_pool(); /* called by each VM when destroyed */
 
 #endif
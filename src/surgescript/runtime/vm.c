@@ -19,7 +19,6 @@
  * SurgeScript Virtual Machine - Runtime Engine
  */
 
-#include <locale.h>
 #include <time.h>
 #include "vm.h"
 #include "stack.h"
@@ -63,12 +62,14 @@ struct surgescript_vm_t
     surgescript_parser_t* parser;
     surgescript_vmargs_t* args;
     double start_time;
+    int update_threads;
 };
 
 /* misc */
 static void create_vm_components(surgescript_vm_t* vm);
 static void destroy_vm_components(surgescript_vm_t* vm);
 static void setup_sslib(surgescript_vm_t* vm);
+static bool call_updater0(surgescript_object_t* object, void* updater);
 static bool call_updater1(surgescript_object_t* object, void* updater);
 static bool call_updater2(surgescript_object_t* object, void* updater);
 static bool call_updater3(surgescript_object_t* object, void* updater);
@@ -89,6 +90,7 @@ surgescript_vm_t* surgescript_vm_create()
     /* set up the VM */
     sslog("Creating the VM...");
     surgescript_var_init_pool();
+    vm->update_threads = 1;
     create_vm_components(vm);
     setup_sslib(vm);
 
@@ -141,6 +143,8 @@ bool surgescript_vm_reset(surgescript_vm_t* vm)
  * surgescript_vm_compile()
  * Compiles a file, given its absolute filepath
  * Returns true on success; false otherwise
+ * If the bytecode cache of the parser is enabled, an up-to-date
+ * precompiled version of the file is loaded instead
  */
 bool surgescript_vm_compile(surgescript_vm_t* vm, const char* absolute_path)
 {
@@ -176,9 +180,6 @@ void surgescript_vm_launch_ex(surgescript_vm_t* vm, int argc, char** argv)
     if(surgescript_vm_is_active(vm))
         return;
 
-    /* SurgeScript uses UTF-8 */
-    setlocale(LC_ALL, "en_US.UTF-8");
-
     /* Setup the pseudo-number generator */
     surgescript_util_srand(time(NULL));
 
@@ -209,8 +210,7 @@ bool surgescript_vm_is_active(surgescript_vm_t* vm)
 bool surgescript_vm_update(surgescript_vm_t* vm)
 {
     if(surgescript_vm_is_active(vm)) {
-        surgescript_object_t* root = surgescript_vm_root_object(vm);
-        surgescript_object_traverse_tree(root, surgescript_object_update);
+        surgescript_objectmanager_traverse(vm->object_manager, NULL, call_updater0);
         return surgescript_vm_is_active(vm);
     }
     else
@@ -224,18 +224,17 @@ bool surgescript_vm_update(surgescript_vm_t* vm)
 bool surgescript_vm_update_ex(surgescript_vm_t* vm, void* user_data, void (*user_update)(surgescript_object_t*,void*), void (*late_update)(surgescript_object_t*,void*))
 {
     if(surgescript_vm_is_active(vm)) {
-        surgescript_object_t* root = surgescript_vm_root_object(vm);
         surgescript_vm_updater_t updater = { user_data, user_update, late_update };
 
         /* update */
         if(user_update != NULL && late_update != NULL)
-            surgescript_object_traverse_tree_ex(root, &updater, call_updater3);
+            surgescript_objectmanager_traverse(vm->object_manager, &updater, call_updater3);
         else if(late_update != NULL)
-            surgescript_object_traverse_tree_ex(root, &updater, call_updater2);
+            surgescript_objectmanager_traverse(vm->object_manager, &updater, call_updater2);
         else if(user_update != NULL)
-            surgescript_object_traverse_tree_ex(root, &updater, call_updater1);
+            surgescript_objectmanager_traverse(vm->object_manager, &updater, call_updater1);
         else
-            surgescript_object_traverse_tree(root, surgescript_object_update);
+            surgescript_objectmanager_traverse(vm->object_manager, NULL, call_updater0);
 
         /* done! */
         return surgescript_vm_is_active(vm);
@@ -351,6 +350,27 @@ void surgescript_vm_install_plugin(surgescript_vm_t* vm, const char* object_name
     surgescript_objectmanager_install_plugin(manager, object_name);
 }
 
+/*
+ * surgescript_vm_set_update_threads()
+ * Sets how many threads update the children of the parallel objects,
+ * including the thread that updates the VM. 1 (default) means that
+ * they're updated sequentially. See the notes on threading in vm.h
+ */
+void surgescript_vm_set_update_threads(surgescript_vm_t* vm, int threads)
+{
+    vm->update_threads = ssmax(1, threads);
+    surgescript_objectmanager_set_update_threads(vm->object_manager, vm->update_threads);
+}
+
+/*
+ * surgescript_vm_update_threads()
+ * How many threads update the children of the parallel objects
+ */
+int surgescript_vm_update_threads(const surgescript_vm_t* vm)
+{
+    return surgescript_objectmanager_update_threads(vm->object_manager);
+}
+
 /* ----- private ----- */
 
 /* creates the VM components */
@@ -363,6 +383,7 @@ void create_vm_components(surgescript_vm_t* vm)
     vm->args = surgescript_vmargs_create();
     vm->object_manager = surgescript_objectmanager_create(vm->program_pool, vm->tag_system, vm->stack, vm->args);
     vm->parser = surgescript_parser_create(vm->program_pool, vm->tag_system);
+    surgescript_objectmanager_set_update_threads(vm->object_manager, vm->update_threads);
 }
 
 /* destroys the VM components */
@@ -400,6 +421,11 @@ void setup_sslib(surgescript_vm_t* vm)
 }
 
 /* these auxiliary functions help traversing the object tree */
+bool call_updater0(surgescript_object_t* object, void* updater)
+{
+    return surgescript_object_update(object);
+}
+
 bool call_updater1(surgescript_object_t* object, void* updater)
 {
     surgescript_vm_updater_t* vm_updater = (surgescript_vm_updater_t*)updater;
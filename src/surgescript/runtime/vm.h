@@ -34,6 +34,33 @@ struct surgescript_programpool_t;
 struct surgescript_tagsystem_t;
 struct surgescript_objectmanager_t;
 
+/*
+ * Threading: a VM runs its objects on the thread that calls
+ * surgescript_vm_update(), except for the children of the parallel objects
+ * (annotated with @Parallel or flagged with surgescript_object_set_parallel())
+ * when surgescript_vm_set_update_threads() is given more than one thread.
+ * Then the subtree of each child of a parallel object is updated as a task
+ * of a thread pool, in an unspecified order, after the parallel object has
+ * been updated. During a parallel update, the objects of a subtree:
+ *
+ * - may spawn, call, modify, reparent and destroy the objects of their own
+ *   subtree, including the objects they spawn;
+ * - may read the parallel object, its ancestors and the system objects,
+ *   but not write to them;
+ * - must not access the objects of other subtrees, whether by calling them,
+ *   storing them or changing their parents.
+ *
+ * Objects destroyed during a parallel update are deleted after it, in order.
+ * GC.collect() is ignored during a parallel update. The callbacks given to
+ * surgescript_vm_update_ex() run on the threads of the pool as well.
+ *
+ * VMs share no state, except for per-thread settings (variable pool, error
+ * functions, pseudo-random number generator, y-axis orientation). Many VMs
+ * may run concurrently, as long as each VM is created, used and destroyed
+ * on a single thread. The threads of the pool copy the orientation of the
+ * y-axis of the thread of the VM when they're started.
+ */
+
 /* api */
 surgescript_vm_t* surgescript_vm_create();
 surgescript_vm_t* surgescript_vm_destroy(surgescript_vm_t* vm);
@@ -64,5 +91,7 @@ surgescript_object_t* surgescript_vm_find_object(surgescript_vm_t* vm, const cha
 void surgescript_vm_bind(surgescript_vm_t* vm, const char* object_name, const char* fun_name, surgescript_program_cfunction_t cfun, int num_params); /* binds a C function to an object */
 void surgescript_vm_install_plugin(surgescript_vm_t* vm, const char* object_name); /* sets a certain object as a plugin */
 bool surgescript_vm_reset(surgescript_vm_t* vm); /* resets a VM, clearing up all its programs and objects */
+void surgescript_vm_set_update_threads(surgescript_vm_t* vm, int threads); /* how many threads update the children of the parallel objects; 1 (default) means sequentially */
+int surgescript_vm_update_threads(const surgescript_vm_t* vm); /* how many threads update the children of the parallel objects */
 
 #endif
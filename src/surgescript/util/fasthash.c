@@ -51,7 +51,7 @@ struct fasthash_t
 
 /* static data */
 static const unsigned SPARSITY = 4; /* 1 / load_factor */
-static fasthash_entry_t BLANK_ENTRY = { 0, BLANK, NULL };
+static const fasthash_entry_t BLANK_ENTRY = { 0, BLANK, NULL };
 static inline uint64_t hash(uint64_t x, uint64_t m);
 static inline void grow(fasthash_t* hashtable);
 static void empty_destructor(void* data);
@@ -102,6 +102,7 @@ fasthash_t* fasthash_destroy(fasthash_t* hashtable)
 
     /* omit warnings */
     (void)fasthash_get;
+    (void)fasthash_peek;
     (void)fasthash_put;
     (void)fasthash_delete;
     (void)fasthash_find;
@@ -146,6 +147,27 @@ void* fasthash_get(fasthash_t* hashtable, uint64_t key)
     return NULL;
 }
 
+/*
+ * fasthash_peek()
+ * Gets an element from the hash table without moving it closer to its
+ * bucket, as fasthash_get() does. Many threads may peek at the same time
+ * Returns NULL if the element doesn't exist
+ */
+void* fasthash_peek(const fasthash_t* hashtable, uint64_t key)
+{
+    uint32_t k = hash(key, hashtable->cap_mask);
+
+    while(hashtable->data[k].state != BLANK) {
+        if(hashtable->data[k].state == ACTIVE && hashtable->data[k].key == key)
+            return hashtable->data[k].value;
+
+        /* probe */
+        ++k; k &= hashtable->cap_mask;
+    }
+
+    return NULL;
+}
+
 /*
  * fasthash_put()
  * Puts an element into the hash table
@@ -40,6 +40,7 @@ typedef struct fasthash_t fasthash_t;
 FASTHASH_API fasthash_t* fasthash_create(void (*element_destructor)(void*), size_t lg2_cap);
 FASTHASH_API fasthash_t* fasthash_destroy(fasthash_t* hashtable);
 FASTHASH_API void* fasthash_get(fasthash_t* hashtable, uint64_t key);
+FASTHASH_API void* fasthash_peek(const fasthash_t* hashtable, uint64_t key);
 FASTHASH_API void fasthash_put(fasthash_t* hashtable, uint64_t key, void* value);
 FASTHASH_API bool fasthash_delete(fasthash_t* hashtable, uint64_t key);
 FASTHASH_API void* fasthash_find(fasthash_t* hashtable, bool (*predicate)(const void*,void*), void* data);
@@ -0,0 +1,219 @@
+/*
+ * SurgeScript
+ * A scripting language for games
+ * Copyright 2026 Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * util/slab.c
+ * SurgeScript slab allocator
+ */
+
+#include <string.h>
+#include "slab.h"
+#include "ssarray.h"
+#include "thread.h"
+#include "util.h"
+
+/*#define DISABLE_SLAB*/ /* use plain malloc() & free(); useful with memory debuggers */
+
+/* size classes */
+#define MIN_BLOCK_SIZE      16      /* the size of the smallest class, in bytes */
+#define NUM_SIZE_CLASSES    9       /* 16, 32, 64, ..., 4096 bytes */
+#define MAX_BLOCK_SIZE      (MIN_BLOCK_SIZE << (NUM_SIZE_CLASSES - 1))
+#define CHUNK_SIZE          16384   /* blocks are carved out of chunks of this size */
+
+/* a free block stores the next free block of its size class */
+typedef struct surgescript_slabblock_t surgescript_slabblock_t;
+struct surgescript_slabblock_t
+{
+    surgescript_slabblock_t* next;
+};
+
+/* slab structure */
+struct surgescript_slab_t
+{
+    surgescript_slabblock_t* free_list[NUM_SIZE_CLASSES]; /* free blocks of each size class */
+    SSARRAY(void*, chunk); /* chunks of memory allocated so far */
+    surgescript_mutex_t* mutex; /* locked when the slab is shared by many threads; may be NULL */
+};
+
+static inline int size_class(size_t size);
+static void refill(surgescript_slab_t* slab, int k);
+
+
+/* -------------------------------
+ * public methods
+ * ------------------------------- */
+
+/*
+ * surgescript_slab_create()
+ * Creates a new slab allocator
+ */
+surgescript_slab_t* surgescript_slab_create()
+{
+    surgescript_slab_t* slab = ssmalloc(sizeof *slab);
+
+    for(int k = 0; k < NUM_SIZE_CLASSES; k++)
+        slab->free_list[k] = NULL;
+    ssarray_init(slab->chunk);
+    slab->mutex = NULL;
+
+    return slab;
+}
+
+/*
+ * surgescript_slab_destroy()
+ * Destroys a slab allocator. The blocks it has allocated are released
+ */
+surgescript_slab_t* surgescript_slab_destroy(surgescript_slab_t* slab)
+{
+    for(int i = 0; i < ssarray_length(slab->chunk); i++)
+        ssfree(slab->chunk[i]);
+    ssarray_release(slab->chunk);
+
+    return ssfree(slab);
+}
+
+/*
+ * surgescript_slab_alloc()
+ * Allocates a block of memory of the given size
+ */
+void* surgescript_slab_alloc(surgescript_slab_t* slab, size_t size)
+{
+#ifndef DISABLE_SLAB
+    int k = size_class(size);
+    surgescript_slabblock_t* block;
+
+    /* large block */
+    if(k < 0)
+        return ssmalloc(size);
+
+    /* pick a free block of the size class */
+    if(slab->mutex != NULL)
+        surgescript_mutex_lock(slab->mutex);
+    if(slab->free_list[k] == NULL)
+        refill(slab, k);
+    block = slab->free_list[k];
+    slab->free_list[k] = block->next;
+    if(slab->mutex != NULL)
+        surgescript_mutex_unlock(slab->mutex);
+
+    return block;
+#else
+    return ssmalloc(size);
+#endif
+}
+
+/*
+ * surgescript_slab_realloc()
+ * Resizes a block of memory, preserving its contents
+ */
+void* surgescript_slab_realloc(surgescript_slab_t* slab, void* ptr, size_t old_size, size_t new_size)
+{
+#ifndef DISABLE_SLAB
+    int old_class = size_class(old_size), new_class = size_class(new_size);
+    void* new_ptr;
+
+    /* nothing to do */
+    if(ptr == NULL)
+        return surgescript_slab_alloc(slab, new_size);
+    else if(old_class == new_class && old_class >= 0)
+        return ptr;
+    else if(old_class < 0 && new_class < 0)
+        return ssrealloc(ptr, new_size);
+
+    /* move the block to another size class */
+    new_ptr = surgescript_slab_alloc(slab, new_size);
+    memcpy(new_ptr, ptr, ssmin(old_size, new_size));
+    surgescript_slab_free(slab, ptr, old_size);
+    return new_ptr;
+#else
+    return ssrealloc(ptr, new_size);
+#endif
+}
+
+/*
+ * surgescript_slab_free()
+ * Frees a block of memory, given its size. Returns NULL
+ */
+void* surgescript_slab_free(surgescript_slab_t* slab, void* ptr, size_t size)
+{
+#ifndef DISABLE_SLAB
+    int k = size_class(size);
+
+    if(ptr == NULL)
+        return NULL;
+    else if(k < 0)
+        return ssfree(ptr);
+    else {
+        surgescript_slabblock_t* block = (surgescript_slabblock_t*)ptr;
+        if(slab->mutex != NULL)
+            surgescript_mutex_lock(slab->mutex);
+        block->next = slab->free_list[k];
+        slab->free_list[k] = block;
+        if(slab->mutex != NULL)
+            surgescript_mutex_unlock(slab->mutex);
+        return NULL;
+    }
+#else
+    return ptr != NULL ? ssfree(ptr) : NULL;
+#endif
+}
+
+/*
+ * surgescript_slab_set_mutex()
+ * Makes the slab lock the given mutex whenever it allocates or frees memory,
+ * so that it can be used by many threads. Pass NULL to stop locking
+ */
+void surgescript_slab_set_mutex(surgescript_slab_t* slab, surgescript_mutex_t* mutex)
+{
+    slab->mutex = mutex;
+}
+
+
+
+
+/* -------------------------------
+ * private methods
+ * ------------------------------- */
+
+/* the size class of a block of the given size, or -1 if the block is too large */
+int size_class(size_t size)
+{
+    int k = 0;
+
+    if(size > MAX_BLOCK_SIZE)
+        return -1;
+
+    while((MIN_BLOCK_SIZE << k) < size)
+        k++;
+
+    return k;
+}
+
+/* carves a new chunk into free blocks of size class k */
+void refill(surgescript_slab_t* slab, int k)
+{
+    size_t block_size = MIN_BLOCK_SIZE << k;
+    int block_count = CHUNK_SIZE / block_size;
+    char* chunk = ssmalloc(block_count * block_size);
+
+    for(int i = block_count - 1; i >= 0; i--) {
+        surgescript_slabblock_t* block = (surgescript_slabblock_t*)(chunk + i * block_size);
+        block->next = slab->free_list[k];
+        slab->free_list[k] = block;
+    }
+
+    ssarray_push(slab->chunk, chunk);
+}
@@ -0,0 +1,51 @@
+/*
+ * SurgeScript
+ * A scripting language for games
+ * Copyright 2026 Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * util/slab.h
+ * SurgeScript slab allocator
+ */
+
+#ifndef _SURGESCRIPT_SLAB_H
+#define _SURGESCRIPT_SLAB_H
+
+#include <stddef.h>
+
+/*
+ * A slab allocator hands out small blocks of memory, grouped in size classes
+ * (powers of two). Freed blocks are kept in a free list of their size class,
+ * so that they can be reused without calling malloc() or free(). Since the
+ * size of a block isn't stored, it must be given to the allocator when the
+ * block is freed. Large blocks are delegated to ssmalloc().
+ */
+
+/* slab type */
+typedef struct surgescript_slab_t surgescript_slab_t;
+struct surgescript_mutex_t;
+
+/* create & destroy */
+surgescript_slab_t* surgescript_slab_create(); /* creates a new slab allocator */
+surgescript_slab_t* surgescript_slab_destroy(surgescript_slab_t* slab); /* destroys a slab allocator and all the memory it holds */
+
+/* allocation */
+void* surgescript_slab_alloc(surgescript_slab_t* slab, size_t size); /* allocates a block of memory */
+void* surgescript_slab_realloc(surgescript_slab_t* slab, void* ptr, size_t old_size, size_t new_size); /* resizes a block of memory */
+void* surgescript_slab_free(surgescript_slab_t* slab, void* ptr, size_t size); /* frees a block of memory; returns NULL */
+
+/* sharing */
+void surgescript_slab_set_mutex(surgescript_slab_t* slab, struct surgescript_mutex_t* mutex); /* if not NULL, the mutex is locked whenever memory is allocated or freed */
+
+#endif
@@ -49,6 +49,13 @@
 #define ssarray_push(arr, x)                  \
     (*(((arr##_len >= arr##_cap) ? (arr = ssrealloc(arr, (arr##_cap *= 2) * sizeof(*(arr)))) : arr) + (arr##_len)) = (x), ++arr##_len)
 
+/*
+ * ssarray_reserve()
+ * makes room for at least n elements, without changing the length of the array
+ */
+#define ssarray_reserve(arr, n)               \
+    do { if((size_t)(n) > arr##_cap) { arr##_cap = ssmax((size_t)(n), 2 * arr##_cap); arr = ssrealloc(arr, arr##_cap * sizeof(*(arr))); } } while(0)
+
 /*
  * ssarray_pop()
  * pops the last element from the array, writing its contents to variable dst
@@ -69,6 +76,12 @@
  */
 #define ssarray_length(arr)                   (arr##_len)
 
+/*
+ * ssarray_truncate()
+ * shrinks the array to length n (n <= length), without freeing anything
+ */
+#define ssarray_truncate(arr, n)              (arr##_len = (n))
+
 /*
  * ssarray_reset()
  * sets the length of the array to zero, without freeing anything
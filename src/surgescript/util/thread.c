@@ -0,0 +1,373 @@
+/*
+ * SurgeScript
+ * A scripting language for games
+ * Copyright 2026 Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * util/thread.c
+ * SurgeScript mutexes & thread pool
+ */
+
+#if !defined(_WIN32) && !defined(_XOPEN_SOURCE)
+#define _XOPEN_SOURCE 700 /* recursive mutexes */
+#endif
+
+#include <stdbool.h>
+#include "thread.h"
+#include "util.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <process.h>
+typedef CRITICAL_SECTION native_mutex_t; /* critical sections are recursive */
+typedef CONDITION_VARIABLE native_cond_t;
+typedef HANDLE native_thread_t;
+#else
+#include <pthread.h>
+typedef pthread_mutex_t native_mutex_t;
+typedef pthread_cond_t native_cond_t;
+typedef pthread_t native_thread_t;
+#endif
+
+/* mutex */
+struct surgescript_mutex_t
+{
+    native_mutex_t mutex;
+};
+
+/* a thread of a pool */
+typedef struct surgescript_poolthread_t surgescript_poolthread_t;
+struct surgescript_poolthread_t
+{
+    surgescript_threadpool_t* pool;
+    int index; /* 1, 2, ..., size - 1 */
+    native_thread_t handle;
+};
+
+/* thread pool */
+struct surgescript_threadpool_t
+{
+    int size; /* how many threads run a job, including the caller of run() */
+    surgescript_poolthread_t* thread; /* threads 1, 2, ..., size - 1 */
+    void* data; /* data of start() and stop() */
+    void (*start)(int,void*);
+    void (*stop)(int,void*);
+
+    /* the current job (protected by the mutex) */
+    native_mutex_t mutex;
+    native_cond_t job_posted; /* signaled when a job is posted or when the pool is destroyed */
+    native_cond_t job_done; /* signaled when the last task of a job is done */
+    unsigned job; /* incremented whenever a job is posted */
+    bool quit; /* should the threads end? */
+    void (*task)(int,int,void*);
+    void* task_data;
+    int next_task; /* the first task that hasn't been taken */
+    int num_tasks; /* the number of tasks of the job */
+    int chunk_size; /* how many tasks a thread takes at once */
+    int pending_tasks; /* the number of tasks that aren't done */
+};
+
+/* private stuff */
+#define CHUNKS_PER_THREAD 4 /* the tasks are taken in chunks; smaller chunks balance the load better */
+static void run_tasks(surgescript_threadpool_t* pool, int thread_index);
+static void thread_loop(surgescript_poolthread_t* thread);
+static void init_mutex(native_mutex_t* mutex);
+static void release_mutex(native_mutex_t* mutex);
+static void lock_mutex(native_mutex_t* mutex);
+static void unlock_mutex(native_mutex_t* mutex);
+static void init_cond(native_cond_t* cond);
+static void release_cond(native_cond_t* cond);
+static void wait_cond(native_cond_t* cond, native_mutex_t* mutex);
+static void broadcast_cond(native_cond_t* cond);
+static void create_thread(surgescript_poolthread_t* thread);
+static void join_thread(surgescript_poolthread_t* thread);
+
+
+
+/* -------------------------------
+ * mutexes
+ * ------------------------------- */
+
+/*
+ * surgescript_mutex_create()
+ * Creates a recursive mutex
+ */
+surgescript_mutex_t* surgescript_mutex_create()
+{
+    surgescript_mutex_t* mutex = ssmalloc(sizeof *mutex);
+    init_mutex(&mutex->mutex);
+    return mutex;
+}
+
+/*
+ * surgescript_mutex_destroy()
+ * Destroys a mutex. It must not be locked
+ */
+surgescript_mutex_t* surgescript_mutex_destroy(surgescript_mutex_t* mutex)
+{
+    release_mutex(&mutex->mutex);
+    return ssfree(mutex);
+}
+
+/*
+ * surgescript_mutex_lock()
+ * Locks a mutex, waiting for other threads to unlock it
+ */
+void surgescript_mutex_lock(surgescript_mutex_t* mutex)
+{
+    lock_mutex(&mutex->mutex);
+}
+
+/*
+ * surgescript_mutex_unlock()
+ * Unlocks a mutex
+ */
+void surgescript_mutex_unlock(surgescript_mutex_t* mutex)
+{
+    unlock_mutex(&mutex->mutex);
+}
+
+
+
+/* -------------------------------
+ * thread pool
+ * ------------------------------- */
+
+/*
+ * surgescript_threadpool_create()
+ * Creates a thread pool with size threads, including the thread that calls
+ * surgescript_threadpool_run(). Hence, size - 1 threads are started
+ */
+surgescript_threadpool_t* surgescript_threadpool_create(int size, void* data, void (*start)(int,void*), void (*stop)(int,void*))
+{
+    surgescript_threadpool_t* pool = ssmalloc(sizeof *pool);
+
+    pool->size = ssmax(1, size);
+    pool->data = data;
+    pool->start = start;
+    pool->stop = stop;
+
+    init_mutex(&pool->mutex);
+    init_cond(&pool->job_posted);
+    init_cond(&pool->job_done);
+    pool->job = 0;
+    pool->quit = false;
+    pool->task = NULL;
+    pool->task_data = NULL;
+    pool->next_task = pool->num_tasks = 0;
+    pool->chunk_size = 1;
+    pool->pending_tasks = 0;
+
+    pool->thread = ssmalloc(pool->size * sizeof(*(pool->thread)));
+    for(int i = 1; i < pool->size; i++) {
+        pool->thread[i].pool = pool;
+        pool->thread[i].index = i;
+        create_thread(&(pool->thread[i]));
+    }
+
+    return pool;
+}
+
+/*
+ * surgescript_threadpool_destroy()
+ * Destroys a thread pool, waiting for its threads to end
+ */
+surgescript_threadpool_t* surgescript_threadpool_destroy(surgescript_threadpool_t* pool)
+{
+    lock_mutex(&pool->mutex);
+    pool->quit = true;
+    broadcast_cond(&pool->job_posted);
+    unlock_mutex(&pool->mutex);
+
+    for(int i = 1; i < pool->size; i++)
+        join_thread(&(pool->thread[i]));
+    ssfree(pool->thread);
+
+    release_cond(&pool->job_done);
+    release_cond(&pool->job_posted);
+    release_mutex(&pool->mutex);
+    return ssfree(pool);
+}
+
+/*
+ * surgescript_threadpool_run()
+ * Runs a job: task(task_index, thread_index, data) is called for each task
+ * index in [0, num_tasks), by any thread of the pool. The calling thread takes
+ * tasks as well, and this function returns when all tasks are done
+ */
+void surgescript_threadpool_run(surgescript_threadpool_t* pool, int num_tasks, void* data, void (*task)(int,int,void*))
+{
+    if(num_tasks <= 0)
+        return;
+
+    /* post the job */
+    lock_mutex(&pool->mutex);
+    pool->task = task;
+    pool->task_data = data;
+    pool->next_task = 0;
+    pool->num_tasks = num_tasks;
+    pool->chunk_size = ssmax(1, num_tasks / (pool->size * CHUNKS_PER_THREAD));
+    pool->pending_tasks = num_tasks;
+    pool->job++;
+    broadcast_cond(&pool->job_posted);
+    unlock_mutex(&pool->mutex);
+
+    /* help */
+    run_tasks(pool, 0);
+
+    /* wait for the other threads */
+    lock_mutex(&pool->mutex);
+    while(pool->pending_tasks > 0)
+        wait_cond(&pool->job_done, &pool->mutex);
+    pool->task = NULL;
+    pool->task_data = NULL;
+    unlock_mutex(&pool->mutex);
+}
+
+/*
+ * surgescript_threadpool_size()
+ * The number of threads of the pool, including the caller of run()
+ */
+int surgescript_threadpool_size(const surgescript_threadpool_t* pool)
+{
+    return pool->size;
+}
+
+
+
+/* -------------------------------
+ * private methods
+ * ------------------------------- */
+
+/* takes chunks of tasks of the current job until there are no more */
+void run_tasks(surgescript_threadpool_t* pool, int thread_index)
+{
+    lock_mutex(&pool->mutex);
+    while(pool->next_task < pool->num_tasks) {
+        void (*task)(int,int,void*) = pool->task;
+        void* data = pool->task_data;
+        int first = pool->next_task;
+        int last = ssmin(first + pool->chunk_size, pool->num_tasks);
+        pool->next_task = last;
+        unlock_mutex(&pool->mutex);
+
+        for(int i = first; i < last; i++)
+            task(i, thread_index, data);
+
+        lock_mutex(&pool->mutex);
+        pool->pending_tasks -= last - first;
+        if(pool->pending_tasks == 0)
+            broadcast_cond(&pool->job_done);
+    }
+    unlock_mutex(&pool->mutex);
+}
+
+/* the main loop of a thread of the pool */
+void thread_loop(surgescript_poolthread_t* thread)
+{
+    surgescript_threadpool_t* pool = thread->pool;
+    unsigned job = 0;
+
+    if(pool->start != NULL)
+        pool->start(thread->index, pool->data);
+
+    for(;;) {
+        /* wait for a new job */
+        lock_mutex(&pool->mutex);
+        while(!pool->quit && pool->job == job)
+            wait_cond(&pool->job_posted, &pool->mutex);
+        if(pool->quit) {
+            unlock_mutex(&pool->mutex);
+            break;
+        }
+        job = pool->job;
+        unlock_mutex(&pool->mutex);
+
+        /* work */
+        run_tasks(pool, thread->index);
+    }
+
+    if(pool->stop != NULL)
+        pool->stop(thread->index, pool->data);
+}
+
+#if defined(_WIN32)
+
+/* entry point of the threads */
+static unsigned __stdcall thread_main(void* thread)
+{
+    thread_loop((surgescript_poolthread_t*)thread);
+    return 0;
+}
+
+void init_mutex(native_mutex_t* mutex) { InitializeCriticalSection(mutex); }
+void release_mutex(native_mutex_t* mutex) { DeleteCriticalSection(mutex); }
+void lock_mutex(native_mutex_t* mutex) { EnterCriticalSection(mutex); }
+void unlock_mutex(native_mutex_t* mutex) { LeaveCriticalSection(mutex); }
+void init_cond(native_cond_t* cond) { InitializeConditionVariable(cond); }
+void release_cond(native_cond_t* cond) { ; }
+void wait_cond(native_cond_t* cond, native_mutex_t* mutex) { SleepConditionVariableCS(cond, mutex, INFINITE); }
+void broadcast_cond(native_cond_t* cond) { WakeAllConditionVariable(cond); }
+
+void create_thread(surgescript_poolthread_t* thread)
+{
+    thread->handle = (HANDLE)_beginthreadex(NULL, 0, thread_main, thread, 0, NULL);
+    if(thread->handle == 0)
+        ssfatal("Can't create a thread.");
+}
+
+void join_thread(surgescript_poolthread_t* thread)
+{
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+}
+
+#else
+
+/* entry point of the threads */
+static void* thread_main(void* thread)
+{
+    thread_loop((surgescript_poolthread_t*)thread);
+    return NULL;
+}
+
+void init_mutex(native_mutex_t* mutex)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+void release_mutex(native_mutex_t* mutex) { pthread_mutex_destroy(mutex); }
+void lock_mutex(native_mutex_t* mutex) { pthread_mutex_lock(mutex); }
+void unlock_mutex(native_mutex_t* mutex) { pthread_mutex_unlock(mutex); }
+void init_cond(native_cond_t* cond) { pthread_cond_init(cond, NULL); }
+void release_cond(native_cond_t* cond) { pthread_cond_destroy(cond); }
+void wait_cond(native_cond_t* cond, native_mutex_t* mutex) { pthread_cond_wait(cond, mutex); }
+void broadcast_cond(native_cond_t* cond) { pthread_cond_broadcast(cond); }
+
+void create_thread(surgescript_poolthread_t* thread)
+{
+    if(pthread_create(&thread->handle, NULL, thread_main, thread) != 0)
+        ssfatal("Can't create a thread.");
+}
+
+void join_thread(surgescript_poolthread_t* thread)
+{
+    pthread_join(thread->handle, NULL);
+}
+
+#endif
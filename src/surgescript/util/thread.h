@@ -0,0 +1,48 @@
+/*
+ * SurgeScript
+ * A scripting language for games
+ * Copyright 2026 Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * util/thread.h
+ * SurgeScript mutexes & thread pool
+ */
+
+#ifndef _SURGESCRIPT_THREAD_H
+#define _SURGESCRIPT_THREAD_H
+
+/* types */
+typedef struct surgescript_mutex_t surgescript_mutex_t;
+typedef struct surgescript_threadpool_t surgescript_threadpool_t;
+
+/* mutexes are recursive: the thread that holds a mutex may lock it again */
+surgescript_mutex_t* surgescript_mutex_create(); /* creates a mutex */
+surgescript_mutex_t* surgescript_mutex_destroy(surgescript_mutex_t* mutex); /* destroys a mutex */
+void surgescript_mutex_lock(surgescript_mutex_t* mutex); /* locks a mutex */
+void surgescript_mutex_unlock(surgescript_mutex_t* mutex); /* unlocks a mutex */
+
+/*
+ * A thread pool runs the tasks of a job on a fixed set of threads. The thread
+ * that calls surgescript_threadpool_run() takes part in the job as thread 0;
+ * the other threads are numbered 1, 2, ..., size - 1. Idle threads take the
+ * next tasks of the job, so that threads given short tasks aren't left idle.
+ * start() and stop(), if not NULL, are called on threads 1, 2, ..., size - 1
+ * when they begin and before they end
+ */
+surgescript_threadpool_t* surgescript_threadpool_create(int size, void* data, void (*start)(int,void*), void (*stop)(int,void*)); /* creates a pool with size threads, including the caller of run() */
+surgescript_threadpool_t* surgescript_threadpool_destroy(surgescript_threadpool_t* pool); /* waits for the threads to end */
+void surgescript_threadpool_run(surgescript_threadpool_t* pool, int num_tasks, void* data, void (*task)(int,int,void*)); /* calls task(task_index, thread_index, data) for each task and waits for all of them */
+int surgescript_threadpool_size(const surgescript_threadpool_t* pool); /* the number of threads of the pool, including the caller of run() */
+
+#endif
@@ -30,7 +30,7 @@
 /* utilities */
 static const float DEG2RAD = 0.01745329251f;
 static const float RAD2DEG = 57.2957795131f;
-static surgescript_transform_t identity = {
+static const surgescript_transform_t identity = {
     .position = { .x = 0.0f, .y = 0.0f, .z = 0.0f },
     .rotation = { .x = 0.0f, .y = 0.0f, .z = 0.0f },
     .scale    = { .x = 1.0f, .y = 1.0f, .z = 1.0f },
@@ -39,7 +39,7 @@ static surgescript_transform_t identity = {
         .cx = 1.0f, .cy = 1.0f, .cz = 1.0f
     }
 };
-static float y_axis = 1.0f;
+static SS_THREADLOCAL float y_axis = 1.0f;
 static void world2local(surgescript_objectmanager_t* manager, surgescript_objecthandle_t handle, surgescript_objecthandle_t root, float* x, float* y);
 
 /*
@@ -87,7 +87,7 @@ void surgescript_transform_util_up2d(const struct surgescript_object_t* object,
 void surgescript_transform_util_lossyscale2d(const struct surgescript_object_t* object, float* x, float* y); /* an approximation of the 2D world scale */
 
 /* global settings */
-void surgescript_transform_use_inverted_y(bool inverted); /* set it to true if your y-axis grows downwards */
+void surgescript_transform_use_inverted_y(bool inverted); /* set it to true if your y-axis grows downwards (applies to the calling thread) */
 bool surgescript_transform_is_using_inverted_y(); /* defaults to false (i.e., y-axis grows upwards) */
 
 #endif
\ No newline at end of file
@@ -25,6 +25,7 @@
 #include <string.h>
 #include <ctype.h>
 #include <time.h>
+#include <locale.h>
 #include "util.h"
 
 #if defined(_WIN32)
@@ -38,7 +39,7 @@
 static void mem_crash(const char* location);
 static void my_log(const char* message);
 static void my_fatal(const char* message);
-static void (*log_function)(const char* message) = my_log;
+static void (*log_function)(const char* message) = my_log; /* process-wide; set once */
 static void (*fatal_function)(const char* message) = my_fatal;
 
 
@@ -191,7 +192,9 @@ const char* surgescript_util_authors()
 
 /*
  * surgescript_util_set_error_functions()
- * Customize the error messages
+ * Customize the error messages. The error functions are shared by all
+ * threads: set them once, before creating any VM, and don't change them
+ * while a VM is running on another thread
  */
 void surgescript_util_set_error_functions(void (*log)(const char*), void (*fatal)(const char*))
 {
@@ -216,6 +219,39 @@ char* surgescript_util_strncpy(char* dst, const char* src, size_t n)
     return p;
 }
 
+/*
+ * surgescript_util_strtod()
+ * Converts a string to a number like strtod(), except that the decimal
+ * separator is always '.', regardless of the locale of the host
+ */
+double surgescript_util_strtod(const char* str, char** endptr)
+{
+    const char* point = localeconv()->decimal_point; /* SurgeScript never calls setlocale() */
+    const char* dot = strchr(str, '.');
+
+    if(dot != NULL && strcmp(point, ".") != 0) {
+        /* replace the first '.' by the decimal separator of the locale */
+        size_t prefix = dot - str, point_length = strlen(point);
+        size_t size = prefix + point_length + strlen(dot + 1) + 1;
+        char tmp[64], *buf = size <= sizeof(tmp) ? tmp : ssmalloc(size), *end;
+        double number;
+
+        memcpy(buf, str, prefix);
+        memcpy(buf + prefix, point, point_length);
+        strcpy(buf + prefix + point_length, dot + 1);
+        number = strtod(buf, &end);
+
+        if(endptr != NULL)
+            *endptr = (char*)str + ((size_t)(end - buf) <= prefix ? (size_t)(end - buf) : (size_t)(end - buf) - point_length + 1);
+        if(buf != tmp)
+            ssfree(buf);
+
+        return number;
+    }
+
+    return strtod(str, endptr);
+}
+
 /*
  * surgescript_util_strdup()
  * Copies a string into another, allocating the required memory
@@ -294,6 +330,25 @@ uint64_t surgescript_util_gettickcount()
 #endif
 }
 
+/*
+ * surgescript_util_getmicroseconds()
+ * Returns the number of microseconds since some arbitrary zero
+ * This is a system-specific routine
+ */
+uint64_t surgescript_util_getmicroseconds()
+{
+#ifndef _WIN32
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return ((uint64_t)now.tv_sec * 1000000) + (uint64_t)now.tv_usec;
+#else
+    LARGE_INTEGER frequency, now;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&now);
+    return (uint64_t)((now.QuadPart / frequency.QuadPart) * 1000000 + ((now.QuadPart % frequency.QuadPart) * 1000000) / frequency.QuadPart);
+#endif
+}
+
 /*
  * surgescript_util_srand()
  * Sets the seed of the pseudo-random number generator
@@ -301,13 +356,15 @@ uint64_t surgescript_util_gettickcount()
 void surgescript_util_srand(uint64_t seed)
 {
     /* using splitmix64 to seed the generator */
-    extern uint64_t* xor_seed;
+    extern void (*xor_seed)(const uint64_t*);
+    uint64_t state[2];
     for(int i = 0; i <= 1; i++) {
         uint64_t x = (seed += UINT64_C(0x9e3779b97f4a7c15));
         x = (x ^ (x >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
         x = (x ^ (x >> 27)) * UINT64_C(0x94d049bb133111eb);
-        xor_seed[i] = x ^ (x >> 31);
+        state[i] = x ^ (x >> 31);
     }
+    xor_seed(state);
 }
 
 /*
@@ -380,7 +437,7 @@ void my_fatal(const char* message)
 
 void mem_crash(const char* location) /* out of memory error */
 {
-    static char buf[128] = "Out of memory in ";
+    char buf[128] = "Out of memory in ";
     surgescript_util_strncpy(buf + 17, location, sizeof(buf) - 17);
     fatal_function(buf);
     exit(1); /* just in case */
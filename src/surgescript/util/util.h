@@ -43,6 +43,36 @@
 #define ssfatal                     surgescript_util_fatal
 #define ssstrdup(str)               surgescript_util_strdup((str), __FILE__ ":" ssstr(__LINE__))
 
+/* thread-local storage */
+#if defined(_MSC_VER)
+#define SS_THREADLOCAL              __declspec(thread)
+#elif defined(__GNUC__) || defined(__clang__)
+#define SS_THREADLOCAL              __thread
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_THREADS__)
+#define SS_THREADLOCAL              _Thread_local
+#else
+#define SS_THREADLOCAL              /* single-threaded */
+#endif
+
+/* atomic operations (objects may be updated in parallel) */
+#if defined(__GNUC__) || defined(__clang__)
+#define ssatomic_increment(ptr)     __atomic_add_fetch((ptr), 1, __ATOMIC_RELAXED)
+#define ssatomic_decrement(ptr)     __atomic_sub_fetch((ptr), 1, __ATOMIC_ACQ_REL)
+#define ssatomic_load(ptr)          __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define ssatomic_store(ptr, value)  __atomic_store_n((ptr), (value), __ATOMIC_RELEASE)
+#elif defined(_MSC_VER)
+#include <intrin.h>
+#define ssatomic_increment(ptr)     ((unsigned)_InterlockedIncrement((volatile long*)(ptr)))
+#define ssatomic_decrement(ptr)     ((unsigned)_InterlockedDecrement((volatile long*)(ptr)))
+#define ssatomic_load(ptr)          (_ReadWriteBarrier(), *(ptr)) /* aligned loads & stores are atomic on x86 */
+#define ssatomic_store(ptr, value)  (_ReadWriteBarrier(), *(ptr) = (value))
+#else
+#define ssatomic_increment(ptr)     (++*(ptr)) /* single-threaded */
+#define ssatomic_decrement(ptr)     (--*(ptr))
+#define ssatomic_load(ptr)          (*(ptr))
+#define ssatomic_store(ptr, value)  (*(ptr) = (value))
+#endif
+
 /* constants */
 #define SS_NAMEMAX                  63 /* names can't be larger than this (computes hashes quickly) */
 
@@ -59,9 +89,10 @@ void* surgescript_util_free(void* ptr); /* memory deallocation */
 
 void surgescript_util_log(const char* fmt, ...); /* logs a message */
 void surgescript_util_fatal(const char* fmt, ...); /* logs a message and kills the app */
-void surgescript_util_set_error_functions(void (*log)(const char*), void (*fatal)(const char*)); /* set custom error functions */
+void surgescript_util_set_error_functions(void (*log)(const char*), void (*fatal)(const char*)); /* set custom error functions (process-wide: set them once, before creating any VM) */
 
 char* surgescript_util_strncpy(char* dst, const char* src, size_t n); /* strcpy */
+double surgescript_util_strtod(const char* str, char** endptr); /* strtod() that always uses '.' as the decimal separator */
 char* surgescript_util_strdup(const char* src, const char* location); /* strdup */
 const char* surgescript_util_basename(const char* path); /* basename */
 char* surgescript_util_accessorfun(const char* prefix, const char* text); /* getter/setter prefixing function */
@@ -69,8 +100,9 @@ char* surgescript_util_accessorfun(const char* prefix, const char* text); /* get
 unsigned surgescript_util_htob(unsigned x); /* host to big-endian */
 unsigned surgescript_util_btoh(unsigned x); /* big to host-endian */
 uint64_t surgescript_util_gettickcount(); /* number of milliseconds since some arbitrary zero */
+uint64_t surgescript_util_getmicroseconds(); /* number of microseconds since some arbitrary zero */
 
-void surgescript_util_srand(uint64_t seed); /* sets the seed of the pseudo-random number generator */
+void surgescript_util_srand(uint64_t seed); /* sets the seed of the pseudo-random number generator of the calling thread */
 uint64_t surgescript_util_random64(); /* generates a pseudo-random 64-bit unsigned integer */
 double surgescript_util_random(); /* generates a pseudo-random double in the [0,1) range */
 
@@ -7,6 +7,7 @@ worldwide. This software is distributed without any warranty.
 See <http://creativecommons.org/publicdomain/zero/1.0/>. */
 
 #include <stdint.h>
+#include "util.h"
 
 /* This is xoroshiro128+ 1.0, our best and fastest small-state generator
    for floating-point numbers. We suggest to use its upper bits for
@@ -36,7 +37,7 @@ static inline uint64_t rotl(const uint64_t x, int k) {
 }
 
 
-static uint64_t s[2];
+static SS_THREADLOCAL uint64_t s[2];
 
 
 uint64_t next(void) {
@@ -98,5 +99,10 @@ void long_jump(void) {
 	s[1] = s1;
 }
 
-uint64_t* xor_seed = s;
+static void seed(const uint64_t* state) {
+	s[0] = state[0];
+	s[1] = state[1];
+}
+
+void (*xor_seed)(const uint64_t*) = seed;
 uint64_t (*xor_next)(void) = next;
\ No newline at end of file